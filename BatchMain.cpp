@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "BrickAccessBatch.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+  int Usage(char const* arg0)
+  {
+    cerr << "usage: " << GetFilename(arg0) << " [--threads n] [--flat|--arena] [--dir directory]... [filename...]" << endl;
+    return EXIT_FAILURE;
+  }
+
+}
+
+// Loads many brick access files concurrently, e.g. all traces of a nightly
+// run. Prints one comma separated line per file, errors included, and the
+// total throughput.
+int main(int argc, char const *argv[])
+{
+  typedef std::chrono::steady_clock Clock;
+
+  BrickAccessBatch batch;
+  size_t threadCount = 0;
+  for (int argi = 1; argi < argc; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--threads" && argi + 1 < argc) {
+      threadCount = size_t(atoi(argv[++argi]));
+    } else if (flag == "--flat") {
+      batch.SetStorage(BrickAccessFile::ST_FLAT);
+    } else if (flag == "--arena") {
+      batch.SetStorage(BrickAccessFile::ST_ARENA);
+    } else if (flag == "--dir" && argi + 1 < argc) {
+      if (!batch.AddDirectory(argv[++argi]))
+        return EXIT_FAILURE;
+    } else if (flag.compare(0, 2, "--") == 0) {
+      return Usage(argv[0]);
+    } else {
+      batch.AddFile(flag);
+    }
+  }
+  if (batch.GetFileCount() == 0)
+    return Usage(argv[0]);
+
+  Clock::time_point const start = Clock::now();
+  bool const bSuccess = batch.Load(threadCount);
+  double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  uint64_t totalBytes = 0;
+  size_t failedCount = 0;
+  cout << "file,dataset,frames,subframes,bricks,bytes,seconds,error" << endl;
+  for (size_t i=0; i<batch.GetFileCount(); ++i) {
+    BrickAccessBatch::Result const& result = batch.GetResult(i);
+    totalBytes += result.fileSize;
+    if (!result.success) {
+      ++failedCount;
+      cout << result.filename << ",,,,," << result.fileSize << "," << result.seconds << ","
+        << result.error << endl;
+      continue;
+    }
+    size_t frameCount = result.trace.GetFrameCount();
+    size_t subframeCount = result.trace.GetTotalSubframeCount();
+    uint64_t brickCount = result.trace.GetTotalBrickCount();
+    if (result.arena.GetFrameCount() > 0) {
+      frameCount = result.arena.GetFrameCount();
+      subframeCount = result.arena.GetTotalSubframeCount();
+      brickCount = result.arena.GetTotalBrickCount();
+    } else if (!result.frames.empty()) {
+      frameCount = result.frames.size();
+      subframeCount = 0;
+      brickCount = 0;
+      for (auto frame=result.frames.cbegin(); frame!=result.frames.cend(); ++frame) {
+        subframeCount += frame->size();
+        for (auto subframe=frame->cbegin(); subframe!=frame->cend(); ++subframe)
+          brickCount += subframe->size();
+      }
+    }
+    cout << result.filename << "," << result.dataset << "," << frameCount << "," << subframeCount << ","
+      << brickCount << "," << result.fileSize << "," << result.seconds << "," << endl;
+  }
+
+  cerr << "loaded files:   " << batch.GetFileCount() - failedCount << " of " << batch.GetFileCount() << endl;
+  cerr << "datasets:       " << batch.GetDatasetCount() << endl;
+  cerr << "total bytes:    " << totalBytes << endl;
+  cerr << "wall seconds:   " << seconds << endl;
+  cerr << "MB/s:           " << (seconds > 0.0 ? double(totalBytes) / seconds / 1e6 : 0.0) << endl;
+  return bSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BrickAccessArena.h"
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessFile.h"
+#include "BrickAccessParser.h"
+#include "BrickAccessTrace.h"
+#include "BrickAccessWriter.h"
+#include "BrickSet.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+// Every allocation of the process is counted, so the benchmark reports how
+// many allocations a case makes in addition to its run time.
+namespace {
+
+  std::atomic<uint64_t> s_iAllocations(0);
+  std::atomic<uint64_t> s_iAllocatedBytes(0);
+
+  // Receives the checksums of the iteration cases, which keeps the compiler
+  // from dropping the loops.
+  volatile uint64_t s_iChecksum = 0;
+
+  void* Allocate(size_t size)
+  {
+    s_iAllocations.fetch_add(1, std::memory_order_relaxed);
+    s_iAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+  }
+
+}
+
+void* operator new(size_t size)
+{
+  void* const p = Allocate(size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t size, std::nothrow_t const&) throw()
+{
+  return Allocate(size);
+}
+
+void operator delete(void* p) throw()
+{
+  free(p);
+}
+
+void operator delete(void* p, std::nothrow_t const&) throw()
+{
+  free(p);
+}
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+  int Usage(char const* arg0)
+  {
+    cerr << "usage: " << GetFilename(arg0) << " [--repeat n] [--threads n] [--case name]... filename..." << endl;
+    cerr << "cases: header, load-stream, load-mapped, load-parallel, load-flat-stream," << endl;
+    cerr << "       load-flat-mapped, load-flat-parallel, load-arena-stream, load-arena-mapped," << endl;
+    cerr << "       load-arena-parallel, iterate-frames, iterate-flat, format, frame-sets" << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Restarts the peak memory measurement if the platform allows it, otherwise
+  // the peak of the whole process is reported.
+  void ResetPeakMemory()
+  {
+#ifdef __linux__
+    // writing 5 resets the peak resident set size (VmHWM), since Linux 4.0
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5" << endl;
+#endif
+  }
+
+  // @returns the peak resident set size in bytes.
+  uint64_t GetPeakMemory()
+  {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+      return 0;
+    return uint64_t(counters.PeakWorkingSetSize);
+#else
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+      if (line.compare(0, 6, "VmHWM:") == 0)
+        return strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+#ifdef __APPLE__
+    return uint64_t(usage.ru_maxrss);
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+  }
+
+  // Measurements of one run of a case.
+  struct Sample {
+    double seconds;
+    uint64_t bytes;
+    uint64_t bricks;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t peakMemory;
+    bool bSuccess;
+  };
+
+  // Runs a case and measures time, allocations and peak memory. The case
+  // reports the number of bytes and bricks it processed.
+  template<class Case>
+  Sample Measure(Case const& run)
+  {
+    Sample sample = { 0.0, 0, 0, 0, 0, 0, false };
+    ResetPeakMemory();
+    uint64_t const allocations = s_iAllocations.load();
+    uint64_t const allocatedBytes = s_iAllocatedBytes.load();
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+    sample.bSuccess = run(sample.bytes, sample.bricks);
+    sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sample.allocations = s_iAllocations.load() - allocations;
+    sample.allocatedBytes = s_iAllocatedBytes.load() - allocatedBytes;
+    sample.peakMemory = GetPeakMemory();
+    return sample;
+  }
+
+  // Parses the header of a file without any frame data.
+  bool ParseHeader(string const& filename, uint64_t& bytes, uint64_t& bricks)
+  {
+    MappedFile file;
+    if (!file.Open(filename)) return false;
+
+    BrickAccessFile::Header header;
+    std::vector<BrickAccessFile::Frame> frames;
+    FrameBuilder builder(frames);
+    BrickAccessParser<FrameBuilder> parser(header, builder);
+    char const* body = file.GetData();
+    if (!parser.ParseHeader(body, file.GetData() + file.GetSize())) return false;
+    bytes = uint64_t(body - file.GetData());
+    bricks = 0;
+    return true;
+  }
+
+  // Counts all bricks of the loaded frames like the loop in SampleMain.cpp.
+  uint64_t IterateFrames(BrickAccessFile const& baf, uint64_t& checksum)
+  {
+    uint64_t totalBrickCount = 0;
+    for (auto frame=baf.GetFrames().cbegin(); frame!=baf.GetFrames().cend(); ++frame) {
+      for (auto subframe=frame->cbegin(); subframe!=frame->cend(); ++subframe) {
+        for (auto brick=subframe->cbegin(); brick!=subframe->cend(); ++brick) {
+          checksum += brick->x + brick->y + brick->z + brick->w;
+          ++totalBrickCount;
+        }
+      }
+    }
+    return totalBrickCount;
+  }
+
+  // Formats all loaded frames like BrickAccessWriter does, one frame at a
+  // time into a reused buffer, without writing anything.
+  // @returns the number of formatted bricks.
+  uint64_t FormatFrames(BrickAccessFile const& baf, uint64_t& bytes, uint64_t& checksum)
+  {
+    std::vector<BrickAccessFile::Frame> const& frames = baf.GetFrames();
+    std::string text;
+    BrickAccessWriter::FormatHeader(baf.GetHeader(), text);
+    bytes = text.size();
+    uint64_t totalBrickCount = 0;
+    for (size_t f=0; f<frames.size(); ++f) {
+      text.clear();
+      BrickAccessWriter::FormatFrame(f, frames[f], text);
+      bytes += text.size();
+      checksum += uint8_t(text[text.size() / 2]);
+      for (size_t s=0; s<frames[f].size(); ++s)
+        totalBrickCount += frames[f][s].size();
+    }
+    return totalBrickCount;
+  }
+
+  // Visits all keys of the flat trace frame by frame.
+  uint64_t IterateTrace(BrickAccessTrace const& trace, uint64_t& checksum)
+  {
+    uint64_t totalBrickCount = 0;
+    for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+      BrickAccessTrace::Bricks const keys = trace.GetFrame(f);
+      for (size_t i=0; i<keys.size(); ++i)
+        checksum += keys[i];
+      totalBrickCount += keys.size();
+    }
+    return totalBrickCount;
+  }
+
+  // Builds the set of distinct bricks of every frame.
+  // @returns the memory used by the sets.
+  uint64_t AssignFrameSets(BrickAccessTrace const& trace, std::vector<BrickSet>& sets)
+  {
+    sets.reserve(trace.GetFrameCount());
+    uint64_t bytes = 0;
+    for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+      BrickSet set;
+      set.AssignFrame(trace, f);
+      bytes += set.GetMemoryUsage();
+      sets.push_back(std::move(set));
+    }
+    return bytes;
+  }
+
+  // Computes the bricks every frame adds to and drops from the previous one
+  // with the prepared sets of all frames.
+  // @returns the number of keys of all compared sets.
+  uint64_t CompareFrameSets(std::vector<BrickSet> const& sets, uint64_t& checksum)
+  {
+    uint64_t keyCount = 0;
+    BrickSet added, dropped;
+    for (size_t f=1; f<sets.size(); ++f) {
+      BrickSet::Difference(sets[f], sets[f - 1], added);
+      BrickSet::Difference(sets[f - 1], sets[f], dropped);
+      checksum += added.GetCardinality() + dropped.GetCardinality() +
+        BrickSet::GetIntersectionCardinality(sets[f], sets[f - 1]);
+      keyCount += 2 * (sets[f].GetCardinality() + sets[f - 1].GetCardinality());
+    }
+    return keyCount;
+  }
+
+  struct LoadCase {
+    char const* name;
+    BrickAccessFile::LoadMode mode;
+    BrickAccessFile::Storage storage;
+  };
+
+  LoadCase const LoadCases[] = {
+    { "load-stream", BrickAccessFile::LM_STREAM, BrickAccessFile::ST_FRAMES },
+    { "load-mapped", BrickAccessFile::LM_MAPPED, BrickAccessFile::ST_FRAMES },
+    { "load-parallel", BrickAccessFile::LM_PARALLEL, BrickAccessFile::ST_FRAMES },
+    { "load-flat-stream", BrickAccessFile::LM_STREAM, BrickAccessFile::ST_FLAT },
+    { "load-flat-mapped", BrickAccessFile::LM_MAPPED, BrickAccessFile::ST_FLAT },
+    { "load-flat-parallel", BrickAccessFile::LM_PARALLEL, BrickAccessFile::ST_FLAT },
+    { "load-arena-stream", BrickAccessFile::LM_STREAM, BrickAccessFile::ST_ARENA },
+    { "load-arena-mapped", BrickAccessFile::LM_MAPPED, BrickAccessFile::ST_ARENA },
+    { "load-arena-parallel", BrickAccessFile::LM_PARALLEL, BrickAccessFile::ST_ARENA }
+  };
+
+  uint64_t GetBrickCount(BrickAccessFile const& baf)
+  {
+    if (baf.GetStorage() == BrickAccessFile::ST_FLAT)
+      return baf.GetTrace().GetTotalBrickCount();
+    if (baf.GetStorage() == BrickAccessFile::ST_ARENA)
+      return baf.GetArena().GetTotalBrickCount();
+    uint64_t count = 0;
+    std::vector<BrickAccessFile::Frame> const& frames = baf.GetFrames();
+    for (size_t f=0; f<frames.size(); ++f) {
+      for (size_t s=0; s<frames[f].size(); ++s)
+        count += frames[f][s].size();
+    }
+    return count;
+  }
+
+  // Benchmarks the selected cases on one file and prints the fastest of all
+  // repetitions of every case.
+  bool RunFile(string const& filename, std::vector<string> const& cases,
+    size_t repeat, size_t threadCount)
+  {
+    // the cases measure parsing, binary files have nothing to parse
+    if (BrickAccessBinaryFile::IsBinaryFile(filename)) {
+      cerr << "failed to benchmark file " << filename << ": binary files are not parsed" << endl;
+      return false;
+    }
+    bool bSuccess = true;
+    auto const selected = [&cases](char const* name) {
+      return cases.empty() || std::find(cases.begin(), cases.end(), string(name)) != cases.end();
+    };
+    auto const report = [&filename, &bSuccess](char const* name, std::vector<Sample> const& samples) {
+      Sample best = samples[0];
+      for (size_t i=1; i<samples.size(); ++i) {
+        if (samples[i].seconds < best.seconds)
+          best = samples[i];
+        best.peakMemory = std::max(best.peakMemory, samples[i].peakMemory);
+        best.bSuccess = best.bSuccess && samples[i].bSuccess;
+      }
+      if (!best.bSuccess) {
+        cerr << "failed to run " << name << " on " << filename << endl;
+        bSuccess = false;
+        return;
+      }
+      double const seconds = std::max(best.seconds, 1e-9);
+      cout << filename << "," << name << "," << samples.size() << ","
+        << best.seconds << "," << best.bytes << "," << best.bricks << ","
+        << double(best.bytes) / seconds / 1e6 << "," << double(best.bricks) / seconds << ","
+        << best.allocations << "," << best.allocatedBytes << "," << best.peakMemory << endl;
+    };
+
+    if (selected("header")) {
+      std::vector<Sample> samples;
+      for (size_t r=0; r<repeat; ++r)
+        samples.push_back(Measure([&filename](uint64_t& bytes, uint64_t& bricks) {
+          return ParseHeader(filename, bytes, bricks);
+        }));
+      report("header", samples);
+    }
+
+    uint64_t fileSize = 0;
+    {
+      MappedFile file;
+      if (!file.Open(filename)) {
+        cerr << "failed to open file " << filename << endl;
+        return false;
+      }
+      fileSize = file.GetSize();
+    }
+
+    for (size_t c=0; c<sizeof(LoadCases)/sizeof(LoadCases[0]); ++c) {
+      LoadCase const& loadCase = LoadCases[c];
+      if (!selected(loadCase.name))
+        continue;
+      std::vector<Sample> samples;
+      for (size_t r=0; r<repeat; ++r) {
+        // only Load() is timed, the frames are counted and released afterwards
+        BrickAccessFile baf(filename);
+        baf.SetStorage(loadCase.storage);
+        samples.push_back(Measure([&](uint64_t& bytes, uint64_t&) {
+          bytes = fileSize;
+          return baf.Load(loadCase.mode, threadCount);
+        }));
+        samples.back().bricks = GetBrickCount(baf);
+      }
+      report(loadCase.name, samples);
+    }
+
+    uint64_t checksum = 0;
+    if (selected("iterate-frames")) {
+      BrickAccessFile baf(filename);
+      if (!baf.Load(BrickAccessFile::LM_PARALLEL, threadCount)) return false;
+      std::vector<Sample> samples;
+      for (size_t r=0; r<repeat; ++r)
+        samples.push_back(Measure([&](uint64_t& bytes, uint64_t& bricks) {
+          bricks = IterateFrames(baf, checksum);
+          bytes = bricks * sizeof(BrickAccessFile::Brick);
+          return true;
+        }));
+      report("iterate-frames", samples);
+    }
+
+    if (selected("iterate-flat")) {
+      BrickAccessFile baf(filename);
+      baf.SetStorage(BrickAccessFile::ST_FLAT);
+      if (!baf.Load(BrickAccessFile::LM_PARALLEL, threadCount)) return false;
+      std::vector<Sample> samples;
+      for (size_t r=0; r<repeat; ++r)
+        samples.push_back(Measure([&](uint64_t& bytes, uint64_t& bricks) {
+          bricks = IterateTrace(baf.GetTrace(), checksum);
+          bytes = bricks * sizeof(BrickAccessTrace::Key);
+          return true;
+        }));
+      report("iterate-flat", samples);
+    }
+
+    if (selected("format")) {
+      BrickAccessFile baf(filename);
+      if (!baf.Load(BrickAccessFile::LM_PARALLEL, threadCount)) return false;
+      std::vector<Sample> samples;
+      for (size_t r=0; r<repeat; ++r)
+        samples.push_back(Measure([&](uint64_t& bytes, uint64_t& bricks) {
+          bricks = FormatFrames(baf, bytes, checksum);
+          return true;
+        }));
+      report("format", samples);
+    }
+
+    if (selected("frame-sets")) {
+      BrickAccessFile baf(filename);
+      baf.SetStorage(BrickAccessFile::ST_FLAT);
+      if (!baf.Load(BrickAccessFile::LM_PARALLEL, threadCount)) return false;
+      std::vector<BrickSet> sets;
+      uint64_t const setBytes = AssignFrameSets(baf.GetTrace(), sets);
+      std::vector<Sample> samples;
+      for (size_t r=0; r<repeat; ++r)
+        samples.push_back(Measure([&](uint64_t& bytes, uint64_t& bricks) {
+          bricks = CompareFrameSets(sets, checksum);
+          bytes = setBytes;
+          return true;
+        }));
+      report("frame-sets", samples);
+    }
+    s_iChecksum = checksum;
+    return bSuccess;
+  }
+
+}
+
+// Measures the throughput of header parsing, loading and iterating brick
+// access files in all load modes and storages. The output is comma separated
+// with one line per file and case. bytes are the file bytes for loads, the
+// header bytes for header parsing, the brick memory for iteration, the text
+// bytes for formatting and the memory of the frame sets for set operations. Time and allocations are taken
+// from the fastest repetition, peak memory is the largest of all repetitions.
+int main(int argc, char const *argv[])
+{
+  size_t repeat = 3;
+  size_t threadCount = 0;
+  std::vector<string> cases;
+  int argi = 1;
+  for (; argi < argc; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--repeat" && argi+1 < argc) {
+      repeat = std::max<size_t>(size_t(atoi(argv[++argi])), 1);
+    } else if (flag == "--threads" && argi+1 < argc) {
+      threadCount = size_t(atoi(argv[++argi]));
+    } else if (flag == "--case" && argi+1 < argc) {
+      cases.push_back(argv[++argi]);
+    } else {
+      break;
+    }
+  }
+  if (argi == argc) {
+    return Usage(argv[0]);
+  }
+
+  cout << "file,case,repeat,seconds,bytes,bricks,MB/s,bricks/s,allocations,allocated bytes,peak rss" << endl;
+  bool bSuccess = true;
+  for (; argi < argc; ++argi) {
+    if (!RunFile(argv[argi], cases, repeat, threadCount))
+      bSuccess = false;
+  }
+  return bSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
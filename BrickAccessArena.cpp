@@ -0,0 +1,236 @@
+#include "BrickAccessArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+  // bricks of the first block when nothing has been reserved, 2 MiB
+  uint64_t const MinBlockBricks = 65536;
+
+}
+
+BrickAccessArena::BrickAccessArena()
+  : m_FrameOffsets(1, 0)
+  , m_iBrickCount(0)
+  , m_iBlockBricks(0)
+  , m_pCounters(nullptr)
+{}
+
+void BrickAccessArena::Clear()
+{
+  for (size_t i=0; i<m_Blocks.size(); ++i)
+    BrickAccessStats::CountBytes(m_pCounters, m_Blocks[i].capacity * sizeof(Brick), 0);
+  size_t const subframeCapacity = m_Subframes.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+  std::vector<Block>().swap(m_Blocks);
+  std::vector<Bricks>().swap(m_Subframes);
+  std::vector<uint64_t>(1, 0).swap(m_FrameOffsets);
+  BrickAccessStats::CountCapacity(m_pCounters, subframeCapacity, m_Subframes);
+  BrickAccessStats::CountCapacity(m_pCounters, frameCapacity, m_FrameOffsets);
+  m_iBrickCount = 0;
+  m_iBlockBricks = 0;
+}
+
+void BrickAccessArena::Reserve(uint64_t brickCount, size_t subframeCount, size_t frameCount)
+{
+  size_t const subframeCapacity = m_Subframes.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+  m_Subframes.reserve(subframeCount);
+  m_FrameOffsets.reserve(frameCount + 1);
+  BrickAccessStats::CountCapacity(m_pCounters, subframeCapacity, m_Subframes);
+  BrickAccessStats::CountCapacity(m_pCounters, frameCapacity, m_FrameOffsets);
+
+  // the next block takes all reserved bricks unless the last one has room
+  uint64_t const available = m_Blocks.empty() ? 0 : m_Blocks.back().capacity - m_Blocks.back().size;
+  if (brickCount > available)
+    m_iBlockBricks = brickCount;
+}
+
+void BrickAccessArena::Append(BrickAccessArena& other)
+{
+  size_t const blockCapacity = m_Blocks.capacity();
+  size_t const subframeCapacity = m_Subframes.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+
+  // the blocks are moved, so the subframe views stay valid, and appending
+  // behind other blocks keeps the free space of the last block in use
+  uint64_t const subframeBase = m_Subframes.size();
+  Block last;
+  bool const bHasLast = !m_Blocks.empty();
+  if (bHasLast) {
+    last = std::move(m_Blocks.back());
+    m_Blocks.pop_back();
+  }
+  for (size_t i=0; i<other.m_Blocks.size(); ++i)
+    m_Blocks.push_back(std::move(other.m_Blocks[i]));
+  if (bHasLast)
+    m_Blocks.push_back(std::move(last));
+  m_Subframes.insert(m_Subframes.end(), other.m_Subframes.begin(), other.m_Subframes.end());
+  m_FrameOffsets.reserve(m_FrameOffsets.size() + other.m_FrameOffsets.size() - 1);
+  for (size_t i=1; i<other.m_FrameOffsets.size(); ++i)
+    m_FrameOffsets.push_back(subframeBase + other.m_FrameOffsets[i]);
+  m_iBrickCount += other.m_iBrickCount;
+  BrickAccessStats::CountCapacity(m_pCounters, blockCapacity, m_Blocks);
+  BrickAccessStats::CountCapacity(m_pCounters, subframeCapacity, m_Subframes);
+  BrickAccessStats::CountCapacity(m_pCounters, frameCapacity, m_FrameOffsets);
+
+  // the blocks now belong to this arena and must not be released twice
+  other.m_Blocks.clear();
+  other.Clear();
+}
+
+void BrickAccessArena::BeginFrame()
+{
+  // the last offset always marks the end of the table
+  size_t const capacity = m_FrameOffsets.capacity();
+  m_FrameOffsets.push_back(m_FrameOffsets.back());
+  BrickAccessStats::CountCapacity(m_pCounters, capacity, m_FrameOffsets);
+}
+
+void BrickAccessArena::BeginSubframe(uint32_t)
+{
+  Bricks const empty = { nullptr, 0 };
+  size_t const capacity = m_Subframes.capacity();
+  m_Subframes.push_back(empty);
+  BrickAccessStats::CountCapacity(m_pCounters, capacity, m_Subframes);
+  m_FrameOffsets.back() = m_Subframes.size();
+}
+
+void BrickAccessArena::AddBricks(Brick const* bricks, size_t count)
+{
+  if (count == 0)
+    return;
+  Bricks& subframe = m_Subframes.back();
+  if (subframe.count == 0) {
+    Brick* const data = Allocate(count);
+    memcpy(data, bricks, count * sizeof(Brick));
+    subframe.data = data;
+    subframe.count = count;
+  } else {
+    // a subframe with more than one brick line, which only grows in place
+    // while it is the end of the last block
+    Block& block = m_Blocks.back();
+    if (subframe.end() == block.data.get() + block.size && block.capacity - block.size >= count) {
+      block.size += count;
+    } else {
+      Brick* const data = Allocate(subframe.count + count);
+      memcpy(data, subframe.data, subframe.count * sizeof(Brick));
+      subframe.data = data;
+    }
+    memcpy(const_cast<Brick*>(subframe.end()), bricks, count * sizeof(Brick));
+    subframe.count += count;
+  }
+  m_iBrickCount += count;
+}
+
+BrickAccessArena::Brick* BrickAccessArena::Allocate(size_t count)
+{
+  if (!m_Blocks.empty()) {
+    Block& block = m_Blocks.back();
+    if (block.capacity - block.size >= count) {
+      Brick* const data = block.data.get() + block.size;
+      block.size += count;
+      return data;
+    }
+  }
+
+  // geometric growth keeps the number of blocks logarithmic in the bricks
+  uint64_t bricks = m_iBlockBricks;
+  if (bricks == 0)
+    bricks = std::max(MinBlockBricks, m_iBrickCount);
+  m_iBlockBricks = 0;
+  size_t const capacity = std::max(size_t(bricks), count);
+
+  size_t const blockCapacity = m_Blocks.capacity();
+  Block block;
+  block.data.reset(new Brick[capacity]);
+  block.capacity = capacity;
+  block.size = count;
+  m_Blocks.push_back(std::move(block));
+  BrickAccessStats::CountCapacity(m_pCounters, blockCapacity, m_Blocks);
+  BrickAccessStats::CountBytes(m_pCounters, 0, capacity * sizeof(Brick));
+  return m_Blocks.back().data.get();
+}
+
+void BrickAccessArena::SetCounters(BrickAccessStats::Counters* pCounters)
+{
+  m_pCounters = pCounters;
+}
+
+size_t BrickAccessArena::GetFrameCount() const
+{
+  return m_FrameOffsets.size() - 1;
+}
+
+size_t BrickAccessArena::GetSubframeCount(size_t frame) const
+{
+  return size_t(m_FrameOffsets[frame+1] - m_FrameOffsets[frame]);
+}
+
+size_t BrickAccessArena::GetTotalSubframeCount() const
+{
+  return m_Subframes.size();
+}
+
+uint64_t BrickAccessArena::GetTotalBrickCount() const
+{
+  return m_iBrickCount;
+}
+
+BrickAccessArena::Bricks BrickAccessArena::GetSubframe(size_t frame, size_t subframe) const
+{
+  return m_Subframes[size_t(m_FrameOffsets[frame]) + subframe];
+}
+
+size_t BrickAccessArena::GetBlockCount() const
+{
+  return m_Blocks.size();
+}
+
+size_t BrickAccessArena::GetMemoryUsage() const
+{
+  size_t bytes = m_Blocks.capacity() * sizeof(Block) + m_Subframes.capacity() * sizeof(Bricks) +
+    m_FrameOffsets.capacity() * sizeof(uint64_t);
+  for (size_t i=0; i<m_Blocks.size(); ++i)
+    bytes += m_Blocks[i].capacity * sizeof(Brick);
+  return bytes;
+}
+
+void BrickAccessArena::ToFrames(std::vector<BrickAccessFile::Frame>& frames) const
+{
+  frames.clear();
+  frames.resize(GetFrameCount());
+  for (size_t f=0; f<frames.size(); ++f) {
+    BrickAccessFile::Frame& frame = frames[f];
+    frame.resize(GetSubframeCount(f));
+    for (size_t s=0; s<frame.size(); ++s) {
+      Bricks const bricks = GetSubframe(f, s);
+      frame[s].assign(bricks.begin(), bricks.end());
+    }
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
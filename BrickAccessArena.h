@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_ARENA_H
+#define BRICK_ACCESS_ARENA_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessStats.h"
+
+// Storage of the captured brick accesses with all bricks in a few large
+// blocks. Subframes are contiguous ranges of a block and frames are ranges of
+// the subframe table, so a trace of millions of subframes takes a handful of
+// allocations instead of one per frame and subframe.
+//
+// Blocks are sized by Reserve(), e.g. from the subframe counts of a frame
+// index or an upper bound found by a quick scan. Without a reservation every
+// new block is as large as all previous ones together. Clear() releases a
+// trace with one deallocation per block, and since the blocks are large the
+// allocator returns them to the system instead of leaving a fragmented heap,
+// which matters for processes that load and unload many traces.
+class BrickAccessArena {
+public:
+  typedef BrickAccessFile::Brick Brick;
+
+  // View of the bricks of a subframe.
+  typedef BrickAccessFile::Span<Brick> Bricks;
+
+  // Creates an empty arena.
+  BrickAccessArena();
+
+  // Removes all frames and releases all blocks.
+  void Clear();
+
+  // Makes room for the given total number of bricks in one block and for the
+  // given number of subframes and frames in the tables.
+  void Reserve(uint64_t brickCount, size_t subframeCount, size_t frameCount);
+
+  // Moves all frames and blocks of another arena behind the frames of this
+  // one, the bricks are not copied. The other arena is cleared.
+  void Append(BrickAccessArena& other);
+
+  // Parser sink interface, see BrickAccessParser.
+  void BeginFrame();
+  void BeginSubframe(uint32_t expectedBricks);
+  void AddBricks(Brick const* bricks, size_t count);
+  void EndFrame() {}
+
+  // Counts the capacity changes of all following calls into the given
+  // counters, null disables counting, see BrickAccessStats.
+  void SetCounters(BrickAccessStats::Counters* pCounters);
+
+  // @returns the number of frames.
+  size_t GetFrameCount() const;
+
+  // @returns the number of subframes of a frame.
+  size_t GetSubframeCount(size_t frame) const;
+
+  // @returns the number of subframes of all frames.
+  size_t GetTotalSubframeCount() const;
+
+  // @returns the number of bricks of all subframes.
+  uint64_t GetTotalBrickCount() const;
+
+  // @returns the bricks of a subframe.
+  Bricks GetSubframe(size_t frame, size_t subframe) const;
+
+  // @returns the number of allocated blocks.
+  size_t GetBlockCount() const;
+
+  // @returns the bytes of all blocks and tables.
+  size_t GetMemoryUsage() const;
+
+  // Creates nested frame vectors as returned by BrickAccessFile::GetFrames().
+  void ToFrames(std::vector<BrickAccessFile::Frame>& frames) const;
+
+private:
+  struct Block {
+    std::unique_ptr<Brick[]> data;
+    size_t capacity;
+    size_t size;
+  };
+
+  // @returns room for count bricks, in the last block if they fit.
+  Brick* Allocate(size_t count);
+
+  std::vector<Block> m_Blocks;
+  std::vector<Bricks> m_Subframes;
+  // first subframe of every frame, the last entry marks the end of the table
+  std::vector<uint64_t> m_FrameOffsets;
+  uint64_t m_iBrickCount;
+  uint64_t m_iBlockBricks;
+  BrickAccessStats::Counters* m_pCounters;
+};
+
+#endif // BRICK_ACCESS_ARENA_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
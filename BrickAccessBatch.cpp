@@ -0,0 +1,399 @@
+#include "BrickAccessBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessParser.h"
+#include "BrickLayout.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  // Sink which forwards to the frames, the trace or the arena of the current
+  // file.
+  class ResultSink {
+  public:
+    ResultSink() : m_pFrames(nullptr), m_pTrace(nullptr), m_pArena(nullptr) {}
+
+    void Start(std::vector<BrickAccessFile::Frame>* frames, BrickAccessTrace* trace, BrickAccessArena* arena)
+    {
+      m_pFrames = frames;
+      m_pTrace = trace;
+      m_pArena = arena;
+    }
+
+    void BeginFrame()
+    {
+      if (m_pTrace)
+        m_pTrace->BeginFrame();
+      else if (m_pArena)
+        m_pArena->BeginFrame();
+      else
+        m_pFrames->push_back(BrickAccessFile::Frame());
+    }
+
+    void BeginSubframe(uint32_t expectedBricks)
+    {
+      if (m_pTrace)
+        m_pTrace->BeginSubframe(expectedBricks);
+      else if (m_pArena)
+        m_pArena->BeginSubframe(expectedBricks);
+      else
+        m_pFrames->back().push_back(BrickAccessFile::Subframe());
+    }
+
+    void AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+    {
+      if (m_pTrace) {
+        m_pTrace->AddBricks(bricks, count);
+      } else if (m_pArena) {
+        m_pArena->AddBricks(bricks, count);
+      } else {
+        BrickAccessFile::Subframe& subframe = m_pFrames->back().back();
+        subframe.insert(subframe.end(), bricks, bricks + count);
+      }
+    }
+
+    void EndFrame()
+    {
+      if (m_pTrace)
+        m_pTrace->EndFrame();
+      else if (m_pArena)
+        m_pArena->EndFrame();
+    }
+
+  private:
+    std::vector<BrickAccessFile::Frame>* m_pFrames;
+    BrickAccessTrace* m_pTrace;
+    BrickAccessArena* m_pArena;
+  };
+
+  // Parser state owned by one thread of the pool and reused for every file
+  // it loads.
+  struct Worker {
+    BrickAccessFile::Header header;
+    ResultSink sink;
+    BrickAccessParser<ResultSink> parser;
+
+    Worker() : parser(header, sink) {}
+  };
+
+  // @returns the error message of a parser as BrickAccessFile prints it.
+  template<class Parser>
+  std::string FormatError(Parser const& parser)
+  {
+    std::ostringstream stream;
+    stream << "failed to parse line " << parser.GetErrorLine() << parser.GetError();
+    return stream.str();
+  }
+
+  template<class T>
+  bool IsEqual(BrickAccessFile::Vec3<T> const& a, BrickAccessFile::Vec3<T> const& b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+  }
+
+  template<class T>
+  bool IsEqual(std::vector<BrickAccessFile::Vec3<T> > const& a, std::vector<BrickAccessFile::Vec3<T> > const& b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (size_t i=0; i<a.size(); ++i) {
+      if (!IsEqual(a[i], b[i]))
+        return false;
+    }
+    return true;
+  }
+
+  bool IsSameDataset(BrickAccessFile::Header const& a, BrickAccessFile::Header const& b)
+  {
+    return IsEqual(a.maxBrickSize, b.maxBrickSize) && IsEqual(a.brickOverlap, b.brickOverlap) &&
+      IsEqual(a.domainSizes, b.domainSizes) && IsEqual(a.brickCounts, b.brickCounts);
+  }
+
+  // Starts the trace of a flat result, keys depend on the brick counts.
+  bool StartTrace(BrickAccessFile::Header const& header, BrickAccessFile::KeyOrder order,
+    BrickAccessBatch::Result& result)
+  {
+    BrickLayout const layout(header.brickCounts, order);
+    if (!layout.IsValid()) {
+      result.error = "failed to load file " + result.filename + ": brick counts exceed the key range";
+      return false;
+    }
+    result.trace.Reset(layout);
+    return true;
+  }
+
+  // Copies the frames of a binary file, see BrickAccessBinaryFile.
+  // @returns false if loading failed, result.error holds the reason then.
+  bool LoadBinaryFile(Worker& worker, BrickAccessFile::Storage storage, BrickAccessFile::KeyOrder order,
+    BrickAccessBatch::Result& result)
+  {
+    BrickAccessBinaryFile binary;
+    if (!binary.Open(result.filename) || !binary.Validate()) {
+      result.error = "failed to load binary file " + result.filename;
+      return false;
+    }
+    result.fileSize = binary.GetFileSize();
+    worker.header = binary.GetHeader();
+    if (storage == BrickAccessFile::ST_FLAT) {
+      if (!StartTrace(worker.header, order, result))
+        return false;
+      result.trace.Reserve(binary.GetTotalBrickCount(), size_t(binary.GetTotalSubframeCount()),
+        size_t(binary.GetFrameCount()));
+      binary.CopyFrames(0, binary.GetFrameCount(), result.trace);
+    } else if (storage == BrickAccessFile::ST_ARENA) {
+      result.arena.Reserve(binary.GetTotalBrickCount(), size_t(binary.GetTotalSubframeCount()),
+        size_t(binary.GetFrameCount()));
+      binary.CopyFrames(0, binary.GetFrameCount(), result.arena);
+    } else {
+      worker.sink.Start(&result.frames, nullptr, nullptr);
+      binary.CopyFrames(0, binary.GetFrameCount(), worker.sink);
+      worker.sink.Start(nullptr, nullptr, nullptr);
+    }
+    return true;
+  }
+
+  // Loads a single file with the parser of a worker.
+  // @returns false if loading failed, result.error holds the reason then.
+  bool LoadFile(Worker& worker, BrickAccessFile::Storage storage, BrickAccessFile::KeyOrder order,
+    BrickAccessBatch::Result& result)
+  {
+    if (BrickAccessBinaryFile::IsBinaryFile(result.filename))
+      return LoadBinaryFile(worker, storage, order, result);
+
+    MappedFile file;
+    if (!file.Open(result.filename)) {
+      result.error = "failed to open file " + result.filename;
+      return false;
+    }
+    result.fileSize = file.GetSize();
+
+    worker.header = BrickAccessFile::Header();
+    worker.parser.Reset();
+    char const* body = file.GetData();
+    char const* const end = body + file.GetSize();
+    if (!worker.parser.ParseHeader(body, end)) {
+      result.error = FormatError(worker.parser);
+      return false;
+    }
+    if (storage == BrickAccessFile::ST_FLAT) {
+      // keys depend on the brick counts, so the header must not change
+      if (!StartTrace(worker.header, order, result))
+        return false;
+      worker.parser.SetBodyOnly(true);
+      worker.sink.Start(nullptr, &result.trace, nullptr);
+    } else if (storage == BrickAccessFile::ST_ARENA) {
+      // one block for all bricks, sized by their brackets
+      result.arena.Reserve(uint64_t(std::count(body, end, '[')), 0, 0);
+      worker.sink.Start(nullptr, nullptr, &result.arena);
+    } else {
+      worker.sink.Start(&result.frames, nullptr, nullptr);
+    }
+
+    bool const bSuccess = worker.parser.Parse(body, end);
+    worker.sink.Start(nullptr, nullptr, nullptr);
+    if (!bSuccess) {
+      result.error = FormatError(worker.parser);
+      std::vector<BrickAccessFile::Frame>().swap(result.frames);
+      result.trace.Clear();
+      result.arena.Clear();
+      return false;
+    }
+    result.trace.ShrinkToFit();
+    return true;
+  }
+
+  // Appends the names of all regular files of a directory.
+  bool ListDirectory(std::string const& directory, std::vector<std::string>& names)
+  {
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE const find = FindFirstFileA((directory + "\\*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+      return false;
+    do {
+      if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        names.push_back(data.cFileName);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+    return true;
+#else
+    DIR* const dir = opendir(directory.c_str());
+    if (dir == nullptr)
+      return false;
+    while (dirent const* entry = readdir(dir)) {
+      std::string const name(entry->d_name);
+      if (name != "." && name != "..")
+        names.push_back(name);
+    }
+    closedir(dir);
+    return true;
+#endif
+  }
+
+}
+
+BrickAccessBatch::BrickAccessBatch()
+  : m_Storage(BrickAccessFile::ST_FRAMES)
+  , m_KeyOrder(BrickAccessFile::KO_ROW_MAJOR)
+{}
+
+BrickAccessBatch::~BrickAccessBatch()
+{}
+
+void BrickAccessBatch::SetStorage(BrickAccessFile::Storage storage, BrickAccessFile::KeyOrder order)
+{
+  m_Storage = storage;
+  m_KeyOrder = order;
+}
+
+void BrickAccessBatch::AddFile(std::string const& filename)
+{
+  m_Filenames.push_back(filename);
+}
+
+bool BrickAccessBatch::AddDirectory(std::string const& directory, std::string const& extension)
+{
+  std::vector<std::string> names;
+  if (!ListDirectory(directory, names)) {
+    std::cerr << "failed to read directory " << directory << std::endl;
+    return false;
+  }
+  std::sort(names.begin(), names.end());
+  for (size_t i=0; i<names.size(); ++i) {
+    std::string const& name = names[i];
+    if (name.size() > extension.size() &&
+        name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+      m_Filenames.push_back(directory + "/" + name);
+  }
+  return true;
+}
+
+bool BrickAccessBatch::Load(size_t threadCount)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  m_Results.clear();
+  m_Datasets.clear();
+  m_Results.resize(m_Filenames.size());
+  std::vector<BrickAccessFile::Header> headers(m_Filenames.size());
+
+  // sizes are known up front, starting with the largest files keeps a single
+  // large file from running alone at the end
+  std::vector<size_t> order(m_Filenames.size());
+  for (size_t i=0; i<m_Filenames.size(); ++i) {
+    Result& result = m_Results[i];
+    result.filename = m_Filenames[i];
+    result.success = false;
+    result.fileSize = 0;
+    result.seconds = 0.0;
+    result.dataset = 0;
+    order[i] = i;
+  }
+  ThreadPool pool(threadCount);
+  pool.ParallelFor(m_Filenames.size(), [this](size_t i) {
+    MappedFile file;
+    if (file.Open(m_Filenames[i]))
+      m_Results[i].fileSize = file.GetSize();
+  });
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return m_Results[a].fileSize > m_Results[b].fileSize;
+  });
+
+  std::vector<std::unique_ptr<Worker> > workers(pool.GetThreadCount());
+  BrickAccessFile::Storage const storage = m_Storage;
+  BrickAccessFile::KeyOrder const keyOrder = m_KeyOrder;
+  pool.ParallelForThreads(order.size(), [&](size_t task, size_t thread) {
+    size_t const i = order[task];
+    Result& result = m_Results[i];
+    Clock::time_point const start = Clock::now();
+    if (!workers[thread])
+      workers[thread].reset(new Worker());
+    Worker& worker = *workers[thread];
+    result.success = LoadFile(worker, storage, keyOrder, result);
+    if (result.success)
+      headers[i] = worker.header;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  });
+
+  // store every distinct header once
+  bool bSuccess = true;
+  for (size_t i=0; i<m_Results.size(); ++i) {
+    Result& result = m_Results[i];
+    if (!result.success) {
+      bSuccess = false;
+      continue;
+    }
+    size_t dataset = 0;
+    while (dataset < m_Datasets.size() && !IsSameDataset(m_Datasets[dataset], headers[i]))
+      ++dataset;
+    if (dataset == m_Datasets.size())
+      m_Datasets.push_back(headers[i]);
+    result.dataset = dataset;
+  }
+  return bSuccess;
+}
+
+void BrickAccessBatch::Clear()
+{
+  m_Filenames.clear();
+  m_Results.clear();
+  m_Datasets.clear();
+}
+
+size_t BrickAccessBatch::GetFileCount() const
+{
+  return m_Filenames.size();
+}
+
+BrickAccessBatch::Result const& BrickAccessBatch::GetResult(size_t file) const
+{
+  return m_Results[file];
+}
+
+size_t BrickAccessBatch::GetDatasetCount() const
+{
+  return m_Datasets.size();
+}
+
+BrickAccessFile::Header const& BrickAccessBatch::GetDataset(size_t dataset) const
+{
+  return m_Datasets[dataset];
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,123 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_BATCH_H
+#define BRICK_ACCESS_BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessArena.h"
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+
+// Loads many brick access files at once. Files are handed out dynamically to
+// the threads of one pool, largest first, so the threads stay busy until the
+// last file and the wall time is bound by the aggregate disk bandwidth
+// instead of a single core. Every thread reuses its parser and brick buffers
+// for all files it loads.
+//
+// Errors are collected per file instead of stopping the batch. Traces of the
+// same dataset share one header, see GetDataset(). Example:
+//
+//   BrickAccessBatch batch;
+//   batch.AddDirectory("traces");
+//   batch.Load();
+//   for (size_t i=0; i<batch.GetFileCount(); ++i) {
+//     BrickAccessBatch::Result const& result = batch.GetResult(i);
+//     if (result.success) { /* process result.frames */ }
+//   }
+class BrickAccessBatch {
+public:
+  // Outcome of loading a single file.
+  struct Result {
+    std::string filename;
+    bool success;
+    // error message as Load() prints it, empty on success
+    std::string error;
+    uint64_t fileSize;
+    // time spent on this file by its thread
+    double seconds;
+    // index of the header, see GetDataset()
+    size_t dataset;
+    // bricks of the file, filled depending on the storage
+    std::vector<BrickAccessFile::Frame> frames;
+    BrickAccessTrace trace;
+    BrickAccessArena arena;
+  };
+
+  BrickAccessBatch();
+  ~BrickAccessBatch();
+
+  // Selects the representation of the loaded bricks, see
+  // BrickAccessFile::SetStorage(). The default is ST_FRAMES.
+  void SetStorage(BrickAccessFile::Storage storage,
+    BrickAccessFile::KeyOrder order = BrickAccessFile::KO_ROW_MAJOR);
+
+  // Adds a file to the batch.
+  void AddFile(std::string const& filename);
+
+  // Adds all files of a directory with the given extension in alphabetical
+  // order, subdirectories are not searched.
+  // @returns false if the directory could not be read, see std::cerr.
+  bool AddDirectory(std::string const& directory, std::string const& extension = ".ba");
+
+  // Loads all added files. The results of a previous call are replaced.
+  // @param threadCount is the number of loading threads, zero uses all
+  //   hardware threads.
+  // @returns true if all files were loaded without problems.
+  bool Load(size_t threadCount = 0);
+
+  // Removes all files and results.
+  void Clear();
+
+  // @returns the number of added files.
+  size_t GetFileCount() const;
+
+  // @returns the result of a file in the order the files were added.
+  Result const& GetResult(size_t file) const;
+
+  // @returns the number of distinct headers of the successfully loaded
+  //   files. Files of the same dataset have identical brick sizes, overlaps,
+  //   domain sizes and brick counts.
+  size_t GetDatasetCount() const;
+
+  // @returns a distinct header, see Result::dataset.
+  BrickAccessFile::Header const& GetDataset(size_t dataset) const;
+
+private:
+  BrickAccessBatch(BrickAccessBatch const&);
+  BrickAccessBatch& operator=(BrickAccessBatch const&);
+
+  std::vector<std::string> m_Filenames;
+  std::vector<Result> m_Results;
+  std::vector<BrickAccessFile::Header> m_Datasets;
+  BrickAccessFile::Storage m_Storage;
+  BrickAccessFile::KeyOrder m_KeyOrder;
+};
+
+#endif // BRICK_ACCESS_BATCH_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
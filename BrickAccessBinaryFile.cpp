@@ -0,0 +1,256 @@
+#include "BrickAccessBinaryFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+  static_assert(sizeof(BrickAccessBinaryFile::FileHeader) == 112,
+    "binary header layout must not depend on the compiler");
+  static_assert(sizeof(BrickAccessBinaryFile::PackedBrick) == 16,
+    "binary brick layout must not depend on the compiler");
+
+  // @returns true if count elements of the given size starting at offset fit
+  //   into a file of fileSize bytes and the offset is properly aligned.
+  bool IsSection(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+  {
+    if (offset % 8 != 0 || offset > fileSize)
+      return false;
+    return count <= (fileSize - offset) / elementSize;
+  }
+
+}
+
+char const* BrickAccessBinaryFile::GetMagic()
+{
+  return "BABTRACE";
+}
+
+bool BrickAccessBinaryFile::IsBinaryFile(std::string const& filename)
+{
+  char magic[sizeof(FileHeader().magic)];
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  return file.read(magic, sizeof(magic)) && memcmp(magic, GetMagic(), sizeof(magic)) == 0;
+}
+
+BrickAccessBinaryFile::BrickAccessBinaryFile()
+  : m_pHeader(nullptr)
+  , m_pBricks(nullptr)
+  , m_pSubframeOffsets(nullptr)
+  , m_pFrameOffsets(nullptr)
+  , m_pDomainSizes(nullptr)
+  , m_pBrickCounts(nullptr)
+{}
+
+bool BrickAccessBinaryFile::Open(std::string const& filename)
+{
+  Close();
+  if (!m_File.Open(filename))
+    return Fail(filename, "file not readable");
+
+  uint64_t const size = m_File.GetSize();
+  if (size < sizeof(FileHeader))
+    return Fail(filename, "file too small");
+
+  char const* const data = m_File.GetData();
+  FileHeader const* header = reinterpret_cast<FileHeader const*>(data);
+  if (memcmp(header->magic, GetMagic(), sizeof(header->magic)) != 0)
+    return Fail(filename, "wrong magic");
+  if (header->byteOrder != ByteOrderMark)
+    return Fail(filename, "wrong byte order");
+  if (header->version != Version)
+    return Fail(filename, "unsupported version");
+  if (header->fileSize != size)
+    return Fail(filename, "file size mismatch, file truncated?");
+  if (!IsSection(header->brickOffset, header->brickCount, sizeof(PackedBrick), size))
+    return Fail(filename, "invalid brick section");
+  if (header->subframeCount == UINT64_MAX ||
+      !IsSection(header->subframeOffset, header->subframeCount + 1, sizeof(uint64_t), size))
+    return Fail(filename, "invalid subframe section");
+  if (header->frameCount == UINT64_MAX ||
+      !IsSection(header->frameOffset, header->frameCount + 1, sizeof(uint64_t), size))
+    return Fail(filename, "invalid frame section");
+  if (header->lodCount > UINT64_MAX / 2 ||
+      !IsSection(header->lodOffset, header->lodCount * 2, sizeof(BrickAccessFile::Vec3<uint64_t>), size))
+    return Fail(filename, "invalid level of detail section");
+
+  m_pBricks = reinterpret_cast<PackedBrick const*>(data + header->brickOffset);
+  m_pSubframeOffsets = reinterpret_cast<uint64_t const*>(data + header->subframeOffset);
+  m_pFrameOffsets = reinterpret_cast<uint64_t const*>(data + header->frameOffset);
+  m_pDomainSizes = reinterpret_cast<BrickAccessFile::Vec3<uint64_t> const*>(data + header->lodOffset);
+  m_pBrickCounts = m_pDomainSizes + header->lodCount;
+
+  // the closing entries tie the tables together, this is enough to keep all
+  // accesses inside of the mapping as long as the tables are monotonic
+  if (m_pSubframeOffsets[0] != 0 || m_pSubframeOffsets[header->subframeCount] != header->brickCount)
+    return Fail(filename, "inconsistent subframe offsets");
+  if (m_pFrameOffsets[0] != 0 || m_pFrameOffsets[header->frameCount] != header->subframeCount)
+    return Fail(filename, "inconsistent frame offsets");
+
+  m_pHeader = header;
+  return true;
+}
+
+void BrickAccessBinaryFile::Close()
+{
+  m_File.Close();
+  m_pHeader = nullptr;
+  m_pBricks = nullptr;
+  m_pSubframeOffsets = nullptr;
+  m_pFrameOffsets = nullptr;
+  m_pDomainSizes = nullptr;
+  m_pBrickCounts = nullptr;
+}
+
+bool BrickAccessBinaryFile::Validate() const
+{
+  if (m_pHeader == nullptr)
+    return false;
+
+  for (uint64_t i=0; i<m_pHeader->frameCount; ++i) {
+    if (m_pFrameOffsets[i] > m_pFrameOffsets[i+1]) {
+      std::cerr << "invalid binary brick access file: frame offsets not monotonic at frame " << i << std::endl;
+      return false;
+    }
+  }
+  for (uint64_t i=0; i<m_pHeader->subframeCount; ++i) {
+    if (m_pSubframeOffsets[i] > m_pSubframeOffsets[i+1]) {
+      std::cerr << "invalid binary brick access file: subframe offsets not monotonic at subframe " << i << std::endl;
+      return false;
+    }
+  }
+  for (uint64_t i=0; i<m_pHeader->brickCount; ++i) {
+    PackedBrick const& brick = m_pBricks[i];
+    if (brick.w >= m_pHeader->lodCount) {
+      std::cerr << "invalid binary brick access file: brick " << i << " LoD exceeds bounds" << std::endl;
+      return false;
+    }
+    BrickAccessFile::Vec3<uint64_t> const& brickCount = m_pBrickCounts[brick.w];
+    if (brick.x >= brickCount.x || brick.y >= brickCount.y || brick.z >= brickCount.z) {
+      std::cerr << "invalid binary brick access file: brick " << i << " position exceeds bounds" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+BrickAccessFile::Vec3<uint32_t> const& BrickAccessBinaryFile::GetMaxBrickSize() const
+{
+  return m_pHeader->maxBrickSize;
+}
+
+BrickAccessFile::Vec3<uint32_t> const& BrickAccessBinaryFile::GetBrickOverlap() const
+{
+  return m_pHeader->brickOverlap;
+}
+
+size_t BrickAccessBinaryFile::GetLoDCount() const
+{
+  return m_pHeader ? size_t(m_pHeader->lodCount) : 0;
+}
+
+BrickAccessFile::Span<BrickAccessFile::Vec3<uint64_t> > BrickAccessBinaryFile::GetDomainSizes() const
+{
+  BrickAccessFile::Span<BrickAccessFile::Vec3<uint64_t> > span = { m_pDomainSizes, GetLoDCount() };
+  return span;
+}
+
+BrickAccessFile::Span<BrickAccessFile::Vec3<uint64_t> > BrickAccessBinaryFile::GetBrickCounts() const
+{
+  BrickAccessFile::Span<BrickAccessFile::Vec3<uint64_t> > span = { m_pBrickCounts, GetLoDCount() };
+  return span;
+}
+
+BrickAccessFile::Header BrickAccessBinaryFile::GetHeader() const
+{
+  BrickAccessFile::Header header = BrickAccessFile::Header();
+  if (m_pHeader == nullptr)
+    return header;
+  header.maxBrickSize = GetMaxBrickSize();
+  header.brickOverlap = GetBrickOverlap();
+  header.domainSizes.assign(GetDomainSizes().begin(), GetDomainSizes().end());
+  header.brickCounts.assign(GetBrickCounts().begin(), GetBrickCounts().end());
+  return header;
+}
+
+uint64_t BrickAccessBinaryFile::GetFrameCount() const
+{
+  return m_pHeader ? m_pHeader->frameCount : 0;
+}
+
+uint64_t BrickAccessBinaryFile::GetSubframeCount(uint64_t iFrame) const
+{
+  return m_pFrameOffsets[iFrame+1] - m_pFrameOffsets[iFrame];
+}
+
+BrickAccessBinaryFile::Subframe BrickAccessBinaryFile::GetSubframe(uint64_t iFrame, uint64_t iSubframe) const
+{
+  uint64_t const i = m_pFrameOffsets[iFrame] + iSubframe;
+  Subframe subframe = { m_pBricks + m_pSubframeOffsets[i], size_t(m_pSubframeOffsets[i+1] - m_pSubframeOffsets[i]) };
+  return subframe;
+}
+
+uint64_t BrickAccessBinaryFile::GetTotalSubframeCount() const
+{
+  return m_pHeader ? m_pHeader->subframeCount : 0;
+}
+
+uint64_t BrickAccessBinaryFile::GetTotalBrickCount() const
+{
+  return m_pHeader ? m_pHeader->brickCount : 0;
+}
+
+uint64_t BrickAccessBinaryFile::GetFileSize() const
+{
+  return m_pHeader ? m_File.GetSize() : 0;
+}
+
+BrickAccessFile::Span<BrickAccessBinaryFile::PackedBrick> BrickAccessBinaryFile::GetBricks() const
+{
+  BrickAccessFile::Span<PackedBrick> span = { m_pBricks, size_t(GetTotalBrickCount()) };
+  return span;
+}
+
+BrickAccessFile::Span<uint64_t> BrickAccessBinaryFile::GetFrameOffsets() const
+{
+  BrickAccessFile::Span<uint64_t> span = { m_pFrameOffsets, m_pHeader ? size_t(m_pHeader->frameCount + 1) : 0 };
+  return span;
+}
+
+BrickAccessFile::Span<uint64_t> BrickAccessBinaryFile::GetSubframeOffsets() const
+{
+  BrickAccessFile::Span<uint64_t> span = { m_pSubframeOffsets, m_pHeader ? size_t(m_pHeader->subframeCount + 1) : 0 };
+  return span;
+}
+
+bool BrickAccessBinaryFile::Fail(std::string const& filename, char const* reason)
+{
+  std::cerr << "invalid binary brick access file " << filename << ": " << reason << std::endl;
+  Close();
+  return false;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,201 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_BINARY_FILE_H
+#define BRICK_ACCESS_BINARY_FILE_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "MappedFile.h"
+
+// Memory mapped access to binary brick access files (extension: *.bab). The
+// binary format stores the same information as the ASCII format, but in a
+// layout which can be used directly from the mapping, so opening a file does
+// neither parse nor copy any frame data.
+//
+// File layout (little endian, all sections 8 byte aligned):
+//
+//   FileHeader
+//   PackedBrick[brickCount]          bricks of all subframes, in file order
+//   uint64_t[subframeCount + 1]      index of the first brick per subframe
+//   uint64_t[frameCount + 1]         index of the first subframe per frame
+//   Vec3<uint64_t>[lodCount]         domain size per level of detail
+//   Vec3<uint64_t>[lodCount]         brick count per level of detail
+//
+// The offset tables hold one additional entry with the total count, so the
+// range of a subframe or frame i is always [table[i], table[i + 1]). The
+// byte offsets of all sections are stored in the header, which allows later
+// versions to append sections without breaking readers.
+//
+// See BrickAccessBinaryWriter to create binary files.
+class BrickAccessBinaryFile {
+public:
+  // A brick of a subframe. The w-component encodes the level of detail.
+  typedef BrickAccessFile::Vec4<uint32_t> PackedBrick;
+
+  // A subframe is a view of its bricks inside of the mapping.
+  typedef BrickAccessFile::Span<PackedBrick> Subframe;
+
+  static uint32_t const Version = 1;
+
+  // Fixed size header at the beginning of the file.
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    BrickAccessFile::Vec3<uint32_t> maxBrickSize;
+    BrickAccessFile::Vec3<uint32_t> brickOverlap;
+    uint64_t lodCount;
+    uint64_t frameCount;
+    uint64_t subframeCount;
+    uint64_t brickCount;
+    uint64_t brickOffset;
+    uint64_t subframeOffset;
+    uint64_t frameOffset;
+    uint64_t lodOffset;
+    uint64_t fileSize;
+  };
+
+  // Magic bytes identifying a binary brick access file.
+  static char const* GetMagic();
+
+  // Reads the first bytes of a file without mapping it. Every reader of
+  // brick access files checks this before parsing a file as ASCII.
+  // @returns true if the file starts with the magic.
+  static bool IsBinaryFile(std::string const& filename);
+
+  // Marker to detect files written on a host with a different byte order.
+  static uint32_t const ByteOrderMark = 0x01020304u;
+
+  BrickAccessBinaryFile();
+
+  // Maps the given file into memory and validates the header and section
+  // layout. The file stays mapped until Close() or destruction.
+  // @returns false if the file is missing or not a valid binary brick access
+  //   file, see std::cerr for details.
+  bool Open(std::string const& filename);
+
+  // Releases the mapping.
+  void Close();
+
+  // Checks the contents of all offset tables and bricks. Open() only checks
+  // the layout, so this is useful for files from untrusted sources.
+  // @returns false if a table is not monotonic or a brick exceeds the brick
+  //   counts of its level of detail, see std::cerr for details.
+  bool Validate() const;
+
+  // @returns the bricking size in voxels including the overlap, see
+  //   BrickAccessFile::GetMaxBrickSize().
+  BrickAccessFile::Vec3<uint32_t> const& GetMaxBrickSize() const;
+
+  // @returns the overlap in voxels between adjacent bricks.
+  BrickAccessFile::Vec3<uint32_t> const& GetBrickOverlap() const;
+
+  // @returns the number of levels of detail used by the dataset.
+  size_t GetLoDCount() const;
+
+  // @returns the domain size in voxels for every level of detail.
+  BrickAccessFile::Span<BrickAccessFile::Vec3<uint64_t> > GetDomainSizes() const;
+
+  // @returns the number of bricks per dimension for every level of detail.
+  BrickAccessFile::Span<BrickAccessFile::Vec3<uint64_t> > GetBrickCounts() const;
+
+  // @returns the header values in the form of the ASCII format.
+  BrickAccessFile::Header GetHeader() const;
+
+  // @returns the number of frames.
+  uint64_t GetFrameCount() const;
+
+  // @returns the number of subframes of the given frame.
+  uint64_t GetSubframeCount(uint64_t iFrame) const;
+
+  // @returns the bricks of a subframe of a frame.
+  Subframe GetSubframe(uint64_t iFrame, uint64_t iSubframe) const;
+
+  // @returns the total number of subframes of all frames.
+  uint64_t GetTotalSubframeCount() const;
+
+  // @returns the total number of bricks of all subframes.
+  uint64_t GetTotalBrickCount() const;
+
+  // @returns the size of the mapped file in bytes.
+  uint64_t GetFileSize() const;
+
+  // @returns all bricks of all subframes in file order.
+  BrickAccessFile::Span<PackedBrick> GetBricks() const;
+
+  // @returns the index of the first subframe of every frame, followed by the
+  //   total subframe count.
+  BrickAccessFile::Span<uint64_t> GetFrameOffsets() const;
+
+  // @returns the index of the first brick of every subframe, followed by the
+  //   total brick count.
+  BrickAccessFile::Span<uint64_t> GetSubframeOffsets() const;
+
+  // Passes a range of frames to a parser sink, see BrickAccessParser, so
+  // binary frames end up in the same storage as parsed ones. The range has
+  // to be within GetFrameCount().
+  template<class Sink>
+  void CopyFrames(uint64_t firstFrame, uint64_t frameCount, Sink& sink) const;
+
+private:
+  bool Fail(std::string const& filename, char const* reason);
+
+  MappedFile m_File;
+  FileHeader const* m_pHeader;
+  PackedBrick const* m_pBricks;
+  uint64_t const* m_pSubframeOffsets;
+  uint64_t const* m_pFrameOffsets;
+  BrickAccessFile::Vec3<uint64_t> const* m_pDomainSizes;
+  BrickAccessFile::Vec3<uint64_t> const* m_pBrickCounts;
+};
+
+template<class Sink>
+void BrickAccessBinaryFile::CopyFrames(uint64_t firstFrame, uint64_t frameCount, Sink& sink) const
+{
+  std::vector<BrickAccessFile::Brick> bricks;
+  for (uint64_t f=firstFrame; f<firstFrame+frameCount; ++f) {
+    sink.BeginFrame();
+    for (uint64_t s=0; s<GetSubframeCount(f); ++s) {
+      Subframe const subframe = GetSubframe(f, s);
+      bricks.resize(subframe.size());
+      for (size_t i=0; i<subframe.size(); ++i) {
+        bricks[i].x = subframe[i].x;
+        bricks[i].y = subframe[i].y;
+        bricks[i].z = subframe[i].z;
+        bricks[i].w = subframe[i].w;
+      }
+      sink.BeginSubframe(uint32_t(subframe.size()));
+      sink.AddBricks(bricks.data(), bricks.size());
+    }
+    sink.EndFrame();
+  }
+}
+
+#endif // BRICK_ACCESS_BINARY_FILE_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,207 @@
+#include "BrickAccessBinaryWriter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "BrickAccessParser.h"
+#include "MappedFile.h"
+
+namespace {
+
+  // Number of bricks collected before they are written as one block.
+  size_t const BufferedBricks = 64 * 1024;
+
+}
+
+BrickAccessBinaryWriter::BrickAccessBinaryWriter()
+  : m_iBrickCount(0)
+  , m_iPosition(0)
+{}
+
+BrickAccessBinaryWriter::~BrickAccessBinaryWriter()
+{
+  if (m_File.is_open()) {
+    // never finished, do not leave a file with a broken header behind
+    m_File.close();
+    std::remove(m_Filename.c_str());
+  }
+}
+
+bool BrickAccessBinaryWriter::Open(std::string const& filename)
+{
+  m_Filename = filename;
+  m_File.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_File.is_open()) {
+    std::cerr << "failed to create file " << filename << std::endl;
+    return false;
+  }
+  m_Buffer.clear();
+  m_Buffer.reserve(BufferedBricks);
+  m_SubframeOffsets.clear();
+  m_FrameOffsets.clear();
+  m_iBrickCount = 0;
+  m_iPosition = 0;
+
+  // reserve space for the header, it is written once all counts are known
+  BrickAccessBinaryFile::FileHeader header;
+  memset(&header, 0, sizeof(header));
+  WriteBlock(&header, sizeof(header));
+  return m_File.good();
+}
+
+bool BrickAccessBinaryWriter::Close(BrickAccessFile::Header const& source)
+{
+  Flush();
+
+  BrickAccessBinaryFile::FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BrickAccessBinaryFile::GetMagic(), sizeof(header.magic));
+  header.version = BrickAccessBinaryFile::Version;
+  header.byteOrder = BrickAccessBinaryFile::ByteOrderMark;
+  header.maxBrickSize = source.maxBrickSize;
+  header.brickOverlap = source.brickOverlap;
+  header.lodCount = source.brickCounts.size();
+  header.frameCount = m_FrameOffsets.size();
+  header.subframeCount = m_SubframeOffsets.size();
+  header.brickCount = m_iBrickCount;
+  header.brickOffset = sizeof(header);
+
+  m_SubframeOffsets.push_back(m_iBrickCount);
+  header.subframeOffset = m_iPosition;
+  WriteBlock(m_SubframeOffsets.data(), m_SubframeOffsets.size() * sizeof(uint64_t));
+
+  m_FrameOffsets.push_back(header.subframeCount);
+  header.frameOffset = m_iPosition;
+  WriteBlock(m_FrameOffsets.data(), m_FrameOffsets.size() * sizeof(uint64_t));
+
+  // both tables have the same length, brick counts define the LoD count
+  std::vector<BrickAccessFile::Vec3<uint64_t> > domainSizes(source.domainSizes);
+  domainSizes.resize(source.brickCounts.size());
+  header.lodOffset = m_iPosition;
+  WriteBlock(domainSizes.data(), domainSizes.size() * sizeof(BrickAccessFile::Vec3<uint64_t>));
+  WriteBlock(source.brickCounts.data(), source.brickCounts.size() * sizeof(BrickAccessFile::Vec3<uint64_t>));
+
+  header.fileSize = m_iPosition;
+  m_File.seekp(0);
+  m_File.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  m_File.close();
+
+  std::vector<uint64_t>().swap(m_SubframeOffsets);
+  std::vector<uint64_t>().swap(m_FrameOffsets);
+  if (m_File.fail()) {
+    std::cerr << "failed to write file " << m_Filename << std::endl;
+    std::remove(m_Filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+void BrickAccessBinaryWriter::BeginFrame()
+{
+  m_FrameOffsets.push_back(m_SubframeOffsets.size());
+}
+
+void BrickAccessBinaryWriter::BeginSubframe(uint32_t)
+{
+  m_SubframeOffsets.push_back(m_iBrickCount);
+}
+
+void BrickAccessBinaryWriter::AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+{
+  for (size_t i=0; i<count; ++i) {
+    BrickAccessBinaryFile::PackedBrick brick;
+    brick.x = uint32_t(bricks[i].x);
+    brick.y = uint32_t(bricks[i].y);
+    brick.z = uint32_t(bricks[i].z);
+    brick.w = uint32_t(bricks[i].w);
+    m_Buffer.push_back(brick);
+    if (m_Buffer.size() == BufferedBricks)
+      Flush();
+  }
+  m_iBrickCount += count;
+}
+
+void BrickAccessBinaryWriter::EndFrame()
+{}
+
+bool BrickAccessBinaryWriter::Write(BrickAccessFile const& source, std::string const& filename)
+{
+  BrickAccessBinaryWriter writer;
+  if (!writer.Open(filename))
+    return false;
+
+  std::vector<BrickAccessFile::Frame> const& frames = source.GetFrames();
+  for (size_t f=0; f<frames.size(); ++f) {
+    writer.BeginFrame();
+    for (size_t s=0; s<frames[f].size(); ++s) {
+      BrickAccessFile::Subframe const& subframe = frames[f][s];
+      writer.BeginSubframe(uint32_t(subframe.size()));
+      writer.AddBricks(subframe.data(), subframe.size());
+    }
+    writer.EndFrame();
+  }
+  return writer.Close(source.GetHeader());
+}
+
+bool BrickAccessBinaryWriter::Convert(std::string const& source, std::string const& target)
+{
+  if (BrickAccessBinaryFile::IsBinaryFile(source)) {
+    std::cerr << "failed to convert file " << source << ": the file is binary already" << std::endl;
+    return false;
+  }
+  MappedFile file;
+  if (!file.Open(source)) {
+    std::cerr << "failed to open file " << source << std::endl;
+    return false;
+  }
+
+  BrickAccessBinaryWriter writer;
+  if (!writer.Open(target))
+    return false;
+
+  BrickAccessFile::Header header;
+  BrickAccessParser<BrickAccessBinaryWriter> parser(header, writer);
+  if (!parser.Parse(file.GetData(), file.GetData() + file.GetSize())) {
+    std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+    return false;
+  }
+  return writer.Close(header);
+}
+
+void BrickAccessBinaryWriter::Flush()
+{
+  if (!m_Buffer.empty())
+    WriteBlock(m_Buffer.data(), m_Buffer.size() * sizeof(BrickAccessBinaryFile::PackedBrick));
+  m_Buffer.clear();
+}
+
+void BrickAccessBinaryWriter::WriteBlock(void const* data, size_t size)
+{
+  m_File.write(static_cast<char const*>(data), std::streamsize(size));
+  m_iPosition += size;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
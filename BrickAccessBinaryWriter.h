@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_BINARY_WRITER_H
+#define BRICK_ACCESS_BINARY_WRITER_H
+
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessFile.h"
+
+// Writes binary brick access files (extension: *.bab), see
+// BrickAccessBinaryFile for the file layout.
+//
+// Bricks are written as they arrive and only the offset tables are kept in
+// memory, so the writer can be used as a BrickAccessParser sink to convert
+// ASCII files of any size without loading them first.
+class BrickAccessBinaryWriter {
+public:
+  BrickAccessBinaryWriter();
+  ~BrickAccessBinaryWriter();
+
+  // Creates the output file.
+  // @returns false if the file could not be created.
+  bool Open(std::string const& filename);
+
+  // Writes the offset tables and the header and closes the file. The header
+  // has to be complete at this point.
+  // @returns false if writing failed, see std::cerr for details.
+  bool Close(BrickAccessFile::Header const& header);
+
+  // Sink interface, see BrickAccessParser.
+  void BeginFrame();
+  void BeginSubframe(uint32_t iExpectedBricks);
+  void AddBricks(BrickAccessFile::Brick const* bricks, size_t count);
+  void EndFrame();
+
+  // Writes all frames of a loaded brick access file.
+  // @returns false if writing failed, see std::cerr for details.
+  static bool Write(BrickAccessFile const& source, std::string const& filename);
+
+  // Converts an ASCII brick access file into a binary one. The source is
+  // parsed straight from a memory mapping into the output file.
+  // @returns false if parsing or writing failed, see std::cerr for details.
+  static bool Convert(std::string const& source, std::string const& target);
+
+private:
+  BrickAccessBinaryWriter(BrickAccessBinaryWriter const&);
+  BrickAccessBinaryWriter& operator=(BrickAccessBinaryWriter const&);
+
+  void Flush();
+  void WriteBlock(void const* data, size_t size);
+
+  std::string m_Filename;
+  std::ofstream m_File;
+  std::vector<BrickAccessBinaryFile::PackedBrick> m_Buffer;
+  std::vector<uint64_t> m_SubframeOffsets;
+  std::vector<uint64_t> m_FrameOffsets;
+  uint64_t m_iBrickCount;
+  uint64_t m_iPosition;
+};
+
+#endif // BRICK_ACCESS_BINARY_WRITER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
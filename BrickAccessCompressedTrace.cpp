@@ -0,0 +1,397 @@
+#include "BrickAccessCompressedTrace.h"
+
+#include <algorithm>
+#include <iterator>
+
+// Layout of the compressed data, all integers are LEB128 variable length
+// integers:
+//
+//   frame:     subframe count, followed by the subframes
+//   subframe:  (count << 1), followed by count key deltas, or
+//              (removed << 1 | 1), removed key deltas, added, added key deltas
+//
+// Key deltas start at zero for every list, so the first delta is the key
+// itself. Repeated keys have a delta of zero.
+namespace {
+
+  template<class T>
+  BrickAccessFile::Span<T> MakeSpan(T const* data, size_t count)
+  {
+    BrickAccessFile::Span<T> span = { data, count };
+    return span;
+  }
+
+  inline void WriteVarint(uint64_t value, std::vector<uint8_t>& target)
+  {
+    while (value >= 0x80) {
+      target.push_back(uint8_t(value | 0x80));
+      value >>= 7;
+    }
+    target.push_back(uint8_t(value));
+  }
+
+  inline uint64_t ReadVarint(uint8_t const*& p)
+  {
+    uint64_t value = *p++;
+    if (value < 0x80)
+      return value; // most deltas fit into a single byte
+    value &= 0x7F;
+    for (unsigned shift=7;; shift+=7) {
+      uint64_t const byte = *p++;
+      value |= (byte & 0x7F) << shift;
+      if (byte < 0x80)
+        return value;
+    }
+  }
+
+  // Appends count delta coded keys to the given vector.
+  inline void DecodeKeys(uint8_t const*& p, size_t count, std::vector<BrickLayout::Key>& keys)
+  {
+    size_t const offset = keys.size();
+    keys.resize(offset + count);
+    BrickLayout::Key* out = keys.data() + offset;
+    BrickLayout::Key key = 0;
+    for (size_t i=0; i<count; ++i) {
+      key += ReadVarint(p);
+      out[i] = key;
+    }
+  }
+
+}
+
+BrickAccessCompressedTrace::BrickAccessCompressedTrace()
+  : m_Mode(CM_DIFFS)
+  , m_iKeyframeInterval(64)
+  , m_iFrameCount(0)
+  , m_iSubframeCount(0)
+  , m_iBrickCount(0)
+  , m_bFrameOpen(false)
+{}
+
+void BrickAccessCompressedTrace::Reset(BrickLayout const& layout, Mode mode, size_t keyframeInterval)
+{
+  m_Layout = layout;
+  m_Mode = mode;
+  m_iKeyframeInterval = std::max<size_t>(keyframeInterval, 1);
+  m_Data.clear();
+  m_Keyframes.clear();
+  m_iFrameCount = 0;
+  m_iSubframeCount = 0;
+  m_iBrickCount = 0;
+  m_bFrameOpen = false;
+  m_Keys.clear();
+  m_Offsets.assign(1, 0);
+  m_PreviousKeys.clear();
+  m_PreviousOffsets.assign(1, 0);
+}
+
+void BrickAccessCompressedTrace::Compress(BrickAccessTrace const& trace, Mode mode, size_t keyframeInterval)
+{
+  Reset(trace.GetLayout(), mode, keyframeInterval);
+  for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+    BeginFrame();
+    for (size_t s=0; s<trace.GetSubframeCount(f); ++s) {
+      Bricks const keys = trace.GetSubframe(f, s);
+      BeginSubframe(uint32_t(keys.size()));
+      AddKeys(keys.data, keys.size());
+    }
+    EndFrame();
+  }
+  Finish();
+}
+
+void BrickAccessCompressedTrace::Compress(BrickAccessFile const& file, Mode mode, size_t keyframeInterval)
+{
+  if (file.GetStorage() == BrickAccessFile::ST_FLAT) {
+    Compress(file.GetTrace(), mode, keyframeInterval);
+    return;
+  }
+  Reset(BrickLayout(file.GetBrickCounts()), mode, keyframeInterval);
+  std::vector<BrickAccessFile::Frame> const& frames = file.GetFrames();
+  for (size_t f=0; f<frames.size(); ++f) {
+    BeginFrame();
+    for (size_t s=0; s<frames[f].size(); ++s) {
+      BeginSubframe(uint32_t(frames[f][s].size()));
+      AddBricks(frames[f][s].data(), frames[f][s].size());
+    }
+    EndFrame();
+  }
+  Finish();
+}
+
+void BrickAccessCompressedTrace::BeginFrame()
+{
+  if (m_bFrameOpen)
+    EncodeFrame();
+  m_Keys.clear();
+  m_Offsets.assign(1, 0);
+  m_bFrameOpen = true;
+}
+
+void BrickAccessCompressedTrace::BeginSubframe(uint32_t)
+{
+  m_Offsets.push_back(m_Offsets.back());
+}
+
+void BrickAccessCompressedTrace::AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+{
+  size_t const offset = m_Keys.size();
+  m_Keys.resize(offset + count);
+  m_Layout.GetKeys(bricks, count, m_Keys.data() + offset);
+  m_Offsets.back() += count;
+}
+
+void BrickAccessCompressedTrace::AddKeys(Key const* keys, size_t count)
+{
+  m_Keys.insert(m_Keys.end(), keys, keys + count);
+  m_Offsets.back() += count;
+}
+
+void BrickAccessCompressedTrace::EndFrame()
+{
+  if (m_bFrameOpen)
+    EncodeFrame();
+  m_bFrameOpen = false;
+}
+
+void BrickAccessCompressedTrace::Finish()
+{
+  EndFrame();
+  std::vector<Key>().swap(m_Keys);
+  std::vector<size_t>(1, 0).swap(m_Offsets);
+  std::vector<Key>().swap(m_PreviousKeys);
+  std::vector<size_t>(1, 0).swap(m_PreviousOffsets);
+  std::vector<uint8_t>().swap(m_Plain);
+  std::vector<uint8_t>().swap(m_Diff);
+  std::vector<Key>().swap(m_Removed);
+  std::vector<Key>().swap(m_Added);
+  m_Data.shrink_to_fit();
+  m_Keyframes.shrink_to_fit();
+}
+
+void BrickAccessCompressedTrace::EncodeFrame()
+{
+  bool const keyframe = (m_iFrameCount % m_iKeyframeInterval) == 0;
+  if (keyframe)
+    m_Keyframes.push_back(m_Data.size());
+
+  size_t const subframeCount = m_Offsets.size() - 1;
+  size_t const previousCount = m_PreviousOffsets.size() - 1;
+  WriteVarint(subframeCount, m_Data);
+  for (size_t s=0; s<subframeCount; ++s) {
+    Key* const begin = m_Keys.data() + m_Offsets[s];
+    Key* const end = m_Keys.data() + m_Offsets[s+1];
+    std::sort(begin, end);
+    size_t const count = size_t(end - begin);
+
+    m_Plain.clear();
+    WriteVarint(uint64_t(count) << 1, m_Plain);
+    EncodeKeys(begin, count, m_Plain);
+
+    if (m_Mode == CM_DIFFS && !keyframe && s < previousCount) {
+      Key const* const previousBegin = m_PreviousKeys.data() + m_PreviousOffsets[s];
+      Key const* const previousEnd = m_PreviousKeys.data() + m_PreviousOffsets[s+1];
+      m_Removed.clear();
+      m_Added.clear();
+      std::set_difference(previousBegin, previousEnd, begin, end, std::back_inserter(m_Removed));
+      std::set_difference(begin, end, previousBegin, previousEnd, std::back_inserter(m_Added));
+
+      // the differences are at most as long as both subframes, only encode
+      // them if they can be smaller
+      if (m_Removed.size() + m_Added.size() < count) {
+        m_Diff.clear();
+        WriteVarint((uint64_t(m_Removed.size()) << 1) | 1, m_Diff);
+        EncodeKeys(m_Removed.data(), m_Removed.size(), m_Diff);
+        WriteVarint(m_Added.size(), m_Diff);
+        EncodeKeys(m_Added.data(), m_Added.size(), m_Diff);
+        if (m_Diff.size() < m_Plain.size())
+          m_Plain.swap(m_Diff);
+      }
+    }
+    m_Data.insert(m_Data.end(), m_Plain.begin(), m_Plain.end());
+  }
+
+  ++m_iFrameCount;
+  m_iSubframeCount += subframeCount;
+  m_iBrickCount += m_Keys.size();
+  m_Keys.swap(m_PreviousKeys);
+  m_Offsets.swap(m_PreviousOffsets);
+}
+
+void BrickAccessCompressedTrace::EncodeKeys(Key const* keys, size_t count, std::vector<uint8_t>& target)
+{
+  Key previous = 0;
+  for (size_t i=0; i<count; ++i) {
+    WriteVarint(keys[i] - previous, target);
+    previous = keys[i];
+  }
+}
+
+void BrickAccessCompressedTrace::Decompress(BrickAccessTrace& trace) const
+{
+  trace.Reset(m_Layout);
+  trace.Reserve(m_iBrickCount, size_t(m_iSubframeCount), m_iFrameCount);
+  Decoder decoder(*this);
+  while (decoder.NextFrame()) {
+    trace.BeginFrame();
+    for (size_t s=0; s<decoder.GetSubframeCount(); ++s) {
+      Bricks const keys = decoder.GetSubframe(s);
+      trace.BeginSubframe(uint32_t(keys.size()));
+      trace.AddKeys(keys.data, keys.size());
+    }
+    trace.EndFrame();
+  }
+}
+
+BrickLayout const& BrickAccessCompressedTrace::GetLayout() const
+{
+  return m_Layout;
+}
+
+size_t BrickAccessCompressedTrace::GetFrameCount() const
+{
+  return m_iFrameCount;
+}
+
+uint64_t BrickAccessCompressedTrace::GetTotalSubframeCount() const
+{
+  return m_iSubframeCount;
+}
+
+uint64_t BrickAccessCompressedTrace::GetTotalBrickCount() const
+{
+  return m_iBrickCount;
+}
+
+size_t BrickAccessCompressedTrace::GetMemoryUsage() const
+{
+  return m_Data.capacity() + m_Keyframes.capacity() * sizeof(uint64_t);
+}
+
+BrickAccessCompressedTrace::Decoder::Decoder(BrickAccessCompressedTrace const& trace)
+  : m_Trace(trace)
+  , m_iPosition(0)
+  , m_iNextFrame(0)
+  , m_iCurrent(0)
+{
+  m_Frames[0].offsets.assign(1, 0);
+  m_Frames[1].offsets.assign(1, 0);
+}
+
+void BrickAccessCompressedTrace::Decoder::Seek(size_t frame)
+{
+  if (frame >= m_Trace.m_iFrameCount) {
+    m_iPosition = m_Trace.m_Data.size();
+    m_iNextFrame = m_Trace.m_iFrameCount;
+    return;
+  }
+
+  // continue from the current position if no keyframe is in between
+  size_t const keyframe = frame / m_Trace.m_iKeyframeInterval;
+  if (frame < m_iNextFrame || keyframe > m_iNextFrame / m_Trace.m_iKeyframeInterval) {
+    m_iPosition = size_t(m_Trace.m_Keyframes[keyframe]);
+    m_iNextFrame = keyframe * m_Trace.m_iKeyframeInterval;
+  }
+  while (m_iNextFrame < frame)
+    NextFrame();
+}
+
+bool BrickAccessCompressedTrace::Decoder::NextFrame()
+{
+  if (m_iNextFrame >= m_Trace.m_iFrameCount)
+    return false;
+
+  FrameBuffer const& previous = m_Frames[m_iCurrent];
+  m_iCurrent = 1 - m_iCurrent;
+  FrameBuffer& current = m_Frames[m_iCurrent];
+  current.keys.clear();
+  current.offsets.assign(1, 0);
+
+  uint8_t const* p = m_Trace.m_Data.data() + m_iPosition;
+  size_t const subframeCount = size_t(ReadVarint(p));
+  for (size_t s=0; s<subframeCount; ++s) {
+    uint64_t const tag = ReadVarint(p);
+    if ((tag & 1) == 0) {
+      DecodeKeys(p, size_t(tag >> 1), current.keys);
+      current.offsets.push_back(current.keys.size());
+      continue;
+    }
+
+    m_Removed.clear();
+    m_Added.clear();
+    DecodeKeys(p, size_t(tag >> 1), m_Removed);
+    size_t const addedCount = size_t(ReadVarint(p));
+    DecodeKeys(p, addedCount, m_Added);
+
+    // merge the previous subframe without the removed keys with the added
+    // keys, removed keys are a sorted sub-multiset of the previous subframe
+    Key const* key = previous.keys.data() + previous.offsets[s];
+    Key const* const keyEnd = previous.keys.data() + previous.offsets[s+1];
+    Key const* removed = m_Removed.data();
+    Key const* const removedEnd = removed + m_Removed.size();
+    Key const* added = m_Added.data();
+    Key const* const addedEnd = added + m_Added.size();
+    for (; key != keyEnd; ++key) {
+      if (removed != removedEnd && *removed == *key) {
+        ++removed;
+        continue;
+      }
+      while (added != addedEnd && *added < *key)
+        current.keys.push_back(*added++);
+      current.keys.push_back(*key);
+    }
+    current.keys.insert(current.keys.end(), added, addedEnd);
+    current.offsets.push_back(current.keys.size());
+  }
+
+  m_iPosition = size_t(p - m_Trace.m_Data.data());
+  ++m_iNextFrame;
+  return true;
+}
+
+size_t BrickAccessCompressedTrace::Decoder::GetFrameIndex() const
+{
+  return m_iNextFrame - 1;
+}
+
+size_t BrickAccessCompressedTrace::Decoder::GetSubframeCount() const
+{
+  return m_Frames[m_iCurrent].offsets.size() - 1;
+}
+
+BrickAccessCompressedTrace::Bricks BrickAccessCompressedTrace::Decoder::GetSubframe(size_t subframe) const
+{
+  FrameBuffer const& frame = m_Frames[m_iCurrent];
+  size_t const begin = frame.offsets[subframe];
+  return MakeSpan(frame.keys.data() + begin, frame.offsets[subframe+1] - begin);
+}
+
+BrickAccessCompressedTrace::Bricks BrickAccessCompressedTrace::Decoder::GetFrame() const
+{
+  FrameBuffer const& frame = m_Frames[m_iCurrent];
+  return MakeSpan(frame.keys.data(), frame.keys.size());
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
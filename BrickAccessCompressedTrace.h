@@ -0,0 +1,178 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_COMPRESSED_TRACE_H
+#define BRICK_ACCESS_COMPRESSED_TRACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+#include "BrickLayout.h"
+
+// Compressed in-memory storage of the captured brick accesses, meant to keep
+// many traces resident at once. The bricks of every subframe are stored as
+// sorted brick keys (see BrickLayout) whose differences are written as
+// variable length integers. Consecutive frames of a ray-guided renderer
+// request mostly the same bricks, so a subframe can also be stored as the
+// bricks removed from and added to the same subframe of the previous frame.
+// The smaller of both encodings is chosen per subframe.
+//
+// The order of bricks within a subframe is not kept, decoded subframes are
+// sorted by key. Repeated requests of a brick within a subframe are kept.
+//
+// Frames are decoded one after another by a Decoder. Every keyframe interval
+// a frame is stored without differences, which allows to start decoding at
+// any frame.
+class BrickAccessCompressedTrace {
+public:
+  typedef BrickAccessTrace::Key Key;
+  typedef BrickAccessTrace::Bricks Bricks;
+
+  // Encodings to choose from.
+  enum Mode {
+    // Every subframe stores its own sorted keys.
+    CM_SUBFRAMES = 0,
+    // Subframes may store differences to the previous frame.
+    CM_DIFFS
+  };
+
+  // Creates an empty trace.
+  BrickAccessCompressedTrace();
+
+  // Removes all frames and prepares the encoding of new ones.
+  // @param layout converts bricks to keys.
+  // @param keyframeInterval is the number of frames from one frame stored
+  //   without differences to the next, which bounds the decoding work to reach
+  //   a frame. Zero is treated as one.
+  void Reset(BrickLayout const& layout, Mode mode = CM_DIFFS, size_t keyframeInterval = 64);
+
+  // Replaces the content by a compressed copy of a trace.
+  void Compress(BrickAccessTrace const& trace, Mode mode = CM_DIFFS, size_t keyframeInterval = 64);
+
+  // Replaces the content by a compressed copy of a loaded file.
+  void Compress(BrickAccessFile const& file, Mode mode = CM_DIFFS, size_t keyframeInterval = 64);
+
+  // Parser sink interface, see BrickAccessParser. Frames are encoded once
+  // they are complete, call Finish() after the last frame.
+  void BeginFrame();
+  void BeginSubframe(uint32_t expectedBricks);
+  void AddBricks(BrickAccessFile::Brick const* bricks, size_t count);
+  void AddKeys(Key const* keys, size_t count);
+  void EndFrame();
+
+  // Encodes a pending frame and releases the encoder buffers.
+  void Finish();
+
+  // Decompresses all frames into a flat trace.
+  void Decompress(BrickAccessTrace& trace) const;
+
+  // @returns the layout which maps keys to bricks.
+  BrickLayout const& GetLayout() const;
+
+  // @returns the number of frames.
+  size_t GetFrameCount() const;
+
+  // @returns the number of subframes of all frames.
+  uint64_t GetTotalSubframeCount() const;
+
+  // @returns the number of bricks of all frames.
+  uint64_t GetTotalBrickCount() const;
+
+  // @returns the number of bytes of the compressed data and keyframe index.
+  size_t GetMemoryUsage() const;
+
+  // Decodes the frames of a compressed trace in order. Buffers are reused, so
+  // no allocations happen once they have grown to the largest frame.
+  class Decoder {
+  public:
+    // Creates a decoder positioned in front of the first frame.
+    explicit Decoder(BrickAccessCompressedTrace const& trace);
+
+    // Positions the decoder in front of the given frame.
+    void Seek(size_t frame);
+
+    // Decodes the next frame.
+    // @returns false after the last frame.
+    bool NextFrame();
+
+    // @returns the index of the current frame.
+    size_t GetFrameIndex() const;
+
+    // @returns the number of subframes of the current frame.
+    size_t GetSubframeCount() const;
+
+    // @returns the sorted bricks of a subframe of the current frame.
+    Bricks GetSubframe(size_t subframe) const;
+
+    // @returns the bricks of all subframes of the current frame.
+    Bricks GetFrame() const;
+
+  private:
+    Decoder& operator=(Decoder const&);
+
+    struct FrameBuffer {
+      std::vector<Key> keys;
+      std::vector<size_t> offsets;
+    };
+
+    BrickAccessCompressedTrace const& m_Trace;
+    size_t m_iPosition;
+    size_t m_iNextFrame;
+    FrameBuffer m_Frames[2];
+    size_t m_iCurrent;
+    std::vector<Key> m_Removed;
+    std::vector<Key> m_Added;
+  };
+
+private:
+  void EncodeFrame();
+  void EncodeKeys(Key const* keys, size_t count, std::vector<uint8_t>& target);
+
+  BrickLayout m_Layout;
+  Mode m_Mode;
+  size_t m_iKeyframeInterval;
+  std::vector<uint8_t> m_Data;
+  // byte offset of every keyframe
+  std::vector<uint64_t> m_Keyframes;
+  size_t m_iFrameCount;
+  uint64_t m_iSubframeCount;
+  uint64_t m_iBrickCount;
+
+  // encoder state, the frame being collected and the previous frame
+  bool m_bFrameOpen;
+  std::vector<Key> m_Keys;
+  std::vector<size_t> m_Offsets;
+  std::vector<Key> m_PreviousKeys;
+  std::vector<size_t> m_PreviousOffsets;
+  std::vector<uint8_t> m_Plain;
+  std::vector<uint8_t> m_Diff;
+  std::vector<Key> m_Removed;
+  std::vector<Key> m_Added;
+};
+
+#endif // BRICK_ACCESS_COMPRESSED_TRACE_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -1,8 +1,19 @@
 #include "BrickAccessFile.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+#include "BrickAccessArena.h"
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessIndex.h"
+#include "BrickAccessParser.h"
+#include "BrickAccessStats.h"
+#include "BrickAccessTrace.h"
+#include "LineReader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
 namespace {
 
   enum ProtectMode {
@@ -119,24 +130,913 @@ namespace {
     return t;
   }
 
+  // Parses a complete brick access file in memory and prints errors.
+  // @param pCounters receives the statistics of the parse, may be null.
+  bool ParseFrames(char const* begin, char const* end,
+    BrickAccessFile::Header& header,
+    std::vector<BrickAccessFile::Frame>& frames,
+    BrickAccessStats::Counters* pCounters)
+  {
+    BrickAccessStats::Timer timer(pCounters, BrickAccessStats::PH_SCAN);
+    FrameBuilder builder(frames, pCounters);
+    BrickAccessParser<FrameBuilder> parser(header, builder);
+    parser.SetCounters(pCounters);
+    bool const bSuccess = parser.Parse(begin, end);
+    if (pCounters != nullptr)
+      pCounters->lines += parser.GetLine();
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Parses the header lines at the beginning of [begin, end) and prints errors.
+  // @param begin is advanced to the first frame data.
+  // @param pCounters receives the statistics of the parse, may be null.
+  bool ParseHeaderLines(char const*& begin, char const* end, BrickAccessFile::Header& header,
+    BrickAccessStats::Counters* pCounters)
+  {
+    BrickAccessStats::Timer timer(pCounters, BrickAccessStats::PH_HEADER);
+    // the header never reaches the sink
+    std::vector<BrickAccessFile::Frame> frames;
+    FrameBuilder builder(frames);
+    BrickAccessParser<FrameBuilder> parser(header, builder);
+    bool const bSuccess = parser.ParseHeader(begin, end);
+    if (pCounters != nullptr)
+      pCounters->lines += parser.GetLine();
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Parses the frames [firstFrame, firstFrame + frameCount) of the indexed
+  // trace at data and prints errors with the line numbers of the file.
+  // @param pCounters receives the statistics of the parse, may be null.
+  template<class Sink>
+  bool ParseFrameRange(char const* data, BrickAccessIndex const& index, size_t firstFrame,
+    size_t frameCount, BrickAccessFile::Header& header, Sink& sink,
+    BrickAccessStats::Counters* pCounters)
+  {
+    if (frameCount == 0)
+      return true;
+    BrickAccessIndex::FrameEntry const& first = index.GetFrame(firstFrame);
+    char const* const begin = data + first.offset;
+    char const* const end = data + index.GetFrameEnd(firstFrame + frameCount - 1);
+
+    BrickAccessStats::Timer timer(pCounters, BrickAccessStats::PH_SCAN);
+    BrickAccessParser<Sink> parser(header, sink);
+    parser.SetBodyOnly(true);
+    parser.SetDeferredFrameBase(true);
+    parser.SetCounters(pCounters);
+    bool const bSuccess = parser.Parse(begin, end);
+    timer.Stop();
+    if (pCounters != nullptr)
+      pCounters->lines += parser.GetLine();
+    if (parser.GetFrameBaseLine() != 0 && parser.GetFrameBase() != firstFrame &&
+        (bSuccess || parser.GetErrorLine() > parser.GetFrameBaseLine())) {
+      std::cerr << "failed to parse line " << first.line + parser.GetFrameBaseLine() << ": wrong Frame value" << std::endl;
+      return false;
+    }
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << first.line + parser.GetErrorLine() << parser.GetError() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Reserves arena space for the frame data [begin, end) from upper bounds
+  // of its counts, found without parsing: every brick opens a bracket and
+  // subframe and frame marks are the only lines starting with S and F.
+  void ReserveArena(char const* begin, char const* end, BrickAccessArena& arena)
+  {
+    uint64_t const iBrickCount = uint64_t(std::count(begin, end, '['));
+    size_t iSubframeCount = 0;
+    size_t iFrameCount = 1;
+    for (char const* p=begin; p!=end; ) {
+      iSubframeCount += (*p == 'S');
+      iFrameCount += (*p == 'F');
+      p = BrickAccessScan::FindLineEnd(p, end);
+      if (p != end) ++p;
+    }
+    arena.Reserve(iBrickCount, iSubframeCount, iFrameCount);
+  }
+
+  // A range of frame data which starts right after a frame mark (or at the
+  // first frame) and can therefore be parsed independently.
+  struct FrameChunk {
+    char const* begin;
+    char const* end;
+    std::vector<BrickAccessFile::Frame> frames;
+    BrickAccessTrace trace;
+    BrickAccessArena arena;
+    bool bSuccess;
+    bool bHeaderInBody;
+    uint64_t iLineCount;
+    uint64_t iErrorLine;
+    std::string error;
+    uint64_t iFrameBaseLine;
+    uint32_t iFrameBase;
+    uint32_t iFrameMarks;
+    BrickAccessStats::Counters counters;
+  };
+
+  // @returns the start of the line following the first frame mark at or
+  //   after position p, or end if there is none.
+  char const* FindFrameBoundary(char const* p, char const* end)
+  {
+    if (p[-1] != '\n') {
+      p = BrickAccessScan::FindLineEnd(p, end);
+      if (p != end) ++p;
+    }
+    while (p != end) {
+      char const* eol = BrickAccessScan::FindLineEnd(p, end);
+      BrickAccessScan::LineKind const kind = BrickAccessScan::ClassifyLine(p, eol);
+      p = (eol == end) ? end : eol + 1;
+      if (kind == BrickAccessScan::LK_FRAME)
+        return p;
+    }
+    return end;
+  }
+
+  // Splits the frame data [begin, end) into about chunkCount chunks of
+  // similar size which all start right after a frame mark.
+  void SplitFrameChunks(char const* begin, char const* end, size_t chunkCount,
+    std::vector<FrameChunk>& chunks)
+  {
+    size_t const size = size_t(end - begin);
+    char const* chunkBegin = begin;
+    for (size_t i=1; i<=chunkCount && chunkBegin != end; ++i) {
+      char const* chunkEnd = end;
+      if (i < chunkCount) {
+        char const* target = begin + size / chunkCount * i;
+        if (target <= chunkBegin)
+          continue;
+        chunkEnd = FindFrameBoundary(target, end);
+      }
+      chunks.push_back(FrameChunk());
+      chunks.back().begin = chunkBegin;
+      chunks.back().end = chunkEnd;
+      chunkBegin = chunkEnd;
+    }
+  }
+
+  // @param pCounters is null or the counters of the chunk, which the sink
+  //   has to use as well.
+  template<class Sink>
+  void ParseFrameChunk(BrickAccessFile::Header const& header, FrameChunk& chunk, Sink& sink,
+    BrickAccessStats::Counters* pCounters)
+  {
+    // every chunk gets its own copy, header marks in the frame data are
+    // detected and handled by the caller
+    BrickAccessStats::Timer timer(pCounters, BrickAccessStats::PH_SCAN);
+    BrickAccessFile::Header localHeader(header);
+    BrickAccessParser<Sink> parser(localHeader, sink);
+    parser.SetBodyOnly(true);
+    parser.SetDeferredFrameBase(true);
+    parser.SetCounters(pCounters);
+    chunk.bSuccess = parser.Parse(chunk.begin, chunk.end);
+    chunk.bHeaderInBody = parser.FoundHeaderInBody();
+    chunk.iLineCount = parser.GetLine();
+    chunk.iErrorLine = parser.GetErrorLine();
+    chunk.error = parser.GetError();
+    chunk.iFrameBaseLine = parser.GetFrameBaseLine();
+    chunk.iFrameBase = parser.GetFrameBase();
+    chunk.iFrameMarks = parser.GetFrameBaseLine() != 0 ?
+      parser.GetFrameCounter() - parser.GetFrameBase() : 0;
+    if (pCounters != nullptr)
+      pCounters->lines += chunk.iLineCount;
+  }
+
+  // @returns the counters of a chunk if statistics are collected, cleared
+  //   for the next parse.
+  BrickAccessStats::Counters* GetChunkCounters(FrameChunk& chunk, BrickAccessStats::Counters* pCounters)
+  {
+    if (pCounters == nullptr)
+      return nullptr;
+    chunk.counters.Clear();
+    return &chunk.counters;
+  }
+
+  // Adds the counters of all chunks, which were parsed concurrently.
+  void AddChunkCounters(std::vector<FrameChunk> const& chunks, BrickAccessStats::Counters* pCounters)
+  {
+    if (pCounters == nullptr)
+      return;
+    for (size_t i=0; i<chunks.size(); ++i)
+      pCounters->Add(chunks[i].counters);
+  }
+
+  // Validates the chunk sequence in file order, the first problem wins.
+  // @param iLineBase is the number of lines in front of the first chunk.
+  // @param pHeaderInBody receives whether a chunk stopped at a header mark,
+  //   which is not reported as error then. Null reports it like any error.
+  // @returns false if a chunk failed, see std::cerr for details.
+  bool CheckFrameChunks(std::vector<FrameChunk> const& chunks, uint64_t iLineBase,
+    bool* pHeaderInBody)
+  {
+    uint32_t iFrameCounter = 0;
+    for (size_t i=0; i<chunks.size(); ++i) {
+      FrameChunk const& chunk = chunks[i];
+      if (chunk.iFrameBaseLine != 0 && chunk.iFrameBase != iFrameCounter &&
+          (chunk.bSuccess || chunk.iErrorLine > chunk.iFrameBaseLine)) {
+        std::cerr << "failed to parse line " << iLineBase + chunk.iFrameBaseLine << ": wrong Frame value" << std::endl;
+        return false;
+      }
+      if (!chunk.bSuccess) {
+        if (pHeaderInBody != nullptr && chunk.bHeaderInBody) {
+          *pHeaderInBody = true;
+          return false;
+        }
+        std::cerr << "failed to parse line " << iLineBase + chunk.iErrorLine << chunk.error << std::endl;
+        return false;
+      }
+      iLineBase += chunk.iLineCount;
+      iFrameCounter += chunk.iFrameMarks;
+    }
+    return true;
+  }
+
 }
 
 BrickAccessFile::BrickAccessFile(std::string const& filename)
-  : m_File(filename)
+  : m_Filename(filename)
+  , m_File(filename)
+  , m_Storage(ST_FRAMES)
+  , m_KeyOrder(KO_ROW_MAJOR)
+  , m_pTrace(new BrickAccessTrace())
+  , m_pArena(new BrickAccessArena())
+  , m_pIndex(new BrickAccessIndex())
+  , m_iFirstFrame(0)
+  , m_bFramesCreated(false)
+  , m_pStats(nullptr)
+{}
+
+BrickAccessFile::~BrickAccessFile()
 {}
 
-bool BrickAccessFile::Load()
+void BrickAccessFile::SetStorage(Storage storage, KeyOrder order)
+{
+  m_Storage = storage;
+  m_KeyOrder = order;
+}
+
+BrickAccessFile::Storage BrickAccessFile::GetStorage() const
+{
+  return m_Storage;
+}
+
+void BrickAccessFile::SetStats(BrickAccessStats* pStats)
+{
+  m_pStats = pStats;
+}
+
+bool BrickAccessFile::Load(LoadMode mode, size_t threadCount)
+{
+  BrickAccessStats::Scope const scope(m_pStats);
+  m_pTrace->Clear();
+  m_pArena->Clear();
+  m_bFramesCreated = false;
+  m_iFirstFrame = 0;
+  if (BrickAccessBinaryFile::IsBinaryFile(m_Filename)) {
+    m_Frames.clear();
+    bool const bSuccess = LoadBinary(false, 0, ~size_t(0));
+    m_pTrace->SetCounters(nullptr);
+    m_pArena->SetCounters(nullptr);
+    return bSuccess;
+  }
+  if (m_Storage == ST_FLAT) {
+    m_Frames.clear();
+    bool const bSuccess = LoadFlat(mode, threadCount);
+    m_pTrace->SetCounters(nullptr);
+    return bSuccess;
+  }
+  if (m_Storage == ST_ARENA) {
+    m_Frames.clear();
+    bool const bSuccess = LoadArena(mode, threadCount);
+    m_pArena->SetCounters(nullptr);
+    return bSuccess;
+  }
+
+  switch (mode) {
+  case LM_MAPPED :
+    return LoadMapped();
+  case LM_PARALLEL :
+    return LoadParallel(threadCount);
+  default :
+    return LoadStream();
+  }
+}
+
+bool BrickAccessFile::LoadHeader()
+{
+  BrickAccessStats::Scope const scope(m_pStats);
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  m_pTrace->Clear();
+  m_pArena->Clear();
+  m_Frames.clear();
+  m_bFramesCreated = false;
+  m_iFirstFrame = 0;
+  if (BrickAccessBinaryFile::IsBinaryFile(m_Filename))
+    return LoadBinary(true, 0, 0);
+
+  // only the pages of the header are read from the mapping
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  m_Header = Header();
+  char const* const data = file.GetData();
+  char const* begin = data;
+  bool const bSuccess = ParseHeaderLines(begin, data + file.GetSize(), m_Header, pCounters);
+  if (pCounters != nullptr)
+    m_pStats->bytes = uint64_t(begin - data);
+  return bSuccess;
+}
+
+bool BrickAccessFile::LoadIndex(bool saveSidecar)
+{
+  if (BrickAccessBinaryFile::IsBinaryFile(m_Filename)) {
+    std::cerr << "failed to index file " << m_Filename << ": binary files store their frame offsets and need no index"
+      << std::endl;
+    return false;
+  }
+  BrickAccessStats::Scope const scope(m_pStats);
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  if (pCounters != nullptr)
+    m_pStats->bytes = file.GetSize();
+  BrickAccessStats::Timer indexTimer(pCounters, BrickAccessStats::PH_INDEX);
+  return UpdateIndex(file.GetData(), file.GetData() + file.GetSize(), saveSidecar);
+}
+
+bool BrickAccessFile::UpdateIndex(char const* begin, char const* end, bool saveSidecar)
+{
+  std::string const sidecar = BrickAccessIndex::GetSidecarFilename(m_Filename);
+  if (m_pIndex->Load(sidecar, begin, end))
+    return true;
+  if (!m_pIndex->Build(begin, end))
+    return false;
+  if (saveSidecar)
+    m_pIndex->Save(sidecar);
+  return true;
+}
+
+bool BrickAccessFile::LoadFrames(size_t firstFrame, size_t frameCount)
+{
+  BrickAccessStats::Scope const scope(m_pStats);
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  m_pTrace->Clear();
+  m_pArena->Clear();
+  m_Frames.clear();
+  m_bFramesCreated = false;
+  m_iFirstFrame = firstFrame;
+  if (BrickAccessBinaryFile::IsBinaryFile(m_Filename)) {
+    bool const bSuccess = LoadBinary(false, firstFrame, frameCount);
+    m_pTrace->SetCounters(nullptr);
+    m_pArena->SetCounters(nullptr);
+    return bSuccess;
+  }
+
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  char const* const data = file.GetData();
+  char const* const end = data + file.GetSize();
+  BrickAccessStats::Timer indexTimer(pCounters, BrickAccessStats::PH_INDEX);
+  if (!m_pIndex->Matches(data, end) && !UpdateIndex(data, end, true))
+    return false;
+  indexTimer.Stop();
+
+  BrickAccessIndex const& index = *m_pIndex;
+  if (firstFrame > index.GetFrameCount() || frameCount > index.GetFrameCount() - firstFrame) {
+    std::cerr << "failed to load frames " << firstFrame << " to " << firstFrame + frameCount
+      << " of file " << m_Filename << ": the file has " << index.GetFrameCount() << " frames" << std::endl;
+    return false;
+  }
+
+  m_Header = Header();
+  char const* body = data;
+  if (!ParseHeaderLines(body, end, m_Header, pCounters))
+    return false;
+  if (pCounters != nullptr && frameCount > 0) {
+    m_pStats->bytes = uint64_t(body - data) + index.GetFrameEnd(firstFrame + frameCount - 1) -
+      index.GetFrame(firstFrame).offset;
+  }
+
+  if (m_Storage == ST_FLAT) {
+    if (!StartTrace()) return false;
+    m_pTrace->SetCounters(pCounters);
+    bool const bSuccess = ParseFrameRange(data, index, firstFrame, frameCount, m_Header, *m_pTrace, pCounters);
+    if (bSuccess) {
+      BrickAccessStats::Timer mergeTimer(pCounters, BrickAccessStats::PH_MERGE);
+      m_pTrace->ShrinkToFit();
+    }
+    m_pTrace->SetCounters(nullptr);
+    return bSuccess;
+  }
+
+  if (m_Storage == ST_ARENA) {
+    // the index knows the exact size of every frame
+    BrickAccessArena& arena = *m_pArena;
+    arena.SetCounters(pCounters);
+    uint64_t iBrickCount = 0;
+    for (size_t f=firstFrame; f<firstFrame+frameCount; ++f)
+      iBrickCount += index.GetFrame(f).brickCount;
+    size_t const iSubframeCount = frameCount == 0 ? 0 :
+      size_t(index.GetFrame(firstFrame + frameCount - 1).firstSubframe - index.GetFrame(firstFrame).firstSubframe) +
+      index.GetSubframeCount(firstFrame + frameCount - 1);
+    arena.Reserve(iBrickCount, iSubframeCount, frameCount);
+    bool const bSuccess = ParseFrameRange(data, index, firstFrame, frameCount, m_Header, arena, pCounters);
+    arena.SetCounters(nullptr);
+    return bSuccess;
+  }
+
+  FrameBuilder builder(m_Frames, pCounters);
+  return ParseFrameRange(data, index, firstFrame, frameCount, m_Header, builder, pCounters);
+}
+
+size_t BrickAccessFile::GetFirstFrame() const
+{
+  return m_iFirstFrame;
+}
+
+BrickAccessIndex const& BrickAccessFile::GetIndex() const
+{
+  return *m_pIndex;
+}
+
+bool BrickAccessFile::LoadMapped()
+{
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  if (pCounters != nullptr)
+    m_pStats->bytes = file.GetSize();
+  m_Frames.clear();
+  return ParseFrames(file.GetData(), file.GetData() + file.GetSize(), m_Header, m_Frames, pCounters);
+}
+
+bool BrickAccessFile::LoadParallel(size_t threadCount)
+{
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  m_Frames.clear();
+  char const* const begin = file.GetData();
+  char const* const end = begin + file.GetSize();
+
+  // the header changes the validation of all frame data, parse it up front
+  BrickAccessStats::Timer headerTimer(pCounters, BrickAccessStats::PH_HEADER);
+  char const* body = begin;
+  FrameBuilder builder(m_Frames, pCounters);
+  BrickAccessParser<FrameBuilder> parser(m_Header, builder);
+  parser.SetCounters(pCounters);
+  if (!parser.ParseHeader(body, end)) {
+    std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+    return false;
+  }
+  headerTimer.Stop();
+
+  ThreadPool pool(threadCount);
+  if (pCounters != nullptr) {
+    m_pStats->bytes = file.GetSize();
+    m_pStats->threads = uint32_t(pool.GetThreadCount());
+  }
+  std::vector<FrameChunk> chunks;
+  SplitFrameChunks(body, end, pool.GetThreadCount() * 4, chunks);
+  if (chunks.size() <= 1) {
+    BrickAccessStats::Timer scanTimer(pCounters, BrickAccessStats::PH_SCAN);
+    bool const bSuccess = parser.Parse(body, end);
+    if (pCounters != nullptr)
+      pCounters->lines += parser.GetLine();
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  Header const& header = m_Header;
+  pool.ParallelFor(chunks.size(), [&chunks, &header, pCounters](size_t i) {
+    BrickAccessStats::Counters* const pChunkCounters = GetChunkCounters(chunks[i], pCounters);
+    FrameBuilder builder(chunks[i].frames, pChunkCounters);
+    ParseFrameChunk(header, chunks[i], builder, pChunkCounters);
+  });
+  AddChunkCounters(chunks, pCounters);
+  if (pCounters != nullptr)
+    pCounters->lines += parser.GetLine();
+
+  bool bHeaderInBody = false;
+  if (!CheckFrameChunks(chunks, parser.GetLine(), &bHeaderInBody)) {
+    if (!bHeaderInBody)
+      return false;
+    // header marks between frames, only a sequential parse is exact
+    chunks.clear();
+    m_Frames.clear();
+    // the parse statistics only describe the sequential parse
+    if (pCounters != nullptr)
+      pCounters->ClearParse();
+    return ParseFrames(begin, end, m_Header, m_Frames, pCounters);
+  }
+
+  BrickAccessStats::Timer mergeTimer(pCounters, BrickAccessStats::PH_MERGE);
+  size_t iFrameCount = 0;
+  for (size_t i=0; i<chunks.size(); ++i)
+    iFrameCount += chunks[i].frames.size();
+  size_t const capacity = m_Frames.capacity();
+  m_Frames.reserve(iFrameCount);
+  BrickAccessStats::CountCapacity(pCounters, capacity, m_Frames);
+  for (size_t i=0; i<chunks.size(); ++i) {
+    std::vector<Frame>& frames = chunks[i].frames;
+    for (size_t f=0; f<frames.size(); ++f) {
+      m_Frames.push_back(Frame());
+      m_Frames.back().swap(frames[f]);
+    }
+    size_t const chunkCapacity = frames.capacity();
+    std::vector<Frame>().swap(frames);
+    BrickAccessStats::CountCapacity(pCounters, chunkCapacity, frames);
+  }
+  return true;
+}
+
+bool BrickAccessFile::LoadFlat(LoadMode mode, size_t threadCount)
+{
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  BrickAccessTrace& trace = *m_pTrace;
+  trace.SetCounters(pCounters);
+  BrickAccessParser<BrickAccessTrace> parser(m_Header, trace);
+  parser.SetCounters(pCounters);
+
+  if (mode == LM_STREAM) {
+    BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+    LineReader reader;
+    if (!reader.Open(m_Filename)) return false;
+    openTimer.Stop();
+
+    bool bBody = false;
+    char const* begin;
+    char const* end;
+    for (;;) {
+      // reading is timed per line, as the reader refills its buffer on demand
+      BrickAccessStats::Timer readTimer(pCounters, BrickAccessStats::PH_READ);
+      if (!reader.NextLine(begin, end))
+        break;
+      readTimer.Stop();
+      BrickAccessStats::Timer scanTimer(pCounters, bBody ? BrickAccessStats::PH_SCAN : BrickAccessStats::PH_HEADER);
+      BrickAccessScan::LineKind const kind = bBody ? BrickAccessScan::LK_NONE :
+        BrickAccessScan::ClassifyLine(begin, end);
+      if (kind == BrickAccessScan::LK_BRICKS || kind == BrickAccessScan::LK_SUBFRAME ||
+          kind == BrickAccessScan::LK_FRAME) {
+        // keys depend on the brick counts, so the header must not change
+        if (!StartTrace()) return false;
+        parser.SetBodyOnly(true);
+        bBody = true;
+      }
+      if (!parser.ParseLine(begin, end)) {
+        std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+        return false;
+      }
+    }
+    if (pCounters != nullptr) {
+      m_pStats->bytes = reader.GetPosition();
+      pCounters->lines += parser.GetLine();
+    }
+    if (reader.HasFailed()) {
+      std::cerr << "failed to read file after line " << parser.GetLine() << std::endl;
+      return false;
+    }
+    if (!bBody && !StartTrace()) return false;
+    BrickAccessStats::Timer mergeTimer(pCounters, BrickAccessStats::PH_MERGE);
+    trace.ShrinkToFit();
+    return true;
+  }
+
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  BrickAccessStats::Timer headerTimer(pCounters, BrickAccessStats::PH_HEADER);
+  char const* body = file.GetData();
+  char const* const end = body + file.GetSize();
+  if (!parser.ParseHeader(body, end)) {
+    std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+    return false;
+  }
+  if (!StartTrace()) return false;
+  parser.SetBodyOnly(true);
+  headerTimer.Stop();
+  if (pCounters != nullptr)
+    m_pStats->bytes = file.GetSize();
+
+  std::vector<FrameChunk> chunks;
+  if (mode == LM_PARALLEL) {
+    ThreadPool pool(threadCount);
+    if (pCounters != nullptr)
+      m_pStats->threads = uint32_t(pool.GetThreadCount());
+    SplitFrameChunks(body, end, pool.GetThreadCount() * 4, chunks);
+    if (chunks.size() > 1) {
+      Header const& header = m_Header;
+      pool.ParallelFor(chunks.size(), [&chunks, &header, &trace, pCounters](size_t i) {
+        BrickAccessStats::Counters* const pChunkCounters = GetChunkCounters(chunks[i], pCounters);
+        chunks[i].trace.Reset(trace.GetLayout());
+        chunks[i].trace.SetCounters(pChunkCounters);
+        ParseFrameChunk(header, chunks[i], chunks[i].trace, pChunkCounters);
+        chunks[i].trace.SetCounters(nullptr);
+      });
+      AddChunkCounters(chunks, pCounters);
+    }
+  }
+
+  if (chunks.size() <= 1) {
+    BrickAccessStats::Timer scanTimer(pCounters, BrickAccessStats::PH_SCAN);
+    bool const bSuccess = parser.Parse(body, end);
+    scanTimer.Stop();
+    if (pCounters != nullptr)
+      pCounters->lines += parser.GetLine();
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+      return false;
+    }
+    BrickAccessStats::Timer mergeTimer(pCounters, BrickAccessStats::PH_MERGE);
+    trace.ShrinkToFit();
+    return true;
+  }
+
+  if (pCounters != nullptr)
+    pCounters->lines += parser.GetLine();
+  if (!CheckFrameChunks(chunks, parser.GetLine(), nullptr))
+    return false;
+
+  BrickAccessStats::Timer mergeTimer(pCounters, BrickAccessStats::PH_MERGE);
+  uint64_t iBrickCount = 0;
+  size_t iSubframeCount = 0;
+  size_t iFrameCount = 0;
+  for (size_t i=0; i<chunks.size(); ++i) {
+    iBrickCount += chunks[i].trace.GetTotalBrickCount();
+    iSubframeCount += chunks[i].trace.GetTotalSubframeCount();
+    iFrameCount += chunks[i].trace.GetFrameCount();
+  }
+  trace.Reserve(iBrickCount, iSubframeCount, iFrameCount);
+  for (size_t i=0; i<chunks.size(); ++i) {
+    trace.Append(chunks[i].trace);
+    // the chunk memory has been counted by the chunk threads
+    chunks[i].trace.SetCounters(pCounters);
+    chunks[i].trace.Clear();
+    chunks[i].trace.SetCounters(nullptr);
+  }
+  return true;
+}
+
+bool BrickAccessFile::LoadArena(LoadMode mode, size_t threadCount)
+{
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  BrickAccessArena& arena = *m_pArena;
+  arena.SetCounters(pCounters);
+  BrickAccessParser<BrickAccessArena> parser(m_Header, arena);
+  parser.SetCounters(pCounters);
+
+  if (mode == LM_STREAM) {
+    // nothing is known up front, the blocks grow geometrically
+    BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+    LineReader reader;
+    if (!reader.Open(m_Filename)) return false;
+    openTimer.Stop();
+
+    bool bBody = false;
+    char const* begin;
+    char const* end;
+    for (;;) {
+      BrickAccessStats::Timer readTimer(pCounters, BrickAccessStats::PH_READ);
+      if (!reader.NextLine(begin, end))
+        break;
+      readTimer.Stop();
+      BrickAccessStats::Timer scanTimer(pCounters, bBody ? BrickAccessStats::PH_SCAN : BrickAccessStats::PH_HEADER);
+      BrickAccessScan::LineKind const kind = bBody ? BrickAccessScan::LK_NONE :
+        BrickAccessScan::ClassifyLine(begin, end);
+      bBody = bBody || kind == BrickAccessScan::LK_BRICKS || kind == BrickAccessScan::LK_SUBFRAME ||
+        kind == BrickAccessScan::LK_FRAME;
+      if (!parser.ParseLine(begin, end)) {
+        std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+        return false;
+      }
+    }
+    if (pCounters != nullptr) {
+      m_pStats->bytes = reader.GetPosition();
+      pCounters->lines += parser.GetLine();
+    }
+    if (reader.HasFailed()) {
+      std::cerr << "failed to read file after line " << parser.GetLine() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  MappedFile file;
+  if (!file.Open(m_Filename)) return false;
+  openTimer.Stop();
+
+  BrickAccessStats::Timer headerTimer(pCounters, BrickAccessStats::PH_HEADER);
+  char const* body = file.GetData();
+  char const* const end = body + file.GetSize();
+  if (!parser.ParseHeader(body, end)) {
+    std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+    return false;
+  }
+  headerTimer.Stop();
+  if (pCounters != nullptr)
+    m_pStats->bytes = file.GetSize();
+
+  std::vector<FrameChunk> chunks;
+  if (mode == LM_PARALLEL) {
+    ThreadPool pool(threadCount);
+    if (pCounters != nullptr)
+      m_pStats->threads = uint32_t(pool.GetThreadCount());
+    SplitFrameChunks(body, end, pool.GetThreadCount() * 4, chunks);
+    if (chunks.size() > 1) {
+      Header const& header = m_Header;
+      pool.ParallelFor(chunks.size(), [&chunks, &header, pCounters](size_t i) {
+        BrickAccessStats::Counters* const pChunkCounters = GetChunkCounters(chunks[i], pCounters);
+        BrickAccessArena& chunkArena = chunks[i].arena;
+        chunkArena.SetCounters(pChunkCounters);
+        {
+          BrickAccessStats::Timer indexTimer(pChunkCounters, BrickAccessStats::PH_INDEX);
+          ReserveArena(chunks[i].begin, chunks[i].end, chunkArena);
+        }
+        ParseFrameChunk(header, chunks[i], chunkArena, pChunkCounters);
+        chunkArena.SetCounters(nullptr);
+      });
+      AddChunkCounters(chunks, pCounters);
+    }
+  }
+
+  if (chunks.size() <= 1) {
+    BrickAccessStats::Timer indexTimer(pCounters, BrickAccessStats::PH_INDEX);
+    ReserveArena(body, end, arena);
+    indexTimer.Stop();
+    BrickAccessStats::Timer scanTimer(pCounters, BrickAccessStats::PH_SCAN);
+    bool const bSuccess = parser.Parse(body, end);
+    scanTimer.Stop();
+    if (pCounters != nullptr)
+      pCounters->lines += parser.GetLine();
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << parser.GetErrorLine() << parser.GetError() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  if (pCounters != nullptr)
+    pCounters->lines += parser.GetLine();
+  bool bHeaderInBody = false;
+  if (!CheckFrameChunks(chunks, parser.GetLine(), &bHeaderInBody)) {
+    if (!bHeaderInBody)
+      return false;
+    // header marks between frames, only a sequential parse is exact
+    chunks.clear();
+    if (pCounters != nullptr)
+      pCounters->ClearParse();
+    ReserveArena(file.GetData(), end, arena);
+    BrickAccessStats::Timer scanTimer(pCounters, BrickAccessStats::PH_SCAN);
+    BrickAccessParser<BrickAccessArena> sequentialParser(m_Header, arena);
+    sequentialParser.SetCounters(pCounters);
+    bool const bSuccess = sequentialParser.Parse(file.GetData(), end);
+    if (pCounters != nullptr)
+      pCounters->lines += sequentialParser.GetLine();
+    if (!bSuccess) {
+      std::cerr << "failed to parse line " << sequentialParser.GetErrorLine() << sequentialParser.GetError() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // the blocks of the chunks are handed over, no brick is copied
+  BrickAccessStats::Timer mergeTimer(pCounters, BrickAccessStats::PH_MERGE);
+  size_t iSubframeCount = 0;
+  size_t iFrameCount = 0;
+  for (size_t i=0; i<chunks.size(); ++i) {
+    iSubframeCount += chunks[i].arena.GetTotalSubframeCount();
+    iFrameCount += chunks[i].arena.GetFrameCount();
+  }
+  arena.Reserve(0, iSubframeCount, iFrameCount);
+  for (size_t i=0; i<chunks.size(); ++i) {
+    // the chunk tables have been counted by the chunk threads
+    chunks[i].arena.SetCounters(pCounters);
+    arena.Append(chunks[i].arena);
+    chunks[i].arena.SetCounters(nullptr);
+  }
+  return true;
+}
+
+bool BrickAccessFile::LoadBinary(bool headerOnly, size_t firstFrame, size_t frameCount)
+{
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
+  BrickAccessStats::Timer openTimer(pCounters, BrickAccessStats::PH_OPEN);
+  BrickAccessBinaryFile binary;
+  if (!binary.Open(m_Filename)) return false;
+  openTimer.Stop();
+  if (pCounters != nullptr)
+    m_pStats->bytes = binary.GetFileSize();
+
+  m_Header = binary.GetHeader();
+  if (headerOnly)
+    return true;
+
+  // the offset tables serve as frame index
+  uint64_t const iFrameCount = binary.GetFrameCount();
+  if (frameCount == ~size_t(0) && firstFrame <= iFrameCount)
+    frameCount = size_t(iFrameCount - firstFrame);
+  if (firstFrame > iFrameCount || frameCount > iFrameCount - firstFrame) {
+    std::cerr << "failed to load frames " << firstFrame << " to " << firstFrame + frameCount
+      << " of file " << m_Filename << ": the file has " << iFrameCount << " frames" << std::endl;
+    return false;
+  }
+
+  // the same checks as for ASCII files before any brick is stored
+  BrickAccessStats::Timer validateTimer(pCounters, BrickAccessStats::PH_VALIDATE);
+  if (!binary.Validate()) return false;
+  validateTimer.Stop();
+
+  BrickAccessFile::Span<uint64_t> const frameOffsets = binary.GetFrameOffsets();
+  BrickAccessFile::Span<uint64_t> const subframeOffsets = binary.GetSubframeOffsets();
+  uint64_t const iFirstSubframe = frameOffsets[firstFrame];
+  uint64_t const iSubframeCount = frameOffsets[firstFrame + frameCount] - iFirstSubframe;
+  uint64_t const iBrickCount = subframeOffsets[iFirstSubframe + iSubframeCount] - subframeOffsets[iFirstSubframe];
+
+  BrickAccessStats::Timer storeTimer(pCounters, BrickAccessStats::PH_STORE);
+  if (m_Storage == ST_FLAT) {
+    if (!StartTrace())
+      return false;
+    m_pTrace->SetCounters(pCounters);
+    m_pTrace->Reserve(iBrickCount, size_t(iSubframeCount), frameCount);
+    binary.CopyFrames(firstFrame, frameCount, *m_pTrace);
+  } else if (m_Storage == ST_ARENA) {
+    m_pArena->SetCounters(pCounters);
+    m_pArena->Reserve(iBrickCount, size_t(iSubframeCount), frameCount);
+    binary.CopyFrames(firstFrame, frameCount, *m_pArena);
+  } else {
+    FrameBuilder builder(m_Frames, pCounters);
+    binary.CopyFrames(firstFrame, frameCount, builder);
+  }
+  if (pCounters != nullptr)
+    pCounters->bricks += iBrickCount;
+  return true;
+}
+
+bool BrickAccessFile::StartTrace()
+{
+  BrickLayout const layout(m_Header.brickCounts, m_KeyOrder);
+  if (!layout.IsValid()) {
+    std::cerr << "failed to load file " << m_Filename << ": brick counts exceed the key range" << std::endl;
+    return false;
+  }
+  m_pTrace->Reset(layout);
+  return true;
+}
+
+bool BrickAccessFile::LoadStream()
 {
   if (!m_File.is_open()) return false;
 
+  // everything but reading the lines counts as scan time, sampled brick lines
+  // are split into phases like in BrickAccessParser
+  typedef BrickAccessStats::Clock Clock;
+  BrickAccessStats::Counters* const pCounters = BrickAccessStats::GetCounters(m_pStats);
   m_Frames.clear();
   uint32_t iExpectedBricks = 0;
   uint32_t iSubframeCounter = 0;
   uint32_t iFrameCounter = 0;
 
   std::vector<std::string> tokens, elements;
+  std::vector<Brick> bricks;
   std::string line;
-  for (uint32_t i=1; getline(m_File, line); ++i) {
+  for (uint32_t i=1; ; ++i) {
+    BrickAccessStats::Timer readTimer(pCounters, BrickAccessStats::PH_READ);
+    if (!getline(m_File, line))
+      break;
+    readTimer.Stop();
+    BrickAccessStats::Timer scanTimer(pCounters, BrickAccessStats::PH_SCAN);
+    if (pCounters != nullptr) {
+      m_pStats->bytes += line.size() + 1;
+      ++pCounters->lines;
+    }
     if (line.size() > 0) {
       if (line[0] == '#' )
         continue; // skip comment line
@@ -144,35 +1044,71 @@ bool BrickAccessFile::Load()
       if (line[0] == '[') {
         Frame& frame = m_Frames.back();
         Subframe& subframe = frame.back();
+        bool const bSample = BrickAccessStats::SampleLine(pCounters, line.size());
+        Clock::time_point start;
+        if (bSample)
+          start = Clock::now();
 
         tokens = Tokenize(line, PM_BRACKETS, '[', ']');
         if (tokens.size() != iExpectedBricks) {
           std::cerr << "failed to parse line " << i << ": wrong brick count for subframe" << std::endl;
           return false;
         }
+        bricks.resize(tokens.size());
         for (size_t t=0; t<tokens.size(); ++t) {
           elements = Tokenize(tokens[t], PM_NONE);
           if (elements.size() != 4) {
             std::cerr << "failed to parse line " << i << " at brick number: " << t << std::endl;
             return false;
           }
-          subframe.push_back(Brick());
-          Brick& brick = subframe.back();
+          Brick& brick = bricks[t];
           brick.x = FromString<uint32_t>(elements[0]);
           brick.y = FromString<uint32_t>(elements[1]);
           brick.z = FromString<uint32_t>(elements[2]);
           brick.w = FromString<uint32_t>(elements[3]);
-          if (brick.w >= m_BrickCounts.size()) {
+          if (brick.w >= m_Header.brickCounts.size()) {
             std::cerr << "failed to parse line " << i << " at brick number: " << t << " brick LoD exceeds bounds" << std::endl;
             return false;
           }
-          if (brick.x >= m_BrickCounts[size_t(brick.w)].x ||
-            brick.y >= m_BrickCounts[size_t(brick.w)].y ||
-            brick.z >= m_BrickCounts[size_t(brick.w)].z) {
+          if (brick.x >= m_Header.brickCounts[size_t(brick.w)].x ||
+            brick.y >= m_Header.brickCounts[size_t(brick.w)].y ||
+            brick.z >= m_Header.brickCounts[size_t(brick.w)].z) {
               std::cerr << "failed to parse line " << i << " at brick number: " << t << " brick position exceeds bounds" << std::endl;
               return false;
           }
         }
+        if (bSample) {
+          // the tokenizing and the validation are repeated on their own, the
+          // rest of the parse time is conversion
+          Clock::time_point const parsed = Clock::now();
+          size_t words = 0;
+          std::vector<std::string> const sampleTokens = Tokenize(line, PM_BRACKETS, '[', ']');
+          for (size_t t=0; t<sampleTokens.size(); ++t)
+            words += Tokenize(sampleTokens[t], PM_NONE).size();
+          Clock::time_point const tokenized = Clock::now();
+          size_t valid = 0;
+          for (size_t b=0; b<bricks.size(); ++b) {
+            Brick const& brick = bricks[b];
+            if (brick.w < m_Header.brickCounts.size()) {
+              Vec3<uint64_t> const& brickCount = m_Header.brickCounts[size_t(brick.w)];
+              valid += brick.x < brickCount.x && brick.y < brickCount.y && brick.z < brickCount.z;
+            }
+          }
+          Clock::time_point const validated = Clock::now();
+          // the results keep the repeated parts from being optimized away
+          pCounters->sampledTokens += words + valid;
+          pCounters->sampledParseSeconds += BrickAccessStats::GetSeconds(start, parsed);
+          pCounters->sampledTokenizeSeconds += BrickAccessStats::GetSeconds(parsed, tokenized);
+          pCounters->sampledValidateSeconds += BrickAccessStats::GetSeconds(tokenized, validated);
+          start = Clock::now();
+        }
+        size_t const capacity = subframe.capacity();
+        subframe.insert(subframe.end(), bricks.begin(), bricks.end());
+        BrickAccessStats::CountCapacity(pCounters, capacity, subframe);
+        if (bSample)
+          pCounters->sampledStoreSeconds += BrickAccessStats::GetSeconds(start, Clock::now());
+        if (pCounters != nullptr)
+          pCounters->bricks += tokens.size();
         iSubframeCounter++;
         continue; // finished parsing subframe
       }
@@ -190,9 +1126,9 @@ bool BrickAccessFile::Load()
             std::cerr << "failed to parse line " << i << ": invalid MaxBrickSize" << std::endl;
             return false;
           }
-          m_MaxBrickSize.x = FromString<uint32_t>(tokens[0]);
-          m_MaxBrickSize.y = FromString<uint32_t>(tokens[1]);
-          m_MaxBrickSize.z = FromString<uint32_t>(tokens[2]);
+          m_Header.maxBrickSize.x = FromString<uint32_t>(tokens[0]);
+          m_Header.maxBrickSize.y = FromString<uint32_t>(tokens[1]);
+          m_Header.maxBrickSize.z = FromString<uint32_t>(tokens[2]);
 
         } else if (tokens[0] == "BrickOverlap") {
           tokens = Tokenize(tokens[1], PM_NONE);
@@ -200,9 +1136,9 @@ bool BrickAccessFile::Load()
             std::cerr << "failed to parse line " << i << ": invalid BrickOverlap" << std::endl;
             return false;
           }
-          m_BrickOverlap.x = FromString<uint32_t>(tokens[0]);
-          m_BrickOverlap.y = FromString<uint32_t>(tokens[1]);
-          m_BrickOverlap.z = FromString<uint32_t>(tokens[2]);
+          m_Header.brickOverlap.x = FromString<uint32_t>(tokens[0]);
+          m_Header.brickOverlap.y = FromString<uint32_t>(tokens[1]);
+          m_Header.brickOverlap.z = FromString<uint32_t>(tokens[2]);
 
         } else if (tokens[0] == "LoDCount") {
           if (tokens.size() != 2) {
@@ -210,8 +1146,8 @@ bool BrickAccessFile::Load()
             return false;
           }
           uint32_t const LoDCount = FromString<uint32_t>(tokens[1]);
-          m_DomainSizes.resize(LoDCount);
-          m_BrickCounts.resize(LoDCount);
+          m_Header.domainSizes.resize(LoDCount);
+          m_Header.brickCounts.resize(LoDCount);
 
         } else if (tokens[0] == " LoD" || tokens[0] == "LoD") {
           if (tokens.size() != 4) {
@@ -224,7 +1160,7 @@ bool BrickAccessFile::Load()
             return false;
           }
           uint32_t const LoD = FromString<uint32_t>(elements[0]);
-          if (LoD >= m_DomainSizes.size() || LoD >= m_BrickCounts.size()) {
+          if (LoD >= m_Header.domainSizes.size() || LoD >= m_Header.brickCounts.size()) {
             std::cerr << "failed to parse line " << i << ": LoD not available" << std::endl;
             return false;
           }
@@ -237,9 +1173,9 @@ bool BrickAccessFile::Load()
             std::cerr << "failed to parse line " << i << ": invalid DomainSize" << std::endl;
             return false;
           }
-          m_DomainSizes[LoD].x = FromString<uint32_t>(elements[0]);
-          m_DomainSizes[LoD].y = FromString<uint32_t>(elements[1]);
-          m_DomainSizes[LoD].z = FromString<uint32_t>(elements[2]);
+          m_Header.domainSizes[LoD].x = FromString<uint32_t>(elements[0]);
+          m_Header.domainSizes[LoD].y = FromString<uint32_t>(elements[1]);
+          m_Header.domainSizes[LoD].z = FromString<uint32_t>(elements[2]);
           if (elements[3] != "BrickCount") {
             std::cerr << "failed to parse line " << i << ": BrickCount not available" << std::endl;
             return false;
@@ -249,9 +1185,9 @@ bool BrickAccessFile::Load()
             std::cerr << "failed to parse line " << i << ": invalid BrickCount" << std::endl;
             return false;
           }
-          m_BrickCounts[LoD].x = FromString<uint32_t>(elements[0]);
-          m_BrickCounts[LoD].y = FromString<uint32_t>(elements[1]);
-          m_BrickCounts[LoD].z = FromString<uint32_t>(elements[2]);
+          m_Header.brickCounts[LoD].x = FromString<uint32_t>(elements[0]);
+          m_Header.brickCounts[LoD].y = FromString<uint32_t>(elements[1]);
+          m_Header.brickCounts[LoD].z = FromString<uint32_t>(elements[2]);
 
         } else if (tokens[0] == " Subframe" || tokens[0] == "Subframe") {
           if (tokens.size() != 3) {
@@ -269,9 +1205,13 @@ bool BrickAccessFile::Load()
             return false;
           }
           iExpectedBricks = FromString<uint32_t>(tokens[2]);
+          size_t const capacity = m_Frames.capacity();
           while (m_Frames.size() <= iFrameCounter)
             m_Frames.push_back(Frame());
+          BrickAccessStats::CountCapacity(pCounters, capacity, m_Frames);
+          size_t const subframeCapacity = m_Frames.back().capacity();
           m_Frames.back().push_back(Subframe());
+          BrickAccessStats::CountCapacity(pCounters, subframeCapacity, m_Frames.back());
 
         } else if (tokens[0] == " Frame" || tokens[0] == "Frame") {
           if (tokens.size() != 4) {
@@ -289,8 +1229,10 @@ bool BrickAccessFile::Load()
             std::cerr << "failed to parse line " << i << ": wrong Frame value" << std::endl;
             return false;
           }
+          size_t const capacity = m_Frames.capacity();
           while (m_Frames.size() <= iFrameCounter)
             m_Frames.push_back(Frame());
+          BrickAccessStats::CountCapacity(pCounters, capacity, m_Frames);
           iFrameCounter++;
           iExpectedBricks = 0;
           iSubframeCounter = 0;
@@ -303,34 +1245,56 @@ bool BrickAccessFile::Load()
 
 BrickAccessFile::Vec3<uint32_t> const& BrickAccessFile::GetMaxBrickSize() const
 {
-  return m_MaxBrickSize;
+  return m_Header.maxBrickSize;
 }
 
 BrickAccessFile::Vec3<uint32_t> const& BrickAccessFile::GetBrickOverlap() const
 {
-  return m_BrickOverlap;
+  return m_Header.brickOverlap;
 }
 
 size_t BrickAccessFile::GetLoDCount() const
 {
-  return m_DomainSizes.size(); 
+  return m_Header.domainSizes.size(); 
 }
 
 std::vector<BrickAccessFile::Vec3<uint64_t> > const& BrickAccessFile::GetDomainSizes() const
 {
-  return m_DomainSizes;
+  return m_Header.domainSizes;
 }
 
 std::vector<BrickAccessFile::Vec3<uint64_t> > const& BrickAccessFile::GetBrickCounts() const
 {
-  return m_BrickCounts;
+  return m_Header.brickCounts;
+}
+
+BrickAccessFile::Header const& BrickAccessFile::GetHeader() const
+{
+  return m_Header;
 }
 
 std::vector<BrickAccessFile::Frame> const& BrickAccessFile::GetFrames() const
 {
+  if (m_Storage == ST_FLAT && !m_bFramesCreated) {
+    m_pTrace->ToFrames(m_Frames);
+    m_bFramesCreated = true;
+  } else if (m_Storage == ST_ARENA && !m_bFramesCreated) {
+    m_pArena->ToFrames(m_Frames);
+    m_bFramesCreated = true;
+  }
   return m_Frames;
 }
 
+BrickAccessTrace const& BrickAccessFile::GetTrace() const
+{
+  return *m_pTrace;
+}
+
+BrickAccessArena const& BrickAccessFile::GetArena() const
+{
+  return *m_pArena;
+}
+
 /*
    The MIT License (MIT)
 
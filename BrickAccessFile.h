@@ -6,8 +6,14 @@
 #include <string>
 #include <fstream>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+class BrickAccessArena;
+class BrickAccessIndex;
+class BrickAccessStats;
+class BrickAccessTrace;
+
 // Helper class to load & parse ASCII-based pre-recorded brick access files
 // (extension: *.ba) for further processing.
 //
@@ -23,6 +29,7 @@ class BrickAccessFile {
 public:
   // C'tor to instantiate a BrickAccessFile from a given filename.
   BrickAccessFile(std::string const& filename);
+  ~BrickAccessFile();
 
   // Generic 3-component vector.
   template<class T>
@@ -36,6 +43,19 @@ public:
     T x, y, z, w;
   };
 
+  // Non-owning view of a contiguous array, e.g. inside of a memory mapping.
+  template<class T>
+  struct Span {
+    T const* data;
+    size_t count;
+
+    T const* begin() const { return data; }
+    T const* end() const { return data + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T const& operator[](size_t i) const { return data[i]; }
+  };
+
   // A spatial brick position/index of a bricked domain. The w-component encodes
   // the level of detail.
   typedef Vec4<uint64_t> Brick;
@@ -46,10 +66,101 @@ public:
   // A frame consists of a bunch of subframes.
   typedef std::vector<Subframe> Frame;
 
+  // The dataset description found at the beginning of a brick access file.
+  struct Header {
+    Vec3<uint32_t> maxBrickSize;
+    Vec3<uint32_t> brickOverlap;
+    std::vector<Vec3<uint64_t> > domainSizes;
+    std::vector<Vec3<uint64_t> > brickCounts;
+  };
+
+  // Strategies to read the brick access file.
+  enum LoadMode {
+    // Reads the file line by line through the standard stream tokenizer.
+    LM_STREAM = 0,
+    // Maps the file into memory and scans the bytes in place. This avoids
+    // all intermediate strings and streams and is much faster on large files.
+    LM_MAPPED,
+    // Like LM_MAPPED, but splits the frame data at frame marks into chunks
+    // which are parsed concurrently on a thread pool.
+    LM_PARALLEL
+  };
+
+  // Representations of the loaded bricks.
+  enum Storage {
+    // Nested frame and subframe vectors of bricks, see GetFrames().
+    ST_FRAMES = 0,
+    // One flat array of 64-bit brick keys with frame and subframe offsets,
+    // see GetTrace(). Needs about a quarter of the memory, but requires the
+    // header to precede all frame data.
+    ST_FLAT,
+    // Subframes packed into a few large blocks which are sized from a quick
+    // scan or the frame index, see GetArena(). Loading and releasing a trace
+    // takes a handful of allocations instead of one per subframe.
+    ST_ARENA
+  };
+
+  // Orders of the bricks within a LoD for 64-bit brick keys, see BrickLayout.
+  enum KeyOrder {
+    KO_ROW_MAJOR = 0,
+    KO_MORTON,
+    KO_HILBERT
+  };
+
+  // Selects the representation used by the next Load() call. The default is
+  // ST_FRAMES.
+  // @param order is the brick order of the keys stored by ST_FLAT.
+  void SetStorage(Storage storage, KeyOrder order = KO_ROW_MAJOR);
+
+  // @returns the representation used by Load().
+  Storage GetStorage() const;
+
+  // Lets every following Load(), LoadHeader(), LoadIndex() and LoadFrames()
+  // clear and fill the given statistics, see BrickAccessStats. The object has
+  // to outlive the loads, null stops collecting. Default is null.
+  void SetStats(BrickAccessStats* pStats);
+
   // Load & parse the brick access file.
+  // @param mode selects how the file is read, all modes produce the same
+  //   results and report the same errors.
+  // @param threadCount is the number of threads used by LM_PARALLEL. Zero
+  //   uses all hardware threads.
   // @returns true if parsing finished without any problems. False indicates an
   //   error, see std::cerr for details.
-  bool Load();
+  // Binary files, see BrickAccessBinaryFile, are recognized by their magic.
+  // Their frames are validated and copied from the mapping into the selected
+  // storage, mode and threadCount are ignored then.
+  bool Load(LoadMode mode = LM_STREAM, size_t threadCount = 0);
+
+  // Parses only the header, which fills GetMaxBrickSize(), GetLoDCount(),
+  // GetDomainSizes() and GetBrickCounts() without reading any frame data.
+  // Previously loaded frames are released. Binary files are accepted, too.
+  // @returns false if the header is broken, see std::cerr for details.
+  bool LoadHeader();
+
+  // Loads the frame index from the sidecar file of the trace, see
+  // BrickAccessIndex. A missing or stale sidecar is rebuilt by scanning the
+  // trace.
+  // @param saveSidecar writes a rebuilt index next to the trace. A sidecar
+  //   which cannot be written is reported but does not fail the call.
+  // @returns false if the trace cannot be indexed, see std::cerr. Binary
+  //   files are refused, their offset tables already index the frames.
+  bool LoadIndex(bool saveSidecar = true);
+
+  // Loads the header and a range of frames using the frame index, which is
+  // loaded first if it does not match the trace. Only the bytes of the
+  // requested frames are parsed, GetFrames() and GetTrace() then start with
+  // frame firstFrame, see GetFirstFrame(). Binary files copy the range
+  // using their offset tables and write no sidecar.
+  // @returns false if the range exceeds the trace or parsing failed, see
+  //   std::cerr for details.
+  bool LoadFrames(size_t firstFrame, size_t frameCount);
+
+  // @returns the number of the first loaded frame, zero after Load().
+  size_t GetFirstFrame() const;
+
+  // @returns the frame index, empty until LoadIndex() or LoadFrames().
+  BrickAccessIndex const& GetIndex() const;
 
   // @returns the bricking size in voxels used for the spatial decomposition of
   //   the domain. The overlap between adjacent bricks is included in this brick
@@ -73,16 +184,47 @@ public:
   //   bricks which exist (given per-dimension).
   std::vector<Vec3<uint64_t> > const& GetBrickCounts() const;
 
+  // @returns all values of the file header.
+  Header const& GetHeader() const;
+
   // @returns the captured brick access patterns indexed by frame and subframes.
+  //   With ST_FLAT and ST_ARENA storage the frames are created on the first
+  //   call, which takes as much memory as loading with ST_FRAMES.
   std::vector<Frame> const& GetFrames() const;
 
+  // @returns the captured brick access patterns as flat key array, only
+  //   filled with ST_FLAT storage.
+  BrickAccessTrace const& GetTrace() const;
+
+  // @returns the captured brick access patterns in blocks, only filled with
+  //   ST_ARENA storage.
+  BrickAccessArena const& GetArena() const;
+
 private:
+  BrickAccessFile(BrickAccessFile const&);
+  BrickAccessFile& operator=(BrickAccessFile const&);
+
+  bool LoadStream();
+  bool LoadMapped();
+  bool LoadParallel(size_t threadCount);
+  bool LoadFlat(LoadMode mode, size_t threadCount);
+  bool LoadArena(LoadMode mode, size_t threadCount);
+  bool LoadBinary(bool headerOnly, size_t firstFrame, size_t frameCount);
+  bool StartTrace();
+  bool UpdateIndex(char const* begin, char const* end, bool saveSidecar);
+
+  std::string m_Filename;
   std::ifstream m_File;
-  Vec3<uint32_t> m_MaxBrickSize;
-  Vec3<uint32_t> m_BrickOverlap;
-  std::vector<Vec3<uint64_t> > m_DomainSizes;
-  std::vector<Vec3<uint64_t> > m_BrickCounts;
-  std::vector<Frame> m_Frames;
+  Header m_Header;
+  Storage m_Storage;
+  KeyOrder m_KeyOrder;
+  std::unique_ptr<BrickAccessTrace> m_pTrace;
+  std::unique_ptr<BrickAccessArena> m_pArena;
+  std::unique_ptr<BrickAccessIndex> m_pIndex;
+  size_t m_iFirstFrame;
+  mutable std::vector<Frame> m_Frames;
+  mutable bool m_bFramesCreated;
+  BrickAccessStats* m_pStats;
 };
 
 #endif // BRICK_ACCESS_FILE_H
@@ -0,0 +1,389 @@
+#include "BrickAccessFollower.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessParser.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+  // upper bound of a single read, which bounds the buffer for large appends
+  size_t const ReadChunkSize = 1 << 20;
+
+  // interval of the file size checks without change notifications
+  uint32_t const PollIntervalMs = 10;
+
+  // longest wait of Follow() before it checks for Stop()
+  uint32_t const StopIntervalMs = 100;
+
+  // Sink which queues frames until they are taken.
+  class FrameQueue {
+  public:
+    FrameQueue() : m_iCompleteCount(0), m_iTakenCount(0), m_bFrameOpen(false) {}
+
+    void BeginFrame()
+    {
+      m_Frames.push_back(BrickAccessFile::Frame());
+      m_bFrameOpen = true;
+    }
+
+    void BeginSubframe(uint32_t)
+    {
+      m_Frames.back().push_back(BrickAccessFile::Subframe());
+    }
+
+    void AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+    {
+      BrickAccessFile::Subframe& subframe = m_Frames.back().back();
+      subframe.insert(subframe.end(), bricks, bricks + count);
+    }
+
+    void EndFrame()
+    {
+      ++m_iCompleteCount;
+      m_bFrameOpen = false;
+    }
+
+    // Completes a frame without frame mark.
+    void CloseFrame()
+    {
+      if (m_bFrameOpen)
+        EndFrame();
+    }
+
+    // @returns the number of completed frames which have not been taken.
+    size_t GetPendingCount() const { return m_iCompleteCount; }
+
+    // @returns the index of the next frame to be taken.
+    uint64_t GetTakenCount() const { return m_iTakenCount; }
+
+    BrickAccessFile::Frame& Front() { return m_Frames.front(); }
+
+    void PopFront()
+    {
+      m_Frames.pop_front();
+      --m_iCompleteCount;
+      ++m_iTakenCount;
+    }
+
+  private:
+    std::deque<BrickAccessFile::Frame> m_Frames;
+    size_t m_iCompleteCount;
+    uint64_t m_iTakenCount;
+    bool m_bFrameOpen;
+  };
+
+}
+
+// File, read buffer and parser state, which persist between updates.
+class BrickAccessFollower::State {
+public:
+  State()
+    : m_Parser(m_Header, m_Frames)
+    , m_iReadPosition(0)
+    , m_bHeader(false)
+    , m_bFailed(false)
+  {}
+
+  std::ifstream m_File;
+  // unterminated rest of the data read so far
+  std::vector<char> m_Buffer;
+  BrickAccessFile::Header m_Header;
+  FrameQueue m_Frames;
+  BrickAccessParser<FrameQueue> m_Parser;
+  uint64_t m_iReadPosition;
+  bool m_bHeader;
+  bool m_bFailed;
+};
+
+// Change notifications of the followed file.
+class BrickAccessFollower::Watch {
+public:
+  explicit Watch(std::string const& filename)
+#ifdef __linux__
+    : m_iNotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+  {
+    if (m_iNotify >= 0 && inotify_add_watch(m_iNotify, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+      close(m_iNotify);
+      m_iNotify = -1;
+    }
+  }
+#else
+  {
+    (void)filename;
+  }
+#endif
+
+  ~Watch()
+  {
+#ifdef __linux__
+    if (m_iNotify >= 0)
+      close(m_iNotify);
+#endif
+  }
+
+  // Blocks until the file has been modified or the timeout expires.
+  void Wait(uint32_t timeoutMs)
+  {
+#ifdef __linux__
+    if (m_iNotify >= 0) {
+      pollfd fd = { m_iNotify, POLLIN, 0 };
+      if (poll(&fd, 1, int(timeoutMs)) > 0) {
+        // only the wake up matters, drop the events
+        char events[4096];
+        while (read(m_iNotify, events, sizeof(events)) > 0) {}
+      }
+      return;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutMs, PollIntervalMs)));
+  }
+
+private:
+  Watch(Watch const&);
+  Watch& operator=(Watch const&);
+
+#ifdef __linux__
+  int m_iNotify;
+#endif
+};
+
+BrickAccessFollower::BrickAccessFollower(std::string const& filename)
+  : m_Filename(filename)
+  , m_bStop(false)
+{}
+
+BrickAccessFollower::~BrickAccessFollower()
+{
+  Close();
+}
+
+bool BrickAccessFollower::Open()
+{
+  Close();
+  // binary files are written in one go, they never grow frame by frame
+  if (BrickAccessBinaryFile::IsBinaryFile(m_Filename)) {
+    std::cerr << "failed to follow file " << m_Filename << ": binary files cannot be followed, use Load()"
+      << std::endl;
+    return false;
+  }
+  std::unique_ptr<State> pState(new State());
+  pState->m_File.open(m_Filename.c_str(), std::ios::in | std::ios::binary);
+  if (!pState->m_File.is_open())
+    return false;
+  m_pState.swap(pState);
+  m_pWatch.reset(new Watch(m_Filename));
+  m_bStop = false;
+  return true;
+}
+
+void BrickAccessFollower::Close()
+{
+  m_pWatch.reset();
+  m_pState.reset();
+}
+
+bool BrickAccessFollower::Update()
+{
+  if (!m_pState || m_pState->m_bFailed)
+    return false;
+  State& state = *m_pState;
+
+  state.m_File.clear();
+  state.m_File.seekg(0, std::ios::end);
+  uint64_t const size = uint64_t(state.m_File.tellg());
+  if (!state.m_File || size < state.m_iReadPosition) {
+    std::cerr << "failed to follow file " << m_Filename << ": file has been truncated" << std::endl;
+    state.m_bFailed = true;
+    return false;
+  }
+
+  state.m_File.seekg(std::streamoff(state.m_iReadPosition));
+  while (state.m_iReadPosition < size) {
+    size_t const rest = state.m_Buffer.size();
+    size_t const count = size_t(std::min<uint64_t>(size - state.m_iReadPosition, ReadChunkSize));
+    state.m_Buffer.resize(rest + count);
+    state.m_File.read(state.m_Buffer.data() + rest, std::streamsize(count));
+    if (size_t(state.m_File.gcount()) != count) {
+      std::cerr << "failed to read file after line " << state.m_Parser.GetLine() << std::endl;
+      state.m_bFailed = true;
+      return false;
+    }
+    state.m_iReadPosition += count;
+
+    // parse the complete lines and keep the partial last one
+    char const* const begin = state.m_Buffer.data();
+    char const* const end = begin + state.m_Buffer.size();
+    char const* lineEnd = end;
+    while (lineEnd != begin && lineEnd[-1] != '\n')
+      --lineEnd;
+    if (lineEnd == begin)
+      continue;
+    if (!ParseLines(begin, lineEnd))
+      return false;
+    state.m_Buffer.erase(state.m_Buffer.begin(), state.m_Buffer.begin() + (lineEnd - begin));
+  }
+  return true;
+}
+
+bool BrickAccessFollower::ParseLines(char const* begin, char const* end)
+{
+  State& state = *m_pState;
+  while (begin != end) {
+    char const* eol = BrickAccessScan::FindLineEnd(begin, end);
+    if (!state.m_bHeader) {
+      BrickAccessScan::LineKind const kind = BrickAccessScan::ClassifyLine(begin, eol);
+      state.m_bHeader = (kind == BrickAccessScan::LK_BRICKS || kind == BrickAccessScan::LK_SUBFRAME ||
+        kind == BrickAccessScan::LK_FRAME);
+    }
+    if (!state.m_Parser.ParseLine(begin, eol)) {
+      std::cerr << "failed to parse line " << state.m_Parser.GetErrorLine() << state.m_Parser.GetError() << std::endl;
+      state.m_bFailed = true;
+      return false;
+    }
+    begin = (eol == end) ? end : eol + 1;
+  }
+  return true;
+}
+
+bool BrickAccessFollower::Wait(uint32_t timeoutMs)
+{
+  if (!m_pState)
+    return false;
+  m_pWatch->Wait(timeoutMs);
+  return Update();
+}
+
+bool BrickAccessFollower::Finish()
+{
+  if (!Update())
+    return false;
+  State& state = *m_pState;
+  if (!state.m_Buffer.empty()) {
+    if (!ParseLines(state.m_Buffer.data(), state.m_Buffer.data() + state.m_Buffer.size()))
+      return false;
+    state.m_Buffer.clear();
+  }
+  state.m_Frames.CloseFrame();
+  return true;
+}
+
+size_t BrickAccessFollower::TakeFrames(std::vector<BrickAccessFile::Frame>& frames)
+{
+  if (!m_pState)
+    return 0;
+  FrameQueue& queue = m_pState->m_Frames;
+  size_t const count = queue.GetPendingCount();
+  frames.reserve(frames.size() + count);
+  for (size_t i=0; i<count; ++i) {
+    frames.push_back(BrickAccessFile::Frame());
+    frames.back().swap(queue.Front());
+    queue.PopFront();
+  }
+  return count;
+}
+
+bool BrickAccessFollower::Follow(Consumer const& consumer, uint32_t idleTimeoutMs)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  if (!Update())
+    return false;
+  Clock::time_point lastGrowth = Clock::now();
+  for (;;) {
+    FrameQueue& queue = m_pState->m_Frames;
+    while (queue.GetPendingCount() > 0) {
+      bool const bContinue = consumer(queue.GetTakenCount(), queue.Front());
+      queue.PopFront();
+      if (!bContinue)
+        return true;
+    }
+    if (m_bStop)
+      return true;
+
+    uint64_t const position = m_pState->m_iReadPosition;
+    uint32_t const idleMs = uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+      Clock::now() - lastGrowth).count());
+    if (idleMs >= idleTimeoutMs) {
+      // the writer is done, deliver the last frame without frame mark
+      if (!Finish())
+        return false;
+      while (queue.GetPendingCount() > 0) {
+        bool const bContinue = consumer(queue.GetTakenCount(), queue.Front());
+        queue.PopFront();
+        if (!bContinue)
+          break;
+      }
+      return true;
+    }
+    if (!Wait(std::min(idleTimeoutMs - idleMs, StopIntervalMs)))
+      return false;
+    if (m_pState->m_iReadPosition != position)
+      lastGrowth = Clock::now();
+  }
+}
+
+void BrickAccessFollower::Stop()
+{
+  m_bStop = true;
+}
+
+bool BrickAccessFollower::HasHeader() const
+{
+  return m_pState && m_pState->m_bHeader;
+}
+
+BrickAccessFile::Header const& BrickAccessFollower::GetHeader() const
+{
+  static BrickAccessFile::Header const empty = BrickAccessFile::Header();
+  return m_pState ? m_pState->m_Header : empty;
+}
+
+uint64_t BrickAccessFollower::GetFrameCount() const
+{
+  if (!m_pState)
+    return 0;
+  return m_pState->m_Frames.GetTakenCount() + m_pState->m_Frames.GetPendingCount();
+}
+
+uint64_t BrickAccessFollower::GetPosition() const
+{
+  if (!m_pState)
+    return 0;
+  return m_pState->m_iReadPosition - m_pState->m_Buffer.size();
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
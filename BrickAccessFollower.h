@@ -0,0 +1,133 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_FOLLOWER_H
+#define BRICK_ACCESS_FOLLOWER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+
+// Follows a brick access file while another process is still writing it,
+// like "tail -f". Every Update() parses only the complete lines appended
+// since the previous call, a partial trailing line is kept until its
+// terminator arrives. The parser state (frame and subframe counters and the
+// expected brick count) persists between calls, so frames are validated
+// exactly like BrickAccessFile::Load() does.
+//
+// A frame is delivered once its frame mark has been parsed. The last frame
+// of a trace does not need a frame mark, Finish() delivers it after the
+// writer is done. Example:
+//
+//   BrickAccessFollower follower(filename);
+//   if (!follower.Open()) return false;
+//   bool const bSuccess = follower.Follow(
+//     [](uint64_t index, BrickAccessFile::Frame const& frame) {
+//       // process frame
+//       return true;
+//     }, 10000);
+class BrickAccessFollower {
+public:
+  // Receives the frames in file order.
+  // @returns false to stop following.
+  typedef std::function<bool(uint64_t index, BrickAccessFile::Frame const& frame)> Consumer;
+
+  // C'tor to instantiate a follower from a given filename.
+  explicit BrickAccessFollower(std::string const& filename);
+  ~BrickAccessFollower();
+
+  // Opens the file, which may still be empty.
+  // @returns false if the file could not be opened or is a binary file,
+  //   see BrickAccessBinaryFile.
+  bool Open();
+
+  // Stops following and closes the file.
+  void Close();
+
+  // Parses all complete lines appended since the last call.
+  // @returns false if parsing or reading failed or the file shrank, see
+  //   std::cerr for details.
+  bool Update();
+
+  // Blocks until the file changes or the timeout expires, then calls
+  // Update(). Uses inotify on Linux and polls the file size elsewhere.
+  // @returns false if Update() failed.
+  bool Wait(uint32_t timeoutMs);
+
+  // Parses a trailing line without terminator and completes the last frame,
+  // which does not need a frame mark. Call it once the writer is done.
+  // @returns false if the trailing line is broken, see std::cerr.
+  bool Finish();
+
+  // Moves all completed frames which have not been taken yet to the end of
+  // frames.
+  // @returns the number of moved frames.
+  size_t TakeFrames(std::vector<BrickAccessFile::Frame>& frames);
+
+  // Hands every completed frame to the consumer as soon as it has been
+  // parsed and waits for more, until the consumer returns false, Stop() is
+  // called, or the file did not grow for idleTimeoutMs. An idle timeout
+  // finishes the trace, see Finish().
+  // @returns false if parsing failed, see std::cerr for details.
+  bool Follow(Consumer const& consumer, uint32_t idleTimeoutMs);
+
+  // Makes a running Follow() return, may be called from any thread.
+  void Stop();
+
+  // @returns true once all header lines have been parsed, which happens
+  //   with the first frame data.
+  bool HasHeader() const;
+
+  // @returns the header, complete once HasHeader() returns true.
+  BrickAccessFile::Header const& GetHeader() const;
+
+  // @returns the number of completed frames, taken or not.
+  uint64_t GetFrameCount() const;
+
+  // @returns the number of bytes parsed so far.
+  uint64_t GetPosition() const;
+
+private:
+  BrickAccessFollower(BrickAccessFollower const&);
+  BrickAccessFollower& operator=(BrickAccessFollower const&);
+
+  class State;
+  class Watch;
+
+  bool ParseLines(char const* begin, char const* end);
+
+  std::string m_Filename;
+  std::unique_ptr<State> m_pState;
+  std::unique_ptr<Watch> m_pWatch;
+  std::atomic<bool> m_bStop;
+};
+
+#endif // BRICK_ACCESS_FOLLOWER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
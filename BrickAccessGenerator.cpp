@@ -0,0 +1,347 @@
+#include "BrickAccessGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "BrickAccessWriter.h"
+#include "BrickHash.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  using BrickHash::Mix;
+
+  double const Pi = 3.14159265358979323846;
+
+  // Number of frames between two random camera offsets, the jitter is
+  // interpolated in between.
+  double const JitterPeriod = 32.0;
+
+  // Number of frames generated per thread before a batch is written.
+  size_t const FramesPerThread = 8;
+
+  // @returns a uniform random value in [0, 1) for a lattice point.
+  double Random(uint64_t seed, int64_t x, int64_t y = 0, int64_t z = 0)
+  {
+    uint64_t const h = Mix(Mix(Mix(seed ^ uint64_t(x)) ^ uint64_t(y)) ^ uint64_t(z));
+    return double(h >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  double Smooth(double t)
+  {
+    return t * t * (3.0 - 2.0 * t);
+  }
+
+  // @returns smooth random values in [-1, 1] over the frames.
+  double Jitter(uint32_t frame, uint64_t seed)
+  {
+    double const t = double(frame) / JitterPeriod;
+    double const knot = std::floor(t);
+    double const a = Random(seed, int64_t(knot));
+    double const b = Random(seed, int64_t(knot) + 1);
+    return 2.0 * (a + (b - a) * Smooth(t - knot)) - 1.0;
+  }
+
+}
+
+BrickAccessGenerator::Config BrickAccessGenerator::GetDefaultConfig()
+{
+  Config config;
+  config.domainSize.x = config.domainSize.y = config.domainSize.z = 2048;
+  config.maxBrickSize.x = config.maxBrickSize.y = config.maxBrickSize.z = 128;
+  config.brickOverlap.x = config.brickOverlap.y = config.brickOverlap.z = 2;
+  config.frameCount = 1000;
+  config.subframeCount = 3;
+  config.framesPerOrbit = 720;
+  config.zoomPeriod = 1000;
+  config.minDistance = 0.6;
+  config.maxDistance = 2.0;
+  config.fieldOfView = 60.0;
+  config.screenHeight = 1080;
+  config.emptyFraction = 0.3;
+  config.seed = 1;
+  return config;
+}
+
+BrickAccessGenerator::BrickAccessGenerator(Config const& config)
+  : m_Config(config)
+  , m_fConeAngle(0.0)
+  , m_fPixelAngle(0.0)
+  , m_bValid(false)
+{
+  BrickAccessFile::Vec3<uint64_t> const& domain = config.domainSize;
+  m_CoreSize.x = config.maxBrickSize.x > 2 * config.brickOverlap.x ? config.maxBrickSize.x - 2 * config.brickOverlap.x : 0;
+  m_CoreSize.y = config.maxBrickSize.y > 2 * config.brickOverlap.y ? config.maxBrickSize.y - 2 * config.brickOverlap.y : 0;
+  m_CoreSize.z = config.maxBrickSize.z > 2 * config.brickOverlap.z ? config.maxBrickSize.z - 2 * config.brickOverlap.z : 0;
+  m_Header.maxBrickSize = config.maxBrickSize;
+  m_Header.brickOverlap = config.brickOverlap;
+  if (m_CoreSize.x == 0 || m_CoreSize.y == 0 || m_CoreSize.z == 0 ||
+      domain.x == 0 || domain.y == 0 || domain.z == 0 || config.subframeCount == 0)
+    return;
+
+  // halve the domain until a single brick remains
+  for (uint32_t lod=0; lod<64; ++lod) {
+    BrickAccessFile::Vec3<uint64_t> size;
+    size.x = std::max<uint64_t>((domain.x + (1ull << lod) - 1) >> lod, 1);
+    size.y = std::max<uint64_t>((domain.y + (1ull << lod) - 1) >> lod, 1);
+    size.z = std::max<uint64_t>((domain.z + (1ull << lod) - 1) >> lod, 1);
+    BrickAccessFile::Vec3<uint64_t> count;
+    count.x = (size.x + m_CoreSize.x - 1) / m_CoreSize.x;
+    count.y = (size.y + m_CoreSize.y - 1) / m_CoreSize.y;
+    count.z = (size.z + m_CoreSize.z - 1) / m_CoreSize.z;
+    m_Header.domainSizes.push_back(size);
+    m_Header.brickCounts.push_back(count);
+    if (count.x == 1 && count.y == 1 && count.z == 1)
+      break;
+  }
+
+  double const halfHeight = std::tan(config.fieldOfView * Pi / 360.0);
+  m_fConeAngle = std::atan(halfHeight * std::sqrt(1.0 + 16.0 * 16.0 / (9.0 * 9.0)));
+  m_fPixelAngle = 2.0 * halfHeight / double(std::max<uint32_t>(config.screenHeight, 1));
+  m_bValid = true;
+}
+
+bool BrickAccessGenerator::IsValid() const
+{
+  return m_bValid;
+}
+
+BrickAccessFile::Header const& BrickAccessGenerator::GetHeader() const
+{
+  return m_Header;
+}
+
+BrickAccessGenerator::Camera BrickAccessGenerator::GetCamera(uint32_t frame) const
+{
+  BrickAccessFile::Vec3<uint64_t> const& domain = m_Config.domainSize;
+  double const diagonal = std::sqrt(double(domain.x) * double(domain.x) +
+    double(domain.y) * double(domain.y) + double(domain.z) * double(domain.z));
+  uint64_t const seed = Mix(m_Config.seed);
+  double const t = double(frame);
+
+  double const azimuth = 2.0 * Pi * t / double(std::max<uint32_t>(m_Config.framesPerOrbit, 1)) +
+    0.2 * Jitter(frame, seed + 1);
+  double const elevation = 0.4 * std::sin(2.0 * Pi * t / (2.5 * double(std::max<uint32_t>(m_Config.framesPerOrbit, 1)))) +
+    0.1 * Jitter(frame, seed + 2);
+  double const zoom = 0.5 - 0.5 * std::cos(2.0 * Pi * t / double(std::max<uint32_t>(m_Config.zoomPeriod, 1)));
+  double const distance = diagonal * (m_Config.minDistance + (m_Config.maxDistance - m_Config.minDistance) * zoom) *
+    (1.0 + 0.05 * Jitter(frame, seed + 3));
+
+  double target[3];
+  target[0] = 0.5 * double(domain.x) + 0.05 * diagonal * Jitter(frame, seed + 4);
+  target[1] = 0.5 * double(domain.y) + 0.05 * diagonal * Jitter(frame, seed + 5);
+  target[2] = 0.5 * double(domain.z) + 0.05 * diagonal * Jitter(frame, seed + 6);
+
+  Camera camera;
+  double const offset[3] = {
+    std::cos(elevation) * std::cos(azimuth),
+    std::cos(elevation) * std::sin(azimuth),
+    std::sin(elevation)
+  };
+  for (int i=0; i<3; ++i) {
+    camera.position[i] = target[i] + distance * offset[i];
+    camera.direction[i] = -offset[i];
+  }
+  return camera;
+}
+
+void BrickAccessGenerator::GenerateFrame(uint32_t frame, BrickAccessFile::Frame& bricks) const
+{
+  bricks.resize(m_bValid ? m_Config.subframeCount : 0);
+  if (!m_bValid)
+    return;
+
+  Camera const camera = GetCamera(frame);
+  size_t const coarsest = m_Header.brickCounts.size() - 1;
+  for (uint32_t s=0; s<m_Config.subframeCount; ++s) {
+    BrickAccessFile::Subframe& subframe = bricks[s];
+    subframe.clear();
+    BrickAccessFile::Brick brick;
+    brick.w = coarsest;
+    BrickAccessFile::Vec3<uint64_t> const& count = m_Header.brickCounts[coarsest];
+    for (brick.z=0; brick.z<count.z; ++brick.z)
+      for (brick.y=0; brick.y<count.y; ++brick.y)
+        for (brick.x=0; brick.x<count.x; ++brick.x)
+          Refine(camera, m_Config.subframeCount - 1 - s, brick, subframe);
+  }
+}
+
+void BrickAccessGenerator::Refine(Camera const& camera, uint32_t lodBias,
+  BrickAccessFile::Brick const& brick, BrickAccessFile::Subframe& bricks) const
+{
+  // extent of the brick in voxels of the finest LoD
+  uint64_t const lod = brick.w;
+  uint64_t const brickIndex[3] = { brick.x, brick.y, brick.z };
+  uint64_t const core[3] = { m_CoreSize.x << lod, m_CoreSize.y << lod, m_CoreSize.z << lod };
+  uint64_t const domain[3] = { m_Config.domainSize.x, m_Config.domainSize.y, m_Config.domainSize.z };
+  double lo[3], hi[3], center[3];
+  double distanceSquared = 0.0;
+  double nearestSquared = 0.0;
+  double radiusSquared = 0.0;
+  double alignment = 0.0;
+  for (int i=0; i<3; ++i) {
+    lo[i] = double(brickIndex[i] * core[i]);
+    hi[i] = double(std::min(brickIndex[i] * core[i] + core[i], domain[i]));
+    center[i] = 0.5 * (lo[i] + hi[i]);
+    double const v = center[i] - camera.position[i];
+    distanceSquared += v * v;
+    alignment += v * camera.direction[i];
+    radiusSquared += 0.25 * (hi[i] - lo[i]) * (hi[i] - lo[i]);
+    double const outside = std::max(std::max(lo[i] - camera.position[i], camera.position[i] - hi[i]), 0.0);
+    nearestSquared += outside * outside;
+  }
+
+  // bounding sphere against the view cone
+  double const distance = std::sqrt(distanceSquared);
+  double const radius = std::sqrt(radiusSquared);
+  if (distance > radius) {
+    double const angle = std::acos(std::max(-1.0, std::min(1.0, alignment / distance)));
+    if (angle > m_fConeAngle + std::asin(radius / distance))
+      return;
+  }
+
+  // refine while a voxel of the brick covers more than a pixel
+  double const nearest = std::max(std::sqrt(nearestSquared), 1.0);
+  double const level = std::floor(std::log2(nearest * m_fPixelAngle)) + double(lodBias);
+  if (lod > 0 && double(lod) > level) {
+    BrickAccessFile::Vec3<uint64_t> const& count = m_Header.brickCounts[size_t(lod - 1)];
+    BrickAccessFile::Brick child;
+    child.w = lod - 1;
+    for (child.z=2*brick.z; child.z<std::min(2*brick.z+2, count.z); ++child.z)
+      for (child.y=2*brick.y; child.y<std::min(2*brick.y+2, count.y); ++child.y)
+        for (child.x=2*brick.x; child.x<std::min(2*brick.x+2, count.x); ++child.x)
+          Refine(camera, lodBias, child, bricks);
+    return;
+  }
+
+  if (!IsEmpty(brick))
+    bricks.push_back(brick);
+}
+
+bool BrickAccessGenerator::IsEmpty(BrickAccessFile::Brick const& brick) const
+{
+  // the density varies over about a sixth of the domain, larger bricks always
+  // contain some data
+  uint64_t const lod = brick.w;
+  double const scale = double(std::max(m_Config.domainSize.x,
+    std::max(m_Config.domainSize.y, m_Config.domainSize.z))) / 6.0;
+  if (double(std::max(m_CoreSize.x, std::max(m_CoreSize.y, m_CoreSize.z)) << lod) > scale)
+    return false;
+  double const position[3] = {
+    (double(brick.x) + 0.5) * double(m_CoreSize.x << lod) / scale,
+    (double(brick.y) + 0.5) * double(m_CoreSize.y << lod) / scale,
+    (double(brick.z) + 0.5) * double(m_CoreSize.z << lod) / scale
+  };
+  return Noise(position, Mix(m_Config.seed) + 7) < m_Config.emptyFraction;
+}
+
+double BrickAccessGenerator::Noise(double const* position, uint64_t seed) const
+{
+  // trilinear interpolation of random lattice values
+  int64_t cell[3];
+  double weight[3];
+  for (int i=0; i<3; ++i) {
+    double const knot = std::floor(position[i]);
+    cell[i] = int64_t(knot);
+    weight[i] = Smooth(position[i] - knot);
+  }
+  double value = 0.0;
+  for (int corner=0; corner<8; ++corner) {
+    double w = 1.0;
+    int64_t p[3];
+    for (int i=0; i<3; ++i) {
+      int const bit = (corner >> i) & 1;
+      p[i] = cell[i] + bit;
+      w *= bit ? weight[i] : 1.0 - weight[i];
+    }
+    value += w * Random(seed, p[0], p[1], p[2]);
+  }
+  return value;
+}
+
+void BrickAccessGenerator::FormatHeader(std::string& text) const
+{
+  text += "Filename=synthetic.raw\n";
+  BrickAccessWriter::FormatHeader(m_Header, text);
+}
+
+bool BrickAccessGenerator::Write(std::string const& filename, size_t threadCount) const
+{
+  if (!m_bValid) {
+    std::cerr << "failed to create file " << filename << ": invalid brick size or domain" << std::endl;
+    return false;
+  }
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "failed to create file " << filename << std::endl;
+    return false;
+  }
+
+  std::string header;
+  FormatHeader(header);
+  file.write(header.data(), std::streamsize(header.size()));
+
+  // two sets of buffers, one is written while the other one is filled
+  ThreadPool pool(threadCount);
+  size_t const batchSize = pool.GetThreadCount() * FramesPerThread;
+  std::vector<std::string> texts[2];
+  std::vector<BrickAccessFile::Frame> frames[2];
+  std::thread writer;
+  size_t current = 0;
+  for (uint32_t first=0; first<m_Config.frameCount; first+=uint32_t(batchSize)) {
+    size_t const count = std::min<size_t>(batchSize, m_Config.frameCount - first);
+    std::vector<std::string>& batch = texts[current];
+    std::vector<BrickAccessFile::Frame>& batchFrames = frames[current];
+    batch.resize(count);
+    batchFrames.resize(count);
+    pool.ParallelFor(count, [this, first, &batch, &batchFrames](size_t i) {
+      GenerateFrame(first + uint32_t(i), batchFrames[i]);
+      batch[i].clear();
+      BrickAccessWriter::FormatFrame(first + uint32_t(i), batchFrames[i], batch[i]);
+    });
+
+    if (writer.joinable())
+      writer.join();
+    writer = std::thread([&file, &batch, count]() {
+      for (size_t i=0; i<count; ++i)
+        file.write(batch[i].data(), std::streamsize(batch[i].size()));
+    });
+    current = 1 - current;
+  }
+  if (writer.joinable())
+    writer.join();
+
+  file.close();
+  if (file.fail()) {
+    std::cerr << "failed to write file " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
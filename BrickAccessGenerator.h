@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_GENERATOR_H
+#define BRICK_ACCESS_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+
+// Creates synthetic brick access files which mimic a ray-guided volume
+// renderer, e.g. to test parsers and caches with traces larger than the
+// captured ones.
+//
+// The dataset is a bricked volume with a LoD hierarchy down to a single
+// brick. A camera orbits the domain center while it slowly zooms in and out,
+// with smooth random jitter on top. Every frame requests the bricks of an
+// octree cut through the view cone: a brick is refined as long as one of its
+// voxels covers more than a pixel at its distance to the camera. Earlier
+// subframes use coarser cuts, like a renderer which refines progressively.
+// Bricks in empty regions of a random density field are skipped, as a
+// renderer with empty space skipping would.
+//
+// Every frame only depends on the configuration and its index, so frames are
+// generated in parallel and the same seed always yields the same file.
+class BrickAccessGenerator {
+public:
+  // Parameters of the dataset and the camera path.
+  struct Config {
+    // size of the finest LoD in voxels
+    BrickAccessFile::Vec3<uint64_t> domainSize;
+    // brick size including the overlap
+    BrickAccessFile::Vec3<uint32_t> maxBrickSize;
+    BrickAccessFile::Vec3<uint32_t> brickOverlap;
+    uint32_t frameCount;
+    uint32_t subframeCount;
+    // number of frames of a full orbit around the domain
+    uint32_t framesPerOrbit;
+    // number of frames from the nearest to the farthest camera and back
+    uint32_t zoomPeriod;
+    // camera distance to the domain center in multiples of the domain
+    // diagonal, values below one half fly through the domain
+    double minDistance;
+    double maxDistance;
+    // vertical field of view in degrees
+    double fieldOfView;
+    // vertical resolution in pixels, the horizontal one has an aspect of 16:9
+    uint32_t screenHeight;
+    // fraction of the domain which is empty, in [0, 1]
+    double emptyFraction;
+    uint64_t seed;
+  };
+
+  // @returns a configuration with a 2048^3 domain of 128^3 bricks.
+  static Config GetDefaultConfig();
+
+  explicit BrickAccessGenerator(Config const& config);
+
+  // @returns false if the configuration cannot be bricked, e.g. if the
+  //   overlap leaves no voxels in a brick.
+  bool IsValid() const;
+
+  // @returns the header of the generated file.
+  BrickAccessFile::Header const& GetHeader() const;
+
+  // Computes the requested bricks of a frame.
+  void GenerateFrame(uint32_t frame, BrickAccessFile::Frame& bricks) const;
+
+  // Writes the header and all frames. Frames are generated in batches on a
+  // thread pool while the previous batch is written.
+  // @param threadCount is the number of generating threads, zero uses all
+  //   hardware threads.
+  // @returns false if writing failed, see std::cerr for details.
+  bool Write(std::string const& filename, size_t threadCount = 0) const;
+
+  // Appends the header lines to a string, frames are formatted by
+  // BrickAccessWriter::FormatFrame().
+  void FormatHeader(std::string& text) const;
+
+private:
+  struct Camera {
+    double position[3];
+    double direction[3];
+  };
+
+  Camera GetCamera(uint32_t frame) const;
+  void Refine(Camera const& camera, uint32_t lodBias, BrickAccessFile::Brick const& brick,
+    BrickAccessFile::Subframe& bricks) const;
+  bool IsEmpty(BrickAccessFile::Brick const& brick) const;
+  double Noise(double const* position, uint64_t seed) const;
+
+  Config m_Config;
+  BrickAccessFile::Header m_Header;
+  BrickAccessFile::Vec3<uint64_t> m_CoreSize;
+  // half of the diagonal view angle and the angle of a pixel in radians
+  double m_fConeAngle;
+  double m_fPixelAngle;
+  bool m_bValid;
+};
+
+#endif // BRICK_ACCESS_GENERATOR_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
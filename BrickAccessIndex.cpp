@@ -0,0 +1,279 @@
+#include "BrickAccessIndex.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "BrickAccessParser.h"
+#include "MappedFile.h"
+
+namespace {
+
+  static_assert(sizeof(BrickAccessIndex::FileHeader) == 56,
+    "index header layout must not depend on the compiler");
+
+  char const Magic[8] = { 'B', 'A', 'I', 'N', 'D', 'E', 'X', '\0' };
+
+  uint32_t const ByteOrderMark = 0x01020304u;
+
+  // FNV-1a over a range of bytes.
+  uint64_t HashBytes(uint64_t hash, char const* begin, char const* end)
+  {
+    for (char const* p=begin; p!=end; ++p) {
+      hash ^= uint8_t(*p);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+}
+
+BrickAccessIndex::BrickAccessIndex()
+  : m_iFileSize(0)
+  , m_iFileHash(GetFileHash(nullptr, nullptr))
+  , m_iHeaderSize(0)
+{
+  FrameEntry const end = { 0, 0, 0, 0 };
+  m_Frames.assign(1, end);
+}
+
+bool BrickAccessIndex::Build(std::string const& filename)
+{
+  MappedFile file;
+  if (!file.Open(filename)) {
+    std::cerr << "failed to open file " << filename << std::endl;
+    return false;
+  }
+  return Build(file.GetData(), file.GetData() + file.GetSize());
+}
+
+bool BrickAccessIndex::Build(char const* begin, char const* end)
+{
+  using BrickAccessScan::LineKind;
+
+  m_iFileSize = uint64_t(end - begin);
+  m_iFileHash = GetFileHash(begin, end);
+  m_iHeaderSize = m_iFileSize;
+  m_Frames.clear();
+  m_Subframes.clear();
+
+  // frames start right after the previous frame mark, like in the parser a
+  // subframe or frame mark opens a frame and the frame mark closes it
+  bool bBody = false;
+  bool bFrameOpen = false;
+  uint64_t iRegionStart = 0;
+  uint64_t iRegionLine = 0;
+  uint64_t iLine = 0;
+  char const* p = begin;
+  while (p != end) {
+    char const* eol = BrickAccessScan::FindLineEnd(p, end);
+    char const* next = (eol == end) ? end : eol + 1;
+    ++iLine;
+    LineKind const kind = BrickAccessScan::ClassifyLine(p, eol);
+    if (kind == BrickAccessScan::LK_HEADER && bBody) {
+      std::cerr << "failed to index line " << iLine << ": header mark inside of frame data" << std::endl;
+      return false;
+    }
+    if (!bBody && (kind == BrickAccessScan::LK_BRICKS || kind == BrickAccessScan::LK_SUBFRAME ||
+        kind == BrickAccessScan::LK_FRAME)) {
+      bBody = true;
+      m_iHeaderSize = uint64_t(p - begin);
+      iRegionStart = m_iHeaderSize;
+      iRegionLine = iLine - 1;
+    }
+    if ((kind == BrickAccessScan::LK_SUBFRAME || kind == BrickAccessScan::LK_FRAME) && !bFrameOpen) {
+      FrameEntry const frame = { iRegionStart, iRegionLine, m_Subframes.size(), 0 };
+      m_Frames.push_back(frame);
+      bFrameOpen = true;
+    }
+    if (kind == BrickAccessScan::LK_SUBFRAME) {
+      BrickAccessScan::Token fields[3];
+      uint64_t count = 0;
+      if (BrickAccessScan::SplitFields(p, eol, '=', fields, 3) == 3)
+        count = BrickAccessScan::ToUInt32(fields[2]);
+      SubframeEntry const subframe = { uint64_t(p - begin), count };
+      m_Subframes.push_back(subframe);
+      m_Frames.back().brickCount += count;
+    } else if (kind == BrickAccessScan::LK_FRAME) {
+      bFrameOpen = false;
+      iRegionStart = uint64_t(next - begin);
+      iRegionLine = iLine;
+    }
+    p = next;
+  }
+
+  // the last frame does not need a frame mark
+  FrameEntry const last = {
+    bFrameOpen ? m_iFileSize : iRegionStart,
+    bFrameOpen ? iLine : iRegionLine,
+    m_Subframes.size(), 0
+  };
+  m_Frames.push_back(last);
+  return true;
+}
+
+bool BrickAccessIndex::Save(std::string const& filename) const
+{
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "failed to create file " << filename << std::endl;
+    return false;
+  }
+
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, Magic, sizeof(header.magic));
+  header.version = Version;
+  header.byteOrder = ByteOrderMark;
+  header.fileSize = m_iFileSize;
+  header.fileHash = m_iFileHash;
+  header.headerSize = m_iHeaderSize;
+  header.frameCount = GetFrameCount();
+  header.subframeCount = m_Subframes.size();
+  file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  file.write(reinterpret_cast<char const*>(m_Frames.data()), std::streamsize(m_Frames.size() * sizeof(FrameEntry)));
+  file.write(reinterpret_cast<char const*>(m_Subframes.data()), std::streamsize(m_Subframes.size() * sizeof(SubframeEntry)));
+  file.close();
+  if (file.fail()) {
+    std::cerr << "failed to write file " << filename << std::endl;
+    std::remove(filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool BrickAccessIndex::Load(std::string const& filename, char const* begin, char const* end)
+{
+  uint64_t const fileSize = uint64_t(end - begin);
+  MappedFile file;
+  if (!file.Open(filename) || file.GetSize() < sizeof(FileHeader))
+    return false;
+
+  FileHeader header;
+  memcpy(&header, file.GetData(), sizeof(header));
+  if (memcmp(header.magic, Magic, sizeof(header.magic)) != 0 || header.version != Version ||
+      header.byteOrder != ByteOrderMark || header.fileSize != fileSize ||
+      header.fileHash != GetFileHash(begin, end))
+    return false;
+  uint64_t const available = file.GetSize() - sizeof(FileHeader);
+  if (header.frameCount >= available / sizeof(FrameEntry) ||
+      header.subframeCount > available / sizeof(SubframeEntry) ||
+      (header.frameCount + 1) * sizeof(FrameEntry) + header.subframeCount * sizeof(SubframeEntry) != available)
+    return false;
+
+  char const* data = file.GetData() + sizeof(FileHeader);
+  std::vector<FrameEntry> frames(size_t(header.frameCount + 1));
+  memcpy(frames.data(), data, frames.size() * sizeof(FrameEntry));
+  data += frames.size() * sizeof(FrameEntry);
+  std::vector<SubframeEntry> subframes(size_t(header.subframeCount));
+  memcpy(subframes.data(), data, subframes.size() * sizeof(SubframeEntry));
+
+  // keep all lookups inside of the tables and the trace
+  for (size_t f=0; f+1<frames.size(); ++f) {
+    if (frames[f].offset > frames[f+1].offset || frames[f].firstSubframe > frames[f+1].firstSubframe)
+      return false;
+  }
+  if (frames.back().offset > fileSize || frames.back().firstSubframe != subframes.size())
+    return false;
+
+  m_iFileSize = header.fileSize;
+  m_iFileHash = header.fileHash;
+  m_iHeaderSize = header.headerSize;
+  m_Frames.swap(frames);
+  m_Subframes.swap(subframes);
+  return true;
+}
+
+bool BrickAccessIndex::Matches(char const* begin, char const* end) const
+{
+  return m_iFileSize == uint64_t(end - begin) && m_iFileHash == GetFileHash(begin, end);
+}
+
+uint64_t BrickAccessIndex::GetFileHash(char const* begin, char const* end)
+{
+  // the blocks overlap in traces shorter than two blocks
+  uint64_t const size = uint64_t(end - begin);
+  uint64_t const blockSize = size < BlockSize ? size : BlockSize;
+  uint64_t hash = 14695981039346656037ull;
+  hash = HashBytes(hash, begin, begin + blockSize);
+  hash = HashBytes(hash, end - blockSize, end);
+  return hash;
+}
+
+std::string BrickAccessIndex::GetSidecarFilename(std::string const& filename)
+{
+  return filename + ".bai";
+}
+
+uint64_t BrickAccessIndex::GetFileSize() const
+{
+  return m_iFileSize;
+}
+
+uint64_t BrickAccessIndex::GetHeaderSize() const
+{
+  return m_iHeaderSize;
+}
+
+size_t BrickAccessIndex::GetFrameCount() const
+{
+  return m_Frames.size() - 1;
+}
+
+BrickAccessIndex::FrameEntry const& BrickAccessIndex::GetFrame(size_t frame) const
+{
+  return m_Frames[frame];
+}
+
+uint64_t BrickAccessIndex::GetFrameEnd(size_t frame) const
+{
+  return m_Frames[frame+1].offset;
+}
+
+size_t BrickAccessIndex::GetSubframeCount(size_t frame) const
+{
+  return size_t(m_Frames[frame+1].firstSubframe - m_Frames[frame].firstSubframe);
+}
+
+BrickAccessIndex::SubframeEntry const& BrickAccessIndex::GetSubframe(size_t frame, size_t subframe) const
+{
+  return m_Subframes[size_t(m_Frames[frame].firstSubframe) + subframe];
+}
+
+size_t BrickAccessIndex::GetTotalSubframeCount() const
+{
+  return m_Subframes.size();
+}
+
+uint64_t BrickAccessIndex::GetTotalBrickCount() const
+{
+  uint64_t count = 0;
+  for (size_t f=0; f+1<m_Frames.size(); ++f)
+    count += m_Frames[f].brickCount;
+  return count;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,157 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_INDEX_H
+#define BRICK_ACCESS_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Byte offsets of all frames and subframes of an ASCII brick access file,
+// which allows to parse any range of frames without the frames in front of
+// it, see BrickAccessFile::LoadFrames().
+//
+// The index is built by a scan which only classifies lines and reads the
+// brick count of subframe marks, bricks are neither parsed nor validated. It
+// can be saved as a sidecar file next to the trace (extension: *.bai) and is
+// considered stale once the size of the trace or a hash of its first and last
+// BlockSize bytes changes. Appending frames or rewriting the trace is noticed
+// this way without reading it completely, only edits of the same size in the
+// middle of the file are not.
+//
+// A frame starts right after the frame mark of the previous frame (or the
+// header) and ends right after its own frame mark, so parsing the bytes of a
+// frame range reproduces exactly the parser state of a complete load.
+class BrickAccessIndex {
+public:
+  static uint32_t const Version = 2;
+
+  // bytes at the beginning and at the end of the trace covered by the hash
+  static uint64_t const BlockSize = 4096;
+
+  // Location of a frame.
+  struct FrameEntry {
+    // first byte of the frame
+    uint64_t offset;
+    // number of lines in front of the frame
+    uint64_t line;
+    // index of the first subframe of the frame
+    uint64_t firstSubframe;
+    // sum of the brick counts of all subframes
+    uint64_t brickCount;
+  };
+
+  // Location of a subframe.
+  struct SubframeEntry {
+    // first byte of the subframe mark
+    uint64_t offset;
+    // brick count given by the subframe mark
+    uint64_t brickCount;
+  };
+
+  // Fixed size header at the beginning of a sidecar file, followed by
+  // FrameEntry[frameCount + 1] and SubframeEntry[subframeCount].
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fileSize;
+    uint64_t fileHash;
+    uint64_t headerSize;
+    uint64_t frameCount;
+    uint64_t subframeCount;
+  };
+
+  // Creates an empty index.
+  BrickAccessIndex();
+
+  // Scans a brick access file.
+  // @returns false if the file could not be read or contains header marks
+  //   between frames, see std::cerr for details.
+  bool Build(std::string const& filename);
+
+  // Scans a brick access file in memory.
+  // @returns false if header marks follow frame data, see std::cerr.
+  bool Build(char const* begin, char const* end);
+
+  // Writes the index to a sidecar file.
+  // @returns false if writing failed, see std::cerr for details.
+  bool Save(std::string const& filename) const;
+
+  // Reads a sidecar file.
+  // @param begin and end are the current bytes of the indexed trace, an index
+  //   which does not match them is rejected, see Matches().
+  // @returns false if the file is missing, broken or stale.
+  bool Load(std::string const& filename, char const* begin, char const* end);
+
+  // @returns true if the index was built from a trace with the size and the
+  //   hash of the given bytes.
+  bool Matches(char const* begin, char const* end) const;
+
+  // @returns the hash of the first and last BlockSize bytes of a trace.
+  static uint64_t GetFileHash(char const* begin, char const* end);
+
+  // @returns the default sidecar filename of a trace.
+  static std::string GetSidecarFilename(std::string const& filename);
+
+  // @returns the size of the indexed file in bytes.
+  uint64_t GetFileSize() const;
+
+  // @returns the number of bytes in front of the first frame data.
+  uint64_t GetHeaderSize() const;
+
+  // @returns the number of frames.
+  size_t GetFrameCount() const;
+
+  // @returns the location of a frame.
+  FrameEntry const& GetFrame(size_t frame) const;
+
+  // @returns the byte behind the last byte of a frame.
+  uint64_t GetFrameEnd(size_t frame) const;
+
+  // @returns the number of subframes of a frame.
+  size_t GetSubframeCount(size_t frame) const;
+
+  // @returns the location of a subframe of a frame.
+  SubframeEntry const& GetSubframe(size_t frame, size_t subframe) const;
+
+  // @returns the number of subframes of all frames.
+  size_t GetTotalSubframeCount() const;
+
+  // @returns the sum of the brick counts of all subframes.
+  uint64_t GetTotalBrickCount() const;
+
+private:
+  uint64_t m_iFileSize;
+  uint64_t m_iFileHash;
+  uint64_t m_iHeaderSize;
+  // one additional entry marks the end of the last frame
+  std::vector<FrameEntry> m_Frames;
+  std::vector<SubframeEntry> m_Subframes;
+};
+
+#endif // BRICK_ACCESS_INDEX_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
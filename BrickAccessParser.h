@@ -0,0 +1,744 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_PARSER_H
+#define BRICK_ACCESS_PARSER_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessStats.h"
+
+// Byte level scanner for the brick access file grammar. The parser operates on
+// raw character ranges (usually a memory mapped file) and never creates
+// intermediate strings or streams. It follows the exact tokenization rules of
+// the stream based reader in BrickAccessFile.cpp, so both produce identical
+// results and error messages.
+//
+// Parsed header values are written to a BrickAccessFile::Header, the frame
+// structure is reported to a Sink which has to provide the following members:
+//
+//   void BeginFrame();                  // a new (empty) frame starts
+//   void BeginSubframe(uint32_t count); // a new subframe with count bricks
+//   void AddBricks(BrickAccessFile::Brick const* bricks, size_t count);
+//   void EndFrame();                    // the current frame is complete
+//
+// AddBricks() always refers to the most recently started subframe. Bricks are
+// validated against the header before they are handed to the sink.
+namespace BrickAccessScan {
+
+  // A non-owning range of characters.
+  struct Token {
+    char const* begin;
+    char const* end;
+  };
+
+  // Matches the whitespace classification of std::istream.
+  inline bool IsSpace(char c)
+  {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  }
+
+  // Matches the separators used by the PM_BRACKETS tokenizer.
+  inline bool IsBracketSpace(char c)
+  {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  inline bool Equals(Token const& token, char const* text)
+  {
+    size_t const length = strlen(text);
+    return size_t(token.end - token.begin) == length &&
+      memcmp(token.begin, text, length) == 0;
+  }
+
+  // Converts the leading number of [begin, end) like operator>> of an
+  // std::istream into an uint32_t would: optional sign, decimal digits,
+  // saturation on overflow, negated values wrap around and a missing number
+  // yields zero. Leading whitespace is skipped.
+  inline uint32_t ToUInt32(char const* p, char const* end)
+  {
+    while (p != end && IsSpace(*p)) ++p;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+      negative = (*p == '-');
+      ++p;
+    }
+    uint64_t value = 0;
+    bool overflow = false;
+    for (; p != end && unsigned(*p - '0') < 10; ++p) {
+      value = value * 10 + unsigned(*p - '0');
+      if (value > 0xFFFFFFFFull) {
+        overflow = true;
+        value = 0xFFFFFFFFull;
+      }
+    }
+    if (overflow)
+      return 0xFFFFFFFFu;
+    return negative ? uint32_t(0u - uint32_t(value)) : uint32_t(value);
+  }
+
+  inline uint32_t ToUInt32(Token const& token)
+  {
+    return ToUInt32(token.begin, token.end);
+  }
+
+  // Splits [begin, end) at whitespace like the PM_NONE tokenizer does.
+  // @returns the total number of words, only the first maxWords are stored.
+  inline size_t SplitWords(char const* p, char const* end, Token* words, size_t maxWords)
+  {
+    size_t count = 0;
+    for (;;) {
+      while (p != end && IsSpace(*p)) ++p;
+      if (p == end)
+        return count;
+      char const* const begin = p;
+      while (p != end && !IsSpace(*p)) ++p;
+      if (count < maxWords) {
+        words[count].begin = begin;
+        words[count].end = p;
+      }
+      ++count;
+    }
+  }
+
+  inline size_t SplitWords(Token const& token, Token* words, size_t maxWords)
+  {
+    return SplitWords(token.begin, token.end, words, maxWords);
+  }
+
+  // Splits [begin, end) at every delimiter and drops empty fields like the
+  // PM_CUSTOM_DELIMITER tokenizer does.
+  // @returns the total number of fields, only the first maxFields are stored.
+  inline size_t SplitFields(char const* p, char const* end, char delimiter, Token* fields, size_t maxFields)
+  {
+    size_t count = 0;
+    char const* begin = p;
+    for (;; ++p) {
+      if (p == end || *p == delimiter) {
+        if (p != begin) {
+          if (count < maxFields) {
+            fields[count].begin = begin;
+            fields[count].end = p;
+          }
+          ++count;
+        }
+        if (p == end)
+          return count;
+        begin = p + 1;
+      }
+    }
+  }
+
+  // Classification of a line by its leading character and mark.
+  enum LineKind {
+    LK_NONE = 0, // empty, comment, unknown or unused lines
+    LK_BRICKS,   // bracketed brick list
+    LK_HEADER,   // MaxBrickSize, BrickOverlap, LoDCount and LoD marks
+    LK_SUBFRAME,
+    LK_FRAME
+  };
+
+  // @returns the kind of mark named by the first field of a mark line.
+  inline LineKind ClassifyMark(Token const& key)
+  {
+    if (Equals(key, "MaxBrickSize") || Equals(key, "BrickOverlap") ||
+        Equals(key, "LoDCount") || Equals(key, " LoD") || Equals(key, "LoD"))
+      return LK_HEADER;
+    if (Equals(key, " Subframe") || Equals(key, "Subframe"))
+      return LK_SUBFRAME;
+    if (Equals(key, " Frame") || Equals(key, "Frame"))
+      return LK_FRAME;
+    return LK_NONE;
+  }
+
+  // @returns the kind of the line [begin, end) without its terminating '\n'.
+  inline LineKind ClassifyLine(char const* begin, char const* end)
+  {
+    if (begin == end || *begin == '#')
+      return LK_NONE;
+    if (*begin == '[')
+      return LK_BRICKS;
+    Token fields[2];
+    if (SplitFields(begin, end, '=', fields, 2) <= 1)
+      return LK_NONE;
+    return ClassifyMark(fields[0]);
+  }
+
+  // @returns the end of the line starting at begin, i.e. the position of the
+  //   terminating '\n' or end for the last line.
+  inline char const* FindLineEnd(char const* begin, char const* end)
+  {
+    char const* eol = static_cast<char const*>(memchr(begin, '\n', size_t(end - begin)));
+    return eol == nullptr ? end : eol;
+  }
+
+  // Walks a brick line like the brick scanner does, but without converting
+  // or storing anything.
+  // @returns the number of words found.
+  inline size_t CountBrickWords(char const* p, char const* end)
+  {
+    size_t count = 0;
+    for (;;) {
+      while (p != end && (IsSpace(*p) || *p == '[' || *p == ']')) ++p;
+      if (p == end)
+        return count;
+      ++count;
+      while (p != end && !IsSpace(*p) && *p != '[' && *p != ']') ++p;
+    }
+  }
+
+} // namespace BrickAccessScan
+
+template<class Sink>
+class BrickAccessParser {
+public:
+  typedef BrickAccessFile::Brick Brick;
+  typedef BrickAccessScan::Token Token;
+
+  // Creates a parser which stores the header into the given object and
+  // reports the frame structure to the given sink.
+  BrickAccessParser(BrickAccessFile::Header& header, Sink& sink)
+    : m_Header(header)
+    , m_Sink(sink)
+    , m_iLine(0)
+    , m_iErrorLine(0)
+    , m_iExpectedBricks(0)
+    , m_iSubframeCounter(0)
+    , m_iFrameCounter(0)
+    , m_bFrameOpen(false)
+    , m_bSubframeOpen(false)
+    , m_bBodyOnly(false)
+    , m_bHeaderInBody(false)
+    , m_bDeferFrameBase(false)
+    , m_iFrameBaseLine(0)
+    , m_iFrameBase(0)
+    , m_pCounters(nullptr)
+  {}
+
+  // Parses all lines of [begin, end). Lines are terminated by '\n', the last
+  // line does not need a terminator.
+  // @returns false on the first error, see GetErrorLine() and GetError().
+  bool Parse(char const* begin, char const* end)
+  {
+    while (begin != end) {
+      char const* eol = BrickAccessScan::FindLineEnd(begin, end);
+      if (!ParseLine(begin, eol))
+        return false;
+      begin = (eol == end) ? end : eol + 1;
+    }
+    return true;
+  }
+
+  // Parses the lines at the beginning of [begin, end) up to the first brick,
+  // subframe or frame line.
+  // @param begin is advanced to the start of the first line not parsed.
+  // @returns false on the first error, see GetErrorLine() and GetError().
+  bool ParseHeader(char const*& begin, char const* end)
+  {
+    while (begin != end) {
+      char const* eol = BrickAccessScan::FindLineEnd(begin, end);
+      BrickAccessScan::LineKind const kind = BrickAccessScan::ClassifyLine(begin, eol);
+      if (kind == BrickAccessScan::LK_BRICKS || kind == BrickAccessScan::LK_SUBFRAME ||
+          kind == BrickAccessScan::LK_FRAME)
+        return true;
+      if (!ParseLine(begin, eol))
+        return false;
+      begin = (eol == end) ? end : eol + 1;
+    }
+    return true;
+  }
+
+  // Parses a single line without its terminating '\n'.
+  // @returns false if the line contains an error.
+  bool ParseLine(char const* begin, char const* end)
+  {
+    ++m_iLine;
+    if (begin == end)
+      return true;
+    if (*begin == '#')
+      return true; // skip comment line
+    if (*begin == '[')
+      return ParseBricks(begin, end);
+    return ParseMarks(begin, end);
+  }
+
+  // Restarts the parser at the beginning of another file. The header object
+  // is left as is, the brick buffer keeps its capacity.
+  void Reset()
+  {
+    m_Error.clear();
+    m_iLine = 0;
+    m_iErrorLine = 0;
+    m_iExpectedBricks = 0;
+    m_iSubframeCounter = 0;
+    m_iFrameCounter = 0;
+    m_bFrameOpen = false;
+    m_bSubframeOpen = false;
+    m_bBodyOnly = false;
+    m_bHeaderInBody = false;
+    m_bDeferFrameBase = false;
+    m_iFrameBaseLine = 0;
+    m_iFrameBase = 0;
+  }
+
+  // @returns the number of lines consumed so far.
+  uint64_t GetLine() const { return m_iLine; }
+
+  // @returns the line number of the last error.
+  uint64_t GetErrorLine() const { return m_iErrorLine; }
+
+  // @returns the description of the last error, formatted as the text which
+  //   follows the line number in the error messages of BrickAccessFile.
+  std::string const& GetError() const { return m_Error; }
+
+  // Restricts the parser to frame data. Header marks change the validation
+  // of all following lines, so a body only parser stops at the first header
+  // mark with an error and FoundHeaderInBody() returns true.
+  void SetBodyOnly(bool bodyOnly) { m_bBodyOnly = bodyOnly; }
+
+  // @returns true if parsing stopped at a header mark in body only mode.
+  bool FoundHeaderInBody() const { return m_bHeaderInBody; }
+
+  // Lets the parser start in the middle of a file right after a frame mark
+  // whose number is unknown. The first frame mark is accepted as is and sets
+  // the frame counter, the caller has to validate it afterwards using
+  // GetFrameBase() and GetFrameBaseLine().
+  void SetDeferredFrameBase(bool defer) { m_bDeferFrameBase = defer; }
+
+  // @returns the line number of the first frame mark accepted with a deferred
+  //   frame base, zero if no frame mark has been parsed yet.
+  uint64_t GetFrameBaseLine() const { return m_iFrameBaseLine; }
+
+  // @returns the frame number of the first frame mark accepted with a
+  //   deferred frame base.
+  uint32_t GetFrameBase() const { return m_iFrameBase; }
+
+  // @returns the number of frame marks parsed so far, including the frame
+  //   base when it was deferred.
+  uint32_t GetFrameCounter() const { return m_iFrameCounter; }
+
+  // Counts bricks, samples brick lines and the capacity of the brick buffer
+  // into the given counters, see BrickAccessStats. Null disables counting.
+  void SetCounters(BrickAccessStats::Counters* pCounters) { m_pCounters = pCounters; }
+
+private:
+  // Parses a line of bracketed bricks into the current subframe.
+  bool ParseBricks(char const* begin, char const* end)
+  {
+    bool const bSample = BrickAccessStats::SampleLine(m_pCounters, size_t(end - begin));
+    BrickAccessStats::Clock::time_point start;
+    if (bSample)
+      start = BrickAccessStats::Clock::now();
+
+    // the smallest valid brick "[0 0 0 0]" takes nine characters, this bounds
+    // the reservation for broken brick counts
+    size_t const maxBricks = size_t(end - begin) / 9 + 1;
+    size_t const capacity = m_Bricks.capacity();
+    m_Bricks.clear();
+    m_Bricks.reserve(std::min(size_t(m_iExpectedBricks), maxBricks));
+
+    BrickError error = { 0, BE_NONE };
+    size_t count = 0;
+    if (!ScanBricks(begin, end, count, error)) {
+      // unusual bracket structure, fall back to the exact tokenizer
+      m_Bricks.clear();
+      error.kind = BE_NONE;
+      count = TokenizeBricks(begin, end, error);
+    }
+    BrickAccessStats::CountCapacity(m_pCounters, capacity, m_Bricks);
+    if (bSample)
+      SampleBricks(begin, end, start);
+
+    if (count != m_iExpectedBricks)
+      return Fail(": wrong brick count for subframe");
+    if (error.kind != BE_NONE) {
+      std::ostringstream ss;
+      ss << " at brick number: " << error.index;
+      if (error.kind == BE_LOD)
+        ss << " brick LoD exceeds bounds";
+      else if (error.kind == BE_POSITION)
+        ss << " brick position exceeds bounds";
+      return Fail(ss.str());
+    }
+
+    // without an open subframe only empty brick lists pass the count check
+    if (m_bSubframeOpen) {
+      if (bSample)
+        start = BrickAccessStats::Clock::now();
+      m_Sink.AddBricks(m_Bricks.data(), m_Bricks.size());
+      if (bSample)
+        m_pCounters->sampledStoreSeconds += BrickAccessStats::GetSeconds(start, BrickAccessStats::Clock::now());
+    }
+#if BRICK_ACCESS_STATS
+    if (m_pCounters != nullptr)
+      m_pCounters->bricks += m_Bricks.size();
+#endif
+    m_iSubframeCounter++;
+    return true; // finished parsing subframe
+  }
+
+  // Measures a parsed brick line in parts: the tokenizing and the validation
+  // are repeated on their own, the rest of the parse time is conversion.
+  void SampleBricks(char const* begin, char const* end, BrickAccessStats::Clock::time_point start)
+  {
+    typedef BrickAccessStats::Clock Clock;
+    Clock::time_point const parsed = Clock::now();
+    size_t const words = BrickAccessScan::CountBrickWords(begin, end);
+    Clock::time_point const tokenized = Clock::now();
+    std::vector<BrickAccessFile::Vec3<uint64_t> > const& brickCounts = m_Header.brickCounts;
+    size_t valid = 0;
+    for (size_t i=0; i<m_Bricks.size(); ++i) {
+      Brick const& brick = m_Bricks[i];
+      if (brick.w < brickCounts.size()) {
+        BrickAccessFile::Vec3<uint64_t> const& brickCount = brickCounts[size_t(brick.w)];
+        valid += brick.x < brickCount.x && brick.y < brickCount.y && brick.z < brickCount.z;
+      }
+    }
+    Clock::time_point const validated = Clock::now();
+    // the results keep the repeated parts from being optimized away
+    m_pCounters->sampledTokens += words + valid;
+    m_pCounters->sampledParseSeconds += BrickAccessStats::GetSeconds(start, parsed);
+    m_pCounters->sampledTokenizeSeconds += BrickAccessStats::GetSeconds(parsed, tokenized);
+    m_pCounters->sampledValidateSeconds += BrickAccessStats::GetSeconds(tokenized, validated);
+  }
+
+  enum BrickErrorKind {
+    BE_NONE = 0,
+    BE_ELEMENTS,
+    BE_LOD,
+    BE_POSITION
+  };
+
+  struct BrickError {
+    size_t index;
+    BrickErrorKind kind;
+  };
+
+  // Fast path for the canonical "[x y z w][x y z w] ..." layout. Tokens are
+  // converted as they are found, but bricks are only validated and collected
+  // until the first error because the brick count error takes precedence.
+  // @returns false if the line uses a bracket structure which needs the exact
+  //   tokenizer, e.g. nested brackets or text outside of brackets.
+  bool ScanBricks(char const* p, char const* end, size_t& count, BrickError& error)
+  {
+    using BrickAccessScan::IsSpace;
+    using BrickAccessScan::IsBracketSpace;
+    for (;;) {
+      while (p != end && IsBracketSpace(*p)) ++p;
+      if (p == end)
+        return true;
+      if (*p != '[')
+        return false;
+      char const* const tokenBegin = ++p;
+
+      uint32_t elements[4];
+      size_t elementCount = 0;
+      for (;;) {
+        while (p != end && IsSpace(*p)) ++p;
+        if (p == end)
+          return false; // unterminated bracket
+        if (*p == ']')
+          break;
+        char const* const wordBegin = p;
+        while (p != end && !IsSpace(*p) && *p != ']' && *p != '[') ++p;
+        if (p != end && *p == '[')
+          return false; // nested bracket
+        if (elementCount < 4)
+          elements[elementCount] = BrickAccessScan::ToUInt32(wordBegin, p);
+        ++elementCount;
+      }
+      if (p == tokenBegin) {
+        ++p;
+        continue; // "[]" does not produce a token
+      }
+      ++p;
+      AddBrick(elements, elementCount, count++, error);
+      if (p != end && !IsBracketSpace(*p) && *p != '[')
+        return false; // text directly after a closing bracket
+    }
+  }
+
+  // Exact reimplementation of the PM_BRACKETS tokenizer for lines which are
+  // not handled by ScanBricks().
+  // @returns the number of tokens found.
+  size_t TokenizeBricks(char const* begin, char const* end, BrickError& error)
+  {
+    size_t count = 0;
+    ptrdiff_t iLevel = 0;
+    char const* start = begin;
+    char const* p = begin;
+    for (; p != end; ++p) {
+      if (*p == '[') {
+        if (iLevel == 0)
+          ++start;
+        ++iLevel;
+        continue;
+      } else if (*p == ']') {
+        --iLevel;
+        if (iLevel == 0) {
+          if (p - start > 0)
+            AddToken(start, p, count++, error);
+          start = p + 1;
+        }
+        continue;
+      }
+      if (BrickAccessScan::IsBracketSpace(*p) && iLevel == 0) {
+        if (p - start > 0)
+          AddToken(start, p, count++, error);
+        start = p + 1;
+      }
+    }
+    if (p - start > 0)
+      AddToken(start, p, count++, error);
+    return count;
+  }
+
+  void AddToken(char const* begin, char const* end, size_t index, BrickError& error)
+  {
+    Token words[4];
+    size_t const wordCount = BrickAccessScan::SplitWords(begin, end, words, 4);
+    uint32_t elements[4];
+    for (size_t i=0; i<wordCount && i<4; ++i)
+      elements[i] = BrickAccessScan::ToUInt32(words[i]);
+    AddBrick(elements, wordCount, index, error);
+  }
+
+  void AddBrick(uint32_t const* elements, size_t elementCount, size_t index, BrickError& error)
+  {
+    if (error.kind != BE_NONE)
+      return; // only the first broken brick is reported
+    if (elementCount != 4) {
+      error.index = index;
+      error.kind = BE_ELEMENTS;
+      return;
+    }
+    Brick brick;
+    brick.x = elements[0];
+    brick.y = elements[1];
+    brick.z = elements[2];
+    brick.w = elements[3];
+    std::vector<BrickAccessFile::Vec3<uint64_t> > const& brickCounts = m_Header.brickCounts;
+    if (brick.w >= brickCounts.size()) {
+      error.index = index;
+      error.kind = BE_LOD;
+      return;
+    }
+    BrickAccessFile::Vec3<uint64_t> const& brickCount = brickCounts[size_t(brick.w)];
+    if (brick.x >= brickCount.x || brick.y >= brickCount.y || brick.z >= brickCount.z) {
+      error.index = index;
+      error.kind = BE_POSITION;
+      return;
+    }
+    m_Bricks.push_back(brick);
+  }
+
+  // Parses header, subframe and frame marks.
+  bool ParseMarks(char const* begin, char const* end)
+  {
+    using BrickAccessScan::Equals;
+    using BrickAccessScan::SplitWords;
+    using BrickAccessScan::ToUInt32;
+
+    Token tokens[4];
+    size_t const tokenCount = BrickAccessScan::SplitFields(begin, end, '=', tokens, 4);
+    if (tokenCount <= 1)
+      return true;
+
+    if (m_bBodyOnly && BrickAccessScan::ClassifyMark(tokens[0]) == BrickAccessScan::LK_HEADER) {
+      m_bHeaderInBody = true;
+      return Fail(": header mark inside of frame data");
+    }
+
+    Token elements[4];
+    if (Equals(tokens[0], "Filename")) {
+      // unused parameter
+
+    } else if (Equals(tokens[0], "MaxBrickSize")) {
+      if (SplitWords(tokens[1], elements, 4) != 3)
+        return Fail(": invalid MaxBrickSize");
+      m_Header.maxBrickSize.x = ToUInt32(elements[0]);
+      m_Header.maxBrickSize.y = ToUInt32(elements[1]);
+      m_Header.maxBrickSize.z = ToUInt32(elements[2]);
+
+    } else if (Equals(tokens[0], "BrickOverlap")) {
+      if (SplitWords(tokens[1], elements, 4) != 3)
+        return Fail(": invalid BrickOverlap");
+      m_Header.brickOverlap.x = ToUInt32(elements[0]);
+      m_Header.brickOverlap.y = ToUInt32(elements[1]);
+      m_Header.brickOverlap.z = ToUInt32(elements[2]);
+
+    } else if (Equals(tokens[0], "LoDCount")) {
+      if (tokenCount != 2)
+        return Fail(": invalid LoDCount");
+      uint32_t const LoDCount = ToUInt32(tokens[1]);
+      m_Header.domainSizes.resize(LoDCount);
+      m_Header.brickCounts.resize(LoDCount);
+
+    } else if (Equals(tokens[0], " LoD") || Equals(tokens[0], "LoD")) {
+      if (tokenCount != 4)
+        return Fail(": invalid LoD");
+      if (SplitWords(tokens[1], elements, 4) != 2)
+        return Fail(": invalid LoD value");
+      uint32_t const LoD = ToUInt32(elements[0]);
+      if (LoD >= m_Header.domainSizes.size() || LoD >= m_Header.brickCounts.size())
+        return Fail(": LoD not available");
+      if (!Equals(elements[1], "DomainSize"))
+        return Fail(": DomainSize not available");
+      if (SplitWords(tokens[2], elements, 4) != 4)
+        return Fail(": invalid DomainSize");
+      m_Header.domainSizes[LoD].x = ToUInt32(elements[0]);
+      m_Header.domainSizes[LoD].y = ToUInt32(elements[1]);
+      m_Header.domainSizes[LoD].z = ToUInt32(elements[2]);
+      if (!Equals(elements[3], "BrickCount"))
+        return Fail(": BrickCount not available");
+      if (SplitWords(tokens[3], elements, 4) != 3)
+        return Fail(": invalid BrickCount");
+      m_Header.brickCounts[LoD].x = ToUInt32(elements[0]);
+      m_Header.brickCounts[LoD].y = ToUInt32(elements[1]);
+      m_Header.brickCounts[LoD].z = ToUInt32(elements[2]);
+
+    } else if (Equals(tokens[0], " Subframe") || Equals(tokens[0], "Subframe")) {
+      if (tokenCount != 3)
+        return Fail(": invalid Subframe");
+      if (SplitWords(tokens[1], elements, 4) != 2)
+        return Fail(": invalid Subframe value");
+      uint32_t const iSubframe = ToUInt32(elements[0]);
+      if (iSubframe != m_iSubframeCounter)
+        return Fail(": wrong Subframe value");
+      m_iExpectedBricks = ToUInt32(tokens[2]);
+      OpenFrame();
+      m_Sink.BeginSubframe(m_iExpectedBricks);
+      m_bSubframeOpen = true;
+
+    } else if (Equals(tokens[0], " Frame") || Equals(tokens[0], "Frame")) {
+      if (tokenCount != 4)
+        return Fail(": invalid Frame");
+      if (SplitWords(tokens[1], elements, 4) != 2)
+        return Fail(": invalid Frame value");
+      uint32_t const iFrame = ToUInt32(elements[0]);
+      if (m_bDeferFrameBase && m_iFrameBaseLine == 0) {
+        m_iFrameBase = iFrame;
+        m_iFrameBaseLine = m_iLine;
+        m_iFrameCounter = iFrame;
+      }
+      if (iFrame != m_iFrameCounter)
+        return Fail(": wrong Frame value");
+      OpenFrame();
+      m_Sink.EndFrame();
+      m_bFrameOpen = false;
+      m_bSubframeOpen = false;
+      m_iFrameCounter++;
+      m_iExpectedBricks = 0;
+      m_iSubframeCounter = 0;
+    }
+    return true;
+  }
+
+  // Frame marks terminate a frame, so subframes and frame marks both open a
+  // new frame if the previous one has been terminated.
+  void OpenFrame()
+  {
+    if (!m_bFrameOpen) {
+      m_Sink.BeginFrame();
+      m_bFrameOpen = true;
+    }
+  }
+
+  bool Fail(std::string const& error)
+  {
+    m_iErrorLine = m_iLine;
+    m_Error = error;
+    return false;
+  }
+
+  BrickAccessFile::Header& m_Header;
+  Sink& m_Sink;
+  std::vector<Brick> m_Bricks;
+  std::string m_Error;
+  uint64_t m_iLine;
+  uint64_t m_iErrorLine;
+  uint32_t m_iExpectedBricks;
+  uint32_t m_iSubframeCounter;
+  uint32_t m_iFrameCounter;
+  bool m_bFrameOpen;
+  bool m_bSubframeOpen;
+  bool m_bBodyOnly;
+  bool m_bHeaderInBody;
+  bool m_bDeferFrameBase;
+  uint64_t m_iFrameBaseLine;
+  uint32_t m_iFrameBase;
+  BrickAccessStats::Counters* m_pCounters;
+};
+
+// Sink which collects the parsed bricks into a vector of frames.
+class FrameBuilder {
+public:
+  // @param pCounters receives the capacity changes of the frames, null
+  //   disables counting, see BrickAccessStats.
+  FrameBuilder(std::vector<BrickAccessFile::Frame>& frames,
+    BrickAccessStats::Counters* pCounters = nullptr)
+    : m_Frames(frames)
+    , m_pCounters(pCounters)
+  {}
+
+  void BeginFrame()
+  {
+    size_t const capacity = m_Frames.capacity();
+    m_Frames.push_back(BrickAccessFile::Frame());
+    BrickAccessStats::CountCapacity(m_pCounters, capacity, m_Frames);
+  }
+
+  void BeginSubframe(uint32_t)
+  {
+    BrickAccessFile::Frame& frame = m_Frames.back();
+    size_t const capacity = frame.capacity();
+    frame.push_back(BrickAccessFile::Subframe());
+    BrickAccessStats::CountCapacity(m_pCounters, capacity, frame);
+  }
+
+  void AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+  {
+    BrickAccessFile::Subframe& subframe = m_Frames.back().back();
+    size_t const capacity = subframe.capacity();
+    subframe.insert(subframe.end(), bricks, bricks + count);
+    BrickAccessStats::CountCapacity(m_pCounters, capacity, subframe);
+  }
+
+  void EndFrame() {}
+
+private:
+  FrameBuilder& operator=(FrameBuilder const&);
+
+  std::vector<BrickAccessFile::Frame>& m_Frames;
+  BrickAccessStats::Counters* m_pCounters;
+};
+
+#endif // BRICK_ACCESS_PARSER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,222 @@
+#include "BrickAccessStats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+  char const* const PhaseNames[BrickAccessStats::PH_COUNT] = {
+    "open", "read", "index", "header", "scan", "convert", "validate", "store", "merge"
+  };
+
+  void GetPageFaults(uint64_t& minorFaults, uint64_t& majorFaults)
+  {
+#ifdef _WIN32
+    minorFaults = 0;
+    majorFaults = 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+      minorFaults = 0;
+      majorFaults = 0;
+      return;
+    }
+    minorFaults = uint64_t(usage.ru_minflt);
+    majorFaults = uint64_t(usage.ru_majflt);
+#endif
+  }
+
+  double GetRate(double value, double seconds)
+  {
+    return seconds > 0.0 ? value / seconds : 0.0;
+  }
+
+}
+
+void BrickAccessStats::Counters::Clear()
+{
+  std::fill(seconds, seconds + PH_COUNT, 0.0);
+  lines = 0;
+  bricks = 0;
+  brickLines = 0;
+  brickLineBytes = 0;
+  allocations = 0;
+  allocatedBytes = 0;
+  capacityBytes = 0;
+  peakCapacityBytes = 0;
+  sampledLines = 0;
+  sampledBytes = 0;
+  sampledTokens = 0;
+  sampledParseSeconds = 0.0;
+  sampledTokenizeSeconds = 0.0;
+  sampledValidateSeconds = 0.0;
+  sampledStoreSeconds = 0.0;
+}
+
+void BrickAccessStats::Counters::ClearParse()
+{
+  std::fill(seconds + PH_SCAN, seconds + PH_COUNT, 0.0);
+  lines = 0;
+  bricks = 0;
+  brickLines = 0;
+  brickLineBytes = 0;
+  allocations = 0;
+  allocatedBytes = 0;
+  capacityBytes = 0;
+  sampledLines = 0;
+  sampledBytes = 0;
+  sampledTokens = 0;
+  sampledParseSeconds = 0.0;
+  sampledTokenizeSeconds = 0.0;
+  sampledValidateSeconds = 0.0;
+  sampledStoreSeconds = 0.0;
+}
+
+void BrickAccessStats::Counters::Add(Counters const& other)
+{
+  for (size_t i=0; i<PH_COUNT; ++i)
+    seconds[i] += other.seconds[i];
+  lines += other.lines;
+  bricks += other.bricks;
+  brickLines += other.brickLines;
+  brickLineBytes += other.brickLineBytes;
+  allocations += other.allocations;
+  allocatedBytes += other.allocatedBytes;
+  peakCapacityBytes = std::max(peakCapacityBytes, capacityBytes + other.peakCapacityBytes);
+  capacityBytes += other.capacityBytes;
+  sampledLines += other.sampledLines;
+  sampledBytes += other.sampledBytes;
+  sampledTokens += other.sampledTokens;
+  sampledParseSeconds += other.sampledParseSeconds;
+  sampledTokenizeSeconds += other.sampledTokenizeSeconds;
+  sampledValidateSeconds += other.sampledValidateSeconds;
+  sampledStoreSeconds += other.sampledStoreSeconds;
+}
+
+BrickAccessStats::Scope::Scope(BrickAccessStats* pStats)
+  : m_pStats(GetCounters(pStats) != nullptr ? pStats : nullptr)
+{
+  if (m_pStats != nullptr)
+    m_pStats->Begin();
+}
+
+BrickAccessStats::Scope::~Scope()
+{
+  if (m_pStats != nullptr)
+    m_pStats->End();
+}
+
+BrickAccessStats::BrickAccessStats()
+{
+  Clear();
+}
+
+void BrickAccessStats::Clear()
+{
+  counters.Clear();
+  bytes = 0;
+  threads = 1;
+  wallSeconds = 0.0;
+  minorFaults = 0;
+  majorFaults = 0;
+}
+
+void BrickAccessStats::Begin()
+{
+  Clear();
+  GetPageFaults(minorFaults, majorFaults);
+  m_Start = Clock::now();
+}
+
+void BrickAccessStats::End()
+{
+  wallSeconds = GetSeconds(m_Start, Clock::now());
+  uint64_t minor, major;
+  GetPageFaults(minor, major);
+  minorFaults = minor - minorFaults;
+  majorFaults = major - majorFaults;
+
+  // the scan time covers everything the parser did, including the repeated
+  // parts of the sampled lines which are removed again
+  Counters& c = counters;
+  if (c.sampledBytes == 0)
+    return;
+  double const scale = double(c.brickLineBytes) / double(c.sampledBytes);
+  double const parse = std::max(c.seconds[PH_SCAN] - c.sampledTokenizeSeconds -
+    c.sampledValidateSeconds, 0.0);
+  double convert = std::max(c.sampledParseSeconds - c.sampledTokenizeSeconds -
+    c.sampledValidateSeconds, 0.0) * scale;
+  double validate = c.sampledValidateSeconds * scale;
+  double store = c.sampledStoreSeconds * scale;
+  double const split = convert + validate + store;
+  if (split > parse) {
+    // samples of very short traces may overshoot the measured total
+    convert *= parse / split;
+    validate *= parse / split;
+    store *= parse / split;
+  }
+  c.seconds[PH_CONVERT] += convert;
+  c.seconds[PH_VALIDATE] += validate;
+  c.seconds[PH_STORE] += store;
+  c.seconds[PH_SCAN] = parse - std::min(convert + validate + store, parse);
+}
+
+void BrickAccessStats::Print(std::ostream& stream) const
+{
+  double total = 0.0;
+  for (size_t i=0; i<PH_COUNT; ++i)
+    total += counters.seconds[i];
+
+  std::streamsize const precision = stream.precision();
+  stream << std::fixed << std::setprecision(3);
+  stream << "wall time:         " << wallSeconds * 1e3 << " ms" << std::endl;
+  stream << "thread time:       " << total * 1e3 << " ms on " << threads << " threads" << std::endl;
+  for (size_t i=0; i<PH_COUNT; ++i) {
+    if (counters.seconds[i] == 0.0)
+      continue;
+    stream << "  " << std::left << std::setw(17) << PhaseNames[i] << std::right
+      << counters.seconds[i] * 1e3 << " ms (" << std::setprecision(1)
+      << (total > 0.0 ? 100.0 * counters.seconds[i] / total : 0.0) << "%)"
+      << std::setprecision(3) << std::endl;
+  }
+  stream << std::setprecision(1);
+  stream << "bytes:             " << bytes << " (" << GetRate(double(bytes), wallSeconds) / 1e6 << " MB/s)" << std::endl;
+  stream << "lines:             " << counters.lines << " (" << counters.brickLines << " brick lines, "
+    << counters.sampledLines << " sampled)" << std::endl;
+  stream << "bricks:            " << counters.bricks << " (" << GetRate(double(counters.bricks), wallSeconds) / 1e6
+    << " M/s)" << std::endl;
+  stream << "allocations:       " << counters.allocations << " (" << counters.allocatedBytes << " bytes)" << std::endl;
+  stream << "peak capacity:     " << counters.peakCapacityBytes << " bytes" << std::endl;
+  stream << "page faults:       " << minorFaults << " minor, " << majorFaults << " major" << std::endl;
+  stream.unsetf(std::ios::floatfield);
+  stream.precision(precision);
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,284 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_STATS_H
+#define BRICK_ACCESS_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// Compile with BRICK_ACCESS_STATS=0 to remove all measurements from the load
+// paths. The interface stays available, but the statistics remain empty.
+#ifndef BRICK_ACCESS_STATS
+#define BRICK_ACCESS_STATS 1
+#endif
+
+// Where the time and memory of a BrickAccessFile load goes, see
+// BrickAccessFile::SetStats().
+//
+// Phase times are measured per thread and summed, so a parallel load reports
+// thread seconds which exceed the wall time. The byte level parser interleaves
+// tokenizing, number conversion and validation within a brick line, so these
+// phases are not timed on every line: every 16th brick line is repeated in
+// parts after it has been parsed, and the parse time of all lines is split in
+// the proportions of these samples. Mapped loads read the file through page
+// faults during parsing, the fault counters show how much of that was I/O.
+class BrickAccessStats {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum Phase {
+    // opening and mapping the file
+    PH_OPEN = 0,
+    // reading the file into buffers, only stream loads read explicitly
+    PH_READ,
+    // loading or building the frame index of LoadFrames(), or counting the
+    // bricks of the file for ST_ARENA
+    PH_INDEX,
+    PH_HEADER,
+    // splitting lines, handling marks and tokenizing brick lists
+    PH_SCAN,
+    // converting the numbers of bricks
+    PH_CONVERT,
+    // checking bricks against the header
+    PH_VALIDATE,
+    // handing bricks to the frames or the flat trace
+    PH_STORE,
+    // joining the chunks of parallel loads and releasing spare capacity
+    PH_MERGE,
+    PH_COUNT
+  };
+
+  // Counters of one thread. Threads count into their own counters, which are
+  // added to the statistics once the thread is done.
+  struct Counters {
+    double seconds[PH_COUNT];
+    uint64_t lines;
+    uint64_t bricks;
+    uint64_t brickLines;
+    uint64_t brickLineBytes;
+    // (re)allocations of the bricks containers and the bytes they requested
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    // capacity of all bricks containers in bytes, now and at most
+    uint64_t capacityBytes;
+    uint64_t peakCapacityBytes;
+    // brick lines measured in parts, see SampleLine()
+    uint64_t sampledLines;
+    uint64_t sampledBytes;
+    uint64_t sampledTokens;
+    double sampledParseSeconds;
+    double sampledTokenizeSeconds;
+    double sampledValidateSeconds;
+    double sampledStoreSeconds;
+
+    void Clear();
+
+    // Clears what a discarded parse counted: the phases from PH_SCAN on, the
+    // line and brick counts and the containers it released. Opening the file,
+    // the index, the header and the peak capacity are kept.
+    void ClearParse();
+
+    // Adds the counters of a thread which ran concurrently, its containers
+    // are assumed to be alive until now.
+    void Add(Counters const& other);
+  };
+
+  // Adds the time from its construction until Stop() or its destruction to a
+  // phase. Does nothing without counters.
+  class Timer {
+  public:
+    Timer(Counters* pCounters, Phase phase);
+    ~Timer();
+    void Stop();
+
+  private:
+    Timer(Timer const&);
+    Timer& operator=(Timer const&);
+
+    Counters* m_pCounters;
+    Phase m_Phase;
+    Clock::time_point m_Start;
+  };
+
+  // Clears the statistics on construction and completes them on destruction,
+  // i.e. it spans one load. Does nothing without statistics.
+  class Scope {
+  public:
+    explicit Scope(BrickAccessStats* pStats);
+    ~Scope();
+
+  private:
+    Scope(Scope const&);
+    Scope& operator=(Scope const&);
+
+    BrickAccessStats* m_pStats;
+  };
+
+  BrickAccessStats();
+
+  void Clear();
+
+  // @returns false if the statistics are compiled out.
+  static bool IsEnabled();
+
+  // Prints all values in a human readable form.
+  void Print(std::ostream& stream) const;
+
+  // @returns the counters of the statistics for the calling thread, null
+  //   without statistics or if they are compiled out.
+  static Counters* GetCounters(BrickAccessStats* pStats);
+
+  // Counts a brick line of the given size.
+  // @returns true if the line should be measured in parts.
+  static bool SampleLine(Counters* pCounters, size_t bytes);
+
+  // Counts a container whose capacity changed, e.g. after an insert.
+  template<class T>
+  static void CountCapacity(Counters* pCounters, size_t oldCapacity, std::vector<T> const& container);
+
+  // Counts memory which has been (re)allocated with newBytes or released
+  // (zero newBytes).
+  static void CountBytes(Counters* pCounters, uint64_t oldBytes, uint64_t newBytes);
+
+  static double GetSeconds(Clock::time_point start, Clock::time_point end);
+
+  // counters of all threads, phase times are final after the load
+  Counters counters;
+  // bytes of the file or frame range
+  uint64_t bytes;
+  uint32_t threads;
+  double wallSeconds;
+  // page faults of the process during the load
+  uint64_t minorFaults;
+  uint64_t majorFaults;
+
+private:
+  void Begin();
+  void End();
+
+  Clock::time_point m_Start;
+};
+
+inline BrickAccessStats::Timer::Timer(Counters* pCounters, Phase phase)
+  : m_pCounters(pCounters)
+  , m_Phase(phase)
+{
+#if BRICK_ACCESS_STATS
+  if (m_pCounters != nullptr)
+    m_Start = Clock::now();
+#endif
+}
+
+inline BrickAccessStats::Timer::~Timer()
+{
+  Stop();
+}
+
+inline void BrickAccessStats::Timer::Stop()
+{
+#if BRICK_ACCESS_STATS
+  if (m_pCounters != nullptr) {
+    m_pCounters->seconds[m_Phase] += GetSeconds(m_Start, Clock::now());
+    m_pCounters = nullptr;
+  }
+#endif
+}
+
+inline bool BrickAccessStats::IsEnabled()
+{
+  return BRICK_ACCESS_STATS != 0;
+}
+
+inline BrickAccessStats::Counters* BrickAccessStats::GetCounters(BrickAccessStats* pStats)
+{
+#if BRICK_ACCESS_STATS
+  return pStats != nullptr ? &pStats->counters : nullptr;
+#else
+  (void)pStats;
+  return nullptr;
+#endif
+}
+
+inline bool BrickAccessStats::SampleLine(Counters* pCounters, size_t bytes)
+{
+#if BRICK_ACCESS_STATS
+  if (pCounters == nullptr)
+    return false;
+  pCounters->brickLineBytes += bytes;
+  if ((pCounters->brickLines++ & 15) != 0)
+    return false;
+  pCounters->sampledBytes += bytes;
+  ++pCounters->sampledLines;
+  return true;
+#else
+  (void)pCounters;
+  (void)bytes;
+  return false;
+#endif
+}
+
+template<class T>
+inline void BrickAccessStats::CountCapacity(Counters* pCounters, size_t oldCapacity, std::vector<T> const& container)
+{
+#if BRICK_ACCESS_STATS
+  if (container.capacity() != oldCapacity)
+    CountBytes(pCounters, uint64_t(oldCapacity) * sizeof(T), uint64_t(container.capacity()) * sizeof(T));
+#else
+  (void)pCounters;
+  (void)oldCapacity;
+  (void)container;
+#endif
+}
+
+inline void BrickAccessStats::CountBytes(Counters* pCounters, uint64_t oldBytes, uint64_t newBytes)
+{
+#if BRICK_ACCESS_STATS
+  if (pCounters == nullptr)
+    return;
+  if (newBytes != 0) {
+    ++pCounters->allocations;
+    pCounters->allocatedBytes += newBytes;
+  }
+  // wraps around for shrinking containers, the sum stays exact
+  pCounters->capacityBytes += newBytes - oldBytes;
+  if (pCounters->capacityBytes > pCounters->peakCapacityBytes)
+    pCounters->peakCapacityBytes = pCounters->capacityBytes;
+#else
+  (void)pCounters;
+  (void)oldBytes;
+  (void)newBytes;
+#endif
+}
+
+inline double BrickAccessStats::GetSeconds(Clock::time_point start, Clock::time_point end)
+{
+  return std::chrono::duration<double>(end - start).count();
+}
+
+#endif // BRICK_ACCESS_STATS_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,347 @@
+#include "BrickAccessStream.h"
+
+#include <iostream>
+
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessParser.h"
+#include "LineReader.h"
+
+// Frame storage which keeps the subframe buffers of previous frames alive.
+// Frames parsed ahead may follow header marks the consumer has not seen yet,
+// so every buffer carries the header of its frame.
+struct BrickAccessStream::FrameBuffer {
+  BrickAccessFile::Frame frame;
+  std::vector<BrickAccessFile::Subframe> spare;
+  uint64_t iIndex;
+  BrickAccessFile::Header header;
+  // header marks the reader had parsed when the header was copied
+  uint64_t iHeaderVersion;
+
+  FrameBuffer() : iIndex(0), iHeaderVersion(~uint64_t(0)) {}
+
+  void Reset()
+  {
+    while (!frame.empty()) {
+      spare.push_back(BrickAccessFile::Subframe());
+      spare.back().swap(frame.back());
+      frame.pop_back();
+    }
+  }
+
+  BrickAccessFile::Subframe& AddSubframe()
+  {
+    frame.push_back(BrickAccessFile::Subframe());
+    if (!spare.empty()) {
+      frame.back().swap(spare.back());
+      spare.pop_back();
+      frame.back().clear();
+    }
+    return frame.back();
+  }
+};
+
+namespace {
+
+  // Sink which fills a single reusable frame buffer.
+  template<class Buffer>
+  class FrameSink {
+  public:
+    FrameSink() : m_pBuffer(nullptr), m_pSubframe(nullptr), m_bFrameOpen(false), m_bComplete(false) {}
+
+    void Start(Buffer* buffer)
+    {
+      m_pBuffer = buffer;
+      m_pBuffer->Reset();
+      m_pSubframe = nullptr;
+      m_bFrameOpen = false;
+      m_bComplete = false;
+    }
+
+    void BeginFrame() { m_bFrameOpen = true; }
+    void BeginSubframe(uint32_t) { m_pSubframe = &m_pBuffer->AddSubframe(); }
+    void AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+    {
+      m_pSubframe->insert(m_pSubframe->end(), bricks, bricks + count);
+    }
+    void EndFrame() { m_bComplete = true; }
+
+    bool IsFrameOpen() const { return m_bFrameOpen; }
+    bool IsComplete() const { return m_bComplete; }
+
+  private:
+    Buffer* m_pBuffer;
+    BrickAccessFile::Subframe* m_pSubframe;
+    bool m_bFrameOpen;
+    bool m_bComplete;
+  };
+
+}
+
+// Line reader and parser state, owned by the prefetch thread while it runs.
+// Binary files are read frame by frame from their mapping instead.
+class BrickAccessStream::Reader {
+public:
+  enum Result {
+    R_FRAME = 0,
+    R_END,
+    R_ERROR
+  };
+
+  Reader()
+    : m_Parser(m_Header, m_Sink)
+    , m_iFrameCount(0)
+    , m_iHeaderVersion(0)
+    , m_bBinary(false)
+  {}
+
+  bool Open(std::string const& filename)
+  {
+    m_bBinary = BrickAccessBinaryFile::IsBinaryFile(filename);
+    if (m_bBinary)
+      return m_Binary.Open(filename) && m_Binary.Validate();
+    return m_Lines.Open(filename);
+  }
+
+  // Parses all lines in front of the first frame data.
+  bool ParseHeader()
+  {
+    if (m_bBinary) {
+      m_Header = m_Binary.GetHeader();
+      return true;
+    }
+    char const* begin;
+    char const* end;
+    while (m_Lines.NextLine(begin, end)) {
+      BrickAccessScan::LineKind const kind = BrickAccessScan::ClassifyLine(begin, end);
+      if (kind == BrickAccessScan::LK_BRICKS || kind == BrickAccessScan::LK_SUBFRAME ||
+          kind == BrickAccessScan::LK_FRAME) {
+        m_Lines.UnreadLine();
+        return true;
+      }
+      if (!m_Parser.ParseLine(begin, end))
+        return Fail();
+    }
+    return !m_Lines.HasFailed();
+  }
+
+  Result ReadFrame(FrameBuffer& buffer)
+  {
+    m_Sink.Start(&buffer);
+    if (m_bBinary) {
+      if (m_iFrameCount == m_Binary.GetFrameCount())
+        return R_END;
+      m_Binary.CopyFrames(m_iFrameCount, 1, m_Sink);
+      return Deliver(buffer);
+    }
+    char const* begin;
+    char const* end;
+    while (m_Lines.NextLine(begin, end)) {
+      if (!m_Parser.ParseLine(begin, end)) {
+        Fail();
+        return R_ERROR;
+      }
+      if (begin != end && *begin != '[' &&
+          BrickAccessScan::ClassifyLine(begin, end) == BrickAccessScan::LK_HEADER)
+        ++m_iHeaderVersion;
+      if (m_Sink.IsComplete())
+        return Deliver(buffer);
+    }
+    if (m_Lines.HasFailed()) {
+      std::cerr << "failed to read file after line " << m_Parser.GetLine() << std::endl;
+      return R_ERROR;
+    }
+    // the last frame does not need a frame mark, just like in Load()
+    return m_Sink.IsFrameOpen() ? Deliver(buffer) : R_END;
+  }
+
+  BrickAccessFile::Header const& GetHeader() const { return m_Header; }
+
+private:
+  Result Deliver(FrameBuffer& buffer)
+  {
+    buffer.iIndex = m_iFrameCount++;
+    if (buffer.iHeaderVersion != m_iHeaderVersion) {
+      buffer.header = m_Header;
+      buffer.iHeaderVersion = m_iHeaderVersion;
+    }
+    return R_FRAME;
+  }
+
+  bool Fail()
+  {
+    std::cerr << "failed to parse line " << m_Parser.GetErrorLine() << m_Parser.GetError() << std::endl;
+    return false;
+  }
+
+  LineReader m_Lines;
+  BrickAccessFile::Header m_Header;
+  FrameSink<FrameBuffer> m_Sink;
+  BrickAccessParser<FrameSink<FrameBuffer> > m_Parser;
+  uint64_t m_iFrameCount;
+  // number of header marks parsed after the header
+  uint64_t m_iHeaderVersion;
+  BrickAccessBinaryFile m_Binary;
+  bool m_bBinary;
+};
+
+BrickAccessStream::BrickAccessStream(std::string const& filename)
+  : m_Filename(filename)
+  , m_pCurrent(nullptr)
+  , m_bFailed(false)
+  , m_bDone(false)
+  , m_bStop(false)
+{}
+
+BrickAccessStream::~BrickAccessStream()
+{
+  Close();
+}
+
+bool BrickAccessStream::Open(size_t prefetchFrames)
+{
+  Close();
+  m_pReader.reset(new Reader());
+  if (!m_pReader->Open(m_Filename) || !m_pReader->ParseHeader()) {
+    m_pReader.reset();
+    m_bFailed = true;
+    return false;
+  }
+  m_Header = m_pReader->GetHeader();
+
+  // one buffer is held by the consumer, the others are filled ahead
+  for (size_t i=0; i<prefetchFrames+1; ++i)
+    m_Buffers.push_back(std::unique_ptr<FrameBuffer>(new FrameBuffer()));
+  if (prefetchFrames > 0) {
+    for (size_t i=0; i<m_Buffers.size(); ++i)
+      m_Free.push_back(m_Buffers[i].get());
+    m_Thread = std::thread(&BrickAccessStream::PrefetchMain, this);
+  }
+  return true;
+}
+
+void BrickAccessStream::Close()
+{
+  if (m_Thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_bStop = true;
+    }
+    m_Changed.notify_all();
+    m_Thread.join();
+  }
+  m_pReader.reset();
+  m_Buffers.clear();
+  m_Ready.clear();
+  m_Free.clear();
+  m_pCurrent = nullptr;
+  m_bFailed = false;
+  m_bDone = false;
+  m_bStop = false;
+}
+
+BrickAccessFile::Header const& BrickAccessStream::GetHeader() const
+{
+  return m_pCurrent ? m_pCurrent->header : m_Header;
+}
+
+BrickAccessFile::Frame const* BrickAccessStream::NextFrame()
+{
+  if (!m_pReader)
+    return nullptr;
+
+  if (!m_Thread.joinable()) {
+    if (m_bDone)
+      return nullptr;
+    m_pCurrent = m_Buffers[0].get();
+    Reader::Result const result = m_pReader->ReadFrame(*m_pCurrent);
+    if (result != Reader::R_FRAME) {
+      m_pCurrent = nullptr;
+      m_bDone = true;
+      m_bFailed = (result == Reader::R_ERROR);
+      return nullptr;
+    }
+    return &m_pCurrent->frame;
+  }
+
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  if (m_pCurrent != nullptr) {
+    m_Free.push_back(m_pCurrent);
+    m_pCurrent = nullptr;
+    m_Changed.notify_all();
+  }
+  while (m_Ready.empty() && !m_bDone)
+    m_Changed.wait(lock);
+  if (m_Ready.empty())
+    return nullptr;
+  m_pCurrent = m_Ready.front();
+  m_Ready.pop_front();
+  return &m_pCurrent->frame;
+}
+
+uint64_t BrickAccessStream::GetFrameIndex() const
+{
+  return m_pCurrent ? m_pCurrent->iIndex : 0;
+}
+
+bool BrickAccessStream::HasFailed() const
+{
+  if (m_Thread.joinable()) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_bFailed;
+  }
+  return m_bFailed;
+}
+
+void BrickAccessStream::PrefetchMain()
+{
+  for (;;) {
+    FrameBuffer* buffer = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      while (!m_bStop && m_Free.empty())
+        m_Changed.wait(lock);
+      if (m_bStop)
+        return;
+      buffer = m_Free.back();
+      m_Free.pop_back();
+    }
+
+    Reader::Result const result = m_pReader->ReadFrame(*buffer);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (result == Reader::R_FRAME) {
+      m_Ready.push_back(buffer);
+    } else {
+      m_Free.push_back(buffer);
+      m_bDone = true;
+      m_bFailed = (result == Reader::R_ERROR);
+    }
+    m_Changed.notify_all();
+    if (m_bDone)
+      return;
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,118 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_STREAM_H
+#define BRICK_ACCESS_STREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BrickAccessFile.h"
+
+// Reads a brick access file one frame at a time. In contrast to
+// BrickAccessFile::Load() only the current frame is kept in memory, so traces
+// of any size can be processed. Frame and subframe buffers are reused between
+// frames, which avoids allocations once the buffers have grown to the size of
+// the largest frame.
+//
+// Frames are validated exactly like BrickAccessFile::Load() does, the first
+// error stops the stream. Header marks between frames change the validation
+// of the following frames, and every frame comes with the header it was
+// validated against, see GetHeader(). Binary files, see BrickAccessBinaryFile,
+// are recognized by their magic and streamed from their mapping. Example:
+//
+//   BrickAccessStream stream(filename);
+//   if (!stream.Open()) return false;
+//   while (BrickAccessFile::Frame const* frame = stream.NextFrame()) {
+//     // process frame
+//   }
+//   if (stream.HasFailed()) return false;
+class BrickAccessStream {
+public:
+  // C'tor to instantiate a stream from a given filename.
+  explicit BrickAccessStream(std::string const& filename);
+  ~BrickAccessStream();
+
+  // Opens the file and parses the header.
+  // @param prefetchFrames is the number of frames parsed ahead on a
+  //   background thread, which lets frame processing and parsing overlap.
+  //   Zero parses every frame on the calling thread within NextFrame().
+  // @returns false if the file could not be opened or the header is broken,
+  //   see std::cerr for details.
+  bool Open(size_t prefetchFrames = 0);
+
+  // Stops reading and closes the file.
+  void Close();
+
+  // @returns the header which validated the frame returned by the last
+  //   NextFrame() call, including header marks between earlier frames. Before
+  //   the first frame, the header found in front of it.
+  BrickAccessFile::Header const& GetHeader() const;
+
+  // Parses the next frame.
+  // @returns the frame, which stays valid until the next call to NextFrame()
+  //   or Close(). Null at the end of the file or after an error, use
+  //   HasFailed() to tell both apart.
+  BrickAccessFile::Frame const* NextFrame();
+
+  // @returns the index of the frame returned by the last NextFrame() call.
+  uint64_t GetFrameIndex() const;
+
+  // @returns true if the stream stopped because of an error.
+  bool HasFailed() const;
+
+private:
+  BrickAccessStream(BrickAccessStream const&);
+  BrickAccessStream& operator=(BrickAccessStream const&);
+
+  class Reader;
+  struct FrameBuffer;
+
+  void PrefetchMain();
+
+  std::string m_Filename;
+  std::unique_ptr<Reader> m_pReader;
+  BrickAccessFile::Header m_Header;
+  std::vector<std::unique_ptr<FrameBuffer> > m_Buffers;
+  FrameBuffer* m_pCurrent;
+  bool m_bFailed;
+
+  // frame hand over between the prefetch thread and the consumer
+  std::thread m_Thread;
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_Changed;
+  std::deque<FrameBuffer*> m_Ready;
+  std::vector<FrameBuffer*> m_Free;
+  bool m_bDone;
+  bool m_bStop;
+};
+
+#endif // BRICK_ACCESS_STREAM_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
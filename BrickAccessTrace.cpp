@@ -0,0 +1,269 @@
+#include "BrickAccessTrace.h"
+
+#include "BrickAccessArena.h"
+
+namespace {
+
+  template<class T>
+  BrickAccessFile::Span<T> MakeSpan(T const* data, size_t count)
+  {
+    BrickAccessFile::Span<T> span = { data, count };
+    return span;
+  }
+
+}
+
+BrickAccessTrace::BrickAccessTrace()
+  : m_SubframeOffsets(1, 0)
+  , m_FrameOffsets(1, 0)
+  , m_pCounters(nullptr)
+{}
+
+void BrickAccessTrace::Reset(BrickLayout const& layout)
+{
+  m_Layout = layout;
+  m_Keys.clear();
+  m_SubframeOffsets.assign(1, 0);
+  m_FrameOffsets.assign(1, 0);
+}
+
+void BrickAccessTrace::Clear()
+{
+  size_t const keyCapacity = m_Keys.capacity();
+  size_t const subframeCapacity = m_SubframeOffsets.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+  m_Layout = BrickLayout();
+  std::vector<Key>().swap(m_Keys);
+  std::vector<uint64_t>(1, 0).swap(m_SubframeOffsets);
+  std::vector<uint64_t>(1, 0).swap(m_FrameOffsets);
+  CountCapacity(keyCapacity, subframeCapacity, frameCapacity);
+}
+
+void BrickAccessTrace::Reserve(uint64_t brickCount, size_t subframeCount, size_t frameCount)
+{
+  size_t const keyCapacity = m_Keys.capacity();
+  size_t const subframeCapacity = m_SubframeOffsets.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+  m_Keys.reserve(size_t(brickCount));
+  m_SubframeOffsets.reserve(subframeCount + 1);
+  m_FrameOffsets.reserve(frameCount + 1);
+  CountCapacity(keyCapacity, subframeCapacity, frameCapacity);
+}
+
+void BrickAccessTrace::ShrinkToFit()
+{
+  size_t const keyCapacity = m_Keys.capacity();
+  size_t const subframeCapacity = m_SubframeOffsets.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+  m_Keys.shrink_to_fit();
+  m_SubframeOffsets.shrink_to_fit();
+  m_FrameOffsets.shrink_to_fit();
+  CountCapacity(keyCapacity, subframeCapacity, frameCapacity);
+}
+
+void BrickAccessTrace::Assign(BrickLayout const& layout, std::vector<BrickAccessFile::Frame> const& frames)
+{
+  Reset(layout);
+  uint64_t iBrickCount = 0;
+  size_t iSubframeCount = 0;
+  for (size_t f=0; f<frames.size(); ++f) {
+    iSubframeCount += frames[f].size();
+    for (size_t s=0; s<frames[f].size(); ++s)
+      iBrickCount += frames[f][s].size();
+  }
+  Reserve(iBrickCount, iSubframeCount, frames.size());
+  for (size_t f=0; f<frames.size(); ++f) {
+    BeginFrame();
+    for (size_t s=0; s<frames[f].size(); ++s) {
+      BeginSubframe(uint32_t(frames[f][s].size()));
+      AddBricks(frames[f][s].data(), frames[f][s].size());
+    }
+    EndFrame();
+  }
+}
+
+BrickAccessTrace const& BrickAccessTrace::FromFile(BrickAccessFile const& file, BrickAccessTrace& ownTrace)
+{
+  if (file.GetStorage() == BrickAccessFile::ST_FLAT)
+    return file.GetTrace();
+  if (file.GetStorage() != BrickAccessFile::ST_ARENA) {
+    ownTrace.Assign(BrickLayout(file.GetBrickCounts()), file.GetFrames());
+    return ownTrace;
+  }
+  // copy the arena directly instead of creating the nested frames first
+  BrickAccessArena const& arena = file.GetArena();
+  ownTrace.Reset(BrickLayout(file.GetBrickCounts()));
+  ownTrace.Reserve(arena.GetTotalBrickCount(), arena.GetTotalSubframeCount(), arena.GetFrameCount());
+  for (size_t f=0; f<arena.GetFrameCount(); ++f) {
+    ownTrace.BeginFrame();
+    for (size_t s=0; s<arena.GetSubframeCount(f); ++s) {
+      BrickAccessArena::Bricks const bricks = arena.GetSubframe(f, s);
+      ownTrace.BeginSubframe(uint32_t(bricks.size()));
+      ownTrace.AddBricks(bricks.data, bricks.size());
+    }
+    ownTrace.EndFrame();
+  }
+  return ownTrace;
+}
+
+void BrickAccessTrace::Append(BrickAccessTrace const& other)
+{
+  uint64_t const keyBase = m_Keys.size();
+  uint64_t const subframeBase = m_SubframeOffsets.size() - 1;
+  size_t const keyCapacity = m_Keys.capacity();
+  size_t const subframeCapacity = m_SubframeOffsets.capacity();
+  size_t const frameCapacity = m_FrameOffsets.capacity();
+  m_Keys.insert(m_Keys.end(), other.m_Keys.begin(), other.m_Keys.end());
+  m_SubframeOffsets.reserve(m_SubframeOffsets.size() + other.m_SubframeOffsets.size() - 1);
+  for (size_t i=1; i<other.m_SubframeOffsets.size(); ++i)
+    m_SubframeOffsets.push_back(keyBase + other.m_SubframeOffsets[i]);
+  m_FrameOffsets.reserve(m_FrameOffsets.size() + other.m_FrameOffsets.size() - 1);
+  for (size_t i=1; i<other.m_FrameOffsets.size(); ++i)
+    m_FrameOffsets.push_back(subframeBase + other.m_FrameOffsets[i]);
+  CountCapacity(keyCapacity, subframeCapacity, frameCapacity);
+}
+
+void BrickAccessTrace::BeginFrame()
+{
+  // the last offset always marks the end of the table
+  size_t const capacity = m_FrameOffsets.capacity();
+  m_FrameOffsets.push_back(m_FrameOffsets.back());
+  BrickAccessStats::CountCapacity(m_pCounters, capacity, m_FrameOffsets);
+}
+
+void BrickAccessTrace::BeginSubframe(uint32_t)
+{
+  size_t const capacity = m_SubframeOffsets.capacity();
+  m_SubframeOffsets.push_back(m_SubframeOffsets.back());
+  BrickAccessStats::CountCapacity(m_pCounters, capacity, m_SubframeOffsets);
+  m_FrameOffsets.back() = m_SubframeOffsets.size() - 1;
+}
+
+void BrickAccessTrace::AddBricks(BrickAccessFile::Brick const* bricks, size_t count)
+{
+  size_t const offset = m_Keys.size();
+  size_t const capacity = m_Keys.capacity();
+  m_Keys.resize(offset + count);
+  BrickAccessStats::CountCapacity(m_pCounters, capacity, m_Keys);
+  m_Layout.GetKeys(bricks, count, m_Keys.data() + offset);
+  m_SubframeOffsets.back() += count;
+}
+
+void BrickAccessTrace::AddKeys(Key const* keys, size_t count)
+{
+  size_t const capacity = m_Keys.capacity();
+  m_Keys.insert(m_Keys.end(), keys, keys + count);
+  BrickAccessStats::CountCapacity(m_pCounters, capacity, m_Keys);
+  m_SubframeOffsets.back() += count;
+}
+
+void BrickAccessTrace::SetCounters(BrickAccessStats::Counters* pCounters)
+{
+  m_pCounters = pCounters;
+}
+
+BrickLayout const& BrickAccessTrace::GetLayout() const
+{
+  return m_Layout;
+}
+
+size_t BrickAccessTrace::GetFrameCount() const
+{
+  return m_FrameOffsets.size() - 1;
+}
+
+size_t BrickAccessTrace::GetSubframeCount(size_t frame) const
+{
+  return size_t(m_FrameOffsets[frame+1] - m_FrameOffsets[frame]);
+}
+
+size_t BrickAccessTrace::GetTotalSubframeCount() const
+{
+  return m_SubframeOffsets.size() - 1;
+}
+
+uint64_t BrickAccessTrace::GetTotalBrickCount() const
+{
+  return m_Keys.size();
+}
+
+BrickAccessTrace::Bricks BrickAccessTrace::GetSubframe(size_t frame, size_t subframe) const
+{
+  size_t const index = size_t(m_FrameOffsets[frame]) + subframe;
+  uint64_t const begin = m_SubframeOffsets[index];
+  return MakeSpan(m_Keys.data() + begin, size_t(m_SubframeOffsets[index+1] - begin));
+}
+
+BrickAccessTrace::Bricks BrickAccessTrace::GetFrame(size_t frame) const
+{
+  uint64_t const begin = m_SubframeOffsets[size_t(m_FrameOffsets[frame])];
+  uint64_t const end = m_SubframeOffsets[size_t(m_FrameOffsets[frame+1])];
+  return MakeSpan(m_Keys.data() + begin, size_t(end - begin));
+}
+
+BrickAccessTrace::Bricks BrickAccessTrace::GetKeys() const
+{
+  return MakeSpan(m_Keys.data(), m_Keys.size());
+}
+
+BrickAccessFile::Span<uint64_t> BrickAccessTrace::GetFrameOffsets() const
+{
+  return MakeSpan(m_FrameOffsets.data(), m_FrameOffsets.size());
+}
+
+BrickAccessFile::Span<uint64_t> BrickAccessTrace::GetSubframeOffsets() const
+{
+  return MakeSpan(m_SubframeOffsets.data(), m_SubframeOffsets.size());
+}
+
+void BrickAccessTrace::CountCapacity(size_t keyCapacity, size_t subframeCapacity, size_t frameCapacity) const
+{
+  BrickAccessStats::CountCapacity(m_pCounters, keyCapacity, m_Keys);
+  BrickAccessStats::CountCapacity(m_pCounters, subframeCapacity, m_SubframeOffsets);
+  BrickAccessStats::CountCapacity(m_pCounters, frameCapacity, m_FrameOffsets);
+}
+
+size_t BrickAccessTrace::GetMemoryUsage() const
+{
+  return m_Keys.capacity() * sizeof(Key) +
+    (m_SubframeOffsets.capacity() + m_FrameOffsets.capacity()) * sizeof(uint64_t);
+}
+
+void BrickAccessTrace::ToFrames(std::vector<BrickAccessFile::Frame>& frames) const
+{
+  frames.clear();
+  frames.resize(GetFrameCount());
+  for (size_t f=0; f<frames.size(); ++f) {
+    frames[f].resize(GetSubframeCount(f));
+    for (size_t s=0; s<frames[f].size(); ++s) {
+      Bricks const keys = GetSubframe(f, s);
+      BrickAccessFile::Subframe& subframe = frames[f][s];
+      subframe.resize(keys.size());
+      m_Layout.GetBricks(keys.data, keys.size(), subframe.data());
+    }
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
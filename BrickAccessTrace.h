@@ -0,0 +1,142 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_TRACE_H
+#define BRICK_ACCESS_TRACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessStats.h"
+#include "BrickLayout.h"
+
+// Flat storage of the captured brick accesses. All bricks of all frames are
+// kept as 64-bit keys (see BrickLayout) in one contiguous array. Subframes are
+// ranges of this array given by an offset table, and frames are ranges of the
+// subframe table, just like a compressed sparse row matrix. Compared to
+// nested vectors of 32 byte bricks this needs about a quarter of the memory,
+// no allocations per subframe and allows to scan a whole trace linearly.
+class BrickAccessTrace {
+public:
+  typedef BrickLayout::Key Key;
+
+  // View of the bricks of a subframe or frame.
+  typedef BrickAccessFile::Span<Key> Bricks;
+
+  // Creates an empty trace.
+  BrickAccessTrace();
+
+  // Removes all frames and sets the layout used to convert bricks to keys.
+  void Reset(BrickLayout const& layout);
+
+  // Removes all frames and releases the memory.
+  void Clear();
+
+  // Reserves memory for the given total number of bricks, subframes and
+  // frames.
+  void Reserve(uint64_t brickCount, size_t subframeCount, size_t frameCount);
+
+  // Releases memory reserved for frames which have not been added.
+  void ShrinkToFit();
+
+  // Replaces the content by nested frame vectors as returned by
+  // BrickAccessFile::GetFrames(), all bricks have to be inside of the layout.
+  void Assign(BrickLayout const& layout, std::vector<BrickAccessFile::Frame> const& frames);
+
+  // @returns the bricks of a loaded file as trace: its own with ST_FLAT
+  //   storage, otherwise ownTrace filled with the frames or the arena in the
+  //   default layout of the file. The file and ownTrace have to outlive the
+  //   result.
+  static BrickAccessTrace const& FromFile(BrickAccessFile const& file, BrickAccessTrace& ownTrace);
+
+  // Appends all frames of another trace with the same layout.
+  void Append(BrickAccessTrace const& other);
+
+  // Parser sink interface, see BrickAccessParser. Bricks have to be inside
+  // of the layout passed to Reset().
+  void BeginFrame();
+  void BeginSubframe(uint32_t expectedBricks);
+  void AddBricks(BrickAccessFile::Brick const* bricks, size_t count);
+  void EndFrame() {}
+
+  // Appends keys of the layout to the current subframe.
+  void AddKeys(Key const* keys, size_t count);
+
+  // Counts the capacity changes of all following calls into the given
+  // counters, null disables counting, see BrickAccessStats.
+  void SetCounters(BrickAccessStats::Counters* pCounters);
+
+  // @returns the layout which maps keys to bricks.
+  BrickLayout const& GetLayout() const;
+
+  // @returns the number of frames.
+  size_t GetFrameCount() const;
+
+  // @returns the number of subframes of a frame.
+  size_t GetSubframeCount(size_t frame) const;
+
+  // @returns the number of subframes of all frames.
+  size_t GetTotalSubframeCount() const;
+
+  // @returns the number of bricks of all frames.
+  uint64_t GetTotalBrickCount() const;
+
+  // @returns the bricks of a subframe.
+  Bricks GetSubframe(size_t frame, size_t subframe) const;
+
+  // @returns the bricks of all subframes of a frame.
+  Bricks GetFrame(size_t frame) const;
+
+  // @returns the bricks of all frames.
+  Bricks GetKeys() const;
+
+  // @returns the index of the first subframe of every frame, followed by
+  //   the total number of subframes.
+  BrickAccessFile::Span<uint64_t> GetFrameOffsets() const;
+
+  // @returns the index of the first brick of every subframe, followed by the
+  //   total number of bricks.
+  BrickAccessFile::Span<uint64_t> GetSubframeOffsets() const;
+
+  // @returns the number of bytes used by the key and offset arrays.
+  size_t GetMemoryUsage() const;
+
+  // Converts the trace to nested frame vectors as used by
+  // BrickAccessFile::GetFrames().
+  void ToFrames(std::vector<BrickAccessFile::Frame>& frames) const;
+
+private:
+  void CountCapacity(size_t keyCapacity, size_t subframeCapacity, size_t frameCapacity) const;
+
+  BrickLayout m_Layout;
+  std::vector<Key> m_Keys;
+  std::vector<uint64_t> m_SubframeOffsets;
+  std::vector<uint64_t> m_FrameOffsets;
+  BrickAccessStats::Counters* m_pCounters;
+};
+
+#endif // BRICK_ACCESS_TRACE_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,337 @@
+#include "BrickAccessTransform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "BrickAccessStream.h"
+#include "BrickAccessWriter.h"
+#include "BrickHash.h"
+
+namespace {
+
+  using BrickHash::Mix;
+
+  uint32_t const EmptySlot = 0xFFFFFFFFu;
+
+  BrickAccessTransform::Stage MakeStage(BrickAccessTransform::StageType type)
+  {
+    BrickAccessTransform::Stage stage;
+    stage.type = type;
+    stage.first = 0;
+    stage.count = 0;
+    stage.step = 0;
+    stage.minLoD = 0;
+    stage.maxLoD = 0;
+    return stage;
+  }
+
+  uint64_t Hash(BrickAccessFile::Brick const& brick)
+  {
+    return Mix(Mix(Mix(brick.x ^ (brick.w << 58)) ^ brick.y) ^ brick.z);
+  }
+
+  bool Equals(BrickAccessFile::Brick const& a, BrickAccessFile::Brick const& b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+  }
+
+  uint64_t GetBrickCount(BrickAccessFile::Frame const& frame)
+  {
+    uint64_t count = 0;
+    for (size_t s=0; s<frame.size(); ++s)
+      count += frame[s].size();
+    return count;
+  }
+
+}
+
+BrickAccessTransform::Stage BrickAccessTransform::Slice(uint64_t first, uint64_t count)
+{
+  Stage stage = MakeStage(TS_SLICE);
+  stage.first = first;
+  stage.count = count;
+  return stage;
+}
+
+BrickAccessTransform::Stage BrickAccessTransform::Subsample(uint64_t step)
+{
+  Stage stage = MakeStage(TS_SUBSAMPLE);
+  stage.step = step;
+  return stage;
+}
+
+BrickAccessTransform::Stage BrickAccessTransform::FilterLoDs(uint32_t minLoD, uint32_t maxLoD)
+{
+  Stage stage = MakeStage(TS_LOD_FILTER);
+  stage.minLoD = minLoD;
+  stage.maxLoD = maxLoD;
+  return stage;
+}
+
+BrickAccessTransform::Stage BrickAccessTransform::CoarsenLoDs(uint32_t minLoD)
+{
+  Stage stage = MakeStage(TS_LOD_COARSEN);
+  stage.minLoD = minLoD;
+  return stage;
+}
+
+BrickAccessTransform::Stage BrickAccessTransform::MergeSubframes(uint64_t step)
+{
+  Stage stage = MakeStage(TS_MERGE_SUBFRAMES);
+  stage.step = step;
+  return stage;
+}
+
+BrickAccessTransform::Stage BrickAccessTransform::Deduplicate()
+{
+  return MakeStage(TS_DEDUPLICATE);
+}
+
+BrickAccessTransform::BrickAccessTransform()
+  : m_bDone(false)
+{}
+
+void BrickAccessTransform::AddStage(Stage const& stage)
+{
+  m_Stages.push_back(stage);
+}
+
+std::vector<BrickAccessTransform::Stage> const& BrickAccessTransform::GetStages() const
+{
+  return m_Stages;
+}
+
+bool BrickAccessTransform::Begin(BrickAccessFile::Header const& header)
+{
+  for (size_t i=0; i<m_Stages.size(); ++i) {
+    Stage const& stage = m_Stages[i];
+    if (stage.type == TS_SUBSAMPLE && stage.step == 0) {
+      std::cerr << "failed to transform: the subsampling step has to be positive" << std::endl;
+      return false;
+    }
+  }
+  if (!SetHeader(header))
+    return false;
+  m_FrameCounters.assign(m_Stages.size(), 0);
+  m_bDone = false;
+  return true;
+}
+
+bool BrickAccessTransform::SetHeader(BrickAccessFile::Header const& header)
+{
+  for (size_t i=0; i<m_Stages.size(); ++i) {
+    Stage const& stage = m_Stages[i];
+    if (stage.type == TS_LOD_COARSEN && stage.minLoD >= header.brickCounts.size()) {
+      std::cerr << "failed to transform: LoD " << stage.minLoD << " exceeds the "
+        << header.brickCounts.size() << " levels of detail" << std::endl;
+      return false;
+    }
+  }
+  m_BrickCounts = header.brickCounts;
+  return true;
+}
+
+bool BrickAccessTransform::Apply(BrickAccessFile::Frame& frame)
+{
+  for (size_t i=0; i<m_Stages.size(); ++i) {
+    Stage const& stage = m_Stages[i];
+    uint64_t const index = m_FrameCounters[i]++;
+    switch (stage.type) {
+    case TS_SLICE :
+      if (index + 1 >= stage.first + stage.count)
+        m_bDone = true;
+      if (index < stage.first || index - stage.first >= stage.count)
+        return false;
+      break;
+    case TS_SUBSAMPLE :
+      if (index % stage.step != 0)
+        return false;
+      break;
+    case TS_LOD_FILTER :
+      for (size_t s=0; s<frame.size(); ++s) {
+        BrickAccessFile::Subframe& subframe = frame[s];
+        subframe.erase(std::remove_if(subframe.begin(), subframe.end(),
+          [&stage](BrickAccessFile::Brick const& brick) {
+            return brick.w < stage.minLoD || brick.w > stage.maxLoD;
+          }), subframe.end());
+      }
+      break;
+    case TS_LOD_COARSEN :
+      ApplyCoarsen(stage, frame);
+      break;
+    case TS_MERGE_SUBFRAMES :
+      ApplyMerge(stage, frame);
+      break;
+    case TS_DEDUPLICATE :
+      for (size_t s=0; s<frame.size(); ++s)
+        ApplyDeduplicate(frame[s]);
+      break;
+    }
+  }
+  return true;
+}
+
+bool BrickAccessTransform::IsDone() const
+{
+  return m_bDone;
+}
+
+bool BrickAccessTransform::Run(std::string const& input, std::string const& output, Result& result,
+  size_t prefetchFrames)
+{
+  std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+  result.inputFrames = 0;
+  result.inputBricks = 0;
+  result.outputFrames = 0;
+  result.outputBricks = 0;
+  result.outputBytes = 0;
+  result.seconds = 0.0;
+
+  BrickAccessStream stream(input);
+  if (!stream.Open(prefetchFrames))
+    return false;
+  if (!Begin(stream.GetHeader()))
+    return false;
+  BrickAccessWriter writer;
+  if (!writer.Open(output, stream.GetHeader()))
+    return false;
+
+  // header marks are detected by their lines, the header of the output only
+  // changes in front of the next frame that is written
+  std::string inputHeader, currentHeader, writtenHeader;
+  BrickAccessWriter::FormatHeader(stream.GetHeader(), writtenHeader);
+  currentHeader = writtenHeader;
+
+  // the frame buffers keep their capacity, so a trace takes about as much
+  // memory as its largest frame
+  BrickAccessFile::Frame frame;
+  bool bSuccess = true;
+  while (!m_bDone) {
+    BrickAccessFile::Frame const* pInput = stream.NextFrame();
+    if (pInput == nullptr)
+      break;
+    inputHeader.clear();
+    BrickAccessWriter::FormatHeader(stream.GetHeader(), inputHeader);
+    if (inputHeader != currentHeader) {
+      if (!SetHeader(stream.GetHeader())) {
+        bSuccess = false;
+        break;
+      }
+      currentHeader.swap(inputHeader);
+    }
+    ++result.inputFrames;
+    frame.resize(pInput->size());
+    for (size_t s=0; s<frame.size(); ++s)
+      frame[s].assign((*pInput)[s].begin(), (*pInput)[s].end());
+    result.inputBricks += GetBrickCount(frame);
+    if (!Apply(frame))
+      continue;
+    result.outputBricks += GetBrickCount(frame);
+    if (currentHeader != writtenHeader) {
+      if (!writer.WriteHeader(stream.GetHeader()))
+        break;
+      writtenHeader = currentHeader;
+    }
+    if (!writer.WriteFrame(frame))
+      break;
+  }
+
+  bSuccess = !stream.HasFailed() && bSuccess;
+  stream.Close();
+  bSuccess = writer.Close() && bSuccess;
+  result.outputFrames = writer.GetFrameCount();
+  result.outputBytes = writer.GetByteCount();
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return bSuccess;
+}
+
+void BrickAccessTransform::ApplyCoarsen(Stage const& stage, BrickAccessFile::Frame& frame) const
+{
+  uint32_t const lod = stage.minLoD;
+  BrickAccessFile::Vec3<uint64_t> const& counts = m_BrickCounts[lod];
+  for (size_t s=0; s<frame.size(); ++s) {
+    BrickAccessFile::Subframe& subframe = frame[s];
+    for (size_t i=0; i<subframe.size(); ++i) {
+      BrickAccessFile::Brick& brick = subframe[i];
+      if (brick.w >= lod)
+        continue;
+      // a brick covers 2^3 bricks of the next finer LoD, the last ancestor
+      // is clamped for domains which are not a power of two
+      uint64_t const shift = lod - brick.w;
+      brick.x = std::min<uint64_t>(brick.x >> shift, counts.x - 1);
+      brick.y = std::min<uint64_t>(brick.y >> shift, counts.y - 1);
+      brick.z = std::min<uint64_t>(brick.z >> shift, counts.z - 1);
+      brick.w = lod;
+    }
+  }
+}
+
+void BrickAccessTransform::ApplyMerge(Stage const& stage, BrickAccessFile::Frame& frame) const
+{
+  size_t const step = stage.step == 0 ? frame.size() : size_t(stage.step);
+  if (step <= 1 || frame.empty())
+    return;
+  size_t const groupCount = (frame.size() + step - 1) / step;
+  for (size_t g=0; g<groupCount; ++g) {
+    // the subframes in front of group g have been merged already, so the
+    // group is gathered in frame[g]
+    BrickAccessFile::Subframe& target = frame[g];
+    if (g != 0)
+      target.swap(frame[g * step]);
+    size_t const end = std::min(frame.size(), (g + 1) * step);
+    for (size_t s=g*step+1; s<end; ++s)
+      target.insert(target.end(), frame[s].begin(), frame[s].end());
+  }
+  frame.resize(groupCount);
+}
+
+void BrickAccessTransform::ApplyDeduplicate(BrickAccessFile::Subframe& subframe)
+{
+  // open addressing with linear probing over the kept bricks, the table is
+  // at most half full
+  size_t size = 16;
+  while (size < 2 * subframe.size())
+    size *= 2;
+  m_Slots.assign(size, EmptySlot);
+  size_t const mask = size - 1;
+  size_t count = 0;
+  for (size_t i=0; i<subframe.size(); ++i) {
+    BrickAccessFile::Brick const brick = subframe[i];
+    for (size_t h=size_t(Hash(brick)) & mask;; h=(h + 1) & mask) {
+      uint32_t const slot = m_Slots[h];
+      if (slot == EmptySlot) {
+        m_Slots[h] = uint32_t(count);
+        subframe[count++] = brick;
+        break;
+      }
+      if (Equals(subframe[slot], brick))
+        break;
+    }
+  }
+  subframe.resize(count);
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,142 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_TRANSFORM_H
+#define BRICK_ACCESS_TRANSFORM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+
+// Rewrites a brick access file frame by frame through a pipeline of stages,
+// e.g. to cut a frame range out of a long capture or to see how a trace
+// changes without the finest levels of detail.
+//
+// The input is read with BrickAccessStream and the output is written with
+// BrickAccessWriter, so only the current frame and a few buffers are kept in
+// memory regardless of the size of the trace. Stages run in the order they
+// were added. Frame selecting stages count the frames which reach them, so a
+// slice behind a subsampling stage selects from the subsampled frames. The
+// header is copied unchanged, header marks between frames are copied in front
+// of the next written frame, and output frames are renumbered from zero.
+//
+// Stages:
+//  - TS_SLICE: keeps `count` frames starting at frame `first`, reading stops
+//    after the last one.
+//  - TS_SUBSAMPLE: keeps every `step`-th frame, starting with the first.
+//  - TS_LOD_FILTER: drops all bricks outside of the LoDs [minLoD, maxLoD].
+//  - TS_LOD_COARSEN: replaces all bricks finer than `minLoD` with their
+//    ancestors at that LoD, as if the renderer never loaded finer bricks.
+//  - TS_MERGE_SUBFRAMES: joins every `step` consecutive subframes of a frame
+//    into one, zero joins all subframes of a frame.
+//  - TS_DEDUPLICATE: drops repeated bricks within a subframe, the first
+//    request of every brick keeps its position.
+class BrickAccessTransform {
+public:
+  enum StageType {
+    TS_SLICE = 0,
+    TS_SUBSAMPLE,
+    TS_LOD_FILTER,
+    TS_LOD_COARSEN,
+    TS_MERGE_SUBFRAMES,
+    TS_DEDUPLICATE
+  };
+
+  // A stage and its parameters, see the factory functions below.
+  struct Stage {
+    StageType type;
+    uint64_t first;
+    uint64_t count;
+    uint64_t step;
+    uint32_t minLoD;
+    uint32_t maxLoD;
+  };
+
+  static Stage Slice(uint64_t first, uint64_t count);
+  static Stage Subsample(uint64_t step);
+  static Stage FilterLoDs(uint32_t minLoD, uint32_t maxLoD);
+  static Stage CoarsenLoDs(uint32_t minLoD);
+  static Stage MergeSubframes(uint64_t step);
+  static Stage Deduplicate();
+
+  // Counters of a Run().
+  struct Result {
+    uint64_t inputFrames;
+    uint64_t inputBricks;
+    uint64_t outputFrames;
+    uint64_t outputBricks;
+    uint64_t outputBytes;
+    double seconds;
+  };
+
+  // Creates an empty pipeline, which copies all frames.
+  BrickAccessTransform();
+
+  // Appends a stage to the pipeline.
+  void AddStage(Stage const& stage);
+
+  // @returns all stages in their order.
+  std::vector<Stage> const& GetStages() const;
+
+  // Starts a new trace with the given header and resets all frame counters.
+  // @returns false if a stage does not fit the header, see std::cerr.
+  bool Begin(BrickAccessFile::Header const& header);
+
+  // Switches to a header found between frames, the frame counters continue.
+  // @returns false if a stage does not fit the header, see std::cerr.
+  bool SetHeader(BrickAccessFile::Header const& header);
+
+  // Runs all stages on a frame.
+  // @returns false if a stage dropped the frame.
+  bool Apply(BrickAccessFile::Frame& frame);
+
+  // @returns true if a stage drops all following frames.
+  bool IsDone() const;
+
+  // Transforms a whole file.
+  // @param prefetchFrames is the number of frames parsed ahead on a
+  //   background thread, see BrickAccessStream::Open().
+  // @returns false if reading, a stage or writing failed, see std::cerr.
+  bool Run(std::string const& input, std::string const& output, Result& result,
+    size_t prefetchFrames = 4);
+
+private:
+  void ApplyCoarsen(Stage const& stage, BrickAccessFile::Frame& frame) const;
+  void ApplyMerge(Stage const& stage, BrickAccessFile::Frame& frame) const;
+  void ApplyDeduplicate(BrickAccessFile::Subframe& subframe);
+
+  std::vector<Stage> m_Stages;
+  // frames which reached every stage
+  std::vector<uint64_t> m_FrameCounters;
+  std::vector<BrickAccessFile::Vec3<uint64_t> > m_BrickCounts;
+  // hash table of brick positions reused by TS_DEDUPLICATE
+  std::vector<uint32_t> m_Slots;
+  bool m_bDone;
+};
+
+#endif // BRICK_ACCESS_TRANSFORM_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,242 @@
+#include "BrickAccessWriter.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+  // Size at which the buffer is written to the file.
+  size_t const BufferBytes = 4 * 1024 * 1024;
+
+  char const DigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+  // Writes the decimal digits of a value in front of end, two at a time.
+  // @returns the first digit.
+  char* FormatUInt(uint64_t value, char* end)
+  {
+    while (value >= 100) {
+      uint64_t const pair = value % 100;
+      value /= 100;
+      end -= 2;
+      memcpy(end, DigitPairs + 2 * pair, 2);
+    }
+    if (value >= 10) {
+      end -= 2;
+      memcpy(end, DigitPairs + 2 * value, 2);
+    } else {
+      *--end = char('0' + value);
+    }
+    return end;
+  }
+
+  void AppendUInt(uint64_t value, std::string& text)
+  {
+    char digits[20];
+    char* const end = digits + sizeof(digits);
+    text.append(FormatUInt(value, end), end);
+  }
+
+  void AppendVec3(char const* name, BrickAccessFile::Vec3<uint64_t> const& v, std::string& text)
+  {
+    text += name;
+    AppendUInt(v.x, text);
+    text.push_back(' ');
+    AppendUInt(v.y, text);
+    text.push_back(' ');
+    AppendUInt(v.z, text);
+  }
+
+  void AppendBricks(BrickAccessFile::Subframe const& bricks, std::string& text)
+  {
+    // every brick is formatted backwards into a small buffer and appended
+    // at once, four numbers of up to 20 digits and five separators
+    char buffer[85];
+    char* const end = buffer + sizeof(buffer);
+    for (size_t i=0; i<bricks.size(); ++i) {
+      BrickAccessFile::Brick const& brick = bricks[i];
+      char* p = end;
+      *--p = ']';
+      p = FormatUInt(brick.w, p);
+      *--p = ' ';
+      p = FormatUInt(brick.z, p);
+      *--p = ' ';
+      p = FormatUInt(brick.y, p);
+      *--p = ' ';
+      p = FormatUInt(brick.x, p);
+      *--p = '[';
+      text.append(p, end);
+    }
+  }
+
+}
+
+BrickAccessWriter::BrickAccessWriter()
+  : m_iFrameCount(0)
+  , m_iByteCount(0)
+  , m_bFailed(false)
+{}
+
+BrickAccessWriter::~BrickAccessWriter()
+{
+  if (m_File.is_open())
+    Close();
+}
+
+bool BrickAccessWriter::Open(std::string const& filename, BrickAccessFile::Header const& header)
+{
+  if (m_File.is_open())
+    Close();
+  m_Filename = filename;
+  m_File.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_File.is_open()) {
+    std::cerr << "failed to create file " << filename << std::endl;
+    return false;
+  }
+  m_Buffer.clear();
+  m_Buffer.reserve(BufferBytes + BufferBytes / 4);
+  m_iFrameCount = 0;
+  m_iByteCount = 0;
+  m_bFailed = false;
+  FormatHeader(header, m_Buffer);
+  return true;
+}
+
+bool BrickAccessWriter::WriteFrame(BrickAccessFile::Frame const& frame)
+{
+  FormatFrame(m_iFrameCount++, frame, m_Buffer);
+  if (m_Buffer.size() >= BufferBytes)
+    return Flush();
+  return !m_bFailed;
+}
+
+bool BrickAccessWriter::WriteHeader(BrickAccessFile::Header const& header)
+{
+  FormatHeader(header, m_Buffer);
+  if (m_Buffer.size() >= BufferBytes)
+    return Flush();
+  return !m_bFailed;
+}
+
+bool BrickAccessWriter::Close()
+{
+  if (!m_File.is_open())
+    return false;
+  Flush();
+  m_File.close();
+  std::string().swap(m_Buffer);
+  if (m_bFailed || m_File.fail()) {
+    std::cerr << "failed to write file " << m_Filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+uint64_t BrickAccessWriter::GetFrameCount() const
+{
+  return m_iFrameCount;
+}
+
+uint64_t BrickAccessWriter::GetByteCount() const
+{
+  return m_iByteCount + m_Buffer.size();
+}
+
+bool BrickAccessWriter::Write(BrickAccessFile const& source, std::string const& filename)
+{
+  BrickAccessWriter writer;
+  if (!writer.Open(filename, source.GetHeader()))
+    return false;
+  std::vector<BrickAccessFile::Frame> const& frames = source.GetFrames();
+  for (size_t f=0; f<frames.size(); ++f)
+    writer.WriteFrame(frames[f]);
+  return writer.Close();
+}
+
+void BrickAccessWriter::FormatHeader(BrickAccessFile::Header const& header, std::string& text)
+{
+  BrickAccessFile::Vec3<uint64_t> v;
+  v.x = header.maxBrickSize.x; v.y = header.maxBrickSize.y; v.z = header.maxBrickSize.z;
+  AppendVec3("MaxBrickSize=", v, text);
+  v.x = header.brickOverlap.x; v.y = header.brickOverlap.y; v.z = header.brickOverlap.z;
+  AppendVec3("\nBrickOverlap=", v, text);
+  text += "\nLoDCount=";
+  AppendUInt(header.brickCounts.size(), text);
+  for (size_t lod=0; lod<header.brickCounts.size(); ++lod) {
+    text += "\nLoD=";
+    AppendUInt(lod, text);
+    AppendVec3(" DomainSize=", header.domainSizes[lod], text);
+    AppendVec3(" BrickCount=", header.brickCounts[lod], text);
+  }
+  text.push_back('\n');
+}
+
+void BrickAccessWriter::FormatFrame(uint64_t frame, BrickAccessFile::Frame const& bricks, std::string& text)
+{
+  uint64_t iBrickCount = 0;
+  for (size_t s=0; s<bricks.size(); ++s) {
+    BrickAccessFile::Subframe const& subframe = bricks[s];
+    text += "Subframe=";
+    AppendUInt(s, text);
+    text += " BrickCount=";
+    AppendUInt(subframe.size(), text);
+    text.push_back('\n');
+    // empty subframes still need a brick line to advance the subframe counter
+    if (subframe.empty())
+      text += "[]";
+    AppendBricks(subframe, text);
+    text.push_back('\n');
+    iBrickCount += subframe.size();
+  }
+  text += "Frame=";
+  AppendUInt(frame, text);
+  text += " SubframeCount=";
+  AppendUInt(bricks.size(), text);
+  text += " BrickCount=";
+  AppendUInt(iBrickCount, text);
+  text.push_back('\n');
+}
+
+bool BrickAccessWriter::Flush()
+{
+  if (!m_Buffer.empty() && !m_bFailed) {
+    m_File.write(m_Buffer.data(), std::streamsize(m_Buffer.size()));
+    m_bFailed = m_File.fail();
+  }
+  m_iByteCount += m_Buffer.size();
+  m_Buffer.clear();
+  return !m_bFailed;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef BRICK_ACCESS_WRITER_H
+#define BRICK_ACCESS_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "BrickAccessFile.h"
+
+// Writes ASCII brick access files (extension: *.ba) in the format read by
+// BrickAccessFile::Load().
+//
+// Frames are formatted into a buffer of a few MiB with a table based integer
+// conversion and written in large blocks, only the current buffer is kept in
+// memory. Frame marks are numbered in the order the frames are written.
+class BrickAccessWriter {
+public:
+  BrickAccessWriter();
+  ~BrickAccessWriter();
+
+  // Creates the output file and writes the header lines.
+  // @returns false if the file could not be created.
+  bool Open(std::string const& filename, BrickAccessFile::Header const& header);
+
+  // Appends a frame.
+  // @returns false if writing failed, see std::cerr for details.
+  bool WriteFrame(BrickAccessFile::Frame const& frame);
+
+  // Appends header lines between frames, which replace the header for all
+  // following frames like the header marks read by BrickAccessStream.
+  // @returns false if writing failed, see std::cerr for details.
+  bool WriteHeader(BrickAccessFile::Header const& header);
+
+  // Writes the buffered frames and closes the file.
+  // @returns false if writing failed, see std::cerr for details.
+  bool Close();
+
+  // @returns the number of frames written since Open().
+  uint64_t GetFrameCount() const;
+
+  // @returns the number of bytes written since Open(), including the
+  //   buffered ones.
+  uint64_t GetByteCount() const;
+
+  // Writes all frames of a loaded brick access file.
+  // @returns false if writing failed, see std::cerr for details.
+  static bool Write(BrickAccessFile const& source, std::string const& filename);
+
+  // Appends the header lines to a string.
+  static void FormatHeader(BrickAccessFile::Header const& header, std::string& text);
+
+  // Appends the lines of a frame, including its frame mark, to a string.
+  static void FormatFrame(uint64_t frame, BrickAccessFile::Frame const& bricks, std::string& text);
+
+private:
+  BrickAccessWriter(BrickAccessWriter const&);
+  BrickAccessWriter& operator=(BrickAccessWriter const&);
+
+  bool Flush();
+
+  std::string m_Filename;
+  std::ofstream m_File;
+  std::string m_Buffer;
+  uint64_t m_iFrameCount;
+  uint64_t m_iByteCount;
+  bool m_bFailed;
+};
+
+#endif // BRICK_ACCESS_WRITER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,167 @@
+#pragma once
+
+#ifndef BRICK_CACHE_H
+#define BRICK_CACHE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Building blocks of the brick caches replayed by BrickCacheSimulator and
+// BrickPrefetchEvaluator. Caches are indexed by the keys of a BrickLayout and
+// hold at most 2^32 - 1 bricks.
+namespace BrickCache {
+
+  typedef uint64_t Key;
+
+  uint32_t const None = std::numeric_limits<uint32_t>::max();
+
+  // Doubly linked lists over a fixed pool of nodes which store one brick key
+  // each. Several lists can share the pool, every node is in at most one.
+  class NodeLists {
+  public:
+    struct List {
+      uint32_t head; // most recently inserted
+      uint32_t tail;
+      size_t size;
+    };
+
+    explicit NodeLists(size_t nodeCount)
+      : m_Keys(nodeCount)
+      , m_Prev(nodeCount)
+      , m_Next(nodeCount)
+      , m_iUsed(0)
+    {}
+
+    static List MakeList()
+    {
+      List list = { None, None, 0 };
+      return list;
+    }
+
+    // @returns an unused node.
+    uint32_t Allocate()
+    {
+      if (!m_Free.empty()) {
+        uint32_t const node = m_Free.back();
+        m_Free.pop_back();
+        return node;
+      }
+      return uint32_t(m_iUsed++);
+    }
+
+    void Release(uint32_t node) { m_Free.push_back(node); }
+
+    Key& GetKey(uint32_t node) { return m_Keys[node]; }
+
+    void PushFront(List& list, uint32_t node)
+    {
+      m_Prev[node] = None;
+      m_Next[node] = list.head;
+      if (list.head != None)
+        m_Prev[list.head] = node;
+      else
+        list.tail = node;
+      list.head = node;
+      ++list.size;
+    }
+
+    void Remove(List& list, uint32_t node)
+    {
+      if (m_Prev[node] != None)
+        m_Next[m_Prev[node]] = m_Next[node];
+      else
+        list.head = m_Next[node];
+      if (m_Next[node] != None)
+        m_Prev[m_Next[node]] = m_Prev[node];
+      else
+        list.tail = m_Prev[node];
+      --list.size;
+    }
+
+  private:
+    std::vector<Key> m_Keys;
+    std::vector<uint32_t> m_Prev;
+    std::vector<uint32_t> m_Next;
+    std::vector<uint32_t> m_Free;
+    size_t m_iUsed;
+  };
+
+  // Least recently used replacement, the most recently used brick is at the
+  // head of the list.
+  class LRUCache {
+  public:
+    LRUCache(uint64_t keyCount, size_t capacity)
+      : m_Nodes(size_t(keyCount), None)
+      , m_Lists(capacity)
+      , m_List(NodeLists::MakeList())
+      , m_iCapacity(capacity)
+    {}
+
+    bool Contains(Key key) const
+    {
+      return m_Nodes[size_t(key)] != None;
+    }
+
+    // Makes a brick the most recently used one, loads it on a miss. The
+    // position in the trace is unused, other policies need it.
+    // @returns true on a hit.
+    bool Access(Key key, uint64_t = 0)
+    {
+      uint32_t node = m_Nodes[size_t(key)];
+      if (node != None) {
+        if (node != m_List.head) {
+          m_Lists.Remove(m_List, node);
+          m_Lists.PushFront(m_List, node);
+        }
+        return true;
+      }
+      if (m_iCapacity == 0)
+        return false;
+      if (m_List.size < m_iCapacity) {
+        node = m_Lists.Allocate();
+      } else {
+        node = m_List.tail;
+        m_Lists.Remove(m_List, node);
+        m_Nodes[size_t(m_Lists.GetKey(node))] = None;
+      }
+      m_Lists.GetKey(node) = key;
+      m_Lists.PushFront(m_List, node);
+      m_Nodes[size_t(key)] = node;
+      return false;
+    }
+
+  private:
+    std::vector<uint32_t> m_Nodes;
+    NodeLists m_Lists;
+    NodeLists::List m_List;
+    size_t m_iCapacity;
+  };
+
+} // namespace BrickCache
+
+#endif // BRICK_CACHE_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
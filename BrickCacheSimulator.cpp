@@ -0,0 +1,549 @@
+#include "BrickCacheSimulator.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "BrickCache.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  typedef BrickAccessTrace::Key Key;
+  using BrickCache::LRUCache;
+  using BrickCache::NodeLists;
+  using BrickCache::None;
+
+  uint64_t const Never = std::numeric_limits<uint64_t>::max();
+
+  class CLOCKCache {
+  public:
+    CLOCKCache(uint64_t keyCount, size_t capacity)
+      : m_Slots(keyCount, None)
+      , m_Keys(capacity)
+      , m_Referenced(capacity, 0)
+      , m_iSize(0)
+      , m_iHand(0)
+    {}
+
+    bool Access(Key key, uint64_t)
+    {
+      uint32_t slot = m_Slots[key];
+      if (slot != None) {
+        m_Referenced[slot] = 1;
+        return true;
+      }
+      if (m_iSize < m_Keys.size()) {
+        slot = uint32_t(m_iSize++);
+      } else {
+        // give referenced bricks a second chance
+        while (m_Referenced[m_iHand]) {
+          m_Referenced[m_iHand] = 0;
+          m_iHand = (m_iHand + 1) % m_Keys.size();
+        }
+        slot = uint32_t(m_iHand);
+        m_iHand = (m_iHand + 1) % m_Keys.size();
+        m_Slots[m_Keys[slot]] = None;
+      }
+      m_Keys[slot] = key;
+      m_Referenced[slot] = 1;
+      m_Slots[key] = slot;
+      return false;
+    }
+
+  private:
+    std::vector<uint32_t> m_Slots;
+    std::vector<Key> m_Keys;
+    std::vector<uint8_t> m_Referenced;
+    size_t m_iSize;
+    size_t m_iHand;
+  };
+
+  // Priority queue of cache slots with lazy deletion. Outdated entries stay in
+  // the heap until they reach the top, the owner tells them apart by their
+  // priority. The heap is rebuilt from the slots once outdated entries
+  // dominate, which bounds its size by a multiple of the capacity.
+  template<class Priority, class Compare>
+  class SlotHeap {
+  public:
+    struct Entry {
+      Priority priority;
+      uint32_t slot;
+    };
+
+    explicit SlotHeap(size_t capacity)
+    {
+      m_Entries.reserve(2 * capacity + 16);
+    }
+
+    void Push(Priority const& priority, uint32_t slot)
+    {
+      Entry const entry = { priority, slot };
+      m_Entries.push_back(entry);
+      std::push_heap(m_Entries.begin(), m_Entries.end(), Less());
+    }
+
+    Entry Pop()
+    {
+      std::pop_heap(m_Entries.begin(), m_Entries.end(), Less());
+      Entry const entry = m_Entries.back();
+      m_Entries.pop_back();
+      return entry;
+    }
+
+    // @returns true if the heap should be rebuilt for the given number of
+    //   valid entries.
+    bool IsBloated(size_t validCount) const
+    {
+      return m_Entries.size() > 2 * validCount + 16;
+    }
+
+    // Replaces all entries by the given valid ones.
+    void Rebuild(std::vector<Entry>& entries)
+    {
+      m_Entries.swap(entries);
+      std::make_heap(m_Entries.begin(), m_Entries.end(), Less());
+    }
+
+  private:
+    struct Less {
+      bool operator()(Entry const& a, Entry const& b) const
+      {
+        return Compare()(a.priority, b.priority);
+      }
+    };
+
+    std::vector<Entry> m_Entries;
+  };
+
+  class LFUCache {
+  public:
+    LFUCache(uint64_t keyCount, size_t capacity)
+      : m_Slots(keyCount, None)
+      , m_Keys(capacity)
+      , m_Priorities(capacity)
+      , m_Heap(capacity)
+      , m_iSize(0)
+    {}
+
+    bool Access(Key key, uint64_t position)
+    {
+      uint32_t slot = m_Slots[key];
+      if (slot != None) {
+        Priority& priority = m_Priorities[slot];
+        ++priority.first;
+        priority.second = position;
+        Push(slot);
+        return true;
+      }
+      if (m_iSize < m_Keys.size()) {
+        slot = uint32_t(m_iSize++);
+      } else {
+        for (;;) {
+          Heap::Entry const entry = m_Heap.Pop();
+          if (entry.priority == m_Priorities[entry.slot]) {
+            slot = entry.slot;
+            break;
+          }
+        }
+        m_Slots[m_Keys[slot]] = None;
+      }
+      m_Keys[slot] = key;
+      m_Priorities[slot] = Priority(1, position);
+      m_Slots[key] = slot;
+      Push(slot);
+      return false;
+    }
+
+  private:
+    // request count and last request, both unique per slot together
+    typedef std::pair<uint64_t, uint64_t> Priority;
+    typedef SlotHeap<Priority, std::greater<Priority> > Heap;
+
+    void Push(uint32_t slot)
+    {
+      m_Heap.Push(m_Priorities[slot], slot);
+      if (m_Heap.IsBloated(m_iSize)) {
+        std::vector<Heap::Entry> entries(m_iSize);
+        for (size_t i=0; i<m_iSize; ++i) {
+          entries[i].priority = m_Priorities[i];
+          entries[i].slot = uint32_t(i);
+        }
+        m_Heap.Rebuild(entries);
+      }
+    }
+
+    std::vector<uint32_t> m_Slots;
+    std::vector<Key> m_Keys;
+    std::vector<Priority> m_Priorities;
+    Heap m_Heap;
+    size_t m_iSize;
+  };
+
+  class OPTCache {
+  public:
+    OPTCache(uint64_t keyCount, size_t capacity, std::vector<uint64_t> const& nextUse)
+      : m_NextUse(nextUse)
+      , m_Slots(keyCount, None)
+      , m_Keys(capacity)
+      , m_NextRequests(capacity)
+      , m_Heap(capacity)
+      , m_iSize(0)
+    {}
+
+    bool Access(Key key, uint64_t position)
+    {
+      uint64_t const nextRequest = m_NextUse[size_t(position)];
+      uint32_t slot = m_Slots[key];
+      if (slot != None) {
+        m_NextRequests[slot] = nextRequest;
+        Push(slot);
+        return true;
+      }
+      if (m_iSize < m_Keys.size()) {
+        slot = uint32_t(m_iSize++);
+      } else {
+        // next requests are unique positions, only bricks which are never
+        // requested again share one, but any of them is a valid victim
+        for (;;) {
+          Heap::Entry const entry = m_Heap.Pop();
+          if (entry.priority == m_NextRequests[entry.slot]) {
+            slot = entry.slot;
+            break;
+          }
+        }
+        m_Slots[m_Keys[slot]] = None;
+      }
+      m_Keys[slot] = key;
+      m_NextRequests[slot] = nextRequest;
+      m_Slots[key] = slot;
+      Push(slot);
+      return false;
+    }
+
+  private:
+    typedef SlotHeap<uint64_t, std::less<uint64_t> > Heap;
+
+    void Push(uint32_t slot)
+    {
+      m_Heap.Push(m_NextRequests[slot], slot);
+      if (m_Heap.IsBloated(m_iSize)) {
+        std::vector<Heap::Entry> entries(m_iSize);
+        for (size_t i=0; i<m_iSize; ++i) {
+          entries[i].priority = m_NextRequests[i];
+          entries[i].slot = uint32_t(i);
+        }
+        m_Heap.Rebuild(entries);
+      }
+    }
+
+    OPTCache& operator=(OPTCache const&);
+
+    std::vector<uint64_t> const& m_NextUse;
+    std::vector<uint32_t> m_Slots;
+    std::vector<Key> m_Keys;
+    std::vector<uint64_t> m_NextRequests;
+    Heap m_Heap;
+    size_t m_iSize;
+  };
+
+  // Adaptive replacement cache as described by Megiddo and Modha, "ARC: A
+  // Self-Tuning, Low Overhead Replacement Cache", FAST 2003. T1 and T2 hold
+  // the cached bricks seen once and repeatedly, B1 and B2 remember bricks
+  // recently evicted from them.
+  class ARCCache {
+  public:
+    ARCCache(uint64_t keyCount, size_t capacity)
+      : m_Nodes(keyCount, None)
+      , m_Lists(2 * capacity)
+      , m_Owner(2 * capacity, uint8_t(LIST_NONE))
+      , m_iCapacity(capacity)
+      , m_iTarget(0)
+    {
+      for (size_t i=0; i<4; ++i)
+        m_List[i] = NodeLists::MakeList();
+    }
+
+    bool Access(Key key, uint64_t)
+    {
+      uint32_t node = m_Nodes[key];
+      uint8_t const owner = node != None ? m_Owner[node] : uint8_t(LIST_NONE);
+      switch (owner) {
+      case T1 :
+      case T2 :
+        Move(node, T2);
+        return true;
+
+      case B1 :
+        m_iTarget = std::min(m_iCapacity,
+          m_iTarget + std::max<size_t>(m_List[B2].size / m_List[B1].size, 1));
+        Replace(false);
+        Move(node, T2);
+        return false;
+
+      case B2 :
+        m_iTarget -= std::min(m_iTarget,
+          std::max<size_t>(m_List[B1].size / m_List[B2].size, 1));
+        Replace(true);
+        Move(node, T2);
+        return false;
+      }
+
+      size_t const sizeL1 = m_List[T1].size + m_List[B1].size;
+      size_t const sizeL2 = m_List[T2].size + m_List[B2].size;
+      if (sizeL1 == m_iCapacity) {
+        if (m_List[T1].size < m_iCapacity) {
+          Forget(m_List[B1].tail);
+          Replace(false);
+        } else {
+          Forget(m_List[T1].tail);
+        }
+      } else if (sizeL1 + sizeL2 >= m_iCapacity) {
+        if (sizeL1 + sizeL2 == 2 * m_iCapacity)
+          Forget(m_List[B2].tail);
+        Replace(false);
+      }
+      node = m_Lists.Allocate();
+      m_Lists.GetKey(node) = key;
+      m_Nodes[key] = node;
+      m_Owner[node] = T1;
+      m_Lists.PushFront(m_List[T1], node);
+      return false;
+    }
+
+  private:
+    enum ListId {
+      T1 = 0,
+      T2,
+      B1,
+      B2,
+      LIST_NONE
+    };
+
+    // Evicts a cached brick into the matching history list.
+    void Replace(bool bInB2)
+    {
+      size_t const sizeT1 = m_List[T1].size;
+      if (sizeT1 > 0 && (sizeT1 > m_iTarget || (bInB2 && sizeT1 == m_iTarget)))
+        Move(m_List[T1].tail, B1);
+      else
+        Move(m_List[T2].tail, B2);
+    }
+
+    void Move(uint32_t node, uint8_t list)
+    {
+      m_Lists.Remove(m_List[m_Owner[node]], node);
+      m_Lists.PushFront(m_List[list], node);
+      m_Owner[node] = list;
+    }
+
+    void Forget(uint32_t node)
+    {
+      m_Lists.Remove(m_List[m_Owner[node]], node);
+      m_Nodes[m_Lists.GetKey(node)] = None;
+      m_Owner[node] = LIST_NONE;
+      m_Lists.Release(node);
+    }
+
+    std::vector<uint32_t> m_Nodes;
+    NodeLists m_Lists;
+    std::vector<uint8_t> m_Owner;
+    NodeLists::List m_List[4];
+    size_t m_iCapacity;
+    size_t m_iTarget;
+  };
+
+  void AddStats(BrickCacheSimulator::Stats& target, BrickCacheSimulator::Stats const& source)
+  {
+    target.requests += source.requests;
+    target.hits += source.hits;
+    target.misses += source.misses;
+    target.bytes += source.bytes;
+    target.remoteMisses += source.remoteMisses;
+  }
+
+}
+
+double BrickCacheSimulator::Stats::GetHitRate() const
+{
+  return requests > 0 ? double(hits) / double(requests) : 1.0;
+}
+
+BrickCacheSimulator::BrickCacheSimulator(BrickAccessFile const& file, uint32_t bytesPerVoxel)
+  : m_Trace(BrickAccessTrace::FromFile(file, m_OwnTrace))
+  , m_iBrickBytes(uint64_t(bytesPerVoxel) * file.GetMaxBrickSize().x *
+    file.GetMaxBrickSize().y * file.GetMaxBrickSize().z)
+  , m_pRemoteKeys(nullptr)
+{}
+
+BrickCacheSimulator::BrickCacheSimulator(BrickAccessTrace const& trace, uint64_t brickBytes)
+  : m_Trace(trace)
+  , m_iBrickBytes(brickBytes)
+  , m_pRemoteKeys(nullptr)
+{}
+
+uint64_t BrickCacheSimulator::GetBrickBytes() const
+{
+  return m_iBrickBytes;
+}
+
+void BrickCacheSimulator::SetRemoteKeys(std::vector<bool> const* pRemoteKeys)
+{
+  m_pRemoteKeys = pRemoteKeys;
+}
+
+void BrickCacheSimulator::Run(Config const& config, Result& result)
+{
+  if (config.policy == CP_OPT && m_NextUse.empty())
+    BuildNextUse();
+
+  // more slots than bricks are never used
+  uint64_t const keyCount = m_Trace.GetLayout().GetKeyCount();
+  size_t const capacity = size_t(std::min<uint64_t>(std::min(config.capacity, keyCount), None - 1));
+
+  result.config = config;
+  result.frames.clear();
+  result.frames.resize(m_Trace.GetFrameCount(), Stats());
+  result.total = Stats();
+  if (capacity == 0) {
+    // nothing can be cached, every request misses
+    for (size_t f=0; f<result.frames.size(); ++f) {
+      BrickAccessTrace::Bricks const bricks = m_Trace.GetFrame(f);
+      Stats& stats = result.frames[f];
+      stats.requests = stats.misses = bricks.size();
+      stats.bytes = stats.misses * m_iBrickBytes;
+      for (size_t i=0; m_pRemoteKeys != nullptr && i<bricks.size(); ++i)
+        stats.remoteMisses += (*m_pRemoteKeys)[size_t(bricks[i])] ? 1 : 0;
+      AddStats(result.total, stats);
+    }
+    return;
+  }
+
+  switch (config.policy) {
+  case CP_LFU :
+    {
+      LFUCache cache(keyCount, capacity);
+      Replay(cache, result);
+    } break;
+  case CP_CLOCK :
+    {
+      CLOCKCache cache(keyCount, capacity);
+      Replay(cache, result);
+    } break;
+  case CP_ARC :
+    {
+      ARCCache cache(keyCount, capacity);
+      Replay(cache, result);
+    } break;
+  case CP_OPT :
+    {
+      OPTCache cache(keyCount, capacity, m_NextUse);
+      Replay(cache, result);
+    } break;
+  default :
+    {
+      LRUCache cache(keyCount, capacity);
+      Replay(cache, result);
+    } break;
+  }
+}
+
+void BrickCacheSimulator::Run(std::vector<Config> const& configs,
+  std::vector<Result>& results, size_t threadCount)
+{
+  for (size_t i=0; i<configs.size(); ++i) {
+    if (configs[i].policy == CP_OPT && m_NextUse.empty())
+      BuildNextUse();
+  }
+  results.resize(configs.size());
+  ThreadPool pool(std::min(threadCount > 0 ? threadCount : ThreadPool::GetHardwareThreadCount(),
+    std::max<size_t>(configs.size(), 1)));
+  pool.ParallelFor(configs.size(), [this, &configs, &results](size_t i) {
+    Run(configs[i], results[i]);
+  });
+}
+
+char const* BrickCacheSimulator::GetPolicyName(Policy policy)
+{
+  switch (policy) {
+  case CP_LRU : return "lru";
+  case CP_LFU : return "lfu";
+  case CP_CLOCK : return "clock";
+  case CP_ARC : return "arc";
+  case CP_OPT : return "opt";
+  default : return "unknown";
+  }
+}
+
+bool BrickCacheSimulator::ParsePolicy(std::string const& name, Policy& policy)
+{
+  for (int i=0; i<CP_COUNT; ++i) {
+    if (name == GetPolicyName(Policy(i))) {
+      policy = Policy(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void BrickCacheSimulator::BuildNextUse()
+{
+  BrickAccessTrace::Bricks const keys = m_Trace.GetKeys();
+  std::vector<uint64_t> lastUse(size_t(m_Trace.GetLayout().GetKeyCount()), Never);
+  m_NextUse.resize(keys.size());
+  for (size_t i=keys.size(); i-- > 0;) {
+    uint64_t& last = lastUse[size_t(keys[i])];
+    m_NextUse[i] = last;
+    last = i;
+  }
+}
+
+template<class Cache>
+void BrickCacheSimulator::Replay(Cache& cache, Result& result) const
+{
+  uint64_t position = 0;
+  for (size_t f=0; f<result.frames.size(); ++f) {
+    BrickAccessTrace::Bricks const bricks = m_Trace.GetFrame(f);
+    Stats& stats = result.frames[f];
+    if (m_pRemoteKeys == nullptr) {
+      for (size_t i=0; i<bricks.size(); ++i)
+        stats.hits += cache.Access(bricks[i], position++) ? 1 : 0;
+    } else {
+      std::vector<bool> const& remote = *m_pRemoteKeys;
+      for (size_t i=0; i<bricks.size(); ++i) {
+        if (cache.Access(bricks[i], position++))
+          ++stats.hits;
+        else if (remote[size_t(bricks[i])])
+          ++stats.remoteMisses;
+      }
+    }
+    stats.requests = bricks.size();
+    stats.misses = stats.requests - stats.hits;
+    stats.bytes = stats.misses * m_iBrickBytes;
+    AddStats(result.total, stats);
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef BRICK_CACHE_SIMULATOR_H
+#define BRICK_CACHE_SIMULATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+
+// Replays the brick requests of a trace through a brick cache, e.g. the brick
+// pool of a ray-guided volume renderer, and counts hits and misses. Every
+// requested brick has to be resident, so a miss always loads the brick and
+// evicts another one once the cache is full.
+//
+// Cache state is kept in tables indexed by brick key, so memory and setup time
+// grow with the number of bricks of the dataset (about 4 bytes per brick for
+// most policies), while every request takes constant or logarithmic time.
+class BrickCacheSimulator {
+public:
+  // Replacement policies.
+  enum Policy {
+    // Evicts the least recently used brick.
+    CP_LRU = 0,
+    // Evicts the brick with the fewest hits since it was loaded, the least
+    // recently used one among equal counts.
+    CP_LFU,
+    // Second chance approximation of LRU with one reference bit per slot.
+    CP_CLOCK,
+    // Adaptive replacement cache, balances recency and frequency.
+    CP_ARC,
+    // Belady's optimal policy, evicts the brick whose next request is the
+    // furthest in the future. This is the lower bound for all policies.
+    CP_OPT,
+    CP_COUNT
+  };
+
+  // A cache to simulate.
+  struct Config {
+    Policy policy;
+    // capacity in bricks
+    uint64_t capacity;
+  };
+
+  // Counters of a frame or of the whole trace.
+  struct Stats {
+    uint64_t requests;
+    uint64_t hits;
+    uint64_t misses;
+    // bytes loaded into the cache, misses times the brick size
+    uint64_t bytes;
+    // misses of keys marked by SetRemoteKeys(), zero otherwise
+    uint64_t remoteMisses;
+
+    // @returns hits / requests, one if there are no requests.
+    double GetHitRate() const;
+  };
+
+  // Results of one simulated cache.
+  struct Result {
+    Config config;
+    Stats total;
+    std::vector<Stats> frames;
+  };
+
+  // Prepares the simulation of a loaded file, see BrickAccessTrace::FromFile().
+  // @param bytesPerVoxel is the voxel size used for the transfer volume, a
+  //   brick takes GetMaxBrickSize() voxels.
+  explicit BrickCacheSimulator(BrickAccessFile const& file, uint32_t bytesPerVoxel = 1);
+
+  // Prepares the simulation of a trace, which has to outlive the simulator.
+  // @param brickBytes is the size of a brick in bytes.
+  BrickCacheSimulator(BrickAccessTrace const& trace, uint64_t brickBytes);
+
+  // @returns the size of a brick in bytes.
+  uint64_t GetBrickBytes() const;
+
+  // Marks keys whose misses are counted separately in Stats::remoteMisses,
+  // e.g. bricks stored on another node. The table is indexed by key, has to
+  // cover the key range of the layout and has to outlive all following
+  // Run() calls. Null disables the count.
+  void SetRemoteKeys(std::vector<bool> const* pRemoteKeys);
+
+  // Replays the whole trace through one cache.
+  void Run(Config const& config, Result& result);
+
+  // Replays the whole trace through several caches at once.
+  // @param threadCount is the number of threads, one cache is simulated per
+  //   thread at a time. Zero uses all hardware threads.
+  void Run(std::vector<Config> const& configs, std::vector<Result>& results,
+    size_t threadCount = 0);
+
+  // @returns the lower case name of a policy, e.g. "lru".
+  static char const* GetPolicyName(Policy policy);
+
+  // @returns the policy of a name as returned by GetPolicyName().
+  static bool ParsePolicy(std::string const& name, Policy& policy);
+
+private:
+  BrickCacheSimulator(BrickCacheSimulator const&);
+  BrickCacheSimulator& operator=(BrickCacheSimulator const&);
+
+  // Computes the position of the next request of the same brick for every
+  // request, which drives CP_OPT.
+  void BuildNextUse();
+
+  template<class Cache>
+  void Replay(Cache& cache, Result& result) const;
+
+  BrickAccessTrace m_OwnTrace;
+  BrickAccessTrace const& m_Trace;
+  uint64_t m_iBrickBytes;
+  std::vector<uint64_t> m_NextUse;
+  std::vector<bool> const* m_pRemoteKeys;
+};
+
+#endif // BRICK_CACHE_SIMULATOR_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
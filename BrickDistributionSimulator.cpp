@@ -0,0 +1,298 @@
+#include "BrickDistributionSimulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BrickHash.h"
+#include "BrickLayout.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  typedef BrickAccessTrace::Key Key;
+  using BrickHash::Mix;
+
+  // Bits per axis of the Morton code over the unit cube.
+  uint32_t const MortonBits = 21;
+
+  // Spreads the lower 21 bits of a value to every third bit.
+  uint64_t Part1By2(uint64_t x)
+  {
+    x &= 0x1FFFFF;
+    x = (x | (x << 32)) & 0x1F00000000FFFFull;
+    x = (x | (x << 16)) & 0x1F0000FF0000FFull;
+    x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+    x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+    x = (x | (x << 2)) & 0x1249249249249249ull;
+    return x;
+  }
+
+  uint64_t GetGridCoordinate(double position)
+  {
+    double const cells = double(1u << MortonBits);
+    return std::min(uint64_t(std::max(position, 0.0) * cells), (uint64_t(1) << MortonBits) - 1);
+  }
+
+  uint32_t GetHashRank(Key key, uint32_t rankCount)
+  {
+    return uint32_t(Mix(key) % rankCount);
+  }
+
+  // @returns the range of tiles a footprint [lower, upper) overlaps along
+  //   one axis of a grid with the given number of tiles.
+  void GetTileRange(double lower, double upper, uint32_t tiles, uint32_t& first, uint32_t& last)
+  {
+    first = std::min(uint32_t(std::max(lower, 0.0) * tiles), tiles - 1);
+    double const end = std::ceil(upper * tiles);
+    last = end > 0.0 ? std::min(uint32_t(end) - 1, tiles - 1) : 0;
+    last = std::max(first, last);
+  }
+
+  // @returns max / mean, one if all values are zero.
+  double GetImbalance(uint64_t max, uint64_t sum, uint32_t count)
+  {
+    return sum > 0 ? double(max) * double(count) / double(sum) : 1.0;
+  }
+
+}
+
+double BrickDistributionSimulator::Result::GetReplication() const
+{
+  return traceRequests > 0 ? double(requests) / double(traceRequests) : 1.0;
+}
+
+BrickDistributionSimulator::BrickDistributionSimulator(BrickAccessFile const& file, uint32_t bytesPerVoxel)
+  : m_Trace(BrickAccessTrace::FromFile(file, m_OwnTrace))
+{
+  Init(file.GetHeader(), bytesPerVoxel);
+}
+
+BrickDistributionSimulator::BrickDistributionSimulator(BrickAccessTrace const& trace,
+  BrickAccessFile::Header const& header, uint32_t bytesPerVoxel)
+  : m_Trace(trace)
+{
+  Init(header, bytesPerVoxel);
+}
+
+void BrickDistributionSimulator::Init(BrickAccessFile::Header const& header, uint32_t bytesPerVoxel)
+{
+  BrickAccessFile::Vec3<uint32_t> const& maxBrickSize = header.maxBrickSize;
+  m_iBrickBytes = uint64_t(bytesPerVoxel) * maxBrickSize.x * maxBrickSize.y * maxBrickSize.z;
+
+  BrickAccessFile::Vec3<uint64_t> const coreBrickSize = BrickLayout::GetCoreBrickSize(header);
+  uint64_t const coreSize[3] = { coreBrickSize.x, coreBrickSize.y, coreBrickSize.z };
+  m_LoDs.resize(header.domainSizes.size());
+  for (size_t lod=0; lod<m_LoDs.size(); ++lod) {
+    BrickAccessFile::Vec3<uint64_t> const& domainSize = header.domainSizes[lod];
+    uint64_t const domain[3] = { domainSize.x, domainSize.y, domainSize.z };
+    for (int axis=0; axis<3; ++axis)
+      m_LoDs[lod].scale[axis] = domain[axis] > 0 ? double(coreSize[axis]) / double(domain[axis]) : 0.0;
+  }
+}
+
+uint64_t BrickDistributionSimulator::GetBrickBytes() const
+{
+  return m_iBrickBytes;
+}
+
+void BrickDistributionSimulator::Run(Config const& config, Result& result, size_t threadCount)
+{
+  uint32_t const rankCount = std::max<uint32_t>(config.rankCount, 1);
+  std::vector<BrickAccessTrace> traces;
+  std::vector<std::vector<bool> > remoteKeys;
+  Partition(config, traces, remoteKeys);
+
+  result.config = config;
+  result.config.rankCount = rankCount;
+  result.ranks.resize(rankCount);
+  ThreadPool pool(std::min<size_t>(threadCount > 0 ? threadCount : ThreadPool::GetHardwareThreadCount(),
+    rankCount));
+  pool.ParallelFor(rankCount, [this, &config, &traces, &remoteKeys, &result](size_t r) {
+    BrickCacheSimulator simulator(traces[r], m_iBrickBytes);
+    simulator.SetRemoteKeys(remoteKeys[r].empty() ? nullptr : &remoteKeys[r]);
+    simulator.Run(config.cache, result.ranks[r]);
+    // the rank traces are large, release them as soon as possible
+    traces[r].Clear();
+    std::vector<bool>().swap(remoteKeys[r]);
+  });
+
+  result.traceRequests = m_Trace.GetTotalBrickCount();
+  result.requests = 0;
+  result.misses = 0;
+  result.maxRankMisses = 0;
+  result.criticalMisses = 0;
+  uint64_t maxRankRequests = 0;
+  uint64_t remoteMisses = 0;
+  for (uint32_t r=0; r<rankCount; ++r) {
+    BrickCacheSimulator::Stats const& total = result.ranks[r].total;
+    result.requests += total.requests;
+    result.misses += total.misses;
+    result.maxRankMisses = std::max(result.maxRankMisses, total.misses);
+    maxRankRequests = std::max(maxRankRequests, total.requests);
+    remoteMisses += total.remoteMisses;
+  }
+  for (size_t f=0; f<m_Trace.GetFrameCount(); ++f) {
+    uint64_t frameMisses = 0;
+    for (uint32_t r=0; r<rankCount; ++r)
+      frameMisses = std::max(frameMisses, result.ranks[r].frames[f].misses);
+    result.criticalMisses += frameMisses;
+  }
+  result.transferBytes = remoteMisses * m_iBrickBytes;
+  result.loadBytes = (result.misses - remoteMisses) * m_iBrickBytes;
+  result.requestImbalance = GetImbalance(maxRankRequests, result.requests, rankCount);
+  result.missImbalance = GetImbalance(result.maxRankMisses, result.misses, rankCount);
+  result.frameImbalance = GetImbalance(result.criticalMisses, result.misses, rankCount);
+}
+
+char const* BrickDistributionSimulator::GetDistributionName(Distribution distribution)
+{
+  switch (distribution) {
+  case DP_HASH : return "hash";
+  case DP_MORTON : return "morton";
+  case DP_ROUND_ROBIN : return "round-robin";
+  case DP_TILES : return "tiles";
+  default : return "unknown";
+  }
+}
+
+bool BrickDistributionSimulator::ParseDistribution(std::string const& name, Distribution& distribution)
+{
+  for (int i=0; i<DP_COUNT; ++i) {
+    if (name == GetDistributionName(Distribution(i))) {
+      distribution = Distribution(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void BrickDistributionSimulator::Partition(Config const& config, std::vector<BrickAccessTrace>& traces,
+  std::vector<std::vector<bool> >& remoteKeys) const
+{
+  uint32_t const rankCount = std::max<uint32_t>(config.rankCount, 1);
+  Distribution const distribution = config.distribution;
+  BrickLayout const& layout = m_Trace.GetLayout();
+  bool const bSpatial = distribution == DP_MORTON || distribution == DP_TILES;
+
+  // the tile grid is as square as the rank count allows, e.g. 4 x 3 for 12
+  uint32_t tilesY = uint32_t(std::sqrt(double(rankCount)));
+  while (rankCount % tilesY != 0)
+    --tilesY;
+  uint32_t const tilesX = rankCount / tilesY;
+
+  traces.assign(rankCount, BrickAccessTrace());
+  for (uint32_t r=0; r<rankCount; ++r) {
+    traces[r].Reset(layout);
+    traces[r].Reserve(m_Trace.GetTotalBrickCount() / rankCount, m_Trace.GetTotalSubframeCount(),
+      m_Trace.GetFrameCount());
+  }
+  // with DP_HASH and DP_MORTON every rank stores what it requests, so there
+  // are no remote keys
+  remoteKeys.assign(rankCount, std::vector<bool>());
+  if (distribution == DP_ROUND_ROBIN || distribution == DP_TILES) {
+    for (uint32_t r=0; r<rankCount; ++r)
+      remoteKeys[r].assign(size_t(layout.GetKeyCount()), false);
+  }
+
+  std::vector<std::vector<Key> > rankKeys(rankCount);
+  std::vector<BrickAccessFile::Brick> bricks;
+  for (size_t f=0; f<m_Trace.GetFrameCount(); ++f) {
+    for (uint32_t r=0; r<rankCount; ++r)
+      traces[r].BeginFrame();
+    uint64_t position = 0;
+    for (size_t s=0; s<m_Trace.GetSubframeCount(f); ++s) {
+      BrickAccessTrace::Bricks const keys = m_Trace.GetSubframe(f, s);
+      if (bSpatial) {
+        bricks.resize(keys.size());
+        layout.GetBricks(keys.data, keys.size(), bricks.data());
+      }
+      for (uint32_t r=0; r<rankCount; ++r)
+        rankKeys[r].clear();
+
+      for (size_t i=0; i<keys.size(); ++i) {
+        Key const key = keys[i];
+        switch (distribution) {
+        case DP_MORTON :
+          {
+            double lower[3], upper[3];
+            GetBounds(bricks[i], lower, upper);
+            uint64_t const code = Part1By2(GetGridCoordinate(0.5 * (lower[0] + upper[0]))) |
+              (Part1By2(GetGridCoordinate(0.5 * (lower[1] + upper[1]))) << 1) |
+              (Part1By2(GetGridCoordinate(0.5 * (lower[2] + upper[2]))) << 2);
+            // cuts the 63-bit curve into equal parts without overflow
+            rankKeys[size_t(((code >> 31) * rankCount) >> 32)].push_back(key);
+          } break;
+        case DP_ROUND_ROBIN :
+          {
+            uint32_t const rank = uint32_t(position++ % rankCount);
+            rankKeys[rank].push_back(key);
+            if (GetHashRank(key, rankCount) != rank)
+              remoteKeys[rank][size_t(key)] = true;
+          } break;
+        case DP_TILES :
+          {
+            double lower[3], upper[3];
+            GetBounds(bricks[i], lower, upper);
+            uint32_t firstX, lastX, firstY, lastY;
+            GetTileRange(lower[0], upper[0], tilesX, firstX, lastX);
+            GetTileRange(lower[1], upper[1], tilesY, firstY, lastY);
+            uint32_t const home = GetHashRank(key, rankCount);
+            for (uint32_t y=firstY; y<=lastY; ++y) {
+              for (uint32_t x=firstX; x<=lastX; ++x) {
+                uint32_t const rank = y * tilesX + x;
+                rankKeys[rank].push_back(key);
+                if (home != rank)
+                  remoteKeys[rank][size_t(key)] = true;
+              }
+            }
+          } break;
+        default :
+          rankKeys[GetHashRank(key, rankCount)].push_back(key);
+          break;
+        }
+      }
+
+      for (uint32_t r=0; r<rankCount; ++r) {
+        traces[r].BeginSubframe(uint32_t(rankKeys[r].size()));
+        traces[r].AddKeys(rankKeys[r].data(), rankKeys[r].size());
+      }
+    }
+    for (uint32_t r=0; r<rankCount; ++r)
+      traces[r].EndFrame();
+  }
+}
+
+void BrickDistributionSimulator::GetBounds(BrickAccessFile::Brick const& brick, double lower[3],
+  double upper[3]) const
+{
+  LoDInfo const& info = m_LoDs[size_t(brick.w)];
+  uint64_t const index[3] = { brick.x, brick.y, brick.z };
+  for (int axis=0; axis<3; ++axis) {
+    lower[axis] = std::min(double(index[axis]) * info.scale[axis], 1.0);
+    upper[axis] = std::min(double(index[axis] + 1) * info.scale[axis], 1.0);
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
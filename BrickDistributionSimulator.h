@@ -0,0 +1,156 @@
+#pragma once
+
+#ifndef BRICK_DISTRIBUTION_SIMULATOR_H
+#define BRICK_DISTRIBUTION_SIMULATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+#include "BrickCacheSimulator.h"
+
+// Simulates a trace rendered by several GPUs or nodes (ranks) which split the
+// brick requests of every frame among them. Every rank replays its share of
+// the trace through its own brick cache, see BrickCacheSimulator, and the
+// ranks are simulated in parallel.
+//
+// Distributions:
+//  - DP_HASH: a brick belongs to the rank given by a hash of its key.
+//  - DP_MORTON: the domain is cut into N blocks along a Z-order curve over
+//    the normalized brick centers, so all LoDs of a region share a rank.
+//  - DP_ROUND_ROBIN: the requests of a frame are dealt out in order, a brick
+//    requested again may go to another rank.
+//  - DP_TILES: sort-first rendering with the screen split into a grid of
+//    tiles. Traces carry no camera, so the screen is the xy plane of the
+//    domain looking along z. A brick is requested by every tile its
+//    footprint overlaps, so bricks on tile borders are loaded several times.
+//
+// Bricks are stored on a home rank: the owner for DP_HASH and DP_MORTON, the
+// hash of the key for the other distributions. A miss of a brick stored on
+// another rank is an inter-rank transfer, all other misses are loaded from
+// local storage.
+class BrickDistributionSimulator {
+public:
+  enum Distribution {
+    DP_HASH = 0,
+    DP_MORTON,
+    DP_ROUND_ROBIN,
+    DP_TILES,
+    DP_COUNT
+  };
+
+  // A cluster to simulate.
+  struct Config {
+    Distribution distribution;
+    uint32_t rankCount;
+    // cache of every rank
+    BrickCacheSimulator::Config cache;
+  };
+
+  // Results of one simulated cluster.
+  struct Result {
+    Config config;
+    // cache simulation of every rank, remoteMisses are the inter-rank
+    // transfers
+    std::vector<BrickCacheSimulator::Result> ranks;
+    // bricks requested by the trace
+    uint64_t traceRequests;
+    // requests of all ranks, more than traceRequests if tiles share bricks
+    uint64_t requests;
+    // misses of all ranks and of the rank with the most misses
+    uint64_t misses;
+    uint64_t maxRankMisses;
+    // sum of the largest miss count of any rank over all frames, the misses
+    // on the critical path if ranks synchronize every frame
+    uint64_t criticalMisses;
+    // bytes sent between ranks and loaded from local storage
+    uint64_t transferBytes;
+    uint64_t loadBytes;
+    // largest rank total divided by the mean of all ranks, one is perfect
+    // balance
+    double requestImbalance;
+    double missImbalance;
+    // criticalMisses divided by the mean misses of a rank
+    double frameImbalance;
+
+    // @returns requests / traceRequests.
+    double GetReplication() const;
+  };
+
+  // Prepares the simulation of a loaded file, see BrickAccessTrace::FromFile().
+  // @param bytesPerVoxel is the voxel size used for the transfer volume, a
+  //   brick takes GetMaxBrickSize() voxels.
+  explicit BrickDistributionSimulator(BrickAccessFile const& file, uint32_t bytesPerVoxel = 1);
+
+  // Prepares the simulation of a trace, which has to outlive the simulator.
+  BrickDistributionSimulator(BrickAccessTrace const& trace, BrickAccessFile::Header const& header,
+    uint32_t bytesPerVoxel = 1);
+
+  // @returns the size of a brick in bytes.
+  uint64_t GetBrickBytes() const;
+
+  // Partitions the trace and replays all ranks.
+  // @param threadCount is the number of threads, one rank is simulated per
+  //   thread at a time. Zero uses all hardware threads.
+  void Run(Config const& config, Result& result, size_t threadCount = 0);
+
+  // @returns the lower case name of a distribution, e.g. "morton".
+  static char const* GetDistributionName(Distribution distribution);
+
+  // @returns the distribution of a name as returned by
+  //   GetDistributionName().
+  static bool ParseDistribution(std::string const& name, Distribution& distribution);
+
+private:
+  BrickDistributionSimulator(BrickDistributionSimulator const&);
+  BrickDistributionSimulator& operator=(BrickDistributionSimulator const&);
+
+  void Init(BrickAccessFile::Header const& header, uint32_t bytesPerVoxel);
+
+  // Splits the trace into one trace per rank, every rank gets all frames and
+  // subframes, and marks the keys each rank has to fetch from another rank.
+  void Partition(Config const& config, std::vector<BrickAccessTrace>& traces,
+    std::vector<std::vector<bool> >& remoteKeys) const;
+
+  // Per-LoD core size of a brick relative to the domain size.
+  struct LoDInfo {
+    double scale[3];
+  };
+
+  // Computes the footprint of a brick in the unit cube, the upper corner of
+  // bricks at the domain border is clamped to one.
+  void GetBounds(BrickAccessFile::Brick const& brick, double lower[3], double upper[3]) const;
+
+  BrickAccessTrace m_OwnTrace;
+  BrickAccessTrace const& m_Trace;
+  std::vector<LoDInfo> m_LoDs;
+  uint64_t m_iBrickBytes;
+};
+
+#endif // BRICK_DISTRIBUTION_SIMULATOR_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,642 @@
+#include "BrickIoReplayer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BRICK_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  typedef std::chrono::steady_clock Clock;
+  typedef BrickAccessTrace::Key Key;
+
+  double GetSeconds(Clock::time_point const& start, Clock::time_point const& end)
+  {
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  // Read buffer aligned for O_DIRECT.
+  class AlignedBuffer {
+  public:
+    explicit AlignedBuffer(uint64_t size)
+      : m_pData(nullptr)
+    {
+      size_t const alignment = size_t(BrickVolumeStore::GetAlignment());
+#ifdef _WIN32
+      m_pData = _aligned_malloc(size_t(std::max<uint64_t>(size, 1)), alignment);
+#else
+      if (posix_memalign(&m_pData, alignment, size_t(std::max<uint64_t>(size, 1))) != 0)
+        m_pData = nullptr;
+#endif
+    }
+
+    ~AlignedBuffer()
+    {
+#ifdef _WIN32
+      _aligned_free(m_pData);
+#else
+      free(m_pData);
+#endif
+    }
+
+    void* GetData() const { return m_pData; }
+
+  private:
+    AlignedBuffer(AlignedBuffer const&);
+    AlignedBuffer& operator=(AlignedBuffer const&);
+
+    void* m_pData;
+  };
+
+  // Read-only file with positional reads which are safe to call from several
+  // threads at once.
+  class VolumeFile {
+  public:
+    VolumeFile()
+#ifdef _WIN32
+      : m_File(INVALID_HANDLE_VALUE)
+#else
+      : m_File(-1)
+#endif
+    {}
+
+    ~VolumeFile()
+    {
+#ifdef _WIN32
+      if (m_File != INVALID_HANDLE_VALUE)
+        CloseHandle(m_File);
+#else
+      if (m_File >= 0)
+        close(m_File);
+#endif
+    }
+
+    bool Open(std::string const& filename, bool bDirect)
+    {
+#ifdef _WIN32
+      m_File = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        bDirect ? FILE_FLAG_NO_BUFFERING : FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (m_File == INVALID_HANDLE_VALUE) {
+        std::cerr << "failed to open file " << filename << std::endl;
+        return false;
+      }
+#else
+      int flags = O_RDONLY;
+#ifdef __linux__
+      if (bDirect)
+        flags |= O_DIRECT;
+#endif
+      m_File = open(filename.c_str(), flags);
+      if (m_File < 0) {
+        std::cerr << "failed to open file " << filename << ": " << strerror(errno) << std::endl;
+        return false;
+      }
+#if defined(__APPLE__)
+      if (bDirect && fcntl(m_File, F_NOCACHE, 1) != 0) {
+        std::cerr << "failed to disable caching of file " << filename << std::endl;
+        return false;
+      }
+#elif !defined(__linux__)
+      if (bDirect) {
+        std::cerr << "direct reads are not supported on this platform" << std::endl;
+        return false;
+      }
+#endif
+#endif
+      return true;
+    }
+
+    // Evicts the file from the page cache.
+    bool DropCache()
+    {
+#if defined(__linux__)
+      int const error = posix_fadvise(m_File, 0, 0, POSIX_FADV_DONTNEED);
+      if (error != 0) {
+        std::cerr << "failed to drop the page cache: " << strerror(error) << std::endl;
+        return false;
+      }
+      return true;
+#else
+      std::cerr << "dropping the page cache is not supported on this platform" << std::endl;
+      return false;
+#endif
+    }
+
+    // Reads size bytes at offset, which have to be inside of the file.
+    bool Read(void* buffer, uint64_t size, uint64_t offset) const
+    {
+      char* data = static_cast<char*>(buffer);
+      while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = DWORD(offset);
+        overlapped.OffsetHigh = DWORD(offset >> 32);
+        DWORD count = 0;
+        if (!ReadFile(m_File, data, DWORD(std::min<uint64_t>(size, 1u << 30)), &count, &overlapped) || count == 0)
+          return false;
+#else
+        ssize_t const count = pread(m_File, data, size_t(size), off_t(offset));
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0)
+          return false;
+#endif
+        data += count;
+        size -= uint64_t(count);
+        offset += uint64_t(count);
+      }
+      return true;
+    }
+
+#ifndef _WIN32
+    int GetDescriptor() const { return m_File; }
+#endif
+
+  private:
+    VolumeFile(VolumeFile const&);
+    VolumeFile& operator=(VolumeFile const&);
+
+#ifdef _WIN32
+    HANDLE m_File;
+#else
+    int m_File;
+#endif
+  };
+
+  // Counts the reads in flight of several threads.
+  class QueueDepth {
+  public:
+    QueueDepth() : m_iInFlight(0), m_iSum(0), m_iPeak(0) {}
+
+    void Issue()
+    {
+      uint32_t const depth = m_iInFlight.fetch_add(1) + 1;
+      m_iSum.fetch_add(depth, std::memory_order_relaxed);
+      uint32_t peak = m_iPeak.load(std::memory_order_relaxed);
+      while (depth > peak && !m_iPeak.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {}
+    }
+
+    void Complete()
+    {
+      m_iInFlight.fetch_sub(1);
+    }
+
+    uint64_t GetSum() const { return m_iSum.load(); }
+    uint32_t GetPeak() const { return m_iPeak.load(); }
+
+  private:
+    std::atomic<uint32_t> m_iInFlight;
+    std::atomic<uint64_t> m_iSum;
+    std::atomic<uint32_t> m_iPeak;
+  };
+
+#ifdef BRICK_IO_URING
+  // Minimal io_uring on top of the raw system calls, which avoids a dependency
+  // on liburing.
+  class Uring {
+  public:
+    Uring()
+      : m_iFile(-1), m_pSqRing(nullptr), m_pCqRing(nullptr), m_pSqes(nullptr)
+      , m_iSqRingSize(0), m_iCqRingSize(0), m_iSqesSize(0), m_iPending(0)
+    {}
+
+    ~Uring()
+    {
+      if (m_pSqes)
+        munmap(m_pSqes, m_iSqesSize);
+      if (m_pCqRing && m_pCqRing != m_pSqRing)
+        munmap(m_pCqRing, m_iCqRingSize);
+      if (m_pSqRing)
+        munmap(m_pSqRing, m_iSqRingSize);
+      if (m_iFile >= 0)
+        close(m_iFile);
+    }
+
+    // @returns false with errno set if the ring could not be set up.
+    bool Open(uint32_t entries)
+    {
+      io_uring_params params;
+      memset(&params, 0, sizeof(params));
+      m_iFile = int(syscall(__NR_io_uring_setup, entries, &params));
+      if (m_iFile < 0)
+        return false;
+
+      m_iSqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+      m_iCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      bool const bSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (bSingleMap)
+        m_iSqRingSize = m_iCqRingSize = std::max(m_iSqRingSize, m_iCqRingSize);
+      m_pSqRing = Map(m_iSqRingSize, IORING_OFF_SQ_RING);
+      if (!m_pSqRing)
+        return false;
+      m_pCqRing = bSingleMap ? m_pSqRing : Map(m_iCqRingSize, IORING_OFF_CQ_RING);
+      if (!m_pCqRing)
+        return false;
+      m_iSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+      m_pSqes = static_cast<io_uring_sqe*>(Map(m_iSqesSize, IORING_OFF_SQES));
+      if (!m_pSqes)
+        return false;
+
+      char* const sq = static_cast<char*>(m_pSqRing);
+      char* const cq = static_cast<char*>(m_pCqRing);
+      m_pSqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+      m_iSqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+      m_pSqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+      m_pCqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+      m_pCqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+      m_iCqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+      m_pCqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+      return true;
+    }
+
+    // Queues a read, the caller keeps the number of queued and running reads
+    // below the number of entries.
+    void PrepareRead(int file, iovec* vector, uint64_t offset, uint64_t userData)
+    {
+      uint32_t const tail = *m_pSqTail;
+      uint32_t const index = tail & m_iSqMask;
+      io_uring_sqe& sqe = m_pSqes[index];
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READV;
+      sqe.fd = file;
+      sqe.addr = reinterpret_cast<uint64_t>(vector);
+      sqe.len = 1;
+      sqe.off = offset;
+      sqe.user_data = userData;
+      m_pSqArray[index] = index;
+      __atomic_store_n(m_pSqTail, tail + 1, __ATOMIC_RELEASE);
+      ++m_iPending;
+    }
+
+    // Submits all queued reads and waits until at least one read completed.
+    bool SubmitAndWait()
+    {
+      for (;;) {
+        int const result = int(syscall(__NR_io_uring_enter, m_iFile, m_iPending, 1u,
+          IORING_ENTER_GETEVENTS, nullptr, size_t(0)));
+        if (result >= 0) {
+          m_iPending -= uint32_t(result);
+          return true;
+        }
+        if (errno != EINTR)
+          return false;
+      }
+    }
+
+    // Takes a completed read.
+    // @returns false if no read has completed.
+    bool Reap(uint64_t& userData, int32_t& result)
+    {
+      uint32_t const head = *m_pCqHead;
+      if (head == __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE))
+        return false;
+      io_uring_cqe const& cqe = m_pCqes[head & m_iCqMask];
+      userData = cqe.user_data;
+      result = cqe.res;
+      __atomic_store_n(m_pCqHead, head + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+  private:
+    Uring(Uring const&);
+    Uring& operator=(Uring const&);
+
+    void* Map(size_t size, off_t offset)
+    {
+      void* const data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iFile, offset);
+      return data == MAP_FAILED ? nullptr : data;
+    }
+
+    int m_iFile;
+    void* m_pSqRing;
+    void* m_pCqRing;
+    io_uring_sqe* m_pSqes;
+    size_t m_iSqRingSize;
+    size_t m_iCqRingSize;
+    size_t m_iSqesSize;
+    uint32_t* m_pSqTail;
+    uint32_t* m_pSqArray;
+    uint32_t m_iSqMask;
+    uint32_t* m_pCqHead;
+    uint32_t* m_pCqTail;
+    uint32_t m_iCqMask;
+    io_uring_cqe* m_pCqes;
+    uint32_t m_iPending;
+  };
+#endif
+
+  char const* const BackendNames[BrickIoReplayer::IB_COUNT] = { "pread", "uring", "mmap" };
+
+  uint64_t const DefaultMaxReadBytes = uint64_t(8) << 20;
+
+}
+
+double BrickIoReplayer::Result::GetPercentile(double percentile) const
+{
+  if (subframeSeconds.empty())
+    return 0.0;
+  std::vector<double> sorted(subframeSeconds);
+  std::sort(sorted.begin(), sorted.end());
+  double const position = std::min(std::max(percentile, 0.0), 100.0) / 100.0 * double(sorted.size() - 1);
+  size_t const lower = size_t(position);
+  size_t const upper = std::min(lower + 1, sorted.size() - 1);
+  double const weight = position - double(lower);
+  return sorted[lower] * (1.0 - weight) + sorted[upper] * weight;
+}
+
+double BrickIoReplayer::Result::GetThroughput() const
+{
+  return seconds > 0.0 ? double(bytes) / seconds : 0.0;
+}
+
+BrickIoReplayer::BrickIoReplayer(BrickAccessTrace const& trace, BrickVolumeStore const& store,
+  std::string const& volumeFilename)
+  : m_Trace(trace)
+  , m_Store(store)
+  , m_VolumeFilename(volumeFilename)
+{}
+
+bool BrickIoReplayer::Run(Config const& config, Result& result) const
+{
+  result.config = config;
+  result.config.queueDepth = std::max<uint32_t>(config.queueDepth, 1);
+  result.subframeSeconds.clear();
+  result.subframeSeconds.reserve(m_Trace.GetTotalSubframeCount());
+  if (config.bCoalesce && config.maxReadBytes == 0)
+    result.config.maxReadBytes = DefaultMaxReadBytes;
+  result.bricks = 0;
+  result.reads = 0;
+  result.bytes = 0;
+  result.seconds = 0.0;
+  result.averageQueueDepth = 0.0;
+  result.peakQueueDepth = 0;
+  if (!IsSupported(config.backend)) {
+    std::cerr << "backend " << GetBackendName(config.backend) << " is not supported by this build" << std::endl;
+    return false;
+  }
+  if (config.backend == IB_URING)
+    return RunUring(result.config, result);
+  return RunThreads(result.config, result);
+}
+
+uint64_t BrickIoReplayer::GetBufferBytes(Config const& config) const
+{
+  // a brick is never split, so a read is at most one brick longer than the
+  // limit
+  if (config.bCoalesce)
+    return std::max(config.maxReadBytes, m_Store.GetMaxStoredBytes());
+  return m_Store.GetMaxStoredBytes();
+}
+
+void BrickIoReplayer::GetReads(Config const& config, size_t frame, size_t subframe,
+  BrickReadPlanner& planner, std::vector<BrickReadPlanner::Read>& reads, Result& result) const
+{
+  BrickAccessTrace::Bricks const keys = m_Trace.GetSubframe(frame, subframe);
+  if (config.bCoalesce) {
+    planner.SetGap(config.gapBytes);
+    planner.SetMaxReadBytes(config.maxReadBytes);
+    planner.Plan(keys.begin(), keys.size());
+    reads = planner.GetReads();
+  } else {
+    reads.resize(keys.size());
+    for (size_t i=0; i<keys.size(); ++i) {
+      reads[i].offset = m_Store.GetOffset(keys[i]);
+      reads[i].size = m_Store.GetStoredBytes(keys[i]);
+      reads[i].firstBrick = uint32_t(i);
+      reads[i].brickCount = 1;
+    }
+  }
+  result.bricks += keys.size();
+  result.reads += reads.size();
+  for (size_t i=0; i<reads.size(); ++i)
+    result.bytes += reads[i].size;
+}
+
+bool BrickIoReplayer::RunThreads(Config const& config, Result& result) const
+{
+  bool const bMapped = config.backend == IB_MMAP;
+  VolumeFile file;
+  if (!file.Open(m_VolumeFilename, config.bDirect && !bMapped))
+    return false;
+  if (config.bDropCache && !file.DropCache())
+    return false;
+  MappedFile mapping;
+  if (bMapped && !mapping.Open(m_VolumeFilename)) {
+    std::cerr << "failed to map file " << m_VolumeFilename << std::endl;
+    return false;
+  }
+
+  ThreadPool pool(config.queueDepth);
+  std::vector<std::unique_ptr<AlignedBuffer> > buffers(pool.GetThreadCount());
+  for (size_t i=0; i<buffers.size(); ++i) {
+    buffers[i].reset(new AlignedBuffer(GetBufferBytes(config)));
+    if (!buffers[i]->GetData()) {
+      std::cerr << "failed to allocate read buffers" << std::endl;
+      return false;
+    }
+  }
+
+  QueueDepth depth;
+  std::atomic<bool> bFailed(false);
+  BrickReadPlanner planner(m_Store);
+  std::vector<BrickReadPlanner::Read> reads;
+  Clock::time_point const start = Clock::now();
+  for (size_t f=0; f<m_Trace.GetFrameCount() && !bFailed; ++f) {
+    for (size_t s=0; s<m_Trace.GetSubframeCount(f); ++s) {
+      Clock::time_point const subframeStart = Clock::now();
+      GetReads(config, f, s, planner, reads, result);
+      pool.ParallelForThreads(reads.size(), [&](size_t i, size_t thread) {
+        BrickReadPlanner::Read const& read = reads[i];
+        void* const buffer = buffers[thread]->GetData();
+        depth.Issue();
+        if (bMapped)
+          memcpy(buffer, mapping.GetData() + read.offset, size_t(read.size));
+        else if (!file.Read(buffer, read.size, read.offset))
+          bFailed = true;
+        depth.Complete();
+      });
+      result.subframeSeconds.push_back(GetSeconds(subframeStart, Clock::now()));
+    }
+  }
+  result.seconds = GetSeconds(start, Clock::now());
+  if (bFailed) {
+    std::cerr << "failed to read file " << m_VolumeFilename << std::endl;
+    return false;
+  }
+  result.averageQueueDepth = result.reads > 0 ? double(depth.GetSum()) / double(result.reads) : 0.0;
+  result.peakQueueDepth = depth.GetPeak();
+  return true;
+}
+
+bool BrickIoReplayer::RunUring(Config const& config, Result& result) const
+{
+#ifdef BRICK_IO_URING
+  VolumeFile file;
+  if (!file.Open(m_VolumeFilename, config.bDirect))
+    return false;
+  if (config.bDropCache && !file.DropCache())
+    return false;
+  Uring ring;
+  if (!ring.Open(config.queueDepth)) {
+    std::cerr << "failed to set up io_uring: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  // one buffer per read in flight, a slot is free again once its read has
+  // completed
+  struct Slot {
+    iovec vector;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t done;
+  };
+  std::vector<std::unique_ptr<AlignedBuffer> > buffers(config.queueDepth);
+  std::vector<Slot> slots(config.queueDepth);
+  std::vector<uint32_t> freeSlots;
+  for (uint32_t i=0; i<config.queueDepth; ++i) {
+    buffers[i].reset(new AlignedBuffer(GetBufferBytes(config)));
+    if (!buffers[i]->GetData()) {
+      std::cerr << "failed to allocate read buffers" << std::endl;
+      return false;
+    }
+    freeSlots.push_back(config.queueDepth - 1 - i);
+  }
+
+  uint64_t depthSum = 0;
+  BrickReadPlanner planner(m_Store);
+  std::vector<BrickReadPlanner::Read> reads;
+  Clock::time_point const start = Clock::now();
+  for (size_t f=0; f<m_Trace.GetFrameCount(); ++f) {
+    for (size_t s=0; s<m_Trace.GetSubframeCount(f); ++s) {
+      Clock::time_point const subframeStart = Clock::now();
+      GetReads(config, f, s, planner, reads, result);
+      size_t next = 0;
+      uint32_t inFlight = 0;
+      while (next < reads.size() || inFlight > 0) {
+        for (; next < reads.size() && inFlight < config.queueDepth; ++next) {
+          uint32_t const index = freeSlots.back();
+          freeSlots.pop_back();
+          Slot& slot = slots[index];
+          slot.offset = reads[next].offset;
+          slot.size = reads[next].size;
+          slot.done = 0;
+          slot.vector.iov_base = buffers[index]->GetData();
+          slot.vector.iov_len = size_t(slot.size);
+          ring.PrepareRead(file.GetDescriptor(), &slot.vector, slot.offset, index);
+          ++inFlight;
+          depthSum += inFlight;
+          result.peakQueueDepth = std::max(result.peakQueueDepth, inFlight);
+        }
+        if (!ring.SubmitAndWait()) {
+          std::cerr << "failed to submit reads: " << strerror(errno) << std::endl;
+          return false;
+        }
+        uint64_t index = 0;
+        int32_t count = 0;
+        while (ring.Reap(index, count)) {
+          Slot& slot = slots[size_t(index)];
+          if (count <= 0) {
+            std::cerr << "failed to read file " << m_VolumeFilename << ": "
+              << (count < 0 ? strerror(-count) : "unexpected end of file") << std::endl;
+            return false;
+          }
+          // short reads continue with the remaining bytes
+          slot.done += uint64_t(count);
+          if (slot.done < slot.size) {
+            slot.vector.iov_base = static_cast<char*>(buffers[size_t(index)]->GetData()) + slot.done;
+            slot.vector.iov_len = size_t(slot.size - slot.done);
+            ring.PrepareRead(file.GetDescriptor(), &slot.vector, slot.offset + slot.done, index);
+            continue;
+          }
+          freeSlots.push_back(uint32_t(index));
+          --inFlight;
+        }
+      }
+      result.subframeSeconds.push_back(GetSeconds(subframeStart, Clock::now()));
+    }
+  }
+  result.seconds = GetSeconds(start, Clock::now());
+  result.averageQueueDepth = result.reads > 0 ? double(depthSum) / double(result.reads) : 0.0;
+  return true;
+#else
+  (void)config;
+  (void)result;
+  return false;
+#endif
+}
+
+bool BrickIoReplayer::IsSupported(Backend backend)
+{
+#ifdef BRICK_IO_URING
+  return backend < IB_COUNT;
+#else
+  return backend < IB_COUNT && backend != IB_URING;
+#endif
+}
+
+char const* BrickIoReplayer::GetBackendName(Backend backend)
+{
+  return backend < IB_COUNT ? BackendNames[backend] : "unknown";
+}
+
+bool BrickIoReplayer::ParseBackend(std::string const& name, Backend& backend)
+{
+  for (int i=0; i<IB_COUNT; ++i) {
+    if (name == BackendNames[i]) {
+      backend = Backend(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef BRICK_IO_REPLAYER_H
+#define BRICK_IO_REPLAYER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessTrace.h"
+#include "BrickReadPlanner.h"
+#include "BrickVolumeStore.h"
+
+// Replays the brick requests of a trace as reads from a volume file (see
+// BrickVolumeStore) and measures the latency of every subframe, throughput
+// and the number of reads in flight.
+//
+// Subframes are replayed one after another like a renderer which waits for
+// the bricks of a pass before it continues, all bricks of a subframe are read
+// concurrently with up to queueDepth reads in flight. The latency of a
+// subframe runs from its first read until its last read has completed.
+// Reads either fetch one requested brick each, in trace order, or the ranges
+// of a BrickReadPlanner which merges the bricks of a subframe in disk order.
+//
+// Backends:
+//  - IB_PREAD: a pool of queueDepth threads with blocking positional reads.
+//  - IB_URING: one thread which keeps queueDepth reads in flight through an
+//    io_uring (Linux only, built if <linux/io_uring.h> is available).
+//  - IB_MMAP: a pool of queueDepth threads copying bricks out of a memory
+//    mapping of the volume file, the page faults do the I/O.
+class BrickIoReplayer {
+public:
+  // Ways to read bricks.
+  enum Backend {
+    IB_PREAD = 0,
+    IB_URING,
+    IB_MMAP,
+    IB_COUNT
+  };
+
+  // A replay to run.
+  struct Config {
+    Backend backend;
+    // reads in flight, the thread count of IB_PREAD and IB_MMAP
+    uint32_t queueDepth;
+    // reads bypass the page cache (O_DIRECT), ignored by IB_MMAP
+    bool bDirect;
+    // evicts the volume file from the page cache before the replay
+    bool bDropCache;
+    // reads the ranges planned by BrickReadPlanner instead of every request
+    bool bCoalesce;
+    // gap and read size limit of the planner, a zero limit uses 8 MiB
+    uint64_t gapBytes;
+    uint64_t maxReadBytes;
+  };
+
+  // Measurements of a replay.
+  struct Result {
+    Config config;
+    // latency of every subframe in trace order
+    std::vector<double> subframeSeconds;
+    // bricks requested by the trace including repeats within a subframe, the
+    // same with and without coalescing
+    uint64_t bricks;
+    uint64_t reads;
+    // bytes read including the gaps between coalesced bricks
+    uint64_t bytes;
+    double seconds;
+    // reads in flight when a read was issued, including the read itself
+    double averageQueueDepth;
+    uint32_t peakQueueDepth;
+
+    // @returns the given percentile in [0, 100] of the subframe latencies.
+    double GetPercentile(double percentile) const;
+
+    // @returns bytes per second.
+    double GetThroughput() const;
+  };
+
+  // Prepares the replay of a trace, trace and store have to outlive the
+  // replayer and the store has to use the layout of the trace.
+  BrickIoReplayer(BrickAccessTrace const& trace, BrickVolumeStore const& store,
+    std::string const& volumeFilename);
+
+  // Replays the whole trace.
+  // @returns false if the volume file could not be read.
+  bool Run(Config const& config, Result& result) const;
+
+  // @returns false if the backend is not available in this build.
+  static bool IsSupported(Backend backend);
+
+  // @returns the lower case name of a backend, e.g. "pread".
+  static char const* GetBackendName(Backend backend);
+
+  // @returns the backend of a name as returned by GetBackendName().
+  static bool ParseBackend(std::string const& name, Backend& backend);
+
+private:
+  BrickIoReplayer(BrickIoReplayer const&);
+  BrickIoReplayer& operator=(BrickIoReplayer const&);
+
+  // @returns the size of a read buffer.
+  uint64_t GetBufferBytes(Config const& config) const;
+
+  // Computes the reads of a subframe and adds them to the counters.
+  void GetReads(Config const& config, size_t frame, size_t subframe, BrickReadPlanner& planner,
+    std::vector<BrickReadPlanner::Read>& reads, Result& result) const;
+
+  bool RunThreads(Config const& config, Result& result) const;
+  bool RunUring(Config const& config, Result& result) const;
+
+  BrickAccessTrace const& m_Trace;
+  BrickVolumeStore const& m_Store;
+  std::string m_VolumeFilename;
+};
+
+#endif // BRICK_IO_REPLAYER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
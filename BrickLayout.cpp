@@ -0,0 +1,386 @@
+#include "BrickLayout.h"
+
+#include <algorithm>
+#include <limits>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  typedef BrickLayout::Key Key;
+  typedef BrickLayout::Level Level;
+
+  // @returns false if a * b overflows, the product is stored in result.
+  bool Multiply(uint64_t a, uint64_t b, uint64_t& result)
+  {
+    if (a != 0 && b > std::numeric_limits<uint64_t>::max() / a)
+      return false;
+    result = a * b;
+    return true;
+  }
+
+  // @returns the number of bits needed for the indices [0, count).
+  uint32_t GetBits(uint64_t count)
+  {
+    uint32_t bits = 0;
+    while (bits < 64 && (uint64_t(1) << bits) < count)
+      ++bits;
+    return bits;
+  }
+
+  // Scatters the low bits of value to the set bits of mask.
+  inline uint64_t Deposit(uint64_t value, uint64_t mask)
+  {
+#ifdef __BMI2__
+    return _pdep_u64(value, mask);
+#else
+    uint64_t result = 0;
+    for (; mask != 0; value >>= 1) {
+      result |= mask & (0 - mask) & (0 - (value & 1));
+      mask &= mask - 1;
+    }
+    return result;
+#endif
+  }
+
+  // Gathers the bits of value at the set bits of mask into the low bits.
+  inline uint64_t Extract(uint64_t value, uint64_t mask)
+  {
+#ifdef __BMI2__
+    return _pext_u64(value, mask);
+#else
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask != 0; bit += bit) {
+      result |= bit & (0 - uint64_t((value & mask & (0 - mask)) != 0));
+      mask &= mask - 1;
+    }
+    return result;
+#endif
+  }
+
+  struct RowMajorCode {
+    static uint64_t Encode(Level const& level, uint64_t x, uint64_t y, uint64_t z)
+    {
+      return x + level.brickCount.x * (y + level.brickCount.y * z);
+    }
+
+    static void Decode(Level const& level, uint64_t index, BrickAccessFile::Brick& brick)
+    {
+      brick.x = index % level.brickCount.x;
+      index /= level.brickCount.x;
+      brick.y = index % level.brickCount.y;
+      brick.z = index / level.brickCount.y;
+    }
+  };
+
+  struct MortonCode {
+    static uint64_t Encode(Level const& level, uint64_t x, uint64_t y, uint64_t z)
+    {
+      return Deposit(x, level.masks[0]) | Deposit(y, level.masks[1]) | Deposit(z, level.masks[2]);
+    }
+
+    static void Decode(Level const& level, uint64_t index, BrickAccessFile::Brick& brick)
+    {
+      brick.x = Extract(index, level.masks[0]);
+      brick.y = Extract(index, level.masks[1]);
+      brick.z = Extract(index, level.masks[2]);
+    }
+  };
+
+  // 3D Hilbert curve after John Skilling, "Programming the Hilbert curve",
+  // AIP Conference Proceedings 707, 2004. The transposed index stores the
+  // bits of the curve position distributed over the three axes.
+  struct HilbertCode {
+    // Exchanges the low bits P of X[0] and Xi if bit Q of Xi is clear,
+    // inverts the low bits of X[0] otherwise.
+    static void Step(uint64_t& X0, uint64_t& Xi, uint64_t Q, uint64_t P)
+    {
+      uint64_t const set = 0 - uint64_t((Xi & Q) != 0);
+      uint64_t const t = (X0 ^ Xi) & P & ~set;
+      X0 ^= (P & set) ^ t;
+      Xi ^= t;
+    }
+
+    static uint64_t Encode(Level const& level, uint64_t x, uint64_t y, uint64_t z)
+    {
+      if (level.cubeBits == 0)
+        return 0;
+      uint64_t X[3] = { x, y, z };
+      uint64_t const M = uint64_t(1) << (level.cubeBits - 1);
+      // inverse undo
+      for (uint64_t Q = M; Q > 1; Q >>= 1) {
+        uint64_t const P = Q - 1;
+        for (int i=0; i<3; ++i)
+          Step(X[0], X[i], Q, P);
+      }
+      // gray encode
+      X[1] ^= X[0];
+      X[2] ^= X[1];
+      uint64_t t = 0;
+      for (uint64_t Q = M; Q > 1; Q >>= 1) {
+        if (X[2] & Q)
+          t ^= Q - 1;
+      }
+      X[0] ^= t;
+      X[1] ^= t;
+      X[2] ^= t;
+      return Deposit(X[0], level.masks[0]) | Deposit(X[1], level.masks[1]) | Deposit(X[2], level.masks[2]);
+    }
+
+    static void Decode(Level const& level, uint64_t index, BrickAccessFile::Brick& brick)
+    {
+      uint64_t X[3] = {
+        Extract(index, level.masks[0]),
+        Extract(index, level.masks[1]),
+        Extract(index, level.masks[2])
+      };
+      if (level.cubeBits > 0) {
+        uint64_t const N = uint64_t(2) << (level.cubeBits - 1);
+        // gray decode
+        uint64_t t = X[2] >> 1;
+        X[2] ^= X[1];
+        X[1] ^= X[0];
+        X[0] ^= t;
+        // undo excess work
+        for (uint64_t Q = 2; Q != N; Q <<= 1) {
+          uint64_t const P = Q - 1;
+          for (int i=2; i>=0; --i)
+            Step(X[0], X[i], Q, P);
+        }
+      }
+      brick.x = X[0];
+      brick.y = X[1];
+      brick.z = X[2];
+    }
+  };
+
+  template<class Code>
+  void EncodeBricks(std::vector<Level> const& levels,
+    BrickAccessFile::Brick const* bricks, size_t count, Key* keys)
+  {
+    for (size_t i=0; i<count; ++i) {
+      Level const& level = levels[size_t(bricks[i].w)];
+      keys[i] = level.offset + Code::Encode(level, bricks[i].x, bricks[i].y, bricks[i].z);
+    }
+  }
+
+  template<class Code>
+  void DecodeKeys(BrickLayout const& layout, std::vector<Level> const& levels,
+    Key const* keys, size_t count, BrickAccessFile::Brick* bricks)
+  {
+    // consecutive keys mostly share their LoD
+    uint32_t lod = 0;
+    uint64_t begin = 1;
+    uint64_t end = 0;
+    for (size_t i=0; i<count; ++i) {
+      if (keys[i] < begin || keys[i] >= end) {
+        lod = layout.GetLoD(keys[i]);
+        begin = layout.GetLoDOffset(lod);
+        end = layout.GetLoDOffset(lod + 1);
+      }
+      Code::Decode(levels[lod], keys[i] - begin, bricks[i]);
+      bricks[i].w = lod;
+    }
+  }
+
+  // @returns the voxels of the brick with the given index along one axis
+  //   without overlap.
+  uint64_t GetCoreVoxels(uint64_t index, uint64_t coreSize, uint64_t domainSize)
+  {
+    uint64_t const start = index * coreSize;
+    return start < domainSize ? std::min(coreSize, domainSize - start) : 0;
+  }
+
+}
+
+BrickAccessFile::Vec3<uint64_t> BrickLayout::GetCoreBrickSize(BrickAccessFile::Header const& header)
+{
+  BrickAccessFile::Vec3<uint32_t> const& maxBrickSize = header.maxBrickSize;
+  BrickAccessFile::Vec3<uint32_t> const& overlap = header.brickOverlap;
+  BrickAccessFile::Vec3<uint64_t> coreSize;
+  coreSize.x = maxBrickSize.x > 2 * overlap.x ? maxBrickSize.x - 2 * overlap.x : 0;
+  coreSize.y = maxBrickSize.y > 2 * overlap.y ? maxBrickSize.y - 2 * overlap.y : 0;
+  coreSize.z = maxBrickSize.z > 2 * overlap.z ? maxBrickSize.z - 2 * overlap.z : 0;
+  return coreSize;
+}
+
+BrickAccessFile::Vec3<uint64_t> BrickLayout::GetCoreExtent(BrickAccessFile::Vec3<uint64_t> const& coreBrickSize,
+  BrickAccessFile::Vec3<uint64_t> const& domainSize, BrickAccessFile::Brick const& brick)
+{
+  BrickAccessFile::Vec3<uint64_t> extent;
+  extent.x = GetCoreVoxels(brick.x, coreBrickSize.x, domainSize.x);
+  extent.y = GetCoreVoxels(brick.y, coreBrickSize.y, domainSize.y);
+  extent.z = GetCoreVoxels(brick.z, coreBrickSize.z, domainSize.z);
+  return extent;
+}
+
+BrickLayout::BrickLayout()
+  : m_Offsets(1, 0)
+  , m_Order(BrickAccessFile::KO_ROW_MAJOR)
+  , m_bValid(true)
+{}
+
+BrickLayout::BrickLayout(std::vector<BrickAccessFile::Vec3<uint64_t> > const& brickCounts,
+  BrickAccessFile::KeyOrder order)
+  : m_Levels(brickCounts.size())
+  , m_Offsets(1, 0)
+  , m_Order(order)
+  , m_bValid(true)
+{
+  m_Offsets.reserve(brickCounts.size() + 1);
+  for (size_t i=0; i<brickCounts.size(); ++i) {
+    Level& level = m_Levels[i];
+    level.brickCount = brickCounts[i];
+    level.offset = m_Offsets.back();
+    level.masks[0] = level.masks[1] = level.masks[2] = 0;
+
+    uint32_t bits[3] = {
+      GetBits(brickCounts[i].x),
+      GetBits(brickCounts[i].y),
+      GetBits(brickCounts[i].z)
+    };
+    level.cubeBits = std::max(std::max(bits[0], bits[1]), bits[2]);
+    if (order == BrickAccessFile::KO_HILBERT)
+      bits[0] = bits[1] = bits[2] = level.cubeBits;
+
+    // Hilbert codes put x into the most significant bit of every triple
+    uint32_t bitCount = 0;
+    for (uint32_t b=0; b<level.cubeBits; ++b) {
+      for (int axis=0; axis<3; ++axis) {
+        int const a = (order == BrickAccessFile::KO_HILBERT) ? 2 - axis : axis;
+        if (b < bits[a] && bitCount < 64)
+          level.masks[a] |= uint64_t(1) << bitCount;
+        bitCount += (b < bits[a]) ? 1 : 0;
+      }
+    }
+
+    uint64_t count = 0;
+    if (order == BrickAccessFile::KO_ROW_MAJOR) {
+      m_bValid = m_bValid &&
+        Multiply(brickCounts[i].x, brickCounts[i].y, count) &&
+        Multiply(count, brickCounts[i].z, count);
+    } else if (brickCounts[i].x == 0 || brickCounts[i].y == 0 || brickCounts[i].z == 0) {
+      count = 0;
+    } else {
+      m_bValid = m_bValid && bitCount < 64;
+      count = m_bValid ? uint64_t(1) << bitCount : 0;
+    }
+    m_bValid = m_bValid && count <= std::numeric_limits<uint64_t>::max() - m_Offsets.back();
+    m_Offsets.push_back(m_bValid ? m_Offsets.back() + count : m_Offsets.back());
+  }
+}
+
+bool BrickLayout::IsValid() const
+{
+  return m_bValid;
+}
+
+BrickAccessFile::KeyOrder BrickLayout::GetOrder() const
+{
+  return m_Order;
+}
+
+bool BrickLayout::HasSameKeys(BrickLayout const& other) const
+{
+  if (m_Order != other.m_Order || m_Levels.size() != other.m_Levels.size())
+    return false;
+  for (size_t lod=0; lod<m_Levels.size(); ++lod) {
+    BrickAccessFile::Vec3<uint64_t> const& a = m_Levels[lod].brickCount;
+    BrickAccessFile::Vec3<uint64_t> const& b = other.m_Levels[lod].brickCount;
+    if (a.x != b.x || a.y != b.y || a.z != b.z)
+      return false;
+  }
+  return true;
+}
+
+size_t BrickLayout::GetLoDCount() const
+{
+  return m_Levels.size();
+}
+
+uint64_t BrickLayout::GetKeyCount() const
+{
+  return m_Offsets.back();
+}
+
+uint64_t BrickLayout::GetLoDOffset(size_t lod) const
+{
+  return m_Offsets[lod];
+}
+
+BrickLayout::Key BrickLayout::GetKey(BrickAccessFile::Brick const& brick) const
+{
+  Key key;
+  GetKeys(&brick, 1, &key);
+  return key;
+}
+
+uint32_t BrickLayout::GetLoD(Key key) const
+{
+  // empty LoDs share their offset with the next one, skip them
+  std::vector<uint64_t>::const_iterator it = std::upper_bound(m_Offsets.begin(), m_Offsets.end(), key);
+  return uint32_t(it - m_Offsets.begin() - 1);
+}
+
+BrickAccessFile::Brick BrickLayout::GetBrick(Key key) const
+{
+  BrickAccessFile::Brick brick;
+  GetBricks(&key, 1, &brick);
+  return brick;
+}
+
+void BrickLayout::GetKeys(BrickAccessFile::Brick const* bricks, size_t count, Key* keys) const
+{
+  switch (m_Order) {
+  case BrickAccessFile::KO_MORTON :
+    EncodeBricks<MortonCode>(m_Levels, bricks, count, keys);
+    break;
+  case BrickAccessFile::KO_HILBERT :
+    EncodeBricks<HilbertCode>(m_Levels, bricks, count, keys);
+    break;
+  default :
+    EncodeBricks<RowMajorCode>(m_Levels, bricks, count, keys);
+    break;
+  }
+}
+
+void BrickLayout::GetBricks(Key const* keys, size_t count, BrickAccessFile::Brick* bricks) const
+{
+  switch (m_Order) {
+  case BrickAccessFile::KO_MORTON :
+    DecodeKeys<MortonCode>(*this, m_Levels, keys, count, bricks);
+    break;
+  case BrickAccessFile::KO_HILBERT :
+    DecodeKeys<HilbertCode>(*this, m_Levels, keys, count, bricks);
+    break;
+  default :
+    DecodeKeys<RowMajorCode>(*this, m_Levels, keys, count, bricks);
+    break;
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef BRICK_LAYOUT_H
+#define BRICK_LAYOUT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+
+// Maps the bricks of all levels of detail to 64-bit keys. Every LoD occupies
+// a contiguous key range, starting with LoD 0, so keys are unique over the
+// whole dataset and can directly index per-brick tables. Within a LoD bricks
+// are numbered in one of three orders:
+//
+// KO_ROW_MAJOR: x varies fastest. Keys are dense, GetKeyCount() equals the
+//   number of bricks.
+// KO_MORTON: bits of x, y and z are interleaved (Z-order curve). Every axis
+//   is padded to a power of two, but axes run out of bits independently, so
+//   the key range of a LoD is less than eight times its brick count.
+// KO_HILBERT: position along a 3D Hilbert curve, which keeps neighboring keys
+//   spatially adjacent. The curve needs a cube, so the key range of a LoD is
+//   the cube of its largest brick count padded to a power of two.
+//
+// Morton and Hilbert codes use the BMI2 instructions pdep and pext if the
+// code is compiled for them (e.g. -mbmi2 or -march=native), a portable bit
+// loop otherwise.
+class BrickLayout {
+public:
+  typedef uint64_t Key;
+
+  // Creates an empty layout without any LoD.
+  BrickLayout();
+
+  // Creates the layout for the given per-LoD brick counts.
+  explicit BrickLayout(std::vector<BrickAccessFile::Vec3<uint64_t> > const& brickCounts,
+    BrickAccessFile::KeyOrder order = BrickAccessFile::KO_ROW_MAJOR);
+
+  // @returns the size of a brick without the overlap on both sides:
+  //   coreBrickSize = maxBrickSize - 2 * brickOverlap, zero on axes the
+  //   overlap fills completely.
+  static BrickAccessFile::Vec3<uint64_t> GetCoreBrickSize(BrickAccessFile::Header const& header);
+
+  // @returns the voxels of a brick without overlap along every axis. Bricks
+  //   at the far end of a LoD are cut off by its domain size.
+  static BrickAccessFile::Vec3<uint64_t> GetCoreExtent(BrickAccessFile::Vec3<uint64_t> const& coreBrickSize,
+    BrickAccessFile::Vec3<uint64_t> const& domainSize, BrickAccessFile::Brick const& brick);
+
+  // @returns false if the key range of all LoDs does not fit into 64 bits.
+  bool IsValid() const;
+
+  // @returns the order of bricks within a LoD.
+  BrickAccessFile::KeyOrder GetOrder() const;
+
+  // @returns true if both layouts map every brick to the same key, which
+  //   takes the same order and brick counts.
+  bool HasSameKeys(BrickLayout const& other) const;
+
+  // @returns the number of levels of detail.
+  size_t GetLoDCount() const;
+
+  // @returns the size of the key range over all levels of detail. This is
+  //   the total number of bricks for KO_ROW_MAJOR and larger for the curves.
+  uint64_t GetKeyCount() const;
+
+  // @returns the first key of the given level of detail. GetLoDOffset(
+  //   GetLoDCount()) equals GetKeyCount().
+  uint64_t GetLoDOffset(size_t lod) const;
+
+  // @returns the key of a brick, which has to be inside of the layout.
+  Key GetKey(BrickAccessFile::Brick const& brick) const;
+
+  // @returns the level of detail of a key.
+  uint32_t GetLoD(Key key) const;
+
+  // @returns the brick of a key, which has to be a key of an existing brick.
+  BrickAccessFile::Brick GetBrick(Key key) const;
+
+  // Batch versions of GetKey() and GetBrick() for whole subframes. The loops
+  // are specialized for the order, and decoding reuses the LoD of the
+  // previous key if possible.
+  void GetKeys(BrickAccessFile::Brick const* bricks, size_t count, Key* keys) const;
+  void GetBricks(Key const* keys, size_t count, BrickAccessFile::Brick* bricks) const;
+
+  // Per-LoD parameters of the key computation.
+  struct Level {
+    BrickAccessFile::Vec3<uint64_t> brickCount;
+    uint64_t offset;
+    // bit positions of x, y and z within a Morton or Hilbert code
+    uint64_t masks[3];
+    // bits per axis of the Hilbert cube
+    uint32_t cubeBits;
+  };
+
+private:
+  std::vector<Level> m_Levels;
+  std::vector<uint64_t> m_Offsets;
+  BrickAccessFile::KeyOrder m_Order;
+  bool m_bValid;
+};
+
+#endif // BRICK_LAYOUT_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
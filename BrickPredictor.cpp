@@ -0,0 +1,348 @@
+#include "BrickPredictor.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace {
+
+  typedef BrickPredictor::Key Key;
+  typedef std::vector<std::vector<Key> > KeyFrame;
+
+  Key const None = ~Key(0);
+
+  // Keeps the bricks of the last subframe.
+  class LastSubframe : public BrickPredictor {
+  public:
+    void Reset(BrickLayout const& layout, BrickAccessFile::Header const& header)
+    {
+      m_Layout = layout;
+      m_BrickCounts = header.brickCounts;
+      m_Keys.clear();
+    }
+
+    void Observe(size_t, size_t, BrickAccessTrace::Bricks keys)
+    {
+      m_Keys.assign(keys.begin(), keys.end());
+    }
+
+  protected:
+    bool IsInside(BrickAccessFile::Brick const& brick) const
+    {
+      BrickAccessFile::Vec3<uint64_t> const& counts = m_BrickCounts[size_t(brick.w)];
+      return brick.x < counts.x && brick.y < counts.y && brick.z < counts.z;
+    }
+
+    BrickLayout m_Layout;
+    std::vector<BrickAccessFile::Vec3<uint64_t> > m_BrickCounts;
+    std::vector<Key> m_Keys;
+    // reused conversion buffers
+    std::vector<BrickAccessFile::Brick> m_Bricks;
+    std::vector<BrickAccessFile::Brick> m_Candidates;
+  };
+
+  class NeighborPredictor : public LastSubframe {
+  public:
+    explicit NeighborPredictor(uint32_t radius)
+      : m_iRadius(std::max<uint32_t>(radius, 1))
+    {}
+
+    void Predict(size_t, size_t, std::vector<Key>& keys)
+    {
+      m_Bricks.resize(m_Keys.size());
+      m_Layout.GetBricks(m_Keys.data(), m_Keys.size(), m_Bricks.data());
+      m_Candidates.clear();
+      // closer neighbors first, bricks left of zero wrap around and are
+      // dropped by IsInside()
+      for (uint64_t d=1; d<=m_iRadius; ++d) {
+        for (size_t i=0; i<m_Bricks.size(); ++i) {
+          BrickAccessFile::Brick const& brick = m_Bricks[i];
+          for (int axis=0; axis<3; ++axis) {
+            for (int sign=-1; sign<=1; sign+=2) {
+              BrickAccessFile::Brick neighbor = brick;
+              uint64_t& coordinate = axis == 0 ? neighbor.x : (axis == 1 ? neighbor.y : neighbor.z);
+              coordinate += sign > 0 ? d : uint64_t(0) - d;
+              if (IsInside(neighbor))
+                m_Candidates.push_back(neighbor);
+            }
+          }
+        }
+      }
+      size_t const offset = keys.size();
+      keys.resize(offset + m_Candidates.size());
+      m_Layout.GetKeys(m_Candidates.data(), m_Candidates.size(), keys.data() + offset);
+    }
+
+  private:
+    uint64_t m_iRadius;
+  };
+
+  class LoDPredictor : public LastSubframe {
+  public:
+    void Predict(size_t, size_t, std::vector<Key>& keys)
+    {
+      m_Bricks.resize(m_Keys.size());
+      m_Layout.GetBricks(m_Keys.data(), m_Keys.size(), m_Bricks.data());
+      m_Candidates.clear();
+      // LoD 0 is the finest, a brick covers 2^3 bricks of the next finer LoD
+      for (size_t i=0; i<m_Bricks.size(); ++i) {
+        BrickAccessFile::Brick const& brick = m_Bricks[i];
+        if (brick.w == 0)
+          continue;
+        for (uint64_t c=0; c<8; ++c) {
+          BrickAccessFile::Brick child;
+          child.x = 2 * brick.x + (c & 1);
+          child.y = 2 * brick.y + ((c >> 1) & 1);
+          child.z = 2 * brick.z + (c >> 2);
+          child.w = brick.w - 1;
+          if (IsInside(child))
+            m_Candidates.push_back(child);
+        }
+      }
+      for (size_t i=0; i<m_Bricks.size(); ++i) {
+        BrickAccessFile::Brick const& brick = m_Bricks[i];
+        if (brick.w + 1 >= m_BrickCounts.size())
+          continue;
+        // the last parent is clamped for domains which are not a power of two
+        BrickAccessFile::Vec3<uint64_t> const& counts = m_BrickCounts[size_t(brick.w + 1)];
+        BrickAccessFile::Brick parent;
+        parent.x = std::min<uint64_t>(brick.x / 2, counts.x - 1);
+        parent.y = std::min<uint64_t>(brick.y / 2, counts.y - 1);
+        parent.z = std::min<uint64_t>(brick.z / 2, counts.z - 1);
+        parent.w = brick.w + 1;
+        m_Candidates.push_back(parent);
+      }
+      size_t const offset = keys.size();
+      keys.resize(offset + m_Candidates.size());
+      m_Layout.GetKeys(m_Candidates.data(), m_Candidates.size(), keys.data() + offset);
+    }
+  };
+
+  // Keeps the subframes of the last complete frames, the newest one first.
+  class FrameHistory : public BrickPredictor {
+  public:
+    explicit FrameHistory(uint32_t history)
+      : m_iHistory(std::max<uint32_t>(history, 1))
+      , m_iFrame(~size_t(0))
+    {}
+
+    void Reset(BrickLayout const& layout, BrickAccessFile::Header const&)
+    {
+      m_iKeyCount = size_t(layout.GetKeyCount());
+      m_Frames.clear();
+      m_Current.clear();
+      m_iFrame = ~size_t(0);
+    }
+
+    void Observe(size_t frame, size_t subframe, BrickAccessTrace::Bricks keys)
+    {
+      BeginFrame(frame);
+      if (m_Current.size() <= subframe)
+        m_Current.resize(subframe + 1);
+      m_Current[subframe].assign(keys.begin(), keys.end());
+    }
+
+  protected:
+    // Moves the current frame into the history once the next one starts.
+    void BeginFrame(size_t frame)
+    {
+      if (frame == m_iFrame)
+        return;
+      if (m_iFrame != ~size_t(0)) {
+        m_Frames.push_front(KeyFrame());
+        m_Frames.front().swap(m_Current);
+        if (m_Frames.size() > m_iHistory) {
+          // reuse the oldest frame's buffers for the next one
+          m_Current.swap(m_Frames.back());
+          m_Frames.pop_back();
+        }
+        for (size_t s=0; s<m_Current.size(); ++s)
+          m_Current[s].clear();
+      }
+      m_iFrame = frame;
+    }
+
+    size_t m_iHistory;
+    size_t m_iKeyCount;
+    std::deque<KeyFrame> m_Frames;
+    KeyFrame m_Current;
+    size_t m_iFrame;
+  };
+
+  class PreviousFramePredictor : public FrameHistory {
+  public:
+    PreviousFramePredictor()
+      : FrameHistory(1)
+    {}
+
+    void Predict(size_t frame, size_t subframe, std::vector<Key>& keys)
+    {
+      BeginFrame(frame);
+      if (m_Frames.empty() || m_Frames.front().size() <= subframe)
+        return;
+      std::vector<Key> const& previous = m_Frames.front()[subframe];
+      keys.insert(keys.end(), previous.begin(), previous.end());
+    }
+  };
+
+  class FrequencyPredictor : public FrameHistory {
+  public:
+    explicit FrequencyPredictor(uint32_t history)
+      : FrameHistory(history)
+    {}
+
+    void Reset(BrickLayout const& layout, BrickAccessFile::Header const& header)
+    {
+      FrameHistory::Reset(layout, header);
+      m_Counts.assign(m_iKeyCount, 0);
+    }
+
+    void Predict(size_t frame, size_t subframe, std::vector<Key>& keys)
+    {
+      BeginFrame(frame);
+      // newer frames are counted first, so the stable sort keeps the most
+      // recent bricks in front among equal counts
+      m_Touched.clear();
+      for (size_t f=0; f<m_Frames.size(); ++f) {
+        if (m_Frames[f].size() <= subframe)
+          continue;
+        std::vector<Key> const& bricks = m_Frames[f][subframe];
+        for (size_t i=0; i<bricks.size(); ++i) {
+          if (m_Counts[size_t(bricks[i])]++ == 0)
+            m_Touched.push_back(bricks[i]);
+        }
+      }
+      std::vector<uint32_t> const& counts = m_Counts;
+      std::stable_sort(m_Touched.begin(), m_Touched.end(), [&counts](Key a, Key b) {
+        return counts[size_t(a)] > counts[size_t(b)];
+      });
+      keys.insert(keys.end(), m_Touched.begin(), m_Touched.end());
+      for (size_t i=0; i<m_Touched.size(); ++i)
+        m_Counts[size_t(m_Touched[i])] = 0;
+    }
+
+  private:
+    std::vector<uint32_t> m_Counts;
+    std::vector<Key> m_Touched;
+  };
+
+  class MarkovPredictor : public BrickPredictor {
+  public:
+    explicit MarkovPredictor(uint32_t width)
+      : m_iWidth(std::max<uint32_t>(width, 1))
+      , m_iLast(None)
+    {}
+
+    void Reset(BrickLayout const& layout, BrickAccessFile::Header const&)
+    {
+      m_Successors.assign(size_t(layout.GetKeyCount()) * m_iWidth, None);
+      m_Keys.clear();
+      m_iLast = None;
+    }
+
+    void Predict(size_t, size_t, std::vector<Key>& keys)
+    {
+      // the most recent successors of all bricks first
+      for (size_t rank=0; rank<m_iWidth; ++rank) {
+        for (size_t i=0; i<m_Keys.size(); ++i) {
+          Key const successor = m_Successors[size_t(m_Keys[i]) * m_iWidth + rank];
+          if (successor != None)
+            keys.push_back(successor);
+        }
+      }
+    }
+
+    void Observe(size_t, size_t, BrickAccessTrace::Bricks keys)
+    {
+      m_Keys.assign(keys.begin(), keys.end());
+      for (size_t i=0; i<keys.size(); ++i) {
+        Key const key = keys[i];
+        if (m_iLast != None && m_iLast != key) {
+          // move to front, the least recent successor drops out
+          Key* const successors = &m_Successors[size_t(m_iLast) * m_iWidth];
+          size_t position = 0;
+          while (position + 1 < m_iWidth && successors[position] != key)
+            ++position;
+          std::copy_backward(successors, successors + position, successors + position + 1);
+          successors[0] = key;
+        }
+        m_iLast = key;
+      }
+    }
+
+  private:
+    size_t m_iWidth;
+    Key m_iLast;
+    // the last distinct successors of every key, the most recent first
+    std::vector<Key> m_Successors;
+    std::vector<Key> m_Keys;
+  };
+
+}
+
+BrickPredictor::Config BrickPredictor::GetDefaultConfig(Type type)
+{
+  Config config;
+  config.type = type;
+  config.radius = 1;
+  config.history = 4;
+  config.width = 2;
+  return config;
+}
+
+std::unique_ptr<BrickPredictor> BrickPredictor::Create(Config const& config)
+{
+  switch (config.type) {
+  case PT_LOD : return std::unique_ptr<BrickPredictor>(new LoDPredictor());
+  case PT_PREVIOUS_FRAME : return std::unique_ptr<BrickPredictor>(new PreviousFramePredictor());
+  case PT_FREQUENCY : return std::unique_ptr<BrickPredictor>(new FrequencyPredictor(config.history));
+  case PT_MARKOV : return std::unique_ptr<BrickPredictor>(new MarkovPredictor(config.width));
+  default : return std::unique_ptr<BrickPredictor>(new NeighborPredictor(config.radius));
+  }
+}
+
+char const* BrickPredictor::GetTypeName(Type type)
+{
+  switch (type) {
+  case PT_NEIGHBORS : return "neighbors";
+  case PT_LOD : return "lod";
+  case PT_PREVIOUS_FRAME : return "previous-frame";
+  case PT_FREQUENCY : return "frequency";
+  case PT_MARKOV : return "markov";
+  default : return "unknown";
+  }
+}
+
+bool BrickPredictor::ParseType(std::string const& name, Type& type)
+{
+  for (int i=0; i<PT_COUNT; ++i) {
+    if (name == GetTypeName(Type(i))) {
+      type = Type(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef BRICK_PREDICTOR_H
+#define BRICK_PREDICTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+#include "BrickLayout.h"
+
+// Predicts the bricks of the next subframe from the subframes seen so far, so
+// a renderer can load them ahead of time. BrickPrefetchEvaluator feeds a trace
+// to a predictor one subframe after another: Predict() for the upcoming
+// subframe, then Observe() with the bricks it actually requested.
+//
+// Derive from this class to evaluate other strategies, Create() returns the
+// built-in ones:
+//  - PT_NEIGHBORS: the bricks within `radius` steps along an axis of the
+//    bricks of the last subframe, on the same LoD.
+//  - PT_LOD: the children and the parent of the bricks of the last subframe,
+//    children first as subframes usually refine from coarse to fine.
+//  - PT_PREVIOUS_FRAME: the bricks of the same subframe of the previous
+//    frame, in their order.
+//  - PT_FREQUENCY: the bricks of the same subframe of the last `history`
+//    frames, the most often requested ones first.
+//  - PT_MARKOV: a first order Markov model of the request stream, which
+//    remembers the last `width` distinct successors of every brick and
+//    predicts those of the bricks of the last subframe.
+class BrickPredictor {
+public:
+  typedef BrickLayout::Key Key;
+
+  enum Type {
+    PT_NEIGHBORS = 0,
+    PT_LOD,
+    PT_PREVIOUS_FRAME,
+    PT_FREQUENCY,
+    PT_MARKOV,
+    PT_COUNT
+  };
+
+  // A built-in predictor and its parameters, unused ones are ignored.
+  struct Config {
+    Type type;
+    uint32_t radius;
+    uint32_t history;
+    uint32_t width;
+  };
+
+  // @returns the config of a built-in predictor with default parameters.
+  static Config GetDefaultConfig(Type type);
+
+  // @returns a new built-in predictor.
+  static std::unique_ptr<BrickPredictor> Create(Config const& config);
+
+  // @returns the lower case name of a predictor, e.g. "markov".
+  static char const* GetTypeName(Type type);
+
+  // @returns the predictor of a name as returned by GetTypeName().
+  static bool ParseType(std::string const& name, Type& type);
+
+  virtual ~BrickPredictor() {}
+
+  // Forgets everything and starts a trace with the given layout and header.
+  virtual void Reset(BrickLayout const& layout, BrickAccessFile::Header const& header) = 0;
+
+  // Appends the predicted bricks of the given subframe to keys, the most
+  // likely ones first. Keys may repeat, only the first one counts.
+  virtual void Predict(size_t frame, size_t subframe, std::vector<Key>& keys) = 0;
+
+  // Passes the bricks the given subframe requested, right after Predict().
+  virtual void Observe(size_t frame, size_t subframe, BrickAccessTrace::Bricks keys) = 0;
+};
+
+#endif // BRICK_PREDICTOR_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
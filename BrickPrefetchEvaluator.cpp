@@ -0,0 +1,193 @@
+#include "BrickPrefetchEvaluator.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "BrickCache.h"
+#include "BrickLayout.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  typedef BrickAccessTrace::Key Key;
+  using BrickCache::LRUCache;
+  using BrickCache::None;
+
+  BrickPrefetchEvaluator::Stats const Empty = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+  void AddStats(BrickPrefetchEvaluator::Stats& target, BrickPrefetchEvaluator::Stats const& source)
+  {
+    target.requests += source.requests;
+    target.newBricks += source.newBricks;
+    target.candidates += source.candidates;
+    target.correct += source.correct;
+    target.prefetches += source.prefetches;
+    target.useful += source.useful;
+    target.newMisses += source.newMisses;
+    target.capacityMisses += source.capacityMisses;
+    target.wastedBytes += source.wastedBytes;
+  }
+
+}
+
+double BrickPrefetchEvaluator::Stats::GetPrecision() const
+{
+  return candidates > 0 ? double(correct) / double(candidates) : 1.0;
+}
+
+double BrickPrefetchEvaluator::Stats::GetRecall() const
+{
+  return newBricks > 0 ? double(correct) / double(newBricks) : 1.0;
+}
+
+double BrickPrefetchEvaluator::Stats::GetHiddenRatio() const
+{
+  return newBricks > 0 ? double(useful) / double(newBricks) : 1.0;
+}
+
+BrickPrefetchEvaluator::BrickPrefetchEvaluator(BrickAccessFile const& file, uint32_t bytesPerVoxel)
+  : m_Trace(BrickAccessTrace::FromFile(file, m_OwnTrace))
+  , m_Header(file.GetHeader())
+  , m_iBrickBytes(uint64_t(bytesPerVoxel) * file.GetMaxBrickSize().x *
+    file.GetMaxBrickSize().y * file.GetMaxBrickSize().z)
+{}
+
+BrickPrefetchEvaluator::BrickPrefetchEvaluator(BrickAccessTrace const& trace,
+  BrickAccessFile::Header const& header, uint32_t bytesPerVoxel)
+  : m_Trace(trace)
+  , m_Header(header)
+  , m_iBrickBytes(uint64_t(bytesPerVoxel) * header.maxBrickSize.x * header.maxBrickSize.y *
+    header.maxBrickSize.z)
+{}
+
+uint64_t BrickPrefetchEvaluator::GetBrickBytes() const
+{
+  return m_iBrickBytes;
+}
+
+void BrickPrefetchEvaluator::Run(Config const& config, Result& result) const
+{
+  std::unique_ptr<BrickPredictor> pPredictor = BrickPredictor::Create(config.predictor);
+  Run(*pPredictor, config, result);
+}
+
+void BrickPrefetchEvaluator::Run(BrickPredictor& predictor, Config const& config, Result& result) const
+{
+  std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+  BrickLayout const& layout = m_Trace.GetLayout();
+  uint64_t const keyCount = layout.GetKeyCount();
+  // more slots than bricks are never used
+  size_t const capacity = size_t(std::min<uint64_t>(std::min(config.capacity, keyCount), None - 1));
+  uint64_t const ioBudget = config.ioBudget > 0 ? config.ioBudget : ~uint64_t(0);
+
+  result.config = config;
+  result.frames.assign(m_Trace.GetFrameCount(), Empty);
+  result.total = Empty;
+  predictor.Reset(layout, m_Header);
+
+  LRUCache cache(keyCount, capacity);
+  // the subframe in which a key was last predicted, requested or new, zero
+  // is never
+  std::vector<uint64_t> predicted(size_t(keyCount), 0);
+  std::vector<uint64_t> requested(size_t(keyCount), 0);
+  std::vector<uint64_t> fresh(size_t(keyCount), 0);
+  std::vector<Key> keys;
+  std::vector<Key> candidates;
+  uint64_t stamp = 0;
+  for (size_t f=0; f<m_Trace.GetFrameCount(); ++f) {
+    Stats& stats = result.frames[f];
+    for (size_t s=0; s<m_Trace.GetSubframeCount(f); ++s) {
+      BrickAccessTrace::Bricks const bricks = m_Trace.GetSubframe(f, s);
+      ++stamp;
+
+      // the distinct predicted bricks which are not resident
+      keys.clear();
+      predictor.Predict(f, s, keys);
+      candidates.clear();
+      for (size_t i=0; i<keys.size(); ++i) {
+        Key const key = keys[i];
+        if (key >= keyCount || predicted[size_t(key)] == stamp)
+          continue;
+        predicted[size_t(key)] = stamp;
+        if (!cache.Contains(key))
+          candidates.push_back(key);
+      }
+      stats.candidates += candidates.size();
+
+      // score the prediction before prefetching changes the cache
+      for (size_t i=0; i<bricks.size(); ++i) {
+        Key const key = bricks[i];
+        if (requested[size_t(key)] == stamp)
+          continue;
+        requested[size_t(key)] = stamp;
+        if (!cache.Contains(key)) {
+          fresh[size_t(key)] = stamp;
+          ++stats.newBricks;
+          stats.correct += predicted[size_t(key)] == stamp ? 1 : 0;
+        }
+      }
+
+      // prefetch within the budget, then load the rest on demand
+      size_t const prefetchCount = size_t(std::min<uint64_t>(candidates.size(), ioBudget));
+      for (size_t i=0; i<prefetchCount; ++i)
+        cache.Access(candidates[i]);
+      uint64_t useful = 0;
+      for (size_t i=0; i<bricks.size(); ++i) {
+        Key const key = bricks[i];
+        bool const bHit = cache.Access(key);
+        if (fresh[size_t(key)] == stamp) {
+          // the first request of a new brick only hits if it was prefetched
+          // and demand loads did not evict it again
+          fresh[size_t(key)] = 0;
+          useful += bHit ? 1 : 0;
+          stats.newMisses += bHit ? 0 : 1;
+        } else if (!bHit) {
+          ++stats.capacityMisses;
+        }
+      }
+      stats.prefetches += prefetchCount;
+      stats.useful += useful;
+      stats.wastedBytes += (prefetchCount - useful) * m_iBrickBytes;
+      stats.requests += bricks.size();
+
+      predictor.Observe(f, s, bricks);
+    }
+    AddStats(result.total, stats);
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BrickPrefetchEvaluator::Run(std::vector<Config> const& configs, std::vector<Result>& results,
+  size_t threadCount) const
+{
+  results.resize(configs.size());
+  ThreadPool pool(std::min(threadCount > 0 ? threadCount : ThreadPool::GetHardwareThreadCount(),
+    std::max<size_t>(configs.size(), 1)));
+  pool.ParallelFor(configs.size(), [this, &configs, &results](size_t i) {
+    Run(configs[i], results[i]);
+  });
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,145 @@
+#pragma once
+
+#ifndef BRICK_PREFETCH_EVALUATOR_H
+#define BRICK_PREFETCH_EVALUATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+#include "BrickPredictor.h"
+
+// Scores brick predictors, see BrickPredictor, by replaying a trace through
+// an LRU brick cache with prefetching. Before every subframe the predictor
+// names the bricks it expects; those which are not resident are candidates,
+// and the first `ioBudget` of them are loaded into the cache in the time the
+// previous subframe renders. Then the subframe requests its bricks, and every
+// brick that is still missing is loaded on demand.
+//
+// Prediction quality is measured on the new bricks of a subframe, those
+// which were not resident when it started. Bricks which were resident but got
+// evicted by the subframe's own loads are capacity misses, no predictor can
+// avoid them, so they are counted separately.
+//
+// Metrics per frame and for the whole trace:
+//  - precision: share of the candidates which were new bricks.
+//  - recall: share of the new bricks the candidates contained.
+//  - wasted bandwidth: bytes of prefetched bricks the subframe did not use.
+//  - hidden latency: share of the new bricks which were prefetched and still
+//    resident when requested, so the renderer did not wait for them.
+//
+// Precision and recall judge the whole prediction, while the budget only
+// limits what is loaded: a long prediction may reach a high recall and still
+// waste little bandwidth if its best candidates come first.
+class BrickPrefetchEvaluator {
+public:
+  // A predictor and the simulated system.
+  struct Config {
+    BrickPredictor::Config predictor;
+    // capacity of the brick cache in bricks
+    uint64_t capacity;
+    // bricks prefetched per subframe, zero loads all candidates
+    uint64_t ioBudget;
+  };
+
+  // Counters of a frame or of the whole trace, bricks are counted once per
+  // subframe.
+  struct Stats {
+    // brick requests including repeats within a subframe
+    uint64_t requests;
+    // requested bricks which were not resident before prefetching
+    uint64_t newBricks;
+    // predicted bricks which were not resident
+    uint64_t candidates;
+    // candidates the subframe requested
+    uint64_t correct;
+    // prefetched bricks, and the new bricks among them which were still
+    // resident at their first request
+    uint64_t prefetches;
+    uint64_t useful;
+    // new bricks loaded on demand, useful + newMisses equals newBricks
+    uint64_t newMisses;
+    // all other misses: repeated requests and bricks which were resident
+    // when the subframe started
+    uint64_t capacityMisses;
+    // bytes of prefetched bricks the subframe did not use
+    uint64_t wastedBytes;
+
+    // @returns correct / candidates, one without candidates.
+    double GetPrecision() const;
+
+    // @returns correct / newBricks, one without new bricks.
+    double GetRecall() const;
+
+    // @returns useful / newBricks, one without new bricks.
+    double GetHiddenRatio() const;
+  };
+
+  // Results of one evaluation.
+  struct Result {
+    Config config;
+    Stats total;
+    std::vector<Stats> frames;
+    double seconds;
+  };
+
+  // Prepares the evaluation of a loaded file, see BrickAccessTrace::FromFile().
+  // @param bytesPerVoxel is the voxel size used for the wasted bandwidth, a
+  //   brick takes GetMaxBrickSize() voxels.
+  explicit BrickPrefetchEvaluator(BrickAccessFile const& file, uint32_t bytesPerVoxel = 1);
+
+  // Prepares the evaluation of a trace, which has to outlive the evaluator.
+  BrickPrefetchEvaluator(BrickAccessTrace const& trace, BrickAccessFile::Header const& header,
+    uint32_t bytesPerVoxel = 1);
+
+  // @returns the size of a brick in bytes.
+  uint64_t GetBrickBytes() const;
+
+  // Evaluates a built-in predictor.
+  void Run(Config const& config, Result& result) const;
+
+  // Evaluates any predictor, config.predictor is only copied to the result.
+  void Run(BrickPredictor& predictor, Config const& config, Result& result) const;
+
+  // Evaluates several built-in predictors or parameters at once.
+  // @param threadCount is the number of threads, one config is evaluated
+  //   per thread at a time. Zero uses all hardware threads.
+  void Run(std::vector<Config> const& configs, std::vector<Result>& results,
+    size_t threadCount = 0) const;
+
+private:
+  BrickPrefetchEvaluator(BrickPrefetchEvaluator const&);
+  BrickPrefetchEvaluator& operator=(BrickPrefetchEvaluator const&);
+
+  BrickAccessTrace m_OwnTrace;
+  BrickAccessTrace const& m_Trace;
+  BrickAccessFile::Header m_Header;
+  uint64_t m_iBrickBytes;
+};
+
+#endif // BRICK_PREFETCH_EVALUATOR_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,160 @@
+#include "BrickReadPlanner.h"
+
+#include <algorithm>
+
+namespace {
+
+  BrickReadPlanner::Stats const Empty = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+}
+
+void BrickReadPlanner::Stats::Add(Stats const& other)
+{
+  subframes += other.subframes;
+  requests += other.requests;
+  bricks += other.bricks;
+  reads += other.reads;
+  traceSeeks += other.traceSeeks;
+  plannedSeeks += other.plannedSeeks;
+  usefulBytes += other.usefulBytes;
+  readBytes += other.readBytes;
+}
+
+BrickReadPlanner::BrickReadPlanner(BrickVolumeStore const& store)
+  : m_Store(store)
+  , m_iGap(0)
+  , m_iMaxReadBytes(0)
+  , m_Stats(Empty)
+{}
+
+void BrickReadPlanner::SetGap(uint64_t bytes)
+{
+  m_iGap = bytes;
+}
+
+uint64_t BrickReadPlanner::GetGap() const
+{
+  return m_iGap;
+}
+
+void BrickReadPlanner::SetMaxReadBytes(uint64_t bytes)
+{
+  m_iMaxReadBytes = bytes;
+}
+
+uint64_t BrickReadPlanner::GetMaxReadBytes() const
+{
+  return m_iMaxReadBytes;
+}
+
+void BrickReadPlanner::Plan(Key const* keys, size_t count)
+{
+  m_Stats = Empty;
+  m_Stats.subframes = 1;
+  m_Stats.requests = count;
+
+  // seeks of the unplanned subframe
+  uint64_t end = 0;
+  for (size_t i=0; i<count; ++i) {
+    uint64_t const offset = m_Store.GetOffset(keys[i]);
+    if (i == 0 || offset != end)
+      ++m_Stats.traceSeeks;
+    end = offset + m_Store.GetStoredBytes(keys[i]);
+  }
+
+  // the store places bricks in key order, so sorting the keys sorts the
+  // bricks into disk order
+  m_Keys.assign(keys, keys + count);
+  std::sort(m_Keys.begin(), m_Keys.end());
+  m_Keys.erase(std::unique(m_Keys.begin(), m_Keys.end()), m_Keys.end());
+  m_Stats.bricks = m_Keys.size();
+
+  m_Reads.clear();
+  for (size_t i=0; i<m_Keys.size(); ++i) {
+    uint64_t const offset = m_Store.GetOffset(m_Keys[i]);
+    uint64_t const size = m_Store.GetStoredBytes(m_Keys[i]);
+    m_Stats.usefulBytes += size;
+    if (!m_Reads.empty()) {
+      Read& read = m_Reads.back();
+      uint64_t const readEnd = read.offset + read.size;
+      uint64_t const merged = offset + size - read.offset;
+      if (offset - readEnd <= m_iGap && (m_iMaxReadBytes == 0 || merged <= m_iMaxReadBytes)) {
+        read.size = merged;
+        ++read.brickCount;
+        continue;
+      }
+    }
+    Read read;
+    read.offset = offset;
+    read.size = size;
+    read.firstBrick = uint32_t(i);
+    read.brickCount = 1;
+    m_Reads.push_back(read);
+  }
+
+  m_Stats.reads = m_Reads.size();
+  for (size_t i=0; i<m_Reads.size(); ++i) {
+    m_Stats.readBytes += m_Reads[i].size;
+    if (i == 0 || m_Reads[i].offset != m_Reads[i - 1].offset + m_Reads[i - 1].size)
+      ++m_Stats.plannedSeeks;
+  }
+}
+
+void BrickReadPlanner::Plan(BrickAccessFile::Subframe const& subframe)
+{
+  m_SubframeKeys.resize(subframe.size());
+  m_Store.GetLayout().GetKeys(subframe.data(), subframe.size(), m_SubframeKeys.data());
+  Plan(m_SubframeKeys.data(), m_SubframeKeys.size());
+}
+
+std::vector<BrickReadPlanner::Read> const& BrickReadPlanner::GetReads() const
+{
+  return m_Reads;
+}
+
+std::vector<BrickReadPlanner::Key> const& BrickReadPlanner::GetKeys() const
+{
+  return m_Keys;
+}
+
+BrickReadPlanner::Stats const& BrickReadPlanner::GetStats() const
+{
+  return m_Stats;
+}
+
+BrickReadPlanner::Stats BrickReadPlanner::PlanTrace(BrickAccessTrace const& trace)
+{
+  Stats total = Empty;
+  for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+    for (size_t s=0; s<trace.GetSubframeCount(f); ++s) {
+      BrickAccessTrace::Bricks const keys = trace.GetSubframe(f, s);
+      Plan(keys.begin(), keys.size());
+      total.Add(m_Stats);
+    }
+  }
+  return total;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
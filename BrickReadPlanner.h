@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef BRICK_READ_PLANNER_H
+#define BRICK_READ_PLANNER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+#include "BrickVolumeStore.h"
+
+// Turns the bricks of a subframe into few large reads of a volume file (see
+// BrickVolumeStore). The bricks are sorted into disk order, which is the key
+// order of the store's layout (row-major, Morton or Hilbert per LoD), repeats
+// are dropped, and bricks whose distance on disk is at most the gap are
+// merged into one contiguous read. The gap bytes between them are read and
+// discarded, which trades bandwidth for fewer requests and seeks.
+//
+// A seek is counted for every read which does not start where the previous
+// read of the subframe ended, the first read included.
+class BrickReadPlanner {
+public:
+  typedef BrickLayout::Key Key;
+
+  // A contiguous byte range of the volume file.
+  struct Read {
+    uint64_t offset;
+    uint64_t size;
+    // bricks of the read as a range of GetKeys()
+    uint32_t firstBrick;
+    uint32_t brickCount;
+  };
+
+  // Counters of one or many planned subframes.
+  struct Stats {
+    uint64_t subframes;
+    // bricks as requested, repeats included
+    uint64_t requests;
+    // distinct bricks
+    uint64_t bricks;
+    uint64_t reads;
+    // seeks when reading every request in trace order
+    uint64_t traceSeeks;
+    // seeks of the planned reads
+    uint64_t plannedSeeks;
+    // bytes of the distinct bricks and of all planned reads
+    uint64_t usefulBytes;
+    uint64_t readBytes;
+
+    void Add(Stats const& other);
+  };
+
+  // Plans reads of the given store, which has to outlive the planner.
+  explicit BrickReadPlanner(BrickVolumeStore const& store);
+
+  // Sets the largest distance between two bricks which are still merged into
+  // one read, zero merges only adjacent bricks. Default is zero.
+  void SetGap(uint64_t bytes);
+  uint64_t GetGap() const;
+
+  // Sets the size at which reads are split, zero does not limit reads. A
+  // brick is never split, so a single brick may exceed it. Default is zero.
+  void SetMaxReadBytes(uint64_t bytes);
+  uint64_t GetMaxReadBytes() const;
+
+  // Plans the reads of a subframe given as keys of the store's layout.
+  void Plan(Key const* keys, size_t count);
+
+  // Plans the reads of a subframe, all bricks have to be inside of the
+  // store's layout.
+  void Plan(BrickAccessFile::Subframe const& subframe);
+
+  // @returns the reads of the last planned subframe in disk order.
+  std::vector<Read> const& GetReads() const;
+
+  // @returns the distinct bricks of the last planned subframe in disk order.
+  std::vector<Key> const& GetKeys() const;
+
+  // @returns the counters of the last planned subframe.
+  Stats const& GetStats() const;
+
+  // Plans every subframe of a trace, which has to use the store's layout.
+  // @returns the sum of the counters of all subframes.
+  Stats PlanTrace(BrickAccessTrace const& trace);
+
+private:
+  BrickVolumeStore const& m_Store;
+  uint64_t m_iGap;
+  uint64_t m_iMaxReadBytes;
+  std::vector<Key> m_Keys;
+  std::vector<Key> m_SubframeKeys;
+  std::vector<Read> m_Reads;
+  Stats m_Stats;
+};
+
+#endif // BRICK_READ_PLANNER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,245 @@
+#include "BrickReuseAnalyzer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+  uint64_t const Never = std::numeric_limits<uint64_t>::max();
+
+  // Initial number of times before the first renumbering.
+  size_t const InitialTimes = 1 << 16;
+
+}
+
+uint64_t BrickReuseAnalyzer::Histogram::GetMissCount(uint64_t capacity) const
+{
+  uint64_t misses = coldMisses;
+  for (size_t d=size_t(std::min<uint64_t>(capacity, distances.size())); d<distances.size(); ++d)
+    misses += distances[d];
+  return misses;
+}
+
+double BrickReuseAnalyzer::Histogram::GetMissRatio(uint64_t capacity) const
+{
+  return requests > 0 ? double(GetMissCount(capacity)) / double(requests) : 0.0;
+}
+
+void BrickReuseAnalyzer::Histogram::GetMissCurve(std::vector<uint64_t>& misses) const
+{
+  misses.resize(distances.size() + 1);
+  misses[distances.size()] = coldMisses;
+  for (size_t d=distances.size(); d-- > 0;)
+    misses[d] = misses[d+1] + distances[d];
+}
+
+BrickReuseAnalyzer::BrickReuseAnalyzer(BrickLayout const& layout,
+  Granularity granularity, bool perLoD)
+  : m_Layout(layout)
+  , m_Granularity(granularity)
+  , m_bPerLoD(perLoD)
+{
+  Reset();
+}
+
+void BrickReuseAnalyzer::Reset()
+{
+  Histogram const empty = { std::vector<uint64_t>(), 0, 0 };
+  m_Total = empty;
+  m_LoDs.assign(m_bPerLoD ? m_Layout.GetLoDCount() : 0, empty);
+  m_LastRequest.assign(size_t(m_Layout.GetKeyCount()), Never);
+  m_Requested.assign(InitialTimes, 0);
+  m_Tree.assign(InitialTimes + 1, 0);
+  m_iTime = 0;
+  m_iUnitStart = 0;
+  m_iDistinct = 0;
+}
+
+void BrickReuseAnalyzer::BeginFrame()
+{
+  if (m_Granularity == RG_FRAME)
+    m_iUnitStart = m_iTime;
+}
+
+void BrickReuseAnalyzer::BeginSubframe()
+{
+  if (m_Granularity == RG_SUBFRAME)
+    m_iUnitStart = m_iTime;
+}
+
+void BrickReuseAnalyzer::AddBricks(Key const* keys, size_t count)
+{
+  for (size_t i=0; i<count; ++i)
+    AddRequest(keys[i]);
+}
+
+void BrickReuseAnalyzer::AddTrace(BrickAccessTrace const& trace)
+{
+  for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+    BeginFrame();
+    for (size_t s=0; s<trace.GetSubframeCount(f); ++s) {
+      BeginSubframe();
+      BrickAccessTrace::Bricks const keys = trace.GetSubframe(f, s);
+      AddBricks(keys.data, keys.size());
+    }
+  }
+}
+
+void BrickReuseAnalyzer::AddFile(BrickAccessFile const& file)
+{
+  if (file.GetStorage() == BrickAccessFile::ST_FLAT) {
+    BrickAccessTrace const& trace = file.GetTrace();
+    if (trace.GetLayout().HasSameKeys(m_Layout)) {
+      AddTrace(trace);
+      return;
+    }
+    // keys of another order or other brick counts are decoded and encoded
+    // again with the layout of the analyzer
+    std::vector<BrickAccessFile::Brick> bricks;
+    std::vector<Key> keys;
+    for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+      BeginFrame();
+      for (size_t s=0; s<trace.GetSubframeCount(f); ++s) {
+        BeginSubframe();
+        BrickAccessTrace::Bricks const subframe = trace.GetSubframe(f, s);
+        bricks.resize(subframe.size());
+        keys.resize(subframe.size());
+        trace.GetLayout().GetBricks(subframe.data, subframe.size(), bricks.data());
+        m_Layout.GetKeys(bricks.data(), bricks.size(), keys.data());
+        AddBricks(keys.data(), keys.size());
+      }
+    }
+    return;
+  }
+  std::vector<BrickAccessFile::Frame> const& frames = file.GetFrames();
+  for (size_t f=0; f<frames.size(); ++f) {
+    BeginFrame();
+    for (size_t s=0; s<frames[f].size(); ++s) {
+      BeginSubframe();
+      BrickAccessFile::Subframe const& subframe = frames[f][s];
+      for (size_t i=0; i<subframe.size(); ++i)
+        AddRequest(m_Layout.GetKey(subframe[i]));
+    }
+  }
+}
+
+BrickReuseAnalyzer::Histogram const& BrickReuseAnalyzer::GetHistogram() const
+{
+  return m_Total;
+}
+
+BrickReuseAnalyzer::Histogram const& BrickReuseAnalyzer::GetLoDHistogram(size_t lod) const
+{
+  return m_LoDs[lod];
+}
+
+void BrickReuseAnalyzer::AddRequest(Key key)
+{
+  uint64_t& last = m_LastRequest[size_t(key)];
+  if (m_Granularity != RG_REQUEST && last != Never && last >= m_iUnitStart)
+    return; // already requested within the current subframe or frame
+
+  if (m_iTime == m_Requested.size()) {
+    Compact();
+  }
+
+  // every distinct brick has exactly one mark at its last request, so the
+  // marks after the last request are the distinct bricks requested since
+  uint64_t distance = Never;
+  if (last != Never) {
+    distance = m_iDistinct - CountUpTo(size_t(last));
+    Update(size_t(last), -1);
+  } else {
+    ++m_iDistinct;
+  }
+  Update(size_t(m_iTime), 1);
+  m_Requested[size_t(m_iTime)] = key;
+  last = m_iTime++;
+
+  Record(m_Total, distance);
+  if (m_bPerLoD)
+    Record(m_LoDs[m_Layout.GetLoD(key)], distance);
+}
+
+void BrickReuseAnalyzer::Record(Histogram& histogram, uint64_t distance)
+{
+  ++histogram.requests;
+  if (distance == Never) {
+    ++histogram.coldMisses;
+    return;
+  }
+  if (distance >= histogram.distances.size())
+    histogram.distances.resize(size_t(distance) + 1, 0);
+  ++histogram.distances[size_t(distance)];
+}
+
+void BrickReuseAnalyzer::Compact()
+{
+  // keep at least as many free times as there are marks, which makes the
+  // renumbering cost constant per request
+  size_t const size = std::max(m_Requested.size(), size_t(2 * m_iDistinct + InitialTimes));
+  std::vector<Key> requested(size, 0);
+  uint64_t iTime = 0;
+  uint64_t iUnitStart = 0;
+  for (size_t t=0; t<m_iTime; ++t) {
+    if (t == m_iUnitStart)
+      iUnitStart = iTime;
+    Key const key = m_Requested[t];
+    if (m_LastRequest[size_t(key)] == t) {
+      requested[size_t(iTime)] = key;
+      m_LastRequest[size_t(key)] = iTime++;
+    }
+  }
+  if (m_iUnitStart >= m_iTime)
+    iUnitStart = iTime;
+
+  // all renumbered times are marked, build the tree in linear time
+  m_Tree.assign(size + 1, 0);
+  for (size_t i=1; i<=size; ++i) {
+    m_Tree[i] += (i <= iTime) ? 1 : 0;
+    size_t const parent = i + (i & (0 - i));
+    if (parent <= size)
+      m_Tree[parent] += m_Tree[i];
+  }
+  m_Requested.swap(requested);
+  m_iTime = iTime;
+  m_iUnitStart = iUnitStart;
+}
+
+void BrickReuseAnalyzer::Update(size_t index, int32_t delta)
+{
+  for (size_t i=index+1; i<m_Tree.size(); i += i & (0 - i))
+    m_Tree[i] += delta;
+}
+
+uint64_t BrickReuseAnalyzer::CountUpTo(size_t index) const
+{
+  uint64_t count = 0;
+  for (size_t i=index+1; i>0; i -= i & (0 - i))
+    count += uint64_t(m_Tree[i]);
+  return count;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef BRICK_REUSE_ANALYZER_H
+#define BRICK_REUSE_ANALYZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+#include "BrickLayout.h"
+
+// Computes the LRU stack distance (reuse distance) of every brick request in
+// one pass, following Mattson et al., "Evaluation techniques for storage
+// hierarchies", 1970. The stack distance is the number of distinct bricks
+// requested since the previous request of the same brick, so a request hits an
+// LRU cache of capacity c exactly if its distance is smaller than c. The
+// histogram of all distances therefore yields the miss counts of all cache
+// sizes at once.
+//
+// Distances are counted with a Fenwick tree which marks the time of the last
+// request of every brick, so each request takes O(log n) time. Times are
+// renumbered whenever the tree is full, which bounds its size by a multiple of
+// the number of distinct bricks instead of the trace length.
+class BrickReuseAnalyzer {
+public:
+  typedef BrickAccessTrace::Key Key;
+
+  // Steps in which requests are counted.
+  enum Granularity {
+    // Every request counts.
+    RG_REQUEST = 0,
+    // Repeated requests of a brick within one subframe count once.
+    RG_SUBFRAME,
+    // Repeated requests of a brick within one frame count once.
+    RG_FRAME
+  };
+
+  // Stack distance histogram of a set of requests.
+  struct Histogram {
+    // number of requests per stack distance
+    std::vector<uint64_t> distances;
+    // first requests of a brick, which miss in every cache
+    uint64_t coldMisses;
+    uint64_t requests;
+
+    // @returns the number of misses of an LRU cache with the given capacity
+    //   in bricks.
+    uint64_t GetMissCount(uint64_t capacity) const;
+
+    // @returns the miss count divided by the number of requests.
+    double GetMissRatio(uint64_t capacity) const;
+
+    // Computes the miss counts of all capacities. misses[c] is the miss count
+    //   of capacity c, larger capacities than misses.size()-1 only have cold
+    //   misses.
+    void GetMissCurve(std::vector<uint64_t>& misses) const;
+  };
+
+  // @param layout defines the key range of the analyzed bricks.
+  // @param perLoD additionally sorts the distances by the LoD of the
+  //   requested brick. All LoDs still share one cache.
+  explicit BrickReuseAnalyzer(BrickLayout const& layout,
+    Granularity granularity = RG_REQUEST, bool perLoD = false);
+
+  // Forgets all requests.
+  void Reset();
+
+  // Adds the requests of a frame or subframe. Subframes belong to the last
+  // started frame.
+  void BeginFrame();
+  void BeginSubframe();
+  void AddBricks(Key const* keys, size_t count);
+
+  // Adds all frames of a trace, whose keys have to be those of the layout of
+  // the analyzer, see BrickLayout::HasSameKeys().
+  void AddTrace(BrickAccessTrace const& trace);
+
+  // Adds all frames of a loaded file with the layout of the analyzer. The keys
+  // of the flat storage are used if their layout matches, otherwise bricks
+  // are converted to keys on the fly.
+  void AddFile(BrickAccessFile const& file);
+
+  // @returns the histogram of all requests.
+  Histogram const& GetHistogram() const;
+
+  // @returns the histogram of the requests of one LoD, only available if
+  //   perLoD was set.
+  Histogram const& GetLoDHistogram(size_t lod) const;
+
+private:
+  void AddRequest(Key key);
+  void Record(Histogram& histogram, uint64_t distance);
+  void Compact();
+
+  // Fenwick tree functions over m_Tree.
+  void Update(size_t index, int32_t delta);
+  uint64_t CountUpTo(size_t index) const;
+
+  BrickLayout m_Layout;
+  Granularity m_Granularity;
+  bool m_bPerLoD;
+
+  Histogram m_Total;
+  std::vector<Histogram> m_LoDs;
+
+  // time of the last request of every brick
+  std::vector<uint64_t> m_LastRequest;
+  // brick requested at every time, to renumber the times
+  std::vector<Key> m_Requested;
+  std::vector<int32_t> m_Tree;
+  uint64_t m_iTime;
+  uint64_t m_iUnitStart;
+  uint64_t m_iDistinct;
+};
+
+#endif // BRICK_REUSE_ANALYZER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
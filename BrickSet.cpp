@@ -0,0 +1,549 @@
+#include "BrickSet.h"
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  typedef BrickSet::Key Key;
+
+  // bits of a key which address the key within its chunk
+  uint32_t const CHUNK_BITS = 16;
+  uint64_t const CHUNK_MASK = (uint64_t(1) << CHUNK_BITS) - 1;
+  // words of a dense chunk
+  size_t const WORD_COUNT = (size_t(1) << CHUNK_BITS) / 64;
+  // sparse chunks hold at most this many keys, 4096 16-bit values take as
+  // much memory as a dense chunk
+  uint32_t const MAX_SPARSE = 4096;
+
+  inline uint64_t PopCount(uint64_t word)
+  {
+#if defined(__GNUC__)
+    return uint64_t(__builtin_popcountll(word));
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ull);
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (word * 0x0101010101010101ull) >> 56;
+#endif
+  }
+
+  // @returns the index of the lowest set bit of a non-zero word.
+  inline uint32_t LowestBit(uint64_t word)
+  {
+#if defined(__GNUC__)
+    return uint32_t(__builtin_ctzll(word));
+#else
+    return uint32_t(PopCount((word & (0 - word)) - 1));
+#endif
+  }
+
+#if defined(__AVX2__) && !defined(__AVX512VPOPCNTDQ__)
+  // Counts the bits of every 64-bit lane with a nibble lookup table (Mula et
+  // al., "Faster Population Counts Using AVX2 Instructions", 2018).
+  inline __m256i PopCount(__m256i v)
+  {
+    __m256i const lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i const low = _mm256_set1_epi8(0x0f);
+    __m256i const lo = _mm256_and_si256(v, low);
+    __m256i const hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    __m256i const bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+  }
+#endif
+
+  // Word operations for CombineWords().
+  struct OrOp {
+    static uint64_t Apply(uint64_t a, uint64_t b) { return a | b; }
+#if defined(__AVX512VPOPCNTDQ__)
+    static __m512i Apply(__m512i a, __m512i b) { return _mm512_or_si512(a, b); }
+#elif defined(__AVX2__)
+    static __m256i Apply(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+#endif
+  };
+
+  struct AndOp {
+    static uint64_t Apply(uint64_t a, uint64_t b) { return a & b; }
+#if defined(__AVX512VPOPCNTDQ__)
+    static __m512i Apply(__m512i a, __m512i b) { return _mm512_and_si512(a, b); }
+#elif defined(__AVX2__)
+    static __m256i Apply(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+#endif
+  };
+
+  struct AndNotOp {
+    static uint64_t Apply(uint64_t a, uint64_t b) { return a & ~b; }
+#if defined(__AVX512VPOPCNTDQ__)
+    // _mm512_andnot_si512 makes GCC 12 warn about an uninitialized operand
+    static __m512i Apply(__m512i a, __m512i b)
+    {
+      return _mm512_and_si512(a, _mm512_xor_si512(b, _mm512_set1_epi64(-1)));
+    }
+#elif defined(__AVX2__)
+    static __m256i Apply(__m256i a, __m256i b) { return _mm256_andnot_si256(b, a); }
+#endif
+  };
+
+  // Combines the words of two dense chunks and stores the result if result is
+  // not null.
+  // @returns the number of set bits of the result.
+  template<class Op>
+  uint64_t CombineWords(uint64_t const* a, uint64_t const* b, uint64_t* result)
+  {
+#if defined(__AVX512VPOPCNTDQ__)
+    __m512i count = _mm512_setzero_si512();
+    for (size_t i=0; i<WORD_COUNT; i+=8) {
+      __m512i const words = Op::Apply(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+      if (result)
+        _mm512_storeu_si512(result + i, words);
+      count = _mm512_add_epi64(count, _mm512_popcnt_epi64(words));
+    }
+    uint64_t counts[8];
+    _mm512_storeu_si512(counts, count);
+    return counts[0] + counts[1] + counts[2] + counts[3] + counts[4] + counts[5] + counts[6] + counts[7];
+#elif defined(__AVX2__)
+    __m256i count = _mm256_setzero_si256();
+    for (size_t i=0; i<WORD_COUNT; i+=4) {
+      __m256i const words = Op::Apply(
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i)));
+      if (result)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i), words);
+      count = _mm256_add_epi64(count, PopCount(words));
+    }
+    return uint64_t(_mm256_extract_epi64(count, 0)) + uint64_t(_mm256_extract_epi64(count, 1)) +
+      uint64_t(_mm256_extract_epi64(count, 2)) + uint64_t(_mm256_extract_epi64(count, 3));
+#else
+    uint64_t count = 0;
+    for (size_t i=0; i<WORD_COUNT; ++i) {
+      uint64_t const word = Op::Apply(a[i], b[i]);
+      if (result)
+        result[i] = word;
+      count += PopCount(word);
+    }
+    return count;
+#endif
+  }
+
+  template<class Chunk>
+  inline bool TestBit(Chunk const& chunk, uint32_t value)
+  {
+    return (chunk.words[value >> 6] >> (value & 63)) & 1;
+  }
+
+  // Converts a chunk to the representation its cardinality requires.
+  template<class Chunk>
+  void Normalize(Chunk& chunk)
+  {
+    if (chunk.IsDense() && chunk.cardinality <= MAX_SPARSE) {
+      chunk.values.clear();
+      chunk.values.reserve(chunk.cardinality);
+      for (size_t i=0; i<WORD_COUNT; ++i) {
+        for (uint64_t word = chunk.words[i]; word != 0; word &= word - 1) {
+          uint32_t const bit = LowestBit(word);
+          chunk.values.push_back(uint16_t(i * 64 + bit));
+        }
+      }
+      std::vector<uint64_t>().swap(chunk.words);
+    } else if (!chunk.IsDense() && chunk.cardinality > MAX_SPARSE) {
+      chunk.words.assign(WORD_COUNT, 0);
+      for (size_t i=0; i<chunk.values.size(); ++i)
+        chunk.words[chunk.values[i] >> 6] |= uint64_t(1) << (chunk.values[i] & 63);
+      std::vector<uint16_t>().swap(chunk.values);
+    }
+  }
+
+  // @returns the number of keys of a chunk in [begin, end) relative to the
+  //   chunk.
+  template<class Chunk>
+  uint64_t CountRange(Chunk const& chunk, uint32_t begin, uint32_t end)
+  {
+    if (begin >= end)
+      return 0;
+    if (!chunk.IsDense()) {
+      return uint64_t(std::lower_bound(chunk.values.begin(), chunk.values.end(), end) -
+        std::lower_bound(chunk.values.begin(), chunk.values.end(), begin));
+    }
+    size_t const first = begin >> 6;
+    size_t const last = (end - 1) >> 6;
+    uint64_t const firstMask = ~uint64_t(0) << (begin & 63);
+    uint64_t const lastMask = ~uint64_t(0) >> (63 - ((end - 1) & 63));
+    if (first == last)
+      return PopCount(chunk.words[first] & firstMask & lastMask);
+    uint64_t count = PopCount(chunk.words[first] & firstMask) + PopCount(chunk.words[last] & lastMask);
+    for (size_t i=first+1; i<last; ++i)
+      count += PopCount(chunk.words[i]);
+    return count;
+  }
+
+}
+
+BrickSet::BrickSet()
+  : m_iCardinality(0)
+{}
+
+void BrickSet::Clear()
+{
+  m_Chunks.clear();
+  m_iCardinality = 0;
+}
+
+void BrickSet::Assign(Key const* keys, size_t count)
+{
+  std::vector<Key> sorted(keys, keys + count);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  Clear();
+  m_iCardinality = sorted.size();
+  for (size_t begin=0; begin<sorted.size(); ) {
+    uint64_t const index = sorted[begin] >> CHUNK_BITS;
+    size_t end = begin + 1;
+    while (end < sorted.size() && (sorted[end] >> CHUNK_BITS) == index)
+      ++end;
+
+    Chunk& chunk = AppendChunk(index);
+    chunk.cardinality = uint32_t(end - begin);
+    if (chunk.cardinality > MAX_SPARSE) {
+      chunk.words.assign(WORD_COUNT, 0);
+      for (size_t i=begin; i<end; ++i)
+        chunk.words[(sorted[i] & CHUNK_MASK) >> 6] |= uint64_t(1) << (sorted[i] & 63);
+    } else {
+      chunk.values.resize(chunk.cardinality);
+      for (size_t i=begin; i<end; ++i)
+        chunk.values[i - begin] = uint16_t(sorted[i] & CHUNK_MASK);
+    }
+    begin = end;
+  }
+}
+
+void BrickSet::AssignFrame(BrickAccessTrace const& trace, size_t frame)
+{
+  BrickAccessTrace::Bricks const bricks = trace.GetFrame(frame);
+  Assign(bricks.begin(), bricks.size());
+}
+
+void BrickSet::AssignSubframe(BrickAccessTrace const& trace, size_t frame, size_t subframe)
+{
+  BrickAccessTrace::Bricks const bricks = trace.GetSubframe(frame, subframe);
+  Assign(bricks.begin(), bricks.size());
+}
+
+void BrickSet::Insert(Key key)
+{
+  uint64_t const index = key >> CHUNK_BITS;
+  uint16_t const value = uint16_t(key & CHUNK_MASK);
+  size_t const position = FindChunk(index);
+  if (position == m_Chunks.size() || m_Chunks[position].index != index) {
+    Chunk chunk;
+    chunk.index = index;
+    chunk.cardinality = 0;
+    m_Chunks.insert(m_Chunks.begin() + position, chunk);
+  }
+
+  Chunk& chunk = m_Chunks[position];
+  if (chunk.IsDense()) {
+    uint64_t& word = chunk.words[value >> 6];
+    uint64_t const bit = uint64_t(1) << (value & 63);
+    if (word & bit)
+      return;
+    word |= bit;
+  } else {
+    auto const it = std::lower_bound(chunk.values.begin(), chunk.values.end(), value);
+    if (it != chunk.values.end() && *it == value)
+      return;
+    chunk.values.insert(it, value);
+  }
+  ++chunk.cardinality;
+  ++m_iCardinality;
+  Normalize(chunk);
+}
+
+bool BrickSet::Contains(Key key) const
+{
+  uint64_t const index = key >> CHUNK_BITS;
+  uint16_t const value = uint16_t(key & CHUNK_MASK);
+  size_t const position = FindChunk(index);
+  if (position == m_Chunks.size() || m_Chunks[position].index != index)
+    return false;
+  Chunk const& chunk = m_Chunks[position];
+  if (chunk.IsDense())
+    return TestBit(chunk, value);
+  return std::binary_search(chunk.values.begin(), chunk.values.end(), value);
+}
+
+uint64_t BrickSet::GetCardinality() const
+{
+  return m_iCardinality;
+}
+
+uint64_t BrickSet::GetCardinality(Key begin, Key end) const
+{
+  uint64_t count = 0;
+  for (size_t i=FindChunk(begin >> CHUNK_BITS); i<m_Chunks.size(); ++i) {
+    Chunk const& chunk = m_Chunks[i];
+    Key const chunkBegin = chunk.index << CHUNK_BITS;
+    if (chunkBegin >= end)
+      break;
+    uint32_t const first = begin > chunkBegin ? uint32_t(begin - chunkBegin) : 0;
+    uint32_t const last = uint32_t(std::min(end - chunkBegin, CHUNK_MASK + 1));
+    if (first == 0 && last == CHUNK_MASK + 1)
+      count += chunk.cardinality;
+    else
+      count += CountRange(chunk, first, last);
+  }
+  return count;
+}
+
+uint64_t BrickSet::GetLoDCardinality(BrickLayout const& layout, size_t lod) const
+{
+  return GetCardinality(layout.GetLoDOffset(lod), layout.GetLoDOffset(lod + 1));
+}
+
+bool BrickSet::IsEmpty() const
+{
+  return m_iCardinality == 0;
+}
+
+void BrickSet::GetKeys(std::vector<Key>& keys) const
+{
+  keys.reserve(keys.size() + m_iCardinality);
+  for (auto chunk=m_Chunks.cbegin(); chunk!=m_Chunks.cend(); ++chunk) {
+    Key const base = chunk->index << CHUNK_BITS;
+    if (chunk->IsDense()) {
+      for (size_t i=0; i<WORD_COUNT; ++i) {
+        for (uint64_t word = chunk->words[i]; word != 0; word &= word - 1) {
+          uint32_t const bit = LowestBit(word);
+          keys.push_back(base + i * 64 + bit);
+        }
+      }
+    } else {
+      for (size_t i=0; i<chunk->values.size(); ++i)
+        keys.push_back(base + chunk->values[i]);
+    }
+  }
+}
+
+size_t BrickSet::GetMemoryUsage() const
+{
+  size_t bytes = sizeof(*this) + m_Chunks.capacity() * sizeof(Chunk);
+  for (auto chunk=m_Chunks.cbegin(); chunk!=m_Chunks.cend(); ++chunk)
+    bytes += chunk->values.capacity() * sizeof(uint16_t) + chunk->words.capacity() * sizeof(uint64_t);
+  return bytes;
+}
+
+void BrickSet::Union(BrickSet const& a, BrickSet const& b, BrickSet& result)
+{
+  result.Clear();
+  size_t i = 0, j = 0;
+  while (i < a.m_Chunks.size() || j < b.m_Chunks.size()) {
+    if (j == b.m_Chunks.size() || (i < a.m_Chunks.size() && a.m_Chunks[i].index < b.m_Chunks[j].index)) {
+      result.m_Chunks.push_back(a.m_Chunks[i++]);
+    } else if (i == a.m_Chunks.size() || b.m_Chunks[j].index < a.m_Chunks[i].index) {
+      result.m_Chunks.push_back(b.m_Chunks[j++]);
+    } else {
+      Chunk const& ca = a.m_Chunks[i++];
+      Chunk const& cb = b.m_Chunks[j++];
+      Chunk& chunk = result.AppendChunk(ca.index);
+      if (ca.IsDense() && cb.IsDense()) {
+        chunk.words.resize(WORD_COUNT);
+        chunk.cardinality = uint32_t(CombineWords<OrOp>(ca.words.data(), cb.words.data(), chunk.words.data()));
+      } else if (ca.IsDense() || cb.IsDense()) {
+        Chunk const& dense = ca.IsDense() ? ca : cb;
+        Chunk const& sparse = ca.IsDense() ? cb : ca;
+        chunk.words = dense.words;
+        chunk.cardinality = dense.cardinality;
+        for (size_t k=0; k<sparse.values.size(); ++k) {
+          uint16_t const value = sparse.values[k];
+          if (!TestBit(chunk, value)) {
+            chunk.words[value >> 6] |= uint64_t(1) << (value & 63);
+            ++chunk.cardinality;
+          }
+        }
+      } else {
+        chunk.values.reserve(ca.values.size() + cb.values.size());
+        std::set_union(ca.values.begin(), ca.values.end(), cb.values.begin(), cb.values.end(),
+          std::back_inserter(chunk.values));
+        chunk.cardinality = uint32_t(chunk.values.size());
+        Normalize(chunk);
+      }
+    }
+    result.m_iCardinality += result.m_Chunks.back().cardinality;
+  }
+}
+
+void BrickSet::Intersection(BrickSet const& a, BrickSet const& b, BrickSet& result)
+{
+  result.Clear();
+  size_t i = 0, j = 0;
+  while (i < a.m_Chunks.size() && j < b.m_Chunks.size()) {
+    if (a.m_Chunks[i].index < b.m_Chunks[j].index) {
+      ++i;
+      continue;
+    }
+    if (b.m_Chunks[j].index < a.m_Chunks[i].index) {
+      ++j;
+      continue;
+    }
+    Chunk const& ca = a.m_Chunks[i++];
+    Chunk const& cb = b.m_Chunks[j++];
+    Chunk& chunk = result.AppendChunk(ca.index);
+    if (ca.IsDense() && cb.IsDense()) {
+      chunk.words.resize(WORD_COUNT);
+      chunk.cardinality = uint32_t(CombineWords<AndOp>(ca.words.data(), cb.words.data(), chunk.words.data()));
+      Normalize(chunk);
+    } else if (ca.IsDense() || cb.IsDense()) {
+      Chunk const& dense = ca.IsDense() ? ca : cb;
+      Chunk const& sparse = ca.IsDense() ? cb : ca;
+      for (size_t k=0; k<sparse.values.size(); ++k) {
+        if (TestBit(dense, sparse.values[k]))
+          chunk.values.push_back(sparse.values[k]);
+      }
+      chunk.cardinality = uint32_t(chunk.values.size());
+    } else {
+      std::set_intersection(ca.values.begin(), ca.values.end(), cb.values.begin(), cb.values.end(),
+        std::back_inserter(chunk.values));
+      chunk.cardinality = uint32_t(chunk.values.size());
+    }
+    if (chunk.cardinality == 0)
+      result.m_Chunks.pop_back();
+    else
+      result.m_iCardinality += chunk.cardinality;
+  }
+}
+
+void BrickSet::Difference(BrickSet const& a, BrickSet const& b, BrickSet& result)
+{
+  result.Clear();
+  size_t j = 0;
+  for (size_t i=0; i<a.m_Chunks.size(); ++i) {
+    Chunk const& ca = a.m_Chunks[i];
+    while (j < b.m_Chunks.size() && b.m_Chunks[j].index < ca.index)
+      ++j;
+    if (j == b.m_Chunks.size() || b.m_Chunks[j].index != ca.index) {
+      result.m_Chunks.push_back(ca);
+      result.m_iCardinality += ca.cardinality;
+      continue;
+    }
+
+    Chunk const& cb = b.m_Chunks[j];
+    Chunk& chunk = result.AppendChunk(ca.index);
+    if (ca.IsDense() && cb.IsDense()) {
+      chunk.words.resize(WORD_COUNT);
+      chunk.cardinality = uint32_t(CombineWords<AndNotOp>(ca.words.data(), cb.words.data(), chunk.words.data()));
+      Normalize(chunk);
+    } else if (ca.IsDense()) {
+      chunk.words = ca.words;
+      chunk.cardinality = ca.cardinality;
+      for (size_t k=0; k<cb.values.size(); ++k) {
+        uint16_t const value = cb.values[k];
+        if (TestBit(chunk, value)) {
+          chunk.words[value >> 6] &= ~(uint64_t(1) << (value & 63));
+          --chunk.cardinality;
+        }
+      }
+      Normalize(chunk);
+    } else if (cb.IsDense()) {
+      for (size_t k=0; k<ca.values.size(); ++k) {
+        if (!TestBit(cb, ca.values[k]))
+          chunk.values.push_back(ca.values[k]);
+      }
+      chunk.cardinality = uint32_t(chunk.values.size());
+    } else {
+      std::set_difference(ca.values.begin(), ca.values.end(), cb.values.begin(), cb.values.end(),
+        std::back_inserter(chunk.values));
+      chunk.cardinality = uint32_t(chunk.values.size());
+    }
+    if (chunk.cardinality == 0)
+      result.m_Chunks.pop_back();
+    else
+      result.m_iCardinality += chunk.cardinality;
+  }
+}
+
+uint64_t BrickSet::GetIntersectionCardinality(BrickSet const& a, BrickSet const& b)
+{
+  uint64_t count = 0;
+  size_t i = 0, j = 0;
+  while (i < a.m_Chunks.size() && j < b.m_Chunks.size()) {
+    if (a.m_Chunks[i].index < b.m_Chunks[j].index) {
+      ++i;
+      continue;
+    }
+    if (b.m_Chunks[j].index < a.m_Chunks[i].index) {
+      ++j;
+      continue;
+    }
+    Chunk const& ca = a.m_Chunks[i++];
+    Chunk const& cb = b.m_Chunks[j++];
+    if (ca.IsDense() && cb.IsDense()) {
+      count += CombineWords<AndOp>(ca.words.data(), cb.words.data(), nullptr);
+    } else if (ca.IsDense() || cb.IsDense()) {
+      Chunk const& dense = ca.IsDense() ? ca : cb;
+      Chunk const& sparse = ca.IsDense() ? cb : ca;
+      for (size_t k=0; k<sparse.values.size(); ++k)
+        count += TestBit(dense, sparse.values[k]) ? 1 : 0;
+    } else {
+      auto va = ca.values.cbegin();
+      auto vb = cb.values.cbegin();
+      while (va != ca.values.cend() && vb != cb.values.cend()) {
+        if (*va < *vb) {
+          ++va;
+        } else if (*vb < *va) {
+          ++vb;
+        } else {
+          ++count;
+          ++va;
+          ++vb;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+size_t BrickSet::FindChunk(uint64_t index) const
+{
+  auto const it = std::lower_bound(m_Chunks.begin(), m_Chunks.end(), index,
+    [](Chunk const& chunk, uint64_t value) { return chunk.index < value; });
+  return size_t(it - m_Chunks.begin());
+}
+
+BrickSet::Chunk& BrickSet::AppendChunk(uint64_t index)
+{
+  m_Chunks.push_back(Chunk());
+  Chunk& chunk = m_Chunks.back();
+  chunk.index = index;
+  chunk.cardinality = 0;
+  return chunk;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,134 @@
+#pragma once
+
+#ifndef BRICK_SET_H
+#define BRICK_SET_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BrickAccessTrace.h"
+#include "BrickLayout.h"
+
+// A set of brick keys, e.g. the bricks of a frame or subframe, which supports
+// fast bulk set operations. Every LoD occupies a contiguous key range (see
+// BrickLayout), so the set is a bitmap over the keys of all LoDs.
+//
+// The key range is split into chunks of 2^16 keys, following roaring bitmaps
+// (Chambi et al., "Better bitmap performance with Roaring bitmaps", 2016).
+// A chunk with more than 4096 keys is stored as a dense bitmap of 8 KiB, a
+// sparser one as a sorted array of 16-bit offsets, and empty chunks take no
+// memory. Coarse LoDs which a frame mostly covers therefore become dense
+// bitmaps while sparse fine LoDs stay small.
+//
+// Operations on two dense chunks process the bitmaps word by word and count
+// the result bits on the fly. They use AVX-512 (VPOPCNTDQ) or AVX2 if the code
+// is compiled for them (e.g. -march=native), 64-bit popcounts otherwise.
+// Example, the bricks a frame loads which the previous one did not use:
+//
+//   BrickSet previous, current, added;
+//   previous.AssignFrame(trace, f - 1);
+//   current.AssignFrame(trace, f);
+//   BrickSet::Difference(current, previous, added);
+class BrickSet {
+public:
+  typedef BrickLayout::Key Key;
+
+  // Creates an empty set.
+  BrickSet();
+
+  // Removes all keys.
+  void Clear();
+
+  // Replaces the set by the given keys, which may be unsorted and repeated.
+  void Assign(Key const* keys, size_t count);
+
+  // Replaces the set by the bricks of a frame or subframe of a trace.
+  void AssignFrame(BrickAccessTrace const& trace, size_t frame);
+  void AssignSubframe(BrickAccessTrace const& trace, size_t frame, size_t subframe);
+
+  // Adds a single key.
+  void Insert(Key key);
+
+  // @returns true if the set contains the key.
+  bool Contains(Key key) const;
+
+  // @returns the number of keys.
+  uint64_t GetCardinality() const;
+
+  // @returns the number of keys in [begin, end).
+  uint64_t GetCardinality(Key begin, Key end) const;
+
+  // @returns the number of keys of a LoD of the layout.
+  uint64_t GetLoDCardinality(BrickLayout const& layout, size_t lod) const;
+
+  // @returns true if the set is empty.
+  bool IsEmpty() const;
+
+  // Appends all keys in ascending order.
+  void GetKeys(std::vector<Key>& keys) const;
+
+  // @returns the number of bytes used by the set.
+  size_t GetMemoryUsage() const;
+
+  // Set operations, result may not alias a or b.
+  static void Union(BrickSet const& a, BrickSet const& b, BrickSet& result);
+  static void Intersection(BrickSet const& a, BrickSet const& b, BrickSet& result);
+  // Keys of a which are not in b.
+  static void Difference(BrickSet const& a, BrickSet const& b, BrickSet& result);
+
+  // @returns the cardinality of the intersection without computing it.
+  static uint64_t GetIntersectionCardinality(BrickSet const& a, BrickSet const& b);
+
+private:
+  struct Chunk;
+
+  // @returns the position of the chunk with the given index or of the first
+  //   chunk behind it.
+  size_t FindChunk(uint64_t index) const;
+
+  // @returns a new chunk at the end for the given index, which has to exceed
+  //   the indices of all chunks.
+  Chunk& AppendChunk(uint64_t index);
+
+  std::vector<Chunk> m_Chunks;
+  uint64_t m_iCardinality;
+};
+
+// Keys of a chunk, either dense or sparse.
+struct BrickSet::Chunk {
+  // key >> 16 of all keys of the chunk
+  uint64_t index;
+  uint32_t cardinality;
+  // sorted low 16 bits of the keys, empty if dense
+  std::vector<uint16_t> values;
+  // 1024 words with one bit per key if dense, empty otherwise
+  std::vector<uint64_t> words;
+
+  bool IsDense() const { return !words.empty(); }
+};
+
+#endif // BRICK_SET_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
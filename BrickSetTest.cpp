@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BrickLayout.h"
+#include "BrickSet.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  typedef BrickSet::Key Key;
+
+  uint64_t const CHUNK_SIZE = 65536;
+
+  // Ways to fill a chunk, chosen to reach every pair of dense, sparse and
+  // empty chunks in the kernels.
+  enum Fill {
+    F_EMPTY = 0,
+    F_SPARSE,
+    // exactly the largest sparse and the smallest dense cardinality
+    F_SPARSE_LIMIT,
+    F_DENSE_LIMIT,
+    F_DENSE,
+    F_FULL,
+    F_COUNT
+  };
+
+  char const* GetKernelName()
+  {
+#if defined(__AVX512VPOPCNTDQ__)
+    return "AVX-512";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+  }
+
+  // Appends the keys of a chunk, unsorted and with repeats like a trace.
+  void FillChunk(uint64_t chunk, Fill fill, std::mt19937_64& random, std::vector<Key>& keys)
+  {
+    Key const base = chunk * CHUNK_SIZE;
+    std::vector<Key> values;
+    switch (fill) {
+    case F_SPARSE :
+    case F_DENSE : {
+      size_t const count = fill == F_SPARSE ? 1 + random() % 2000 : 8000 + random() % 40000;
+      for (size_t i=0; i<count; ++i)
+        values.push_back(base + random() % CHUNK_SIZE);
+      break;
+    }
+    case F_SPARSE_LIMIT :
+    case F_DENSE_LIMIT : {
+      for (Key i=0; i<CHUNK_SIZE; ++i)
+        values.push_back(base + i);
+      std::shuffle(values.begin(), values.end(), random);
+      values.resize(fill == F_SPARSE_LIMIT ? 4096 : 4097);
+      break;
+    }
+    case F_FULL :
+      for (Key i=0; i<CHUNK_SIZE; ++i)
+        values.push_back(base + i);
+      break;
+    default :
+      break;
+    }
+    keys.insert(keys.end(), values.begin(), values.end());
+    if (!values.empty())
+      keys.insert(keys.end(), values.begin(), values.begin() + values.size() / 4);
+  }
+
+  std::vector<Key> Sorted(std::vector<Key> keys)
+  {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+  }
+
+  uint64_t CountRange(std::vector<Key> const& keys, Key begin, Key end)
+  {
+    if (begin >= end)
+      return 0;
+    return uint64_t(std::lower_bound(keys.begin(), keys.end(), end) -
+      std::lower_bound(keys.begin(), keys.end(), begin));
+  }
+
+  // Counts checks and reports failures.
+  class Checker {
+  public:
+    Checker() : m_iChecks(0), m_iFailures(0) {}
+
+    void Check(bool ok, string const& name, size_t round)
+    {
+      ++m_iChecks;
+      if (!ok) {
+        ++m_iFailures;
+        cerr << "failed: " << name << " in round " << round << endl;
+      }
+    }
+
+    uint64_t GetChecks() const { return m_iChecks; }
+    uint64_t GetFailures() const { return m_iFailures; }
+
+  private:
+    uint64_t m_iChecks;
+    uint64_t m_iFailures;
+  };
+
+  // Compares a set to its reference keys.
+  void CheckSet(Checker& checker, BrickSet const& set, std::vector<Key> const& reference, string const& name,
+    size_t round, std::mt19937_64& random)
+  {
+    std::vector<Key> keys;
+    set.GetKeys(keys);
+    checker.Check(keys == reference, name + " keys", round);
+    checker.Check(set.GetCardinality() == reference.size(), name + " cardinality", round);
+    checker.Check(set.IsEmpty() == reference.empty(), name + " empty", round);
+
+    // ranges within a word, across words and across chunks
+    Key const limit = 8 * CHUNK_SIZE;
+    for (int i=0; i<64; ++i) {
+      Key const begin = random() % limit;
+      Key const end = begin + (i % 4 == 0 ? random() % 64 : random() % (limit - begin + 1));
+      checker.Check(set.GetCardinality(begin, end) == CountRange(reference, begin, end),
+        name + " range cardinality", round);
+    }
+    for (int i=0; i<64; ++i) {
+      Key const key = random() % limit;
+      checker.Check(set.Contains(key) == std::binary_search(reference.begin(), reference.end(), key),
+        name + " contains", round);
+    }
+  }
+
+}
+
+// Compares the set operations of BrickSet, including the cardinality
+// variants, against std::set_union and friends on random sets which mix
+// empty, sparse and dense chunks. The dense kernels are those selected by
+// ARCHFLAGS, see the test-arch target of the makefile.
+int main(int argc, char const *argv[])
+{
+  (void)argc;
+  (void)argv;
+#if defined(__GNUC__) && defined(__AVX512VPOPCNTDQ__)
+  if (!__builtin_cpu_supports("avx512vpopcntdq")) {
+    cout << "BrickSet tests skipped: the CPU cannot run the " << GetKernelName() << " kernels" << endl;
+    return EXIT_SUCCESS;
+  }
+#elif defined(__GNUC__) && defined(__AVX2__)
+  if (!__builtin_cpu_supports("avx2")) {
+    cout << "BrickSet tests skipped: the CPU cannot run the " << GetKernelName() << " kernels" << endl;
+    return EXIT_SUCCESS;
+  }
+#endif
+
+  size_t const chunkCount = 6;
+  std::mt19937_64 random(20130701);
+  Checker checker;
+  for (size_t round=0; round<F_COUNT * F_COUNT; ++round) {
+    // the first chunk pairs every fill of a with every fill of b, the others
+    // are random
+    std::vector<Key> a, b;
+    for (uint64_t chunk=0; chunk<chunkCount; ++chunk) {
+      Fill const fillA = chunk == 0 ? Fill(round / F_COUNT) : Fill(random() % F_COUNT);
+      Fill const fillB = chunk == 0 ? Fill(round % F_COUNT) : Fill(random() % F_COUNT);
+      FillChunk(chunk, fillA, random, a);
+      FillChunk(chunk, fillB, random, b);
+    }
+    // a chunk only one of the sets has
+    FillChunk(chunkCount + (round % 2), F_DENSE, random, round % 2 ? a : b);
+
+    BrickSet setA, setB;
+    setA.Assign(a.data(), a.size());
+    for (size_t i=0; i<b.size(); ++i)
+      setB.Insert(b[i]);
+    std::vector<Key> const refA = Sorted(a);
+    std::vector<Key> const refB = Sorted(b);
+    CheckSet(checker, setA, refA, "assign", round, random);
+    CheckSet(checker, setB, refB, "insert", round, random);
+
+    std::vector<Key> refUnion, refIntersection, refDifference;
+    std::set_union(refA.begin(), refA.end(), refB.begin(), refB.end(), std::back_inserter(refUnion));
+    std::set_intersection(refA.begin(), refA.end(), refB.begin(), refB.end(),
+      std::back_inserter(refIntersection));
+    std::set_difference(refA.begin(), refA.end(), refB.begin(), refB.end(), std::back_inserter(refDifference));
+
+    BrickSet result;
+    BrickSet::Union(setA, setB, result);
+    CheckSet(checker, result, refUnion, "union", round, random);
+    BrickSet::Intersection(setA, setB, result);
+    CheckSet(checker, result, refIntersection, "intersection", round, random);
+    BrickSet::Difference(setA, setB, result);
+    CheckSet(checker, result, refDifference, "difference", round, random);
+    checker.Check(BrickSet::GetIntersectionCardinality(setA, setB) == refIntersection.size(),
+      "intersection cardinality", round);
+    checker.Check(BrickSet::GetIntersectionCardinality(setB, setA) == refIntersection.size(),
+      "swapped intersection cardinality", round);
+
+    // LoDs of varying sizes which do not align with the chunks
+    std::vector<BrickAccessFile::Vec3<uint64_t> > brickCounts;
+    for (uint64_t size=96; size>=3; size/=2) {
+      BrickAccessFile::Vec3<uint64_t> const count = { size, size, size };
+      brickCounts.push_back(count);
+    }
+    BrickLayout const layout(brickCounts);
+    for (size_t lod=0; lod<layout.GetLoDCount(); ++lod) {
+      checker.Check(result.GetLoDCardinality(layout, lod) ==
+        CountRange(refDifference, layout.GetLoDOffset(lod), layout.GetLoDOffset(lod + 1)),
+        "LoD cardinality", round);
+    }
+  }
+
+  if (checker.GetFailures() > 0) {
+    cerr << "BrickSet tests: " << checker.GetFailures() << " of " << checker.GetChecks() << " checks failed with the "
+      << GetKernelName() << " kernels" << endl;
+    return EXIT_FAILURE;
+  }
+  cout << "BrickSet tests: " << checker.GetChecks() << " checks passed with the " << GetKernelName() << " kernels"
+    << endl;
+  return EXIT_SUCCESS;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,229 @@
+#include "BrickVolumeStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+  typedef BrickVolumeStore::Key Key;
+
+  uint64_t const Alignment = 4096;
+
+  // First bytes of the header block of a volume file.
+  struct VolumeHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t bytesPerVoxel;
+    uint32_t keyOrder;
+    uint64_t keyCount;
+    uint64_t fileSize;
+    // hash of all brick offsets, which covers the brick sizes
+    uint64_t offsetHash;
+  };
+
+  static_assert(sizeof(VolumeHeader) == 48,
+    "volume header layout must not depend on the compiler");
+
+  char const Magic[8] = { 'B', 'A', 'V', 'O', 'L', 'U', 'M', 'E' };
+  uint32_t const Version = 1;
+  uint32_t const ByteOrderMark = 0x01020304;
+
+  uint64_t AlignUp(uint64_t value)
+  {
+    return (value + Alignment - 1) / Alignment * Alignment;
+  }
+
+  // FNV-1a over the bytes of all offsets.
+  uint64_t HashOffsets(std::vector<uint64_t> const& offsets)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i=0; i<offsets.size(); ++i) {
+      for (uint32_t shift=0; shift<64; shift+=8) {
+        hash ^= (offsets[i] >> shift) & 0xff;
+        hash *= 1099511628211ull;
+      }
+    }
+    return hash;
+  }
+
+  VolumeHeader MakeHeader(uint32_t bytesPerVoxel, BrickLayout const& layout, std::vector<uint64_t> const& offsets)
+  {
+    VolumeHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(header.magic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.bytesPerVoxel = bytesPerVoxel;
+    header.keyOrder = uint32_t(layout.GetOrder());
+    header.keyCount = layout.GetKeyCount();
+    header.fileSize = offsets.back();
+    header.offsetHash = HashOffsets(offsets);
+    return header;
+  }
+
+}
+
+BrickVolumeStore::BrickVolumeStore(BrickLayout const& layout, BrickAccessFile::Header const& header,
+  uint32_t bytesPerVoxel)
+  : m_Layout(layout)
+  , m_iBytesPerVoxel(bytesPerVoxel)
+  , m_iMaxStoredBytes(0)
+  , m_bValid(false)
+{
+  if (!layout.IsValid() || layout.GetLoDCount() != header.brickCounts.size() ||
+      header.domainSizes.size() != header.brickCounts.size())
+    return;
+
+  // a brick stores its core voxels and the overlap on both sides
+  BrickAccessFile::Vec3<uint32_t> const& overlap = header.brickOverlap;
+  BrickAccessFile::Vec3<uint64_t> const coreSize = BrickLayout::GetCoreBrickSize(header);
+
+  m_BrickBytes.assign(size_t(layout.GetKeyCount()), 0);
+  for (size_t lod=0; lod<header.brickCounts.size(); ++lod) {
+    BrickAccessFile::Vec3<uint64_t> const& count = header.brickCounts[lod];
+    BrickAccessFile::Vec3<uint64_t> const& domain = header.domainSizes[lod];
+    BrickAccessFile::Brick brick;
+    brick.w = lod;
+    for (brick.z=0; brick.z<count.z; ++brick.z) {
+      for (brick.y=0; brick.y<count.y; ++brick.y) {
+        for (brick.x=0; brick.x<count.x; ++brick.x) {
+          BrickAccessFile::Vec3<uint64_t> const core = BrickLayout::GetCoreExtent(coreSize, domain, brick);
+          m_BrickBytes[size_t(layout.GetKey(brick))] = m_iBytesPerVoxel * (core.x + 2 * overlap.x) *
+            (core.y + 2 * overlap.y) * (core.z + 2 * overlap.z);
+        }
+      }
+    }
+  }
+
+  m_Offsets.resize(m_BrickBytes.size() + 1);
+  m_Offsets[0] = Alignment;
+  for (size_t key=0; key<m_BrickBytes.size(); ++key) {
+    uint64_t const stored = AlignUp(m_BrickBytes[key]);
+    m_Offsets[key + 1] = m_Offsets[key] + stored;
+    m_iMaxStoredBytes = std::max(m_iMaxStoredBytes, stored);
+  }
+  m_bValid = true;
+}
+
+bool BrickVolumeStore::IsValid() const
+{
+  return m_bValid;
+}
+
+BrickLayout const& BrickVolumeStore::GetLayout() const
+{
+  return m_Layout;
+}
+
+uint64_t BrickVolumeStore::GetOffset(Key key) const
+{
+  return m_Offsets[size_t(key)];
+}
+
+uint64_t BrickVolumeStore::GetBrickBytes(Key key) const
+{
+  return m_BrickBytes[size_t(key)];
+}
+
+uint64_t BrickVolumeStore::GetStoredBytes(Key key) const
+{
+  return m_Offsets[size_t(key) + 1] - m_Offsets[size_t(key)];
+}
+
+uint64_t BrickVolumeStore::GetMaxStoredBytes() const
+{
+  return m_iMaxStoredBytes;
+}
+
+uint64_t BrickVolumeStore::GetFileSize() const
+{
+  return m_Offsets.empty() ? 0 : m_Offsets.back();
+}
+
+uint64_t BrickVolumeStore::GetAlignment()
+{
+  return Alignment;
+}
+
+bool BrickVolumeStore::Create(std::string const& filename) const
+{
+  if (!m_bValid)
+    return false;
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "failed to create file " << filename << std::endl;
+    return false;
+  }
+
+  std::vector<char> block(size_t(Alignment), 0);
+  VolumeHeader const header = MakeHeader(m_iBytesPerVoxel, m_Layout, m_Offsets);
+  memcpy(block.data(), &header, sizeof(header));
+  file.write(block.data(), std::streamsize(block.size()));
+
+  // one buffer of random bytes is reused for all bricks, only the key at the
+  // start differs
+  std::vector<char> voxels(static_cast<size_t>(m_iMaxStoredBytes));
+  uint64_t state = 0x9e3779b97f4a7c15ull;
+  for (size_t i=0; i<voxels.size(); ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    voxels[i] = char(state);
+  }
+  for (size_t key=0; key<m_BrickBytes.size() && file.good(); ++key) {
+    uint64_t const stored = GetStoredBytes(key);
+    if (stored == 0)
+      continue;
+    uint64_t const value = key;
+    memcpy(voxels.data(), &value, sizeof(value));
+    file.write(voxels.data(), std::streamsize(stored));
+  }
+  file.close();
+  if (!file) {
+    std::cerr << "failed to write file " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool BrickVolumeStore::IsCurrent(std::string const& filename) const
+{
+  if (!m_bValid)
+    return false;
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open())
+    return false;
+  VolumeHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    return false;
+  file.seekg(0, std::ios::end);
+  VolumeHeader const expected = MakeHeader(m_iBytesPerVoxel, m_Layout, m_Offsets);
+  return memcmp(&header, &expected, sizeof(header)) == 0 && uint64_t(file.tellg()) == GetFileSize();
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef BRICK_VOLUME_STORE_H
+#define BRICK_VOLUME_STORE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickLayout.h"
+
+// Layout of a local file with the voxel data of every brick of a dataset, so
+// that traces can be replayed as real reads (see BrickIoReplayer).
+//
+// The file starts with a header block, followed by the bricks in key order of
+// a BrickLayout. Every brick takes its actual voxels including the overlap,
+// bricks at the upper domain border are smaller, and is padded to a multiple
+// of GetAlignment() bytes, so that bricks can be read with O_DIRECT. Keys of
+// the curve orders which do not belong to a brick take no space, thus the key
+// order of the layout is the order of the bricks on disk.
+//
+// The voxels are pseudo random bytes with the brick key in the first eight
+// bytes, which keeps compressing or deduplicating file systems from turning
+// reads into no-ops.
+class BrickVolumeStore {
+public:
+  typedef BrickLayout::Key Key;
+
+  // Computes the layout of a volume file.
+  // @param layout gives the bricks and their order on disk, it has to match
+  //   the brick counts of the header.
+  // @param bytesPerVoxel is the size of a voxel on disk.
+  BrickVolumeStore(BrickLayout const& layout, BrickAccessFile::Header const& header,
+    uint32_t bytesPerVoxel = 1);
+
+  // @returns false if the layout does not match the header.
+  bool IsValid() const;
+
+  // @returns the layout of the bricks.
+  BrickLayout const& GetLayout() const;
+
+  // @returns the offset of the brick with the given key in the file.
+  uint64_t GetOffset(Key key) const;
+
+  // @returns the voxel bytes of a brick.
+  uint64_t GetBrickBytes(Key key) const;
+
+  // @returns the voxel bytes of a brick including the padding, the size of a
+  //   read of the brick.
+  uint64_t GetStoredBytes(Key key) const;
+
+  // @returns the largest GetStoredBytes() of all bricks.
+  uint64_t GetMaxStoredBytes() const;
+
+  // @returns the size of the whole file.
+  uint64_t GetFileSize() const;
+
+  // @returns the alignment of all bricks in the file.
+  static uint64_t GetAlignment();
+
+  // Writes the volume file, any existing file is replaced.
+  // @returns false if the file could not be written.
+  bool Create(std::string const& filename) const;
+
+  // @returns true if the file exists and was created for the same layout,
+  //   brick sizes and voxel size.
+  bool IsCurrent(std::string const& filename) const;
+
+private:
+  BrickLayout m_Layout;
+  uint32_t m_iBytesPerVoxel;
+  // file offset per key, GetKeyCount() + 1 entries
+  std::vector<uint64_t> m_Offsets;
+  // voxel bytes per key
+  std::vector<uint64_t> m_BrickBytes;
+  uint64_t m_iMaxStoredBytes;
+  bool m_bValid;
+};
+
+#endif // BRICK_VOLUME_STORE_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,269 @@
+#include "BrickWorkingSetAnalyzer.h"
+
+#include <algorithm>
+
+#include "BrickLayout.h"
+#include "ThreadPool.h"
+
+namespace {
+
+  typedef BrickAccessTrace::Key Key;
+
+  BrickWorkingSetAnalyzer::Footprint const Empty = { 0, 0, 0, 0 };
+
+  void Add(BrickWorkingSetAnalyzer::Footprint& a, BrickWorkingSetAnalyzer::Footprint const& b)
+  {
+    a.bricks += b.bricks;
+    a.slotBytes += b.slotBytes;
+    a.dataBytes += b.dataBytes;
+    a.coreBytes += b.coreBytes;
+  }
+
+  void Subtract(BrickWorkingSetAnalyzer::Footprint& a, BrickWorkingSetAnalyzer::Footprint const& b)
+  {
+    a.bricks -= b.bricks;
+    a.slotBytes -= b.slotBytes;
+    a.dataBytes -= b.dataBytes;
+    a.coreBytes -= b.coreBytes;
+  }
+
+  void Maximize(BrickWorkingSetAnalyzer::Footprint& a, BrickWorkingSetAnalyzer::Footprint const& b)
+  {
+    a.bricks = std::max(a.bricks, b.bricks);
+    a.slotBytes = std::max(a.slotBytes, b.slotBytes);
+    a.dataBytes = std::max(a.dataBytes, b.dataBytes);
+    a.coreBytes = std::max(a.coreBytes, b.coreBytes);
+  }
+
+  // @returns the number of elements of two sorted ranges which are in both.
+  uint64_t CountShared(std::vector<Key> const& a, std::vector<Key> const& b)
+  {
+    uint64_t count = 0;
+    std::vector<Key>::const_iterator i = a.begin();
+    std::vector<Key>::const_iterator j = b.begin();
+    while (i != a.end() && j != b.end()) {
+      if (*i < *j) {
+        ++i;
+      } else if (*j < *i) {
+        ++j;
+      } else {
+        ++count;
+        ++i;
+        ++j;
+      }
+    }
+    return count;
+  }
+
+}
+
+BrickWorkingSetAnalyzer::BrickWorkingSetAnalyzer(BrickAccessFile const& file, uint32_t bytesPerVoxel)
+  : m_Trace(BrickAccessTrace::FromFile(file, m_OwnTrace))
+{
+  Init(file.GetHeader(), bytesPerVoxel);
+}
+
+BrickWorkingSetAnalyzer::BrickWorkingSetAnalyzer(BrickAccessTrace const& trace,
+  BrickAccessFile::Header const& header, uint32_t bytesPerVoxel)
+  : m_Trace(trace)
+{
+  Init(header, bytesPerVoxel);
+}
+
+void BrickWorkingSetAnalyzer::Init(BrickAccessFile::Header const& header, uint32_t bytesPerVoxel)
+{
+  BrickAccessFile::Vec3<uint32_t> const& maxBrickSize = header.maxBrickSize;
+  BrickAccessFile::Vec3<uint32_t> const& overlap = header.brickOverlap;
+  m_Overlap.x = overlap.x;
+  m_Overlap.y = overlap.y;
+  m_Overlap.z = overlap.z;
+  m_iBytesPerVoxel = bytesPerVoxel;
+  m_iSlotBytes = m_iBytesPerVoxel * maxBrickSize.x * maxBrickSize.y * maxBrickSize.z;
+  m_iWindowSize = 1;
+
+  BrickAccessFile::Vec3<uint64_t> const coreSize = BrickLayout::GetCoreBrickSize(header);
+  m_LoDs.resize(header.domainSizes.size());
+  for (size_t lod=0; lod<m_LoDs.size(); ++lod) {
+    m_LoDs[lod].domainSize = header.domainSizes[lod];
+    m_LoDs[lod].coreSize = coreSize;
+  }
+
+  m_Total = Empty;
+  m_PeakFrame = Empty;
+  m_PeakWindow = Empty;
+}
+
+void BrickWorkingSetAnalyzer::Run(uint32_t windowSize, size_t threadCount)
+{
+  m_iWindowSize = std::max<uint32_t>(windowSize, 1);
+  size_t const frameCount = m_Trace.GetFrameCount();
+  size_t const lodCount = m_LoDs.size();
+  BrickLayout const& layout = m_Trace.GetLayout();
+
+  m_Frames.assign(frameCount, FrameStats());
+  m_LoDBricks.assign(frameCount * lodCount, 0);
+  m_Total = Empty;
+  m_PeakFrame = Empty;
+  m_PeakWindow = Empty;
+
+  // distinct bricks of every frame, sorted by key
+  ThreadPool pool(threadCount);
+  std::vector<std::vector<Key> > uniqueKeys(frameCount);
+  std::vector<std::vector<BrickAccessFile::Brick> > buffers(pool.GetThreadCount());
+  pool.ParallelForThreads(frameCount, [&](size_t f, size_t thread) {
+    BrickAccessTrace::Bricks const keys = m_Trace.GetFrame(f);
+    std::vector<Key>& unique = uniqueKeys[f];
+    unique.assign(keys.begin(), keys.end());
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+    FrameStats& stats = m_Frames[f];
+    stats.requests = keys.size();
+    stats.unique = Empty;
+    stats.sharedBricks = 0;
+    stats.window = Empty;
+    std::vector<BrickAccessFile::Brick>& bricks = buffers[thread];
+    AddBricks(unique.data(), unique.size(), bricks, stats.unique);
+    uint64_t* const lodBricks = m_LoDBricks.data() + f * lodCount;
+    for (size_t i=0; i<bricks.size(); ++i)
+      ++lodBricks[size_t(bricks[i].w)];
+  });
+  std::vector<std::vector<BrickAccessFile::Brick> >().swap(buffers);
+
+  pool.ParallelFor(frameCount, [&](size_t f) {
+    if (f > 0)
+      m_Frames[f].sharedBricks = CountShared(uniqueKeys[f], uniqueKeys[f-1]);
+  });
+
+  // sliding windows: a brick is in the window while its count is non-zero
+  std::vector<uint32_t> counts(size_t(layout.GetKeyCount()), 0);
+  std::vector<bool> seen(counts.size(), false);
+  Footprint window = Empty;
+  for (size_t f=0; f<frameCount; ++f) {
+    std::vector<Key> const& added = uniqueKeys[f];
+    for (size_t i=0; i<added.size(); ++i) {
+      Key const key = added[i];
+      if (counts[size_t(key)]++ == 0) {
+        Footprint const footprint = GetFootprint(layout.GetBrick(key));
+        Add(window, footprint);
+        if (!seen[size_t(key)]) {
+          seen[size_t(key)] = true;
+          Add(m_Total, footprint);
+        }
+      }
+    }
+    if (f >= m_iWindowSize) {
+      std::vector<Key>& removed = uniqueKeys[f - m_iWindowSize];
+      for (size_t i=0; i<removed.size(); ++i) {
+        Key const key = removed[i];
+        if (--counts[size_t(key)] == 0)
+          Subtract(window, GetFootprint(layout.GetBrick(key)));
+      }
+      std::vector<Key>().swap(removed);
+    }
+    m_Frames[f].window = window;
+    Maximize(m_PeakFrame, m_Frames[f].unique);
+    Maximize(m_PeakWindow, window);
+  }
+}
+
+void BrickWorkingSetAnalyzer::AddBricks(Key const* keys, size_t count,
+  std::vector<BrickAccessFile::Brick>& bricks, Footprint& footprint) const
+{
+  bricks.resize(count);
+  m_Trace.GetLayout().GetBricks(keys, count, bricks.data());
+  for (size_t i=0; i<count; ++i)
+    Add(footprint, GetFootprint(bricks[i]));
+}
+
+BrickWorkingSetAnalyzer::Footprint BrickWorkingSetAnalyzer::GetFootprint(BrickAccessFile::Brick const& brick) const
+{
+  LoDInfo const& lod = m_LoDs[size_t(brick.w)];
+  BrickAccessFile::Vec3<uint64_t> const core = BrickLayout::GetCoreExtent(lod.coreSize, lod.domainSize, brick);
+  Footprint footprint;
+  footprint.bricks = 1;
+  footprint.slotBytes = m_iSlotBytes;
+  footprint.dataBytes = m_iBytesPerVoxel * (core.x + 2 * m_Overlap.x) * (core.y + 2 * m_Overlap.y) *
+    (core.z + 2 * m_Overlap.z);
+  footprint.coreBytes = m_iBytesPerVoxel * core.x * core.y * core.z;
+  return footprint;
+}
+
+size_t BrickWorkingSetAnalyzer::GetFrameCount() const
+{
+  return m_Frames.size();
+}
+
+BrickWorkingSetAnalyzer::FrameStats const& BrickWorkingSetAnalyzer::GetFrame(size_t frame) const
+{
+  return m_Frames[frame];
+}
+
+uint64_t BrickWorkingSetAnalyzer::GetLoDBricks(size_t frame, size_t lod) const
+{
+  return m_LoDBricks[frame * m_LoDs.size() + lod];
+}
+
+double BrickWorkingSetAnalyzer::GetOverlapRatio(size_t frame) const
+{
+  FrameStats const& stats = m_Frames[frame];
+  return stats.unique.bricks > 0 ? double(stats.sharedBricks) / double(stats.unique.bricks) : 0.0;
+}
+
+BrickWorkingSetAnalyzer::Footprint const& BrickWorkingSetAnalyzer::GetTotal() const
+{
+  return m_Total;
+}
+
+BrickWorkingSetAnalyzer::Footprint const& BrickWorkingSetAnalyzer::GetPeakFrame() const
+{
+  return m_PeakFrame;
+}
+
+BrickWorkingSetAnalyzer::Footprint const& BrickWorkingSetAnalyzer::GetPeakWindow() const
+{
+  return m_PeakWindow;
+}
+
+void BrickWorkingSetAnalyzer::WriteCsv(std::ostream& stream) const
+{
+  stream << "frame,requests,unique bricks,slot bytes,data bytes,core bytes,shared bricks,overlap ratio,"
+    "window frames,window bricks,window slot bytes,window data bytes,window core bytes";
+  for (size_t lod=0; lod<m_LoDs.size(); ++lod)
+    stream << ",lod " << lod << " bricks";
+  stream << "\n";
+  for (size_t f=0; f<m_Frames.size(); ++f) {
+    FrameStats const& stats = m_Frames[f];
+    stream << f << "," << stats.requests << "," << stats.unique.bricks << "," << stats.unique.slotBytes << ","
+      << stats.unique.dataBytes << "," << stats.unique.coreBytes << "," << stats.sharedBricks << ","
+      << GetOverlapRatio(f) << "," << std::min<size_t>(f + 1, m_iWindowSize) << "," << stats.window.bricks << ","
+      << stats.window.slotBytes << "," << stats.window.dataBytes << "," << stats.window.coreBytes;
+    for (size_t lod=0; lod<m_LoDs.size(); ++lod)
+      stream << "," << GetLoDBricks(f, lod);
+    stream << "\n";
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
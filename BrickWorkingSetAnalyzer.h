@@ -0,0 +1,146 @@
+#pragma once
+
+#ifndef BRICK_WORKING_SET_ANALYZER_H
+#define BRICK_WORKING_SET_ANALYZER_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickAccessTrace.h"
+
+// Computes the working set of every frame of a trace: the distinct bricks a
+// frame requests, their number per LoD and the GPU memory they occupy, the
+// share of bricks the previous frame requested as well, and the working set
+// of a sliding window over the last frames.
+//
+// Memory is given in three variants. Slot bytes assume a brick pool with
+// slots of GetMaxBrickSize() voxels. Data bytes count the actual voxels of
+// every brick including the overlap: a brick holds up to the core size
+// maxBrickSize - 2 * brickOverlap voxels of its LoD, bricks at the upper
+// domain border hold the remaining ones, and the overlap is added on both
+// sides. Core bytes count the voxels without overlap, so summed over a LoD
+// they equal the LoD's domain size.
+//
+// The distinct bricks of the frames are computed in parallel, the sliding
+// windows in one pass over them with a counter per brick key.
+class BrickWorkingSetAnalyzer {
+public:
+  // Memory of a set of bricks.
+  struct Footprint {
+    uint64_t bricks;
+    uint64_t slotBytes;
+    uint64_t dataBytes;
+    uint64_t coreBytes;
+  };
+
+  // Working set of a frame.
+  struct FrameStats {
+    // bricks requested by all subframes, repeats included
+    uint64_t requests;
+    // distinct bricks of the frame
+    Footprint unique;
+    // distinct bricks of the frame which the previous frame requested too
+    uint64_t sharedBricks;
+    // distinct bricks of the last window frames up to this one
+    Footprint window;
+  };
+
+  // Prepares the analysis of a loaded file, see BrickAccessTrace::FromFile().
+  // @param bytesPerVoxel is the size of a voxel on the GPU.
+  explicit BrickWorkingSetAnalyzer(BrickAccessFile const& file, uint32_t bytesPerVoxel = 1);
+
+  // Prepares the analysis of a trace, which has to outlive the analyzer.
+  BrickWorkingSetAnalyzer(BrickAccessTrace const& trace, BrickAccessFile::Header const& header,
+    uint32_t bytesPerVoxel = 1);
+
+  // Analyzes all frames.
+  // @param windowSize is the number of frames of a sliding window, at least
+  //   one.
+  // @param threadCount is the number of threads, zero uses all hardware
+  //   threads.
+  void Run(uint32_t windowSize, size_t threadCount = 0);
+
+  // @returns the number of analyzed frames.
+  size_t GetFrameCount() const;
+
+  // @returns the working set of a frame.
+  FrameStats const& GetFrame(size_t frame) const;
+
+  // @returns the number of distinct bricks of a frame in a LoD.
+  uint64_t GetLoDBricks(size_t frame, size_t lod) const;
+
+  // @returns sharedBricks divided by the distinct bricks of the frame, zero
+  //   for the first frame.
+  double GetOverlapRatio(size_t frame) const;
+
+  // @returns the distinct bricks of the whole trace.
+  Footprint const& GetTotal() const;
+
+  // @returns the largest working set of any frame and of any window, all
+  //   members are maximized independently.
+  Footprint const& GetPeakFrame() const;
+  Footprint const& GetPeakWindow() const;
+
+  // Writes one comma separated line per frame with a header line.
+  void WriteCsv(std::ostream& stream) const;
+
+private:
+  BrickWorkingSetAnalyzer(BrickWorkingSetAnalyzer const&);
+  BrickWorkingSetAnalyzer& operator=(BrickWorkingSetAnalyzer const&);
+
+  void Init(BrickAccessFile::Header const& header, uint32_t bytesPerVoxel);
+
+  // Adds the memory of the given distinct bricks to a footprint.
+  void AddBricks(BrickAccessTrace::Key const* keys, size_t count,
+    std::vector<BrickAccessFile::Brick>& bricks, Footprint& footprint) const;
+  Footprint GetFootprint(BrickAccessFile::Brick const& brick) const;
+
+  // Per-LoD sizes for the voxel counts.
+  struct LoDInfo {
+    BrickAccessFile::Vec3<uint64_t> domainSize;
+    BrickAccessFile::Vec3<uint64_t> coreSize;
+  };
+
+  BrickAccessTrace m_OwnTrace;
+  BrickAccessTrace const& m_Trace;
+  std::vector<LoDInfo> m_LoDs;
+  BrickAccessFile::Vec3<uint64_t> m_Overlap;
+  uint64_t m_iBytesPerVoxel;
+  uint64_t m_iSlotBytes;
+  uint32_t m_iWindowSize;
+
+  std::vector<FrameStats> m_Frames;
+  // distinct bricks per frame and LoD, frame major
+  std::vector<uint64_t> m_LoDBricks;
+  Footprint m_Total;
+  Footprint m_PeakFrame;
+  Footprint m_PeakWindow;
+};
+
+#endif // BRICK_WORKING_SET_ANALYZER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
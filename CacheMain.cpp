@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickCacheSimulator.h"
+#include "BrickDistributionSimulator.h"
+#include "BrickPrefetchEvaluator.h"
+#include "BrickReuseAnalyzer.h"
+#include "BrickWorkingSetAnalyzer.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+  int Usage(char const* arg0)
+  {
+    cerr << "usage: " << GetFilename(arg0) << " [--policy lru|lfu|clock|arc|opt|all]"
+      " [--bytes-per-voxel n] [--threads n] [--frames] filename capacity..." << endl;
+    cerr << "       " << GetFilename(arg0) << " --curve [--granularity request|subframe|frame]"
+      " [--lods] filename [capacity...]" << endl;
+    cerr << "       " << GetFilename(arg0) << " --working-set frames [--bytes-per-voxel n] [--threads n]"
+      " filename" << endl;
+    cerr << "       " << GetFilename(arg0) << " --ranks n [--distribution hash|morton|round-robin|tiles|all]"
+      " [--policy ...]" << endl;
+    cerr << "         [--bytes-per-voxel n] [--threads n] filename capacity..." << endl;
+    cerr << "       " << GetFilename(arg0) << " --predictor neighbors|lod|previous-frame|frequency|markov|all"
+      " [--io-budget n]..." << endl;
+    cerr << "         [--radius n] [--history frames] [--width n] [--bytes-per-voxel n] [--threads n]"
+      " [--frames] filename capacity..." << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Prints the LRU miss counts of the given capacities, or of all capacities
+  // at which the miss count changes if none are given.
+  void PrintCurve(string const& name, BrickReuseAnalyzer::Histogram const& histogram,
+    std::vector<uint64_t> const& capacities)
+  {
+    std::vector<uint64_t> misses;
+    histogram.GetMissCurve(misses);
+    std::vector<uint64_t> points(capacities);
+    if (points.empty()) {
+      points.push_back(0);
+      for (size_t d=0; d<histogram.distances.size(); ++d) {
+        if (histogram.distances[d] != 0)
+          points.push_back(d+1);
+      }
+    }
+    for (size_t i=0; i<points.size(); ++i) {
+      uint64_t const missCount = misses[size_t(std::min<uint64_t>(points[i], misses.size()-1))];
+      cout << name << "," << points[i] << "," << histogram.requests << "," << missCount << ","
+        << (histogram.requests > 0 ? double(missCount) / double(histogram.requests) : 0.0) << endl;
+    }
+  }
+
+  // Computes the miss counts of all LRU cache sizes in one pass.
+  int PrintReuseCurves(BrickAccessFile const& baf, BrickReuseAnalyzer::Granularity granularity,
+    bool perLoD, std::vector<uint64_t> const& capacities)
+  {
+    BrickReuseAnalyzer analyzer(baf.GetTrace().GetLayout(), granularity, perLoD);
+    analyzer.AddFile(baf);
+
+    cout << "lod,capacity,requests,misses,miss ratio" << endl;
+    PrintCurve("all", analyzer.GetHistogram(), capacities);
+    for (size_t lod=0; perLoD && lod<baf.GetLoDCount(); ++lod) {
+      std::ostringstream name;
+      name << lod;
+      PrintCurve(name.str(), analyzer.GetLoDHistogram(lod), capacities);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Prints the working set of every frame and of a sliding window.
+  int PrintWorkingSets(BrickAccessFile const& baf, uint32_t windowSize, uint32_t bytesPerVoxel,
+    size_t threadCount)
+  {
+    BrickWorkingSetAnalyzer analyzer(baf, bytesPerVoxel);
+    analyzer.Run(windowSize, threadCount);
+    analyzer.WriteCsv(cout);
+
+    BrickWorkingSetAnalyzer::Footprint const& total = analyzer.GetTotal();
+    BrickWorkingSetAnalyzer::Footprint const& frame = analyzer.GetPeakFrame();
+    BrickWorkingSetAnalyzer::Footprint const& window = analyzer.GetPeakWindow();
+    cerr << "trace bricks:       " << total.bricks << " (" << total.slotBytes << " slot bytes)" << endl;
+    cerr << "peak frame bricks:  " << frame.bricks << " (" << frame.slotBytes << " slot bytes)" << endl;
+    cerr << "peak window bricks: " << window.bricks << " (" << window.slotBytes << " slot bytes)" << endl;
+    return EXIT_SUCCESS;
+  }
+
+  // Simulates every distribution, policy and per-rank capacity on a cluster
+  // and prints one line for the whole cluster and one per rank.
+  int PrintDistributions(BrickAccessFile const& baf, uint32_t rankCount,
+    std::vector<BrickDistributionSimulator::Distribution> const& distributions,
+    std::vector<BrickCacheSimulator::Config> const& caches, uint32_t bytesPerVoxel, size_t threadCount)
+  {
+    BrickDistributionSimulator simulator(baf, bytesPerVoxel);
+    cout << "distribution,ranks,policy,capacity,rank,requests,misses,hit rate,load bytes,transfer bytes,"
+      "request imbalance,miss imbalance,frame imbalance,critical misses,replication" << endl;
+    for (size_t d=0; d<distributions.size(); ++d) {
+      for (size_t c=0; c<caches.size(); ++c) {
+        BrickDistributionSimulator::Config config;
+        config.distribution = distributions[d];
+        config.rankCount = rankCount;
+        config.cache = caches[c];
+        BrickDistributionSimulator::Result result;
+        simulator.Run(config, result, threadCount);
+
+        std::ostringstream prefix;
+        prefix << BrickDistributionSimulator::GetDistributionName(config.distribution) << ","
+          << result.config.rankCount << "," << BrickCacheSimulator::GetPolicyName(config.cache.policy)
+          << "," << config.cache.capacity << ",";
+        cout << prefix.str() << "all," << result.requests << "," << result.misses << ","
+          << (result.requests > 0 ? 1.0 - double(result.misses) / double(result.requests) : 1.0) << ","
+          << result.loadBytes << "," << result.transferBytes << "," << result.requestImbalance << ","
+          << result.missImbalance << "," << result.frameImbalance << "," << result.criticalMisses << ","
+          << result.GetReplication() << endl;
+        // the imbalance of a rank is its share relative to the mean
+        double const meanRequests = double(result.requests) / double(result.ranks.size());
+        double const meanMisses = double(result.misses) / double(result.ranks.size());
+        for (size_t r=0; r<result.ranks.size(); ++r) {
+          BrickCacheSimulator::Stats const& stats = result.ranks[r].total;
+          cout << prefix.str() << r << "," << stats.requests << "," << stats.misses << ","
+            << stats.GetHitRate() << "," << (stats.misses - stats.remoteMisses) * simulator.GetBrickBytes()
+            << "," << stats.remoteMisses * simulator.GetBrickBytes() << ","
+            << (meanRequests > 0.0 ? double(stats.requests) / meanRequests : 1.0) << ","
+            << (meanMisses > 0.0 ? double(stats.misses) / meanMisses : 1.0) << ",,," << endl;
+        }
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Evaluates every predictor with every LRU capacity and I/O budget.
+  int PrintPrefetching(BrickAccessFile const& baf, std::vector<BrickPredictor::Config> const& predictors,
+    std::vector<uint64_t> const& capacities, std::vector<uint64_t> const& ioBudgets, bool perFrame,
+    uint32_t bytesPerVoxel, size_t threadCount)
+  {
+    std::vector<BrickPrefetchEvaluator::Config> configs;
+    for (size_t p=0; p<predictors.size(); ++p) {
+      for (size_t c=0; c<capacities.size(); ++c) {
+        for (size_t b=0; b<ioBudgets.size(); ++b) {
+          BrickPrefetchEvaluator::Config config;
+          config.predictor = predictors[p];
+          config.capacity = capacities[c];
+          config.ioBudget = ioBudgets[b];
+          configs.push_back(config);
+        }
+      }
+    }
+
+    BrickPrefetchEvaluator evaluator(baf, bytesPerVoxel);
+    std::vector<BrickPrefetchEvaluator::Result> results;
+    evaluator.Run(configs, results, threadCount);
+
+    // comma separated values, one line per config or per config and frame
+    cout << "predictor,capacity,io budget," << (perFrame ? "frame," : "") << "requests,new bricks,"
+      "candidates,prefetches,useful,new misses,capacity misses,precision,recall,wasted bytes,hidden ratio,"
+      "seconds" << endl;
+    for (size_t r=0; r<results.size(); ++r) {
+      BrickPrefetchEvaluator::Result const& result = results[r];
+      size_t const count = perFrame ? result.frames.size() : 1;
+      for (size_t f=0; f<count; ++f) {
+        BrickPrefetchEvaluator::Stats const& stats = perFrame ? result.frames[f] : result.total;
+        cout << BrickPredictor::GetTypeName(result.config.predictor.type) << "," << result.config.capacity
+          << "," << result.config.ioBudget << ",";
+        if (perFrame)
+          cout << f << ",";
+        cout << stats.requests << "," << stats.newBricks << "," << stats.candidates << ","
+          << stats.prefetches << "," << stats.useful << "," << stats.newMisses << ","
+          << stats.capacityMisses << ","
+          << stats.GetPrecision() << "," << stats.GetRecall() << "," << stats.wastedBytes << ","
+          << stats.GetHiddenRatio() << "," << result.seconds << endl;
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+}
+
+// Replays a brick access file through simulated brick caches and prints hit
+// rates and transfer volumes for every policy and capacity (in bricks).
+int main(int argc, char const *argv[])
+{
+  std::vector<BrickCacheSimulator::Policy> policies;
+  uint32_t bytesPerVoxel = 1;
+  size_t threadCount = 0;
+  bool perFrame = false;
+  bool curve = false;
+  bool perLoD = false;
+  uint32_t windowSize = 0;
+  uint32_t rankCount = 0;
+  std::vector<BrickDistributionSimulator::Distribution> distributions;
+  std::vector<BrickPredictor::Type> predictorTypes;
+  std::vector<uint64_t> ioBudgets;
+  BrickPredictor::Config predictorParameters = BrickPredictor::GetDefaultConfig(BrickPredictor::PT_NEIGHBORS);
+  BrickReuseAnalyzer::Granularity granularity = BrickReuseAnalyzer::RG_REQUEST;
+  int argi = 1;
+  for (; argi < argc; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--policy" && argi+1 < argc) {
+      string const name(argv[++argi]);
+      BrickCacheSimulator::Policy policy;
+      if (name == "all") {
+        for (int i=0; i<BrickCacheSimulator::CP_COUNT; ++i)
+          policies.push_back(BrickCacheSimulator::Policy(i));
+      } else if (BrickCacheSimulator::ParsePolicy(name, policy)) {
+        policies.push_back(policy);
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (flag == "--bytes-per-voxel" && argi+1 < argc) {
+      bytesPerVoxel = uint32_t(atoi(argv[++argi]));
+    } else if (flag == "--threads" && argi+1 < argc) {
+      threadCount = size_t(atoi(argv[++argi]));
+    } else if (flag == "--frames") {
+      perFrame = true;
+    } else if (flag == "--curve") {
+      curve = true;
+    } else if (flag == "--lods") {
+      perLoD = true;
+    } else if (flag == "--working-set" && argi+1 < argc) {
+      windowSize = uint32_t(std::max(atoi(argv[++argi]), 1));
+    } else if (flag == "--ranks" && argi+1 < argc) {
+      rankCount = uint32_t(std::max(atoi(argv[++argi]), 1));
+    } else if (flag == "--distribution" && argi+1 < argc) {
+      string const name(argv[++argi]);
+      BrickDistributionSimulator::Distribution distribution;
+      if (name == "all") {
+        for (int i=0; i<BrickDistributionSimulator::DP_COUNT; ++i)
+          distributions.push_back(BrickDistributionSimulator::Distribution(i));
+      } else if (BrickDistributionSimulator::ParseDistribution(name, distribution)) {
+        distributions.push_back(distribution);
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (flag == "--predictor" && argi+1 < argc) {
+      string const name(argv[++argi]);
+      BrickPredictor::Type type;
+      if (name == "all") {
+        for (int i=0; i<BrickPredictor::PT_COUNT; ++i)
+          predictorTypes.push_back(BrickPredictor::Type(i));
+      } else if (BrickPredictor::ParseType(name, type)) {
+        predictorTypes.push_back(type);
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (flag == "--io-budget" && argi+1 < argc) {
+      ioBudgets.push_back(strtoull(argv[++argi], nullptr, 10));
+    } else if (flag == "--radius" && argi+1 < argc) {
+      predictorParameters.radius = uint32_t(std::max(atoi(argv[++argi]), 1));
+    } else if (flag == "--history" && argi+1 < argc) {
+      predictorParameters.history = uint32_t(std::max(atoi(argv[++argi]), 1));
+    } else if (flag == "--width" && argi+1 < argc) {
+      predictorParameters.width = uint32_t(std::max(atoi(argv[++argi]), 1));
+    } else if (flag == "--granularity" && argi+1 < argc) {
+      string const name(argv[++argi]);
+      if (name == "request")
+        granularity = BrickReuseAnalyzer::RG_REQUEST;
+      else if (name == "subframe")
+        granularity = BrickReuseAnalyzer::RG_SUBFRAME;
+      else if (name == "frame")
+        granularity = BrickReuseAnalyzer::RG_FRAME;
+      else
+        return Usage(argv[0]);
+    } else {
+      break;
+    }
+  }
+  if (argc - argi < (curve || windowSize > 0 ? 1 : 2)) {
+    return Usage(argv[0]);
+  }
+  if (policies.empty()) {
+    policies.push_back(BrickCacheSimulator::CP_LRU);
+  }
+  if (distributions.empty()) {
+    distributions.push_back(BrickDistributionSimulator::DP_HASH);
+  }
+  if (ioBudgets.empty()) {
+    ioBudgets.push_back(0);
+  }
+
+  BrickAccessFile baf(argv[argi]);
+  baf.SetStorage(BrickAccessFile::ST_FLAT);
+  if (!baf.Load(BrickAccessFile::LM_PARALLEL, threadCount)) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<uint64_t> capacities;
+  for (int i=argi+1; i<argc; ++i) {
+    capacities.push_back(strtoull(argv[i], nullptr, 10));
+  }
+  if (curve) {
+    return PrintReuseCurves(baf, granularity, perLoD, capacities);
+  }
+  if (windowSize > 0) {
+    return PrintWorkingSets(baf, windowSize, bytesPerVoxel, threadCount);
+  }
+
+  if (!predictorTypes.empty()) {
+    std::vector<BrickPredictor::Config> predictors(predictorTypes.size(), predictorParameters);
+    for (size_t i=0; i<predictorTypes.size(); ++i)
+      predictors[i].type = predictorTypes[i];
+    return PrintPrefetching(baf, predictors, capacities, ioBudgets, perFrame, bytesPerVoxel, threadCount);
+  }
+
+  std::vector<BrickCacheSimulator::Config> configs;
+  for (size_t i=0; i<capacities.size(); ++i) {
+    for (size_t p=0; p<policies.size(); ++p) {
+      BrickCacheSimulator::Config config;
+      config.policy = policies[p];
+      config.capacity = capacities[i];
+      configs.push_back(config);
+    }
+  }
+  if (rankCount > 0) {
+    return PrintDistributions(baf, rankCount, distributions, configs, bytesPerVoxel, threadCount);
+  }
+
+  BrickCacheSimulator simulator(baf, bytesPerVoxel);
+  std::vector<BrickCacheSimulator::Result> results;
+  simulator.Run(configs, results, threadCount);
+
+  // comma separated values, one line per cache or per cache and frame
+  cout << "policy,capacity," << (perFrame ? "frame," : "") << "requests,hits,misses,hit rate,bytes" << endl;
+  for (size_t r=0; r<results.size(); ++r) {
+    BrickCacheSimulator::Result const& result = results[r];
+    char const* const name = BrickCacheSimulator::GetPolicyName(result.config.policy);
+    size_t const count = perFrame ? result.frames.size() : 1;
+    for (size_t f=0; f<count; ++f) {
+      BrickCacheSimulator::Stats const& stats = perFrame ? result.frames[f] : result.total;
+      cout << name << "," << result.config.capacity << ",";
+      if (perFrame)
+        cout << f << ",";
+      cout << stats.requests << "," << stats.hits << "," << stats.misses << ","
+        << stats.GetHitRate() << "," << stats.bytes << endl;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+
+#include "BrickAccessBinaryFile.h"
+#include "BrickAccessBinaryWriter.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+}
+
+// Converts an ASCII brick access file (*.ba) into the binary format (*.bab),
+// which can be opened instantly through BrickAccessBinaryFile.
+int main(int argc, char const *argv[])
+{
+  if (argc != 3) {
+    string const arg0(argv[0]);
+    cerr << "usage: " << GetFilename(arg0) << " input.ba output.bab" << endl;
+    return EXIT_FAILURE;
+  }
+
+  string const source(argv[1]);
+  string const target(argv[2]);
+
+  if (!BrickAccessBinaryWriter::Convert(source, target)) {
+    return EXIT_FAILURE;
+  }
+
+  BrickAccessBinaryFile babf;
+  if (!babf.Open(target) || !babf.Validate()) {
+    return EXIT_FAILURE;
+  }
+
+  cout << "levels of detail:     " << babf.GetLoDCount() << endl;
+  cout << "total frame count:    " << babf.GetFrameCount() << endl;
+  cout << "total subframe count: " << babf.GetTotalSubframeCount() << endl;
+  cout << "total brick count:    " << babf.GetTotalBrickCount() << endl;
+
+  return EXIT_SUCCESS;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "BrickAccessGenerator.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+  int Usage(char const* arg0)
+  {
+    cerr << "usage: " << GetFilename(arg0) << " [--frames n] [--subframes n] [--domain x y z]"
+      " [--brick-size n] [--overlap n] [--orbit frames] [--zoom min max] [--zoom-period frames]"
+      " [--fov degrees] [--screen-height pixels] [--empty fraction] [--seed n] [--threads n]"
+      " filename" << endl;
+    return EXIT_FAILURE;
+  }
+
+}
+
+// Writes a synthetic brick access file of a camera orbiting a bricked volume,
+// see BrickAccessGenerator for the model.
+int main(int argc, char const *argv[])
+{
+  BrickAccessGenerator::Config config = BrickAccessGenerator::GetDefaultConfig();
+  size_t threadCount = 0;
+  int argi = 1;
+  for (; argi < argc-1; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--frames" && argi+1 < argc-1) {
+      config.frameCount = uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--subframes" && argi+1 < argc-1) {
+      config.subframeCount = uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--domain" && argi+3 < argc-1) {
+      config.domainSize.x = strtoull(argv[++argi], nullptr, 10);
+      config.domainSize.y = strtoull(argv[++argi], nullptr, 10);
+      config.domainSize.z = strtoull(argv[++argi], nullptr, 10);
+    } else if (flag == "--brick-size" && argi+1 < argc-1) {
+      config.maxBrickSize.x = config.maxBrickSize.y = config.maxBrickSize.z =
+        uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--overlap" && argi+1 < argc-1) {
+      config.brickOverlap.x = config.brickOverlap.y = config.brickOverlap.z =
+        uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--orbit" && argi+1 < argc-1) {
+      config.framesPerOrbit = uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--zoom" && argi+2 < argc-1) {
+      config.minDistance = atof(argv[++argi]);
+      config.maxDistance = atof(argv[++argi]);
+    } else if (flag == "--zoom-period" && argi+1 < argc-1) {
+      config.zoomPeriod = uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--fov" && argi+1 < argc-1) {
+      config.fieldOfView = atof(argv[++argi]);
+    } else if (flag == "--screen-height" && argi+1 < argc-1) {
+      config.screenHeight = uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else if (flag == "--empty" && argi+1 < argc-1) {
+      config.emptyFraction = atof(argv[++argi]);
+    } else if (flag == "--seed" && argi+1 < argc-1) {
+      config.seed = strtoull(argv[++argi], nullptr, 10);
+    } else if (flag == "--threads" && argi+1 < argc-1) {
+      threadCount = size_t(atoi(argv[++argi]));
+    } else {
+      break;
+    }
+  }
+  if (argi != argc-1) {
+    return Usage(argv[0]);
+  }
+
+  BrickAccessGenerator generator(config);
+  if (!generator.IsValid()) {
+    cerr << "the overlap leaves no voxels in a brick or the domain is empty" << endl;
+    return EXIT_FAILURE;
+  }
+
+  std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+  if (!generator.Write(argv[argc-1], threadCount)) {
+    return EXIT_FAILURE;
+  }
+  double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  cout << "levels of detail: " << generator.GetHeader().brickCounts.size() << endl;
+  cout << "frame count:      " << config.frameCount << endl;
+  cout << "seconds:          " << seconds << endl;
+  return EXIT_SUCCESS;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,130 @@
+#include "LineReader.h"
+
+#include <cstring>
+
+LineReader::LineReader(size_t bufferSize)
+  : m_Buffer(bufferSize > 0 ? bufferSize : 1)
+  , m_iBegin(0)
+  , m_iEnd(0)
+  , m_iLineBegin(0)
+  , m_iPosition(0)
+  , m_bEOF(false)
+  , m_bFailed(false)
+{}
+
+bool LineReader::Open(std::string const& filename)
+{
+  Close();
+  m_File.open(filename.c_str(), std::ios::in | std::ios::binary);
+  return m_File.is_open();
+}
+
+void LineReader::Close()
+{
+  if (m_File.is_open())
+    m_File.close();
+  m_File.clear();
+  m_iBegin = 0;
+  m_iEnd = 0;
+  m_iLineBegin = 0;
+  m_iPosition = 0;
+  m_bEOF = false;
+  m_bFailed = false;
+}
+
+bool LineReader::IsOpen() const
+{
+  return m_File.is_open();
+}
+
+bool LineReader::NextLine(char const*& begin, char const*& end)
+{
+  for (;;) {
+    char const* const data = m_Buffer.data();
+    char const* eol = static_cast<char const*>(memchr(data + m_iBegin, '\n', m_iEnd - m_iBegin));
+    if (eol != nullptr) {
+      begin = data + m_iBegin;
+      end = eol;
+      m_iLineBegin = m_iBegin;
+      m_iBegin = size_t(eol - data) + 1;
+      m_iPosition += m_iBegin - m_iLineBegin;
+      return true;
+    }
+    if (m_bEOF) {
+      if (m_iBegin == m_iEnd)
+        return false;
+      // the last line does not need a terminator
+      begin = data + m_iBegin;
+      end = data + m_iEnd;
+      m_iLineBegin = m_iBegin;
+      m_iBegin = m_iEnd;
+      m_iPosition += m_iBegin - m_iLineBegin;
+      return true;
+    }
+    Fill();
+  }
+}
+
+void LineReader::UnreadLine()
+{
+  m_iPosition -= m_iBegin - m_iLineBegin;
+  m_iBegin = m_iLineBegin;
+}
+
+bool LineReader::HasFailed() const
+{
+  return m_bFailed;
+}
+
+uint64_t LineReader::GetPosition() const
+{
+  return m_iPosition;
+}
+
+bool LineReader::Fill()
+{
+  if (m_iBegin > 0) {
+    memmove(m_Buffer.data(), m_Buffer.data() + m_iBegin, m_iEnd - m_iBegin);
+    m_iEnd -= m_iBegin;
+    m_iLineBegin = 0;
+    m_iBegin = 0;
+  }
+  if (m_iEnd == m_Buffer.size())
+    m_Buffer.resize(m_Buffer.size() * 2); // a single line exceeds the buffer
+
+  size_t count = 0;
+  if (m_File.is_open() && m_File.good()) {
+    m_File.read(m_Buffer.data() + m_iEnd, std::streamsize(m_Buffer.size() - m_iEnd));
+    count = size_t(m_File.gcount());
+  }
+  m_iEnd += count;
+  if (count == 0) {
+    m_bEOF = true;
+    m_bFailed = !m_File.is_open() || m_File.bad();
+  }
+  return count > 0;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+// Reads a file line by line through a fixed size buffer. Lines are returned
+// as character ranges inside of the buffer, so no strings are created and the
+// memory footprint does not depend on the file size. The buffer only grows if
+// a single line does not fit into it.
+class LineReader {
+public:
+  // @param bufferSize is the initial size of the read buffer in bytes.
+  explicit LineReader(size_t bufferSize = 1 << 20);
+
+  // Opens the given file for reading.
+  // @returns false if the file could not be opened.
+  bool Open(std::string const& filename);
+
+  // Closes the file.
+  void Close();
+
+  // @returns true if a file is open.
+  bool IsOpen() const;
+
+  // Fetches the next line without its terminating '\n'. The range stays
+  // valid until the next call to NextLine().
+  // @returns false at the end of the file or if reading failed.
+  bool NextLine(char const*& begin, char const*& end);
+
+  // Makes the next NextLine() call return the last line again. Only the most
+  // recent line can be pushed back.
+  void UnreadLine();
+
+  // @returns true if reading failed for another reason than the end of file.
+  bool HasFailed() const;
+
+  // @returns the number of bytes consumed so far, including terminators.
+  uint64_t GetPosition() const;
+
+private:
+  // Moves unconsumed data to the front of the buffer and reads more data.
+  // @returns false if no more data could be read.
+  bool Fill();
+
+  std::ifstream m_File;
+  std::vector<char> m_Buffer;
+  size_t m_iBegin;
+  size_t m_iEnd;
+  size_t m_iLineBegin;
+  uint64_t m_iPosition;
+  bool m_bEOF;
+  bool m_bFailed;
+};
+
+#endif // LINE_READER_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,161 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+  : m_Data(nullptr)
+  , m_Size(0)
+  , m_IsOpen(false)
+#ifdef _WIN32
+  , m_File(INVALID_HANDLE_VALUE)
+  , m_Mapping(nullptr)
+#else
+  , m_File(-1)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(std::string const& filename)
+{
+  Close();
+
+  m_File = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+    nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (m_File == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_File, &size)) {
+    Close();
+    return false;
+  }
+  m_Size = uint64_t(size.QuadPart);
+  m_IsOpen = true;
+  if (m_Size == 0)
+    return true; // empty files cannot be mapped
+
+  m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_Mapping == nullptr) {
+    Close();
+    return false;
+  }
+  m_Data = static_cast<char const*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+  if (m_Data == nullptr) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (m_Data != nullptr)
+    UnmapViewOfFile(m_Data);
+  if (m_Mapping != nullptr)
+    CloseHandle(m_Mapping);
+  if (m_File != INVALID_HANDLE_VALUE)
+    CloseHandle(m_File);
+  m_Data = nullptr;
+  m_Mapping = nullptr;
+  m_File = INVALID_HANDLE_VALUE;
+  m_Size = 0;
+  m_IsOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(std::string const& filename)
+{
+  Close();
+
+  m_File = open(filename.c_str(), O_RDONLY);
+  if (m_File < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(m_File, &info) != 0) {
+    Close();
+    return false;
+  }
+  m_Size = uint64_t(info.st_size);
+  m_IsOpen = true;
+  if (m_Size == 0)
+    return true; // empty files cannot be mapped
+
+  void* data = mmap(nullptr, size_t(m_Size), PROT_READ, MAP_PRIVATE, m_File, 0);
+  if (data == MAP_FAILED) {
+    Close();
+    return false;
+  }
+  // the parsers walk the file front to back, let the kernel read ahead
+  madvise(data, size_t(m_Size), MADV_SEQUENTIAL);
+  m_Data = static_cast<char const*>(data);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (m_Data != nullptr)
+    munmap(const_cast<char*>(m_Data), size_t(m_Size));
+  if (m_File >= 0)
+    close(m_File);
+  m_Data = nullptr;
+  m_File = -1;
+  m_Size = 0;
+  m_IsOpen = false;
+}
+
+#endif
+
+bool MappedFile::IsOpen() const
+{
+  return m_IsOpen;
+}
+
+char const* MappedFile::GetData() const
+{
+  return m_Data;
+}
+
+uint64_t MappedFile::GetSize() const
+{
+  return m_Size;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file. The mapped bytes stay valid until
+// the object is closed or destroyed, which allows parsers to scan the file
+// contents in place without copying them into intermediate buffers.
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  // Maps the given file into memory. Any previously mapped file is closed.
+  // @returns false if the file could not be opened or mapped. Empty files are
+  //   mapped successfully with a size of zero and a null data pointer.
+  bool Open(std::string const& filename);
+
+  // Releases the mapping and the underlying file handle.
+  void Close();
+
+  // @returns true if a file is currently mapped.
+  bool IsOpen() const;
+
+  // @returns the first byte of the mapping.
+  char const* GetData() const;
+
+  // @returns the size of the mapping in bytes.
+  uint64_t GetSize() const;
+
+private:
+  // Mappings are unique resources, copying is not supported.
+  MappedFile(MappedFile const&);
+  MappedFile& operator=(MappedFile const&);
+
+  char const* m_Data;
+  uint64_t m_Size;
+  bool m_IsOpen;
+#ifdef _WIN32
+  void* m_File;
+  void* m_Mapping;
+#else
+  int m_File;
+#endif
+};
+
+#endif // MAPPED_FILE_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BrickAccessFile.h"
+#include "BrickIoReplayer.h"
+#include "BrickReadPlanner.h"
+#include "BrickVolumeStore.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+  int Usage(char const* arg0)
+  {
+    cerr << "usage: " << GetFilename(arg0) << " [--volume filename] [--bytes-per-voxel n]"
+      " [--order row|morton|hilbert]" << endl;
+    cerr << "       [--backend pread|uring|mmap|all]... [--queue-depth n]... [--direct] [--drop-cache]"
+      " [--subframes]" << endl;
+    cerr << "       [--coalesce gapBytes]... [--max-read bytes] [--plan] filename" << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Plans the reads of all subframes for every gap without reading anything.
+  int PrintPlans(BrickAccessTrace const& trace, BrickVolumeStore const& store,
+    std::vector<int64_t> const& gaps, uint64_t maxReadBytes)
+  {
+    cout << "gap,requests,bricks,reads,trace seeks,planned seeks,useful bytes,read bytes,"
+      "requests per read,seek reduction,read amplification" << endl;
+    BrickReadPlanner planner(store);
+    planner.SetMaxReadBytes(maxReadBytes);
+    for (size_t g=0; g<gaps.size(); ++g) {
+      if (gaps[g] < 0)
+        continue;
+      planner.SetGap(uint64_t(gaps[g]));
+      BrickReadPlanner::Stats const stats = planner.PlanTrace(trace);
+      cout << gaps[g] << "," << stats.requests << "," << stats.bricks << "," << stats.reads << ","
+        << stats.traceSeeks << "," << stats.plannedSeeks << "," << stats.usefulBytes << ","
+        << stats.readBytes << ","
+        << (stats.reads > 0 ? double(stats.requests) / double(stats.reads) : 0.0) << ","
+        << (stats.traceSeeks > 0 ? 1.0 - double(stats.plannedSeeks) / double(stats.traceSeeks) : 0.0) << ","
+        << (stats.usefulBytes > 0 ? double(stats.readBytes) / double(stats.usefulBytes) : 0.0) << endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+}
+
+// Replays a brick access file as reads from a local bricked volume file and
+// prints subframe latency percentiles, throughput and queue depths for every
+// backend, queue depth and coalescing gap. The volume file is created next to
+// the trace if it does not exist or does not match the dataset. --plan only
+// reports how many requests and seeks coalescing saves, without any I/O.
+int main(int argc, char const *argv[])
+{
+  std::vector<BrickIoReplayer::Backend> backends;
+  std::vector<uint32_t> queueDepths;
+  // a negative gap replays every request without coalescing
+  std::vector<int64_t> gaps;
+  uint64_t maxReadBytes = 8 << 20;
+  bool plan = false;
+  string volumeFilename;
+  uint32_t bytesPerVoxel = 1;
+  BrickAccessFile::KeyOrder order = BrickAccessFile::KO_ROW_MAJOR;
+  bool bDirect = false;
+  bool bDropCache = false;
+  bool perSubframe = false;
+  int argi = 1;
+  for (; argi < argc; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--backend" && argi+1 < argc) {
+      string const name(argv[++argi]);
+      BrickIoReplayer::Backend backend;
+      if (name == "all") {
+        for (int i=0; i<BrickIoReplayer::IB_COUNT; ++i) {
+          if (BrickIoReplayer::IsSupported(BrickIoReplayer::Backend(i)))
+            backends.push_back(BrickIoReplayer::Backend(i));
+        }
+      } else if (BrickIoReplayer::ParseBackend(name, backend)) {
+        backends.push_back(backend);
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (flag == "--queue-depth" && argi+1 < argc) {
+      queueDepths.push_back(uint32_t(std::max(atoi(argv[++argi]), 1)));
+    } else if (flag == "--volume" && argi+1 < argc) {
+      volumeFilename = argv[++argi];
+    } else if (flag == "--bytes-per-voxel" && argi+1 < argc) {
+      bytesPerVoxel = uint32_t(std::max(atoi(argv[++argi]), 1));
+    } else if (flag == "--order" && argi+1 < argc) {
+      string const name(argv[++argi]);
+      if (name == "row")
+        order = BrickAccessFile::KO_ROW_MAJOR;
+      else if (name == "morton")
+        order = BrickAccessFile::KO_MORTON;
+      else if (name == "hilbert")
+        order = BrickAccessFile::KO_HILBERT;
+      else
+        return Usage(argv[0]);
+    } else if (flag == "--direct") {
+      bDirect = true;
+    } else if (flag == "--drop-cache") {
+      bDropCache = true;
+    } else if (flag == "--subframes") {
+      perSubframe = true;
+    } else if (flag == "--coalesce" && argi+1 < argc) {
+      gaps.push_back(std::max<int64_t>(strtoll(argv[++argi], nullptr, 10), 0));
+    } else if (flag == "--max-read" && argi+1 < argc) {
+      maxReadBytes = strtoull(argv[++argi], nullptr, 10);
+    } else if (flag == "--plan") {
+      plan = true;
+    } else {
+      break;
+    }
+  }
+  if (argc - argi != 1) {
+    return Usage(argv[0]);
+  }
+  if (backends.empty()) {
+    backends.push_back(BrickIoReplayer::IB_PREAD);
+  }
+  if (queueDepths.empty()) {
+    queueDepths.push_back(8);
+  }
+  if (gaps.empty()) {
+    gaps.push_back(plan ? 0 : -1);
+  }
+  string const filename(argv[argi]);
+  if (volumeFilename.empty()) {
+    volumeFilename = filename + ".bricks";
+  }
+
+  BrickAccessFile baf(filename);
+  baf.SetStorage(BrickAccessFile::ST_FLAT, order);
+  if (!baf.Load(BrickAccessFile::LM_PARALLEL)) {
+    return EXIT_FAILURE;
+  }
+  BrickAccessTrace const& trace = baf.GetTrace();
+  BrickVolumeStore const store(trace.GetLayout(), baf.GetHeader(), bytesPerVoxel);
+  if (!store.IsValid()) {
+    cerr << "failed to lay out the bricks of " << filename << endl;
+    return EXIT_FAILURE;
+  }
+  if (plan) {
+    return PrintPlans(trace, store, gaps, maxReadBytes);
+  }
+  if (!store.IsCurrent(volumeFilename)) {
+    cerr << "creating volume file " << volumeFilename << " with " << store.GetFileSize() << " bytes" << endl;
+    if (!store.Create(volumeFilename))
+      return EXIT_FAILURE;
+  }
+
+  BrickIoReplayer replayer(trace, store, volumeFilename);
+  if (perSubframe) {
+    cout << "backend,queue depth,gap,frame,subframe,requested bricks,ms" << endl;
+  } else {
+    cout << "backend,queue depth,gap,requested bricks,reads,bytes,seconds,MB/s,reads/s,p50 ms,p90 ms,p99 ms,max ms,"
+      "average queue depth,peak queue depth" << endl;
+  }
+  for (size_t b=0; b<backends.size(); ++b) {
+    for (size_t q=0; q<queueDepths.size(); ++q) {
+      for (size_t g=0; g<gaps.size(); ++g) {
+        BrickIoReplayer::Config config;
+        config.backend = backends[b];
+        config.queueDepth = queueDepths[q];
+        config.bDirect = bDirect;
+        config.bDropCache = bDropCache;
+        config.bCoalesce = gaps[g] >= 0;
+        config.gapBytes = config.bCoalesce ? uint64_t(gaps[g]) : 0;
+        config.maxReadBytes = maxReadBytes;
+        BrickIoReplayer::Result result;
+        if (!replayer.Run(config, result))
+          return EXIT_FAILURE;
+
+        char const* const name = BrickIoReplayer::GetBackendName(config.backend);
+        string const gap = config.bCoalesce ? std::to_string(config.gapBytes) : string("none");
+        if (perSubframe) {
+          size_t i = 0;
+          for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+            for (size_t s=0; s<trace.GetSubframeCount(f); ++s, ++i) {
+              cout << name << "," << config.queueDepth << "," << gap << "," << f << "," << s << ","
+                << trace.GetSubframe(f, s).size() << "," << result.subframeSeconds[i] * 1e3 << endl;
+            }
+          }
+          continue;
+        }
+        cout << name << "," << config.queueDepth << "," << gap << "," << result.bricks << ","
+          << result.reads << "," << result.bytes << ","
+          << result.seconds << "," << result.GetThroughput() / 1e6 << ","
+          << (result.seconds > 0.0 ? double(result.reads) / result.seconds : 0.0) << ","
+          << result.GetPercentile(50.0) * 1e3 << "," << result.GetPercentile(90.0) * 1e3 << ","
+          << result.GetPercentile(99.0) * 1e3 << "," << result.GetPercentile(100.0) * 1e3 << ","
+          << result.averageQueueDepth << "," << result.peakQueueDepth << endl;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
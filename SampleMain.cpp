@@ -1,7 +1,13 @@
 #include <iostream>
 #include <string>
 
+#include "BrickAccessArena.h"
+#include "BrickAccessCompressedTrace.h"
 #include "BrickAccessFile.h"
+#include "BrickAccessFollower.h"
+#include "BrickAccessStats.h"
+#include "BrickAccessStream.h"
+#include "BrickAccessTrace.h"
 
 using std::cerr;
 using std::cout;
@@ -15,6 +21,68 @@ string GetFilename(const std::string& filename)
   return name;
 }
 
+// Counts frames, subframes and bricks while only one frame at a time is held
+// in memory. A background thread parses the next frames in the meantime.
+int StreamFrames(string const& filename)
+{
+  BrickAccessStream stream(filename);
+  if (!stream.Open(2)) {
+    return EXIT_FAILURE;
+  }
+
+  size_t totalFrameCount = 0;
+  size_t totalSubframeCount = 0;
+  size_t totalBrickCount = 0;
+  while (BrickAccessFile::Frame const* frame = stream.NextFrame()) {
+    for (auto subframe=frame->cbegin(); subframe!=frame->cend(); ++subframe) {
+      totalBrickCount += subframe->size();
+      ++totalSubframeCount;
+    }
+    ++totalFrameCount;
+  }
+  if (stream.HasFailed()) {
+    return EXIT_FAILURE;
+  }
+
+  cout << "levels of detail:     " << stream.GetHeader().brickCounts.size() << endl;
+  cout << "total frame count:    " << totalFrameCount << endl;
+  cout << "total subframe count: " << totalSubframeCount << endl;
+  cout << "total brick count:    " << totalBrickCount << endl;
+  return EXIT_SUCCESS;
+}
+
+// Prints every frame as soon as the writer of the file has completed it and
+// stops once the file did not grow for idleSeconds.
+int FollowFrames(string const& filename, uint32_t idleSeconds)
+{
+  BrickAccessFollower follower(filename);
+  if (!follower.Open()) {
+    cerr << "failed to open file " << filename << endl;
+    return EXIT_FAILURE;
+  }
+
+  size_t totalSubframeCount = 0;
+  size_t totalBrickCount = 0;
+  bool const bSuccess = follower.Follow(
+    [&](uint64_t index, BrickAccessFile::Frame const& frame) {
+      size_t brickCount = 0;
+      for (auto subframe=frame.cbegin(); subframe!=frame.cend(); ++subframe)
+        brickCount += subframe->size();
+      cout << "frame " << index << ": " << frame.size() << " subframes, " << brickCount << " bricks" << endl;
+      totalSubframeCount += frame.size();
+      totalBrickCount += brickCount;
+      return true;
+    }, idleSeconds * 1000);
+  if (!bSuccess) {
+    return EXIT_FAILURE;
+  }
+
+  cout << "total frame count:    " << follower.GetFrameCount() << endl;
+  cout << "total subframe count: " << totalSubframeCount << endl;
+  cout << "total brick count:    " << totalBrickCount << endl;
+  return EXIT_SUCCESS;
+}
+
 // Simple example program to demonstrate the BrickAccessFile class and print
 // some values of the loaded file.
 //
@@ -28,17 +96,88 @@ string GetFilename(const std::string& filename)
 // Please see the paper for further details.
 int main(int argc, char const *argv[])
 {
-  if (argc != 2) {
+  BrickAccessFile::LoadMode mode = BrickAccessFile::LM_STREAM;
+  bool streaming = false;
+  bool flat = false;
+  bool arena = false;
+  bool compressed = false;
+  bool headerOnly = false;
+  bool range = false;
+  bool follow = false;
+  bool stats = false;
+  uint32_t idleSeconds = 0;
+  size_t firstFrame = 0;
+  size_t frameCount = 0;
+  int argi = 1;
+  for (; argi < argc-1; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--mapped")
+      mode = BrickAccessFile::LM_MAPPED;
+    else if (flag == "--parallel")
+      mode = BrickAccessFile::LM_PARALLEL;
+    else if (flag == "--streaming")
+      streaming = true;
+    else if (flag == "--flat")
+      flat = true;
+    else if (flag == "--arena")
+      arena = true;
+    else if (flag == "--compressed")
+      compressed = true;
+    else if (flag == "--header")
+      headerOnly = true;
+    else if (flag == "--stats")
+      stats = true;
+    else if (flag == "--range" && argi + 3 < argc) {
+      range = true;
+      firstFrame = size_t(strtoull(argv[++argi], nullptr, 10));
+      frameCount = size_t(strtoull(argv[++argi], nullptr, 10));
+    } else if (flag == "--follow" && argi + 2 < argc) {
+      follow = true;
+      idleSeconds = uint32_t(strtoul(argv[++argi], nullptr, 10));
+    } else
+      break;
+  }
+  if (argi != argc-1) {
     string const arg0(argv[0]);
-    cerr << "usage: " << GetFilename(arg0) << " filename" << endl;
+    cerr << "usage: " << GetFilename(arg0) << " [--mapped|--parallel|--streaming] [--flat|--arena|--compressed] [--header|--range first count|--follow idleSeconds] [--stats] filename" << endl;
     return EXIT_FAILURE;
   }
 
-  string const arg1(argv[1]);
+  string const arg1(argv[argc-1]);
+
+  if (streaming) {
+    return StreamFrames(arg1);
+  }
+
+  if (follow) {
+    return FollowFrames(arg1, idleSeconds);
+  }
 
   BrickAccessFile baf(arg1);
+  if (flat || compressed) {
+    baf.SetStorage(BrickAccessFile::ST_FLAT);
+  } else if (arena) {
+    baf.SetStorage(BrickAccessFile::ST_ARENA);
+  }
+  // without compiled in statistics the notice replaces the table of zeros
+  if (stats && !BrickAccessStats::IsEnabled()) {
+    cerr << "load statistics are compiled out (BRICK_ACCESS_STATS=0)" << endl;
+    stats = false;
+  }
+  BrickAccessStats loadStats;
+  if (stats)
+    baf.SetStats(&loadStats);
 
-  if (!baf.Load()) {
+  // the header only and range loads use the frame index instead of a mode
+  if (headerOnly) {
+    if (!baf.LoadHeader()) {
+      return EXIT_FAILURE;
+    }
+  } else if (range) {
+    if (!baf.LoadFrames(firstFrame, frameCount)) {
+      return EXIT_FAILURE;
+    }
+  } else if (!baf.Load(mode)) {
     return EXIT_FAILURE;
   }
 
@@ -65,20 +204,58 @@ int main(int argc, char const *argv[])
   // You might want to use this data, for example to benchmark your own data
   // structures with real world data indices provided at our supplementary
   // material webpage.
-  for (auto frame=baf.GetFrames().cbegin(); frame!=baf.GetFrames().cend(); ++frame) {
-    for (auto subframe=frame->cbegin(); subframe!=frame->cend(); ++subframe) {
-      for (auto brick=subframe->cbegin(); brick!=subframe->cend(); ++brick) {
-        ++totalBrickCount;
+  if (compressed) {
+    // the compressed trace decodes one frame at a time into reused buffers
+    BrickAccessCompressedTrace compressedTrace;
+    compressedTrace.Compress(baf);
+    BrickAccessCompressedTrace::Decoder decoder(compressedTrace);
+    while (decoder.NextFrame()) {
+      totalSubframeCount += decoder.GetSubframeCount();
+      totalBrickCount += decoder.GetFrame().size();
+      ++totalFrameCount;
+    }
+    cout << "flat trace bytes:       " << baf.GetTrace().GetMemoryUsage() << endl;
+    cout << "compressed trace bytes: " << compressedTrace.GetMemoryUsage() << endl;
+  } else if (flat) {
+    // the flat storage offers the same data as one contiguous array
+    BrickAccessTrace const& trace = baf.GetTrace();
+    totalFrameCount = trace.GetFrameCount();
+    totalSubframeCount = trace.GetTotalSubframeCount();
+    for (size_t f=0; f<trace.GetFrameCount(); ++f) {
+      BrickAccessTrace::Bricks const bricks = trace.GetFrame(f);
+      totalBrickCount += bricks.size();
+    }
+  } else if (arena) {
+    // the arena storage offers every subframe as a view into its blocks
+    BrickAccessArena const& bricks = baf.GetArena();
+    totalFrameCount = bricks.GetFrameCount();
+    for (size_t f=0; f<bricks.GetFrameCount(); ++f) {
+      for (size_t s=0; s<bricks.GetSubframeCount(f); ++s)
+        totalBrickCount += bricks.GetSubframe(f, s).size();
+      totalSubframeCount += bricks.GetSubframeCount(f);
+    }
+    cout << "arena blocks:         " << bricks.GetBlockCount() << " (" << bricks.GetMemoryUsage() << " bytes)" << endl;
+  } else {
+    for (auto frame=baf.GetFrames().cbegin(); frame!=baf.GetFrames().cend(); ++frame) {
+      for (auto subframe=frame->cbegin(); subframe!=frame->cend(); ++subframe) {
+        for (auto brick=subframe->cbegin(); brick!=subframe->cend(); ++brick) {
+          ++totalBrickCount;
+        }
+        ++totalSubframeCount;
       }
-      ++totalSubframeCount;
+      ++totalFrameCount;
     }
-    ++totalFrameCount;
   }
 
   cout << "total frame count:    " << totalFrameCount << endl;
   cout << "total subframe count: " << totalSubframeCount << endl;
   cout << "total brick count:    " << totalBrickCount << endl;
 
+  if (stats) {
+    cout << "load statistics:" << endl;
+    loadStats.Print(cout);
+  }
+
   return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,139 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadCount)
+  : m_pTask(nullptr)
+  , m_iTaskCount(0)
+  , m_iNextTask(0)
+  , m_iActiveWorkers(0)
+  , m_iGeneration(0)
+  , m_bShutdown(false)
+{
+  if (threadCount == 0)
+    threadCount = GetHardwareThreadCount();
+  for (size_t i=1; i<threadCount; ++i)
+    m_Threads.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bShutdown = true;
+  }
+  m_WakeUp.notify_all();
+  for (size_t i=0; i<m_Threads.size(); ++i)
+    m_Threads[i].join();
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+  return m_Threads.size() + 1;
+}
+
+size_t ThreadPool::GetHardwareThreadCount()
+{
+  size_t const count = std::thread::hardware_concurrency();
+  return count > 0 ? count : 1;
+}
+
+void ThreadPool::ParallelFor(size_t count, std::function<void(size_t)> const& task)
+{
+  ParallelForThreads(count, [&task](size_t i, size_t) { task(i); });
+}
+
+void ThreadPool::ParallelForThreads(size_t count, std::function<void(size_t, size_t)> const& task)
+{
+  if (count == 0)
+    return;
+  if (m_Threads.empty() || count == 1) {
+    for (size_t i=0; i<count; ++i)
+      task(i, 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_pTask = &task;
+    m_iTaskCount = count;
+    m_iNextTask = 0;
+    m_iActiveWorkers = m_Threads.size();
+    m_Exception = std::exception_ptr();
+    ++m_iGeneration;
+  }
+  m_WakeUp.notify_all();
+
+  RunTasks(0);
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (m_iActiveWorkers > 0)
+      m_Done.wait(lock);
+    m_pTask = nullptr;
+    exception = m_Exception;
+    m_Exception = std::exception_ptr();
+  }
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
+void ThreadPool::WorkerMain(size_t thread)
+{
+  uint64_t iGeneration = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      while (!m_bShutdown && m_iGeneration == iGeneration)
+        m_WakeUp.wait(lock);
+      if (m_bShutdown)
+        return;
+      iGeneration = m_iGeneration;
+    }
+
+    RunTasks(thread);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (--m_iActiveWorkers == 0)
+      m_Done.notify_all();
+  }
+}
+
+void ThreadPool::RunTasks(size_t thread)
+{
+  for (;;) {
+    size_t const i = m_iNextTask++;
+    if (i >= m_iTaskCount)
+      return;
+    try {
+      (*m_pTask)(i, thread);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (!m_Exception)
+        m_Exception = std::current_exception();
+    }
+  }
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
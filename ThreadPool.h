@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads to process independent tasks in parallel. The
+// calling thread takes part in the work, so a pool with a thread count of one
+// runs everything on the caller without any synchronization.
+class ThreadPool {
+public:
+  // @param threadCount is the number of threads working on tasks including
+  //   the calling thread. Zero uses all hardware threads.
+  explicit ThreadPool(size_t threadCount = 0);
+  ~ThreadPool();
+
+  // @returns the number of threads working on tasks including the caller.
+  size_t GetThreadCount() const;
+
+  // Calls task(i) for every i in [0, count) and blocks until all calls have
+  // finished. Tasks are handed out dynamically, so tasks with very different
+  // run times are balanced across the threads. The first exception thrown by
+  // a task is rethrown after all tasks have finished. Must not be called
+  // concurrently or from within a task.
+  void ParallelFor(size_t count, std::function<void(size_t)> const& task);
+
+  // Like ParallelFor(), but also passes the index of the executing thread in
+  // [0, GetThreadCount()), the caller being thread zero. Tasks can use it to
+  // reuse per thread buffers without any locking.
+  void ParallelForThreads(size_t count, std::function<void(size_t task, size_t thread)> const& task);
+
+  // @returns the number of hardware threads, at least one.
+  static size_t GetHardwareThreadCount();
+
+private:
+  // Pools own their threads, copying is not supported.
+  ThreadPool(ThreadPool const&);
+  ThreadPool& operator=(ThreadPool const&);
+
+  void WorkerMain(size_t thread);
+  void RunTasks(size_t thread);
+
+  std::vector<std::thread> m_Threads;
+  std::mutex m_Mutex;
+  std::condition_variable m_WakeUp;
+  std::condition_variable m_Done;
+  std::function<void(size_t, size_t)> const* m_pTask;
+  size_t m_iTaskCount;
+  std::atomic<size_t> m_iNextTask;
+  size_t m_iActiveWorkers;
+  uint64_t m_iGeneration;
+  std::exception_ptr m_Exception;
+  bool m_bShutdown;
+};
+
+#endif // THREAD_POOL_H
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "BrickAccessTransform.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace {
+
+  string GetFilename(const std::string& filename)
+  {
+    size_t index = std::max(size_t(filename.find_last_of("\\")), size_t(filename.find_last_of("/")))+1;
+    string name = filename.substr(index,filename.length()-index);
+    return name;
+  }
+
+  int Usage(char const* arg0)
+  {
+    cerr << "usage: " << GetFilename(arg0) << " [--frames first count] [--every n] [--lods min max]"
+      " [--coarsen lod]" << endl;
+    cerr << "       [--merge-subframes n] [--dedup] [--prefetch frames] input.ba output.ba" << endl;
+    cerr << "stages run in the order given, --merge-subframes 0 merges all subframes of a frame" << endl;
+    return EXIT_FAILURE;
+  }
+
+}
+
+// Rewrites a brick access file through a pipeline of frame slicing,
+// subsampling, LoD filtering and coarsening, subframe merging and
+// deduplication, see BrickAccessTransform. The trace is streamed, so files of
+// any size take constant memory.
+int main(int argc, char const *argv[])
+{
+  BrickAccessTransform transform;
+  size_t prefetchFrames = 4;
+  int argi = 1;
+  for (; argi < argc-2; ++argi) {
+    string const flag(argv[argi]);
+    if (flag == "--frames" && argi+2 < argc-2) {
+      uint64_t const first = strtoull(argv[++argi], nullptr, 10);
+      uint64_t const count = strtoull(argv[++argi], nullptr, 10);
+      transform.AddStage(BrickAccessTransform::Slice(first, count));
+    } else if (flag == "--every" && argi+1 < argc-2) {
+      transform.AddStage(BrickAccessTransform::Subsample(strtoull(argv[++argi], nullptr, 10)));
+    } else if (flag == "--lods" && argi+2 < argc-2) {
+      uint32_t const minLoD = uint32_t(strtoul(argv[++argi], nullptr, 10));
+      uint32_t const maxLoD = uint32_t(strtoul(argv[++argi], nullptr, 10));
+      transform.AddStage(BrickAccessTransform::FilterLoDs(minLoD, maxLoD));
+    } else if (flag == "--coarsen" && argi+1 < argc-2) {
+      transform.AddStage(BrickAccessTransform::CoarsenLoDs(uint32_t(strtoul(argv[++argi], nullptr, 10))));
+    } else if (flag == "--merge-subframes" && argi+1 < argc-2) {
+      transform.AddStage(BrickAccessTransform::MergeSubframes(strtoull(argv[++argi], nullptr, 10)));
+    } else if (flag == "--dedup") {
+      transform.AddStage(BrickAccessTransform::Deduplicate());
+    } else if (flag == "--prefetch" && argi+1 < argc-2) {
+      prefetchFrames = size_t(strtoul(argv[++argi], nullptr, 10));
+    } else {
+      break;
+    }
+  }
+  if (argi != argc-2) {
+    return Usage(argv[0]);
+  }
+
+  BrickAccessTransform::Result result;
+  if (!transform.Run(argv[argc-2], argv[argc-1], result, prefetchFrames)) {
+    return EXIT_FAILURE;
+  }
+
+  double const seconds = std::max(result.seconds, 1e-9);
+  cout << "input frames:  " << result.inputFrames << " (" << result.inputBricks << " bricks)" << endl;
+  cout << "output frames: " << result.outputFrames << " (" << result.outputBricks << " bricks)" << endl;
+  cout << "output bytes:  " << result.outputBytes << " (" << double(result.outputBytes) / seconds / 1e6
+    << " MB/s)" << endl;
+  cout << "seconds:       " << result.seconds << endl;
+  return EXIT_SUCCESS;
+}
+
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2013 HPC Group, Duisburg-Essen.
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/